@@ -36,6 +36,7 @@ enum EMessageTypes {
    kMESS_CINT            = 5,            //cint command follows
    kMESS_STREAMERINFO    = 6,            //TStreamerInfo object follows
    kMESS_PROCESSID       = 7,            //TProcessID object follows
+   kMESS_SHMUPLOAD       = 8,            //TParallelMergingFile upload in a shared memory file follows
 
    //---- PROOF message opcodes (1000 - 1999)
    kPROOF_GROUPVIEW      = 1000,         //groupview follows
@@ -5092,6 +5092,96 @@ Bool_t TH1::SameLimitsAndNBins(const TAxis& axis1, const TAxis& axis2)
       return kFALSE;
 }
 
+//______________________________________________________________________________
+static Bool_t SameBinning(TAxis &axis1, TAxis &axis2)
+{
+   // Return true if both axis have the same bin edges and no labels.
+
+   if (axis1.GetLabels() || axis2.GetLabels()) return kFALSE;
+   if (axis1.GetNbins() != axis2.GetNbins()
+       || axis1.GetXmin() != axis2.GetXmin()
+       || axis1.GetXmax() != axis2.GetXmax()) return kFALSE;
+   const TArrayD *bins1 = axis1.GetXbins();
+   const TArrayD *bins2 = axis2.GetXbins();
+   if (bins1->fN != bins2->fN) return kFALSE;
+   return bins1->fN == 0 || memcmp(bins1->fArray, bins2->fArray, bins1->fN*sizeof(Double_t)) == 0;
+}
+
+//______________________________________________________________________________
+template <typename T>
+static void AddArray(T *to, const T *from, Int_t n)
+{
+   // Add the n elements of from to those of to.
+
+   for (Int_t i = 0; i < n; ++i) to[i] += from[i];
+}
+
+//______________________________________________________________________________
+Bool_t TH1::MergeSameBinning(TCollection *li)
+{
+   // Fast path of Merge for the common case where all the histograms in
+   // the collection are of the same class as this one and have exactly
+   // the same binning, without labels nor pending buffers. The bin
+   // contents, errors and statistics are then added in a single pass
+   // over the bin arrays, without any check or lookup per bin.
+   // Returns kFALSE, leaving this histogram untouched, if the condition
+   // is not met, in which case the general algorithm must be used.
+
+   if (fXaxis.GetXmin() >= fXaxis.GetXmax()) return kFALSE;
+   if (fBuffer && fBuffer[0]) return kFALSE;
+   TIter next(li);
+   TObject *obj;
+   while ((obj = next())) {
+      if (obj->IsA() != IsA()) return kFALSE;
+      TH1 *h = (TH1*)obj;
+      if (h->fBuffer && h->fBuffer[0]) return kFALSE;
+      if (!SameBinning(fXaxis, h->fXaxis)) return kFALSE;
+      if (fDimension > 1 && !SameBinning(fYaxis, h->fYaxis)) return kFALSE;
+      if (fDimension > 2 && !SameBinning(fZaxis, h->fZaxis)) return kFALSE;
+   }
+
+   Double_t stats[kNstat], totstats[kNstat];
+   for (Int_t i=0;i<kNstat;i++) {totstats[i] = stats[i] = 0;}
+   GetStats(totstats);
+   Double_t nentries = GetEntries();
+
+   TArrayD *contD = dynamic_cast<TArrayD*>(this);
+   TArrayF *contF = contD ? 0 : dynamic_cast<TArrayF*>(this);
+   next.Reset();
+   while ((obj = next())) {
+      TH1 *h = (TH1*)obj;
+      h->GetStats(stats);
+      for (Int_t i=0;i<kNstat;i++) totstats[i] += stats[i];
+      nentries += h->GetEntries();
+
+      if (contD) {
+         AddArray(contD->fArray, dynamic_cast<TArrayD*>(h)->fArray, fNcells);
+      } else if (contF) {
+         AddArray(contF->fArray, dynamic_cast<TArrayF*>(h)->fArray, fNcells);
+      } else {
+         for (Int_t bin = 0; bin < fNcells; ++bin) {
+            Double_t cu = h->GetBinContent(bin);
+            if (cu != 0) AddBinContent(bin, cu);
+         }
+      }
+      if (fSumw2.fN) {
+         if (h->fSumw2.fN) {
+            AddArray(fSumw2.fArray, h->fSumw2.fArray, fNcells);
+         } else {
+            for (Int_t bin = 0; bin < fNcells; ++bin) {
+               Double_t error = h->GetBinError(bin);
+               fSumw2.fArray[bin] += error*error;
+            }
+         }
+      }
+   }
+
+   //copy merged stats
+   PutStats(totstats);
+   SetEntries(nentries);
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 Bool_t TH1::RecomputeAxisLimits(TAxis& destAxis, const TAxis& anAxis)
 {
@@ -5192,6 +5282,7 @@ Long64_t TH1::Merge(TCollection *li)
 
    if (!li) return 0;
    if (li->IsEmpty()) return (Long64_t) GetEntries();
+   if (MergeSameBinning(li)) return (Long64_t) GetEntries();
 
    // is this really needed ?
    TList inlist;
@@ -1444,6 +1444,7 @@ Long64_t TH2::Merge(TCollection *list)
 
    if (!list) return 0;
    if (list->IsEmpty()) return (Long64_t) GetEntries();
+   if (MergeSameBinning(list)) return (Long64_t) GetEntries();
 
    TList inlist;
    inlist.AddAll(list);
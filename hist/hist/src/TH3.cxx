@@ -1477,6 +1477,7 @@ Long64_t TH3::Merge(TCollection *list)
 
    if (!list) return 0;
    if (list->IsEmpty()) return (Long64_t) GetEntries();
+   if (MergeSameBinning(list)) return (Long64_t) GetEntries();
 
    TList inlist;
    inlist.AddAll(list);
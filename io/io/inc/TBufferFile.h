@@ -42,7 +42,7 @@ class TVirtualStreamerInfo;
 class TStreamerInfo;
 class TStreamerElement;
 class TClass;
-class TExMap;
+class TBufferFileMap;
 class TVirtualArray;
 namespace TStreamerInfoActions {
    class TActionSequence;
@@ -57,8 +57,7 @@ protected:
    Int_t           fMapSize;       //Default size of map
    Int_t           fDisplacement;  //Value to be added to the map offsets
    UShort_t        fPidOffset;     //Offset to be added to the pid index in this key/buffer.
-   TExMap         *fMap;           //Map containing object,offset pairs for reading/writing
-   TExMap         *fClassMap;      //Map containing object,class pairs for reading
+   TBufferFileMap *fMap;           //Map containing object,offset pairs for writing, offset,object,class for reading
    TStreamerInfo  *fInfo;          //Pointer to TStreamerInfo object writing/reading the buffer
    InfoList_t      fInfoStack;     //Stack of pointers to the TStreamerInfos
 
@@ -66,7 +65,7 @@ protected:
 
    // Default ctor
    TBufferFile() : TBuffer(), fMapCount(0), fMapSize(0),
-               fDisplacement(0),fPidOffset(0), fMap(0), fClassMap(0),
+               fDisplacement(0),fPidOffset(0), fMap(0),
      fInfo(0), fInfoStack() {}
 
    // TBuffer objects cannot be copied or assigned
@@ -0,0 +1,78 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TBufferFileMap
+#define ROOT_TBufferFileMap
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TBufferFileMap                                                       //
+//                                                                      //
+// The map used by TBufferFile to keep track of the objects and classes //
+// already streamed. It associates a key (an object address when        //
+// writing, a buffer offset when reading) with a value and an extra     //
+// value (the class of the object when reading).                        //
+// The table uses open addressing with linear probing on a power of 2   //
+// number of slots. Clearing the map only bumps a generation counter,   //
+// so that a buffer can be reused for many objects without touching    //
+// the whole table each time.                                           //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ROOT_Rtypes
+#include "Rtypes.h"
+#endif
+
+class TBufferFileMap {
+
+private:
+   struct Slot_t {
+      Long64_t   fKey;
+      Long64_t   fValue;
+      Long64_t   fExtra;
+      UInt_t     fGeneration;   // slot is in use when equal to the map's generation
+   };
+
+   Slot_t     *fTable;        // [fCapacity] slots
+   UInt_t      fCapacity;     // number of slots (power of 2)
+   Int_t       fShift;        // 64 - log2(fCapacity)
+   Int_t       fTally;        // number of slots in use
+   UInt_t      fGeneration;   // current generation, never 0
+
+   TBufferFileMap(const TBufferFileMap&);            // Not implemented.
+   TBufferFileMap &operator=(const TBufferFileMap&); // Not implemented.
+
+   UInt_t      Home(Long64_t key) const;
+   Bool_t      InUse(UInt_t slot) const { return fTable[slot].fGeneration == fGeneration; }
+   UInt_t      FindSlot(Long64_t key) const;
+   void        Allocate(UInt_t capacity);
+
+public:
+   TBufferFileMap(Int_t mapSize = 503);
+   ~TBufferFileMap();
+
+   void        Add(Long64_t key, Long64_t value, Long64_t extra = 0);
+   void        AddAt(UInt_t slot, Long64_t key, Long64_t value, Long64_t extra = 0);
+   Int_t       Capacity() const { return fCapacity; }
+   void        Clear();
+   void        Expand(Int_t newsize);
+   Int_t       GetSize() const { return fTally; }
+   Long64_t    GetValue(Long64_t key) const;
+   Long64_t    GetValue(Long64_t key, UInt_t &slot) const;
+   Bool_t      GetValues(Long64_t key, Long64_t &value, Long64_t &extra) const;
+   void        Remove(Long64_t key);
+   void        Reserve(Int_t size);
+
+   static UInt_t CapacityFor(Int_t size);
+};
+
+#endif
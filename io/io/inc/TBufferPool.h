@@ -0,0 +1,56 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TBufferPool
+#define ROOT_TBufferPool
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TBufferPool                                                          //
+//                                                                      //
+// A process wide pool of I/O buffer storage. Buffers are handed out in //
+// power of 2 size classes (4 kB to 64 MB) and kept on a free list per  //
+// class when released, up to a total of GetMaxPooledSize() bytes.      //
+// It is used by TKey, TBasket and TTreeCacheUnzip for the transient    //
+// buffers holding compressed and uncompressed records, which otherwise //
+// cause a lot of allocation churn in long running jobs.                //
+//                                                                      //
+// Memory obtained with Acquire must be given back with Release (never  //
+// with delete []). A TBuffer created by NewBuffer uses the pool to     //
+// expand and must be deleted with DeleteBuffer.                        //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ROOT_TBuffer
+#include "TBuffer.h"
+#endif
+
+class TBufferPool {
+
+private:
+   TBufferPool();  // Not implemented, only static members.
+
+public:
+   static char     *Acquire(Int_t size);
+   static Int_t     Capacity(const char *buffer);
+   static void      DeleteBuffer(TBuffer *buffer);
+   static Long64_t  GetMaxPooledSize();
+   static Long64_t  GetPooledSize();
+   static Bool_t    IsPooled(const TBuffer *buffer);
+   static TBuffer  *NewBuffer(TBuffer::EMode mode, Int_t size);
+   static char     *ReAlloc(char *buffer, size_t newsize, size_t oldsize);
+   static void      Release(char *buffer);
+   static void      ReleaseBuffer(TBuffer *buffer);
+   static void      SetMaxPooledSize(Long64_t size);
+};
+
+#endif
@@ -45,9 +45,23 @@ protected:
    Long64_t    fSeekKeys;        //Location of Keys record on file
    TFile      *fFile;            //pointer to current file in memory
    TList      *fKeys;            //Pointer to keys list in memory
+   char       *fKeysBuffer;      //! Key list record while its keys are loaded lazily
+   Char_t     *fKeysPages;       //! Flags of the pages of fKeysBuffer already read
+   Int_t       fNkeysLazy;       //! Number of keys in fKeysBuffer, 0 if all keys are in fKeys
+   UInt_t     *fKeysHash;        //! [fNkeysLazy] Sorted hashes of the key names
+   Int_t      *fKeysOffset;      //! [fNkeysLazy] Offsets of the key headers in fKeysBuffer
+   TKey      **fKeysLoaded;      //! [fNkeysLazy] Keys created so far, 0 if not yet created
+
+   static Bool_t fgLazyKeys;     //True if the keys of read-only directories are loaded on demand
 
    virtual void         CleanTargets();
    void Init(TClass *cl = 0);
+   TKey                *LookupKey(const char *name, Short_t cycle, Bool_t exact) const;
+   TKey                *LoadLazyKey(Int_t i, Long64_t fsize);
+   void                 LoadAllKeys();
+   Bool_t               ReadKeysPages(Int_t pos, Int_t len);
+   Int_t                ReadKeysLazy();
+   void                 ReleaseLazyKeys();
 
 private:
    TDirectoryFile(const TDirectoryFile &directory);  //Directories cannot be copied
@@ -88,13 +102,14 @@ public:
    const TDatime      &GetCreationDate() const { return fDatimeC; }
    virtual TFile      *GetFile() const { return fFile; }
    virtual TKey       *GetKey(const char *name, Short_t cycle=9999) const;
-   virtual TList      *GetListOfKeys() const { return fKeys; }
+   virtual TList      *GetListOfKeys() const;
    const TDatime      &GetModificationDate() const { return fDatimeM; }
    virtual Int_t       GetNbytesKeys() const { return fNbytesKeys; }
-   virtual Int_t       GetNkeys() const { return fKeys->GetSize(); }
+   virtual Int_t       GetNkeys() const { return fNkeysLazy ? fNkeysLazy : fKeys->GetSize(); }
    virtual Long64_t    GetSeekDir() const { return fSeekDir; }
    virtual Long64_t    GetSeekParent() const { return fSeekParent; }
    virtual Long64_t    GetSeekKeys() const { return fSeekKeys; }
+   Bool_t              IsLazy() const { return fNkeysLazy != 0; }
    Bool_t              IsModified() const { return fModified; }
    Bool_t              IsWritable() const { return fWritable; }
    virtual void        ls(Option_t *option="") const;
@@ -105,6 +120,7 @@ public:
    virtual void        Purge(Short_t nkeep=1);
    virtual void        ReadAll(Option_t *option="");
    virtual Int_t       ReadKeys(Bool_t forceRead=kTRUE);
+           Int_t       ReadObjects(Int_t n, const char **namecycles, TObject **objects, Int_t nthreads = -1);
    virtual Int_t       ReadTObject(TObject *obj, const char *keyname);
    virtual void        ResetAfterMerge(TFileMergeInfo *);
    virtual void        rmdir(const char *name);
@@ -116,6 +132,8 @@ public:
    void                SetSeekDir(Long64_t v) { fSeekDir = v; }
    virtual void        SetTRefAction(TObject *ref, TObject *parent);
    void                SetWritable(Bool_t writable=kTRUE);
+   static void         SetLazyKeys(Bool_t lazy=kTRUE);
+   static Bool_t       GetLazyKeys();
    virtual Int_t       Sizeof() const;
    virtual Int_t       Write(const char *name=0, Int_t opt=0, Int_t bufsize=0);
    virtual Int_t       Write(const char *name=0, Int_t opt=0, Int_t bufsize=0) const ;
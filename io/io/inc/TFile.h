@@ -44,6 +44,7 @@ class TFilePrefetch;
 class TFile : public TDirectoryFile {
   friend class TDirectoryFile;
   friend class TFilePrefetch;
+  friend class TFileCacheWrite;
 
 public:
    // Asynchronous open request status
@@ -90,6 +91,7 @@ protected:
    Bool_t           fIsRootFile;     //!True is this is a ROOT file, raw file otherwise
    Bool_t           fInitDone;       //!True if the file has been initialized
    Bool_t           fMustFlush;      //!True if the file buffers must be flushed
+   Bool_t           fInfoPending;    //!True if the reading of the StreamerInfo record has been deferred
    TFileOpenHandle *fAsyncHandle;    //!For proper automatic cleanup
    EAsyncOpenStatus fAsyncOpenStatus; //!Status of an asynchronous open request
    TUrl             fUrl;            //!URL of file
@@ -110,10 +112,12 @@ protected:
    static Int_t     fgReadCalls;             //Number of bytes read from all TFile objects
    static Int_t     fgReadaheadSize;         //Readahead buffer size
    static Bool_t    fgReadInfo;              //if true (default) ReadStreamerInfo is called when opening a file
+   static Bool_t    fgReadInfoOnDemand;      //if true ReadStreamerInfo is deferred for read-only files until a class needs it
 
    virtual EAsyncOpenStatus GetAsyncOpenStatus() { return fAsyncOpenStatus; }
    virtual void  Init(Bool_t create);
    Bool_t        FlushWriteCache();
+   TList        *GetStreamerInfoListImpl(TString *payload, Bool_t &known);
    Int_t         ReadBufferViaCache(char *buf, Int_t len);
    Int_t         WriteBufferViaCache(const char *buf, Int_t len);
 
@@ -215,6 +219,7 @@ public:
    virtual Bool_t      IsArchive() const { return fIsArchive; }
            Bool_t      IsBinary() const { return TestBit(kBinaryFile); }
            Bool_t      IsRaw() const { return !fIsRootFile; }
+           Bool_t      IsStreamerInfoPending() const { return fInfoPending; }
    virtual Bool_t      IsOpen() const;
    virtual void        ls(Option_t *option="") const;
    virtual void        MakeFree(Long64_t first, Long64_t last);
@@ -231,6 +236,7 @@ public:
    virtual Bool_t      ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf);
    virtual void        ReadFree();
    virtual TProcessID *ReadProcessID(UShort_t pidf);
+           Bool_t      ReadPendingStreamerInfo();
    virtual void        ReadStreamerInfo();
    virtual Int_t       Recover();
    virtual Int_t       ReOpen(Option_t *mode);
@@ -264,6 +270,7 @@ public:
                             const char *ftitle = "", Int_t compress = 1,
                             Int_t netopt = 0);
    static TFile       *Open(TFileOpenHandle *handle);
+   static void         CancelAsyncOpen(TFileOpenHandle *handle);
 
    static EFileType    GetType(const char *name, Option_t *option = "", TString *prefix = 0);
 
@@ -281,6 +288,8 @@ public:
    static void         SetFileReadCalls(Int_t readcalls = 0);
    static void         SetReadaheadSize(Int_t bufsize = 256000);
    static void         SetReadStreamerInfo(Bool_t readinfo=kTRUE);
+   static void         SetReadStreamerInfoOnDemand(Bool_t ondemand=kTRUE);
+   static Bool_t       GetReadStreamerInfoOnDemand();
 
    static Long64_t     GetFileCounter();
    static void         IncrementFileCounter();
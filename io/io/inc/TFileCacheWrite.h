@@ -26,6 +26,9 @@
 #endif
 
 class TFile;
+class TThread;
+class TMutex;
+class TCondition;
 
 class TFileCacheWrite : public TObject {
 
@@ -36,6 +39,23 @@ protected:
    TFile        *fFile;           //Pointer to file
    char         *fBuffer;         //[fBufferSize] buffer of contiguous prefetched blocks
    Bool_t        fRecursive;      //flag to avoid recursive calls
+   Bool_t        fWriteBehind;    //! True if full buffers are written by the I/O thread
+   char         *fSpare;          //! Second buffer, filled while the other one is being written
+   Int_t         fInFlight;       //! Number of bytes handed to the I/O thread, not yet accounted
+   char         *fPending;        //! Buffer to be written by the I/O thread
+   Long64_t      fPendingSeek;    //! Position (in the file descriptor) of fPending
+   Int_t         fPendingLen;     //! Length of fPending, 0 when the I/O thread is idle
+   Int_t         fPendingFd;      //! File descriptor to write fPending to
+   Int_t         fAsyncErrno;     //! errno of the last failed asynchronous write, 0 if none
+   Bool_t        fStop;           //! Request the I/O thread to exit
+   TThread      *fThread;         //! I/O thread
+   TMutex       *fMutex;          //! Protects the fPending*, fAsyncErrno and fStop members
+   TCondition   *fCondition;      //! Signals a new write and its completion
+
+   Bool_t        CanWriteBehind() const;
+   Bool_t        FlushBehind();
+
+   static void  *WriteBehindLoop(void *arg);
 
 private:
    TFileCacheWrite(const TFileCacheWrite &);            //cannot be copied
@@ -46,13 +66,16 @@ public:
    TFileCacheWrite(TFile *file, Int_t buffersize);
    virtual ~TFileCacheWrite();
    virtual Bool_t      Flush();
-   virtual Int_t       GetBytesInCache() const { return fNtot; }
+   virtual Int_t       GetBytesInCache() const { return fNtot + fInFlight; }
+   Bool_t              IsWriteBehind() const { return fWriteBehind; }
    virtual void        Print(Option_t *option="") const;
    virtual Int_t       ReadBuffer(char *buf, Long64_t pos, Int_t len);
    virtual Int_t       WriteBuffer(const char *buf, Long64_t pos, Int_t len);
    virtual void        SetFile(TFile *file);
+   Bool_t              SetWriteBehind(Bool_t on = kTRUE);
+   Bool_t              WaitForWrite();
 
-   ClassDef(TFileCacheWrite,1)  //TFile cache when writing
+   ClassDef(TFileCacheWrite,2)  //TFile cache when writing
 };
 
 #endif
@@ -54,6 +54,8 @@ protected:
    TString        fOutputFilename;   // the name of the outputfile for merging
    Bool_t         fFastMethod;       // True if using Fast merging algorithm (default)
    Bool_t         fNoTrees;          // True if Trees should not be merged (default is kFALSE)
+   Long64_t       fClusterSize;      // Size of the TTree clusters when fast merging, 0 to keep the input ones (default)
+   TString        fAccessProfile;    // Access profile used to size the clusters and baskets of the output TTrees (default none)
    Bool_t         fExplicitCompLevel;// True if the user explicitly requested a compressio level change (default kFALSE)
    Bool_t         fCompressionChange;// True if the output and input have different compression level (default kFALSE)
    Int_t          fPrintLevel;       // How much information to print out at run time.
@@ -118,9 +120,11 @@ public:
    virtual Bool_t PartialMerge(Int_t type = kAll | kIncremental);
    virtual void   SetFastMethod(Bool_t fast=kTRUE)  {fFastMethod = fast;}
    virtual void   SetNotrees(Bool_t notrees=kFALSE) {fNoTrees = notrees;}
+   virtual void   SetClusterSize(Long64_t size=0)   {fClusterSize = size;}
+   virtual void   SetAccessProfile(const char *profile = "") {fAccessProfile = profile;}
    virtual void        RecursiveRemove(TObject *obj);
 
-   ClassDef(TFileMerger,5)  // File copying and merging services
+   ClassDef(TFileMerger,7)  // File copying and merging services
 };
 
 #endif
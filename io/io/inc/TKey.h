@@ -65,6 +65,7 @@ protected:
    virtual void     Create(Int_t nbytes, TFile* f = 0);
            void     Build(TDirectory* motherDir, const char* classname, Long64_t filepos);
    virtual void     Reset(); // Currently only for the use of TBasket.
+           Bool_t   ReadFileUnzip(char *dest);
    virtual Int_t    WriteFileKeepBuffer(TFile *f = 0);
 
 
@@ -108,6 +109,7 @@ protected:
    virtual Int_t       Read(TObject *obj);
    virtual TObject    *ReadObj();
    virtual TObject    *ReadObjWithBuffer(char *bufferRead);
+           TObject    *ReadObjWithUnzippedBuffer(char *buffer);
    virtual void       *ReadObjectAny(const TClass *expectedClass);
    virtual void        ReadBuffer(char *&buffer);
            void        ReadKeyBuffer(char *&buffer);
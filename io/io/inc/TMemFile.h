@@ -76,6 +76,7 @@ public:
    virtual Long64_t CopyTo(void *to, Long64_t maxsize) const;
    virtual void     CopyTo(TBuffer &tobuf) const;
    virtual Long64_t GetSize() const;
+   Long64_t         WriteTo(Int_t fd) const;
 
    void ResetAfterMerge(TFileMergeInfo *);
    void ResetErrno() const;
@@ -0,0 +1,93 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TSharedMapFile
+#define ROOT_TSharedMapFile
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TSharedMapFile                                                       //
+//                                                                      //
+// A shared memory object store for live objects (typically histograms  //
+// filled by a producer and looked at by online monitors). Like         //
+// TMapFile, objects are registered with Add() and copied, streamed,    //
+// into shared memory by Update(); consumer processes get a fresh copy  //
+// with Get(). Unlike TMapFile the region does not need a fixed map     //
+// address, grows as needed, and readers never block the writer: every  //
+// object is protected by its own sequence counter and a reader simply  //
+// retries its copy when the object was being updated meanwhile.        //
+// There must be a single writer process per store.                     //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ROOT_TObject
+#include "TObject.h"
+#endif
+#ifndef ROOT_TString
+#include "TString.h"
+#endif
+
+class TBuffer;
+class TObjArray;
+
+class TSharedMapFile : public TObject {
+
+private:
+   TString     fName;           //Name of the store
+   TString     fPath;           //Path of the shared memory file
+   Int_t       fFd;             //Descriptor of the shared memory file
+   char       *fBase;           //! Start of the mapped region
+   Long64_t    fMapSize;        //Size of the mapped region
+   Bool_t      fWritable;       //TRUE if opened by the writer
+   TObjArray  *fObjects;        //! Objects added by the writer, indexed by record
+   TBuffer    *fBuffer;         //! Buffer used to stream objects
+
+   TSharedMapFile(const TSharedMapFile&);            // Not implemented.
+   TSharedMapFile &operator=(const TSharedMapFile&); // Not implemented.
+
+   TSharedMapFile(const char *name, const char *path, Int_t fd, Bool_t writable);
+
+   Int_t         FindRecord(const char *name) const;
+   Bool_t        Grow(Long64_t needed);
+   Bool_t        Init(Int_t maxobjects, Long64_t size);
+   Bool_t        Map(Long64_t size);
+   Bool_t        Remap() const;
+   void          UpdateRecord(Int_t index);
+
+public:
+   enum { kDefaultMaxObjects = 1024, kDefaultSize = 0x100000 }; // 1 MB
+
+   TSharedMapFile();
+   virtual ~TSharedMapFile();
+
+   void          Add(const TObject *obj, const char *name = "");
+   void          Close(Option_t *option = "");
+   TObject      *Get(const char *name, TObject *retObj = 0);
+   const char   *GetName() const { return fName; }
+   Int_t         GetNobjects() const;
+   const char   *GetPath() const { return fPath; }
+   Long64_t      GetSize() const { return fMapSize; }
+   UInt_t        GetVersion(const char *name) const;
+   Bool_t        IsWritable() const { return fWritable; }
+   void          ls(Option_t *option="") const;
+   void          Print(Option_t *option="") const;
+   TObject      *Remove(const char *name);
+   void          Update(TObject *obj = 0);
+
+   static TSharedMapFile *Create(const char *name, Option_t *option="READ", Int_t maxobjects=kDefaultMaxObjects, Long64_t size=kDefaultSize);
+   static TString         GetSharedMemoryPath(const char *name);
+   static Bool_t          Unlink(const char *name);
+
+   ClassDef(TSharedMapFile,0)  // Growable shared memory object store with lock-free readers
+};
+
+#endif
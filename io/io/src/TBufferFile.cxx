@@ -23,7 +23,7 @@
 
 #include "TFile.h"
 #include "TBufferFile.h"
-#include "TExMap.h"
+#include "TBufferFileMap.h"
 #include "TClass.h"
 #include "TProcessID.h"
 #include "TRefTable.h"
@@ -46,6 +46,247 @@
 #include "Bswapcpy.h"
 #endif
 
+#if defined(R__BYTESWAP) && defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(__INTEL_COMPILER) && !defined(__CINT__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#define USE_SIMDSWAP
+#include <immintrin.h>
+#endif
+
+#ifdef R__BYTESWAP
+//______________________________________________________________________________
+//
+// Byte swapping copy kernels used by the array streamers.
+// SwapCopyNN(to, from, n) copies n elements of NN bits from 'from' to 'to',
+// reversing the byte order of each element. Neither pointer has to be
+// aligned. The kernel matching the running CPU (AVX2, SSSE3 or plain C++)
+// is selected on the first call.
+
+typedef void (*SwapCopy_t)(void *to, const void *from, Int_t n);
+
+static inline UShort_t SwapBytes(UShort_t x)
+{
+   return (UShort_t)((x >> 8) | (x << 8));
+}
+
+static inline UInt_t SwapBytes(UInt_t x)
+{
+   return ((x & 0xff000000u) >> 24) | ((x & 0x00ff0000u) >>  8) |
+          ((x & 0x0000ff00u) <<  8) | ((x & 0x000000ffu) << 24);
+}
+
+static inline ULong64_t SwapBytes(ULong64_t x)
+{
+   return ((ULong64_t)SwapBytes((UInt_t)(x & 0xffffffffu)) << 32) |
+           (ULong64_t)SwapBytes((UInt_t)(x >> 32));
+}
+
+template <typename T>
+static inline void SwapCopyScalar(char *to, const char *from, Int_t n)
+{
+   for (Int_t i = 0; i < n; ++i, to += sizeof(T), from += sizeof(T)) {
+      T x;
+      memcpy(&x, from, sizeof(T));
+      x = SwapBytes(x);
+      memcpy(to, &x, sizeof(T));
+   }
+}
+
+template <typename T>
+static void SwapCopyGeneric(void *to, const void *from, Int_t n)
+{
+   SwapCopyScalar<T>((char*)to, (const char*)from, n);
+}
+
+#ifdef USE_BSWAPCPY
+static void SwapCopyAsm16(void *to, const void *from, Int_t n)
+{
+   bswapcpy16(to, from, n);
+}
+
+static void SwapCopyAsm32(void *to, const void *from, Int_t n)
+{
+   bswapcpy32(to, from, n);
+}
+#endif
+
+#ifdef USE_SIMDSWAP
+// pshufb masks reversing the bytes of 2, 4 and 8 byte elements in each 16 byte lane.
+static const unsigned char gSwapMask[3][32] __attribute__((aligned(32))) = {
+   { 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14 },
+   { 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12 },
+   { 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8 }
+};
+
+template <typename T>
+__attribute__((target("ssse3")))
+static void SwapCopySSSE3(void *to, const void *from, Int_t n)
+{
+   char *dst = (char*)to;
+   const char *src = (const char*)from;
+   const __m128i mask = _mm_load_si128((const __m128i*)gSwapMask[sizeof(T)/4]);
+   const Int_t nvec = (Int_t)((n*sizeof(T)) / 16);
+   for (Int_t i = 0; i < nvec; ++i, dst += 16, src += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)src);
+      _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(v, mask));
+   }
+   SwapCopyScalar<T>(dst, src, n - (Int_t)(nvec*16/sizeof(T)));
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static void SwapCopyAVX2(void *to, const void *from, Int_t n)
+{
+   char *dst = (char*)to;
+   const char *src = (const char*)from;
+   const __m256i mask = _mm256_load_si256((const __m256i*)gSwapMask[sizeof(T)/4]);
+   const Int_t nvec = (Int_t)((n*sizeof(T)) / 32);
+   for (Int_t i = 0; i < nvec; ++i, dst += 32, src += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)src);
+      _mm256_storeu_si256((__m256i*)dst, _mm256_shuffle_epi8(v, mask));
+   }
+   Int_t left = n - (Int_t)(nvec*32/sizeof(T));
+   if (left*sizeof(T) >= 16) {
+      const __m128i mask128 = _mm_load_si128((const __m128i*)gSwapMask[sizeof(T)/4]);
+      __m128i v = _mm_loadu_si128((const __m128i*)src);
+      _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(v, mask128));
+      dst += 16;
+      src += 16;
+      left -= (Int_t)(16/sizeof(T));
+   }
+   SwapCopyScalar<T>(dst, src, left);
+}
+#endif
+
+static void SwapCopySelect16(void *to, const void *from, Int_t n);
+static void SwapCopySelect32(void *to, const void *from, Int_t n);
+static void SwapCopySelect64(void *to, const void *from, Int_t n);
+
+static SwapCopy_t gSwapCopy16 = SwapCopySelect16;
+static SwapCopy_t gSwapCopy32 = SwapCopySelect32;
+static SwapCopy_t gSwapCopy64 = SwapCopySelect64;
+
+//______________________________________________________________________________
+static void SwapCopySelect()
+{
+   // Select the byte swapping kernels for the running CPU. All threads
+   // select the same kernels so there is no harm in doing it concurrently.
+
+#ifdef USE_SIMDSWAP
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2")) {
+      gSwapCopy16 = SwapCopyAVX2<UShort_t>;
+      gSwapCopy32 = SwapCopyAVX2<UInt_t>;
+      gSwapCopy64 = SwapCopyAVX2<ULong64_t>;
+      return;
+   }
+   if (__builtin_cpu_supports("ssse3")) {
+      gSwapCopy16 = SwapCopySSSE3<UShort_t>;
+      gSwapCopy32 = SwapCopySSSE3<UInt_t>;
+      gSwapCopy64 = SwapCopySSSE3<ULong64_t>;
+      return;
+   }
+#endif
+#ifdef USE_BSWAPCPY
+   gSwapCopy16 = SwapCopyAsm16;
+   gSwapCopy32 = SwapCopyAsm32;
+#else
+   gSwapCopy16 = SwapCopyGeneric<UShort_t>;
+   gSwapCopy32 = SwapCopyGeneric<UInt_t>;
+#endif
+   gSwapCopy64 = SwapCopyGeneric<ULong64_t>;
+}
+
+static void SwapCopySelect16(void *to, const void *from, Int_t n)
+{
+   SwapCopySelect();
+   (*gSwapCopy16)(to, from, n);
+}
+
+static void SwapCopySelect32(void *to, const void *from, Int_t n)
+{
+   SwapCopySelect();
+   (*gSwapCopy32)(to, from, n);
+}
+
+static void SwapCopySelect64(void *to, const void *from, Int_t n)
+{
+   SwapCopySelect();
+   (*gSwapCopy64)(to, from, n);
+}
+#endif
+
+//______________________________________________________________________________
+static inline void ReadUIntArray(char *&buf, void *to, Int_t n)
+{
+   // Copy n unsigned ints stored in network byte order from buf to 'to'
+   // (which does not need to be aligned) and advance buf.
+
+#ifdef R__BYTESWAP
+   (*gSwapCopy32)(to, buf, n);
+#else
+   memcpy(to, buf, n*sizeof(UInt_t));
+#endif
+   buf += n*sizeof(UInt_t);
+}
+
+//______________________________________________________________________________
+template <typename T>
+static void ReadArrayWithFactor(char *&buf, T *ptr, Int_t n, Double_t factor, Double_t minvalue)
+{
+   // Read n unsigned ints, stored as the scaled value of floats or doubles,
+   // into the storage of ptr and convert them in place. The conversion runs
+   // backwards since T may be wider than UInt_t.
+
+   ReadUIntArray(buf, ptr, n);
+   const char *ints = (const char*)ptr;
+   for (Int_t j = n-1; j >= 0; --j) {
+      UInt_t aint;
+      memcpy(&aint, ints + j*sizeof(UInt_t), sizeof(UInt_t));
+      ptr[j] = (T)(aint/factor + minvalue);
+   }
+}
+
+//______________________________________________________________________________
+template <typename T>
+static void ReadArrayWithNbits(char *&buf, T *ptr, Int_t n, Int_t nbits)
+{
+   // Rebuild n floats stored as their exponent (UChar_t) followed by their
+   // mantissa truncated to nbits (UShort_t), see TBufferFile::WriteFloat16.
+   // The 3 byte records are decoded straight from buf.
+
+   const UChar_t *p = (const UChar_t*)buf;
+   const Int_t manmask = (1<<(nbits+1))-1;
+   const Int_t signbit = 1<<(nbits+1);
+   union {
+      Float_t fFloatValue;
+      Int_t   fIntValue;
+   };
+   for (Int_t i = 0; i < n; ++i, p += 3) {
+      Int_t theMan = (p[1] << 8) | p[2];
+      fIntValue = p[0];
+      fIntValue <<= 23;
+      fIntValue |= (theMan & manmask) << (23-nbits);
+      if (signbit & theMan) fFloatValue = -fFloatValue;
+      ptr[i] = (T)fFloatValue;
+   }
+   buf += 3*n;
+}
+
+//______________________________________________________________________________
+static void ReadFloatArrayAsDouble(char *&buf, Double_t *d, Int_t n)
+{
+   // Read n floats into the storage of d and widen them in place to doubles.
+
+   ReadUIntArray(buf, d, n);
+   const char *floats = (const char*)d;
+   for (Int_t j = n-1; j >= 0; --j) {
+      Float_t afloat;
+      memcpy(&afloat, floats + j*sizeof(Float_t), sizeof(Float_t));
+      d[j] = (Double_t)afloat;
+   }
+}
+
 
 const UInt_t kNullTag           = 0;
 const UInt_t kNewClassTag       = 0xFFFFFFFF;
@@ -61,18 +302,46 @@ Int_t TBufferFile::fgMapSize   = kMapSize;
 
 ClassImp(TBufferFile)
 
+// Number of entries above which the table of a map is not kept when the
+// buffer is reset, unless it was needed again (see ResetMap).
+static const Int_t kMaxRetainedMapSize = 65536;
+
+//______________________________________________________________________________
+static inline void ReadPendingStreamerInfo(TObject *parent, const TClass *cl, Int_t version)
+{
+   // If the StreamerInfo record of the file being read has been deferred
+   // (see TFile::SetReadStreamerInfoOnDemand), read it when version of cl
+   // may only be described there: a version other than the one in memory,
+   // or a class without dictionary.
+
+   if (!parent || !cl) return;
+   if (version == cl->GetClassVersion() && cl->IsLoaded()) return;
+   TFile *file = (TFile*)parent;
+   if (!file->IsStreamerInfoPending()) return;
+   TObjArray *infos = cl->GetStreamerInfos();
+   if (version >= 0 && version < infos->GetSize() && infos->UncheckedAt(version)) return;
+   file->ReadPendingStreamerInfo();
+}
+
 //______________________________________________________________________________
-static inline ULong_t Void_Hash(const void *ptr)
+static inline TStreamerInfo *FindStreamerInfo(TObject *parent, const TClass *cl, UInt_t checksum)
 {
-   // Return hash value for this object.
+   // Return the StreamerInfo of cl with the given checksum, reading the
+   // StreamerInfo record of the file if it has been deferred and may
+   // describe it.
 
-   return TString::Hash(&ptr, sizeof(void*));
+   TStreamerInfo *vinfo = (TStreamerInfo*)cl->FindStreamerInfo(checksum);
+   if (!vinfo && parent && checksum != cl->GetCheckSum()
+       && ((TFile*)parent)->ReadPendingStreamerInfo()) {
+      vinfo = (TStreamerInfo*)cl->FindStreamerInfo(checksum);
+   }
+   return vinfo;
 }
 
 //______________________________________________________________________________
 TBufferFile::TBufferFile(TBuffer::EMode mode)
             :TBuffer(mode),
-             fDisplacement(0),fPidOffset(0), fMap(0), fClassMap(0),
+             fDisplacement(0),fPidOffset(0), fMap(0),
              fInfo(0), fInfoStack()
 {
    // Create an I/O buffer object. Mode should be either TBuffer::kRead or
@@ -82,7 +351,6 @@ TBufferFile::TBufferFile(TBuffer::EMode mode)
    fMapCount     = 0;
    fMapSize      = fgMapSize;
    fMap          = 0;
-   fClassMap     = 0;
    fParent       = 0;
    fDisplacement = 0;
 }
@@ -90,7 +358,7 @@ TBufferFile::TBufferFile(TBuffer::EMode mode)
 //______________________________________________________________________________
 TBufferFile::TBufferFile(TBuffer::EMode mode, Int_t bufsiz)
             :TBuffer(mode,bufsiz),
-             fDisplacement(0),fPidOffset(0), fMap(0), fClassMap(0),
+             fDisplacement(0),fPidOffset(0), fMap(0),
              fInfo(0), fInfoStack()
 {
    // Create an I/O buffer object. Mode should be either TBuffer::kRead or
@@ -99,14 +367,13 @@ TBufferFile::TBufferFile(TBuffer::EMode mode, Int_t bufsiz)
    fMapCount = 0;
    fMapSize  = fgMapSize;
    fMap      = 0;
-   fClassMap = 0;
    fDisplacement = 0;
 }
 
 //______________________________________________________________________________
 TBufferFile::TBufferFile(TBuffer::EMode mode, Int_t bufsiz, void *buf, Bool_t adopt, ReAllocCharFun_t reallocfunc) :
    TBuffer(mode,bufsiz,buf,adopt,reallocfunc),
-   fDisplacement(0),fPidOffset(0), fMap(0), fClassMap(0),
+   fDisplacement(0),fPidOffset(0), fMap(0),
    fInfo(0), fInfoStack()
 {
    // Create an I/O buffer object. Mode should be either TBuffer::kRead or
@@ -121,7 +388,6 @@ TBufferFile::TBufferFile(TBuffer::EMode mode, Int_t bufsiz, void *buf, Bool_t ad
    fMapCount = 0;
    fMapSize  = fgMapSize;
    fMap      = 0;
-   fClassMap = 0;
    fDisplacement = 0;
 }
 
@@ -131,7 +397,6 @@ TBufferFile::~TBufferFile()
    // Delete an I/O buffer object.
 
    delete fMap;
-   delete fClassMap;
 }
 
 //______________________________________________________________________________
@@ -728,13 +993,8 @@ Int_t TBufferFile::ReadArray(Short_t *&h)
    if (!h) h = new Short_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
+   (*gSwapCopy16)(h, fBufCur, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
 #else
    memcpy(h, fBufCur, l);
    fBufCur += l;
@@ -761,13 +1021,8 @@ Int_t TBufferFile::ReadArray(Int_t *&ii)
    if (!ii) ii = new Int_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
+   (*gSwapCopy32)(ii, fBufCur, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
 #else
    memcpy(ii, fBufCur, l);
    fBufCur += l;
@@ -820,8 +1075,8 @@ Int_t TBufferFile::ReadArray(Long64_t *&ll)
    if (!ll) ll = new Long64_t[n];
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   (*gSwapCopy64)(ll, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(ll, fBufCur, l);
    fBufCur += l;
@@ -848,13 +1103,8 @@ Int_t TBufferFile::ReadArray(Float_t *&f)
    if (!f) f = new Float_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
+   (*gSwapCopy32)(f, fBufCur, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
 #else
    memcpy(f, fBufCur, l);
    fBufCur += l;
@@ -881,8 +1131,8 @@ Int_t TBufferFile::ReadArray(Double_t *&d)
    if (!d) d = new Double_t[n];
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   (*gSwapCopy64)(d, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(d, fBufCur, l);
    fBufCur += l;
@@ -1001,13 +1251,8 @@ Int_t TBufferFile::ReadStaticArray(Short_t *h)
    if (!h) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
+   (*gSwapCopy16)(h, fBufCur, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
 #else
    memcpy(h, fBufCur, l);
    fBufCur += l;
@@ -1033,13 +1278,8 @@ Int_t TBufferFile::ReadStaticArray(Int_t *ii)
    if (!ii) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
+   (*gSwapCopy32)(ii, fBufCur, n);
    fBufCur += sizeof(Int_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
 #else
    memcpy(ii, fBufCur, l);
    fBufCur += l;
@@ -1090,8 +1330,8 @@ Int_t TBufferFile::ReadStaticArray(Long64_t *ll)
    if (!ll) return 0;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   (*gSwapCopy64)(ll, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(ll, fBufCur, l);
    fBufCur += l;
@@ -1117,13 +1357,8 @@ Int_t TBufferFile::ReadStaticArray(Float_t *f)
    if (!f) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
+   (*gSwapCopy32)(f, fBufCur, n);
    fBufCur += sizeof(Float_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
 #else
    memcpy(f, fBufCur, l);
    fBufCur += l;
@@ -1149,8 +1384,8 @@ Int_t TBufferFile::ReadStaticArray(Double_t *d)
    if (!d) return 0;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   (*gSwapCopy64)(d, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(d, fBufCur, l);
    fBufCur += l;
@@ -1267,13 +1502,8 @@ void TBufferFile::ReadFastArray(Short_t *h, Int_t n)
    if (n <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
+   (*gSwapCopy16)(h, fBufCur, n);
    fBufCur += sizeof(Short_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
 #else
    memcpy(h, fBufCur, l);
    fBufCur += l;
@@ -1289,13 +1519,8 @@ void TBufferFile::ReadFastArray(Int_t *ii, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
+   (*gSwapCopy32)(ii, fBufCur, n);
    fBufCur += sizeof(Int_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
 #else
    memcpy(ii, fBufCur, l);
    fBufCur += l;
@@ -1327,8 +1552,8 @@ void TBufferFile::ReadFastArray(Long64_t *ll, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   (*gSwapCopy64)(ll, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(ll, fBufCur, l);
    fBufCur += l;
@@ -1344,13 +1569,8 @@ void TBufferFile::ReadFastArray(Float_t *f, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
+   (*gSwapCopy32)(f, fBufCur, n);
    fBufCur += sizeof(Float_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
 #else
    memcpy(f, fBufCur, l);
    fBufCur += l;
@@ -1366,8 +1586,8 @@ void TBufferFile::ReadFastArray(Double_t *d, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   (*gSwapCopy64)(d, fBufCur, n);
+   fBufCur += l;
 #else
    memcpy(d, fBufCur, l);
    fBufCur += l;
@@ -1384,33 +1604,14 @@ void TBufferFile::ReadFastArrayFloat16(Float_t *f, Int_t n, TStreamerElement *el
 
    if (ele && ele->GetFactor() != 0) {
       //a range was specified. We read an integer and convert it back to a float
-      Double_t xmin = ele->GetXmin();
-      Double_t factor = ele->GetFactor();
-      for (int j=0;j < n; j++) {
-         UInt_t aint; *this >> aint; f[j] = (Float_t)(aint/factor + xmin);
-      }
+      ReadArrayWithFactor(fBufCur, f, n, ele->GetFactor(), ele->GetXmin());
    } else {
-      Int_t i;
       Int_t nbits = 0;
       if (ele) nbits = (Int_t)ele->GetXmin();
       if (!nbits) nbits = 12;
       //we read the exponent and the truncated mantissa of the float
       //and rebuild the new float.
-      union {
-         Float_t fFloatValue;
-         Int_t   fIntValue;
-      };
-      UChar_t  theExp;
-      UShort_t theMan;
-      for (i = 0; i < n; i++) {
-         *this >> theExp;
-         *this >> theMan;
-         fIntValue = theExp;
-         fIntValue <<= 23;
-         fIntValue |= (theMan & ((1<<(nbits+1))-1)) <<(23-nbits);
-         if(1<<(nbits+1) & theMan) fFloatValue = -fFloatValue;
-         f[i] = fFloatValue;
-      }
+      ReadArrayWithNbits(fBufCur, f, n, nbits);
    }
 }
 
@@ -1423,9 +1624,7 @@ void TBufferFile::ReadFastArrayWithFactor(Float_t *ptr, Int_t n, Double_t factor
    if (n <= 0 || 3*n > fBufSize) return;
 
    //a range was specified. We read an integer and convert it back to a float
-   for (int j=0;j < n; j++) {
-      UInt_t aint; *this >> aint; ptr[j] = (Float_t)(aint/factor + minvalue);
-   }
+   ReadArrayWithFactor(fBufCur, ptr, n, factor, minvalue);
 }
 
 //______________________________________________________________________________
@@ -1439,21 +1638,7 @@ void TBufferFile::ReadFastArrayWithNbits(Float_t *ptr, Int_t n, Int_t nbits)
    if (!nbits) nbits = 12;
    //we read the exponent and the truncated mantissa of the float
    //and rebuild the new float.
-   union {
-      Float_t fFloatValue;
-      Int_t   fIntValue;
-   };
-   UChar_t  theExp;
-   UShort_t theMan;
-   for (Int_t i = 0; i < n; i++) {
-      *this >> theExp;
-      *this >> theMan;
-      fIntValue = theExp;
-      fIntValue <<= 23;
-      fIntValue |= (theMan & ((1<<(nbits+1))-1)) <<(23-nbits);
-      if(1<<(nbits+1) & theMan) fFloatValue = -fFloatValue;
-      ptr[i] = fFloatValue;
-   }
+   ReadArrayWithNbits(fBufCur, ptr, n, nbits);
 }
 
 //______________________________________________________________________________
@@ -1466,40 +1651,17 @@ void TBufferFile::ReadFastArrayDouble32(Double_t *d, Int_t n, TStreamerElement *
 
    if (ele && ele->GetFactor() != 0) {
       //a range was specified. We read an integer and convert it back to a double.
-      Double_t xmin = ele->GetXmin();
-      Double_t factor = ele->GetFactor();
-      for (int j=0;j < n; j++) {
-         UInt_t aint; *this >> aint; d[j] = (Double_t)(aint/factor + xmin);
-      }
+      ReadArrayWithFactor(fBufCur, d, n, ele->GetFactor(), ele->GetXmin());
    } else {
-      Int_t i;
       Int_t nbits = 0;
       if (ele) nbits = (Int_t)ele->GetXmin();
       if (!nbits) {
          //we read a float and convert it to double
-         Float_t afloat;
-         for (i = 0; i < n; i++) {
-            *this >> afloat;
-            d[i] = (Double_t)afloat;
-         }
+         ReadFloatArrayAsDouble(fBufCur, d, n);
       } else {
          //we read the exponent and the truncated mantissa of the float
          //and rebuild the double.
-         union {
-            Float_t fFloatValue;
-            Int_t   fIntValue;
-         };
-         UChar_t  theExp;
-         UShort_t theMan;
-         for (i = 0; i < n; i++) {
-            *this >> theExp;
-            *this >> theMan;
-            fIntValue = theExp;
-            fIntValue <<= 23;
-            fIntValue |= (theMan & ((1<<(nbits+1))-1)) <<(23-nbits);
-            if (1<<(nbits+1) & theMan) fFloatValue = -fFloatValue;
-            d[i] = (Double_t)fFloatValue;
-         }
+         ReadArrayWithNbits(fBufCur, d, n, nbits);
       }
    }
 }
@@ -1513,9 +1675,7 @@ void TBufferFile::ReadFastArrayWithFactor(Double_t *d, Int_t n, Double_t factor,
    if (n <= 0 || 3*n > fBufSize) return;
 
    //a range was specified. We read an integer and convert it back to a double.
-   for (int j=0;j < n; j++) {
-      UInt_t aint; *this >> aint; d[j] = (Double_t)(aint/factor + minvalue);
-   }
+   ReadArrayWithFactor(fBufCur, d, n, factor, minvalue);
 }
 
 //______________________________________________________________________________
@@ -1528,29 +1688,11 @@ void TBufferFile::ReadFastArrayWithNbits(Double_t *d, Int_t n, Int_t nbits)
 
    if (!nbits) {
       //we read a float and convert it to double
-      Float_t afloat;
-      for (Int_t i = 0; i < n; i++) {
-         *this >> afloat;
-         d[i] = (Double_t)afloat;
-      }
+      ReadFloatArrayAsDouble(fBufCur, d, n);
    } else {
       //we read the exponent and the truncated mantissa of the float
       //and rebuild the double.
-      union {
-         Float_t fFloatValue;
-         Int_t   fIntValue;
-      };
-      UChar_t  theExp;
-      UShort_t theMan;
-      for (Int_t i = 0; i < n; i++) {
-         *this >> theExp;
-         *this >> theMan;
-         fIntValue = theExp;
-         fIntValue <<= 23;
-         fIntValue |= (theMan & ((1<<(nbits+1))-1)) <<(23-nbits);
-         if (1<<(nbits+1) & theMan) fFloatValue = -fFloatValue;
-         d[i] = (Double_t)fFloatValue;
-      }
+      ReadArrayWithNbits(fBufCur, d, n, nbits);
    }
 }
 
@@ -1699,13 +1841,8 @@ void TBufferFile::WriteArray(const Short_t *h, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(fBufCur, h, n);
+   (*gSwapCopy16)(fBufCur, h, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, h[i]);
-# endif
 #else
    memcpy(fBufCur, h, l);
    fBufCur += l;
@@ -1729,13 +1866,8 @@ void TBufferFile::WriteArray(const Int_t *ii, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, ii, n);
+   (*gSwapCopy32)(fBufCur, ii, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ii[i]);
-# endif
 #else
    memcpy(fBufCur, ii, l);
    fBufCur += l;
@@ -1797,8 +1929,8 @@ void TBufferFile::WriteArray(const Long64_t *ll, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ll[i]);
+   (*gSwapCopy64)(fBufCur, ll, n);
+   fBufCur += l;
 #else
    memcpy(fBufCur, ll, l);
    fBufCur += l;
@@ -1822,13 +1954,8 @@ void TBufferFile::WriteArray(const Float_t *f, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, f, n);
+   (*gSwapCopy32)(fBufCur, f, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, f[i]);
-# endif
 #else
    memcpy(fBufCur, f, l);
    fBufCur += l;
@@ -1852,8 +1979,8 @@ void TBufferFile::WriteArray(const Double_t *d, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, d[i]);
+   (*gSwapCopy64)(fBufCur, d, n);
+   fBufCur += l;
 #else
    memcpy(fBufCur, d, l);
    fBufCur += l;
@@ -1965,13 +2092,8 @@ void TBufferFile::WriteFastArray(const Short_t *h, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(fBufCur, h, n);
+   (*gSwapCopy16)(fBufCur, h, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, h[i]);
-# endif
 #else
    memcpy(fBufCur, h, l);
    fBufCur += l;
@@ -1989,13 +2111,8 @@ void TBufferFile::WriteFastArray(const Int_t *ii, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, ii, n);
+   (*gSwapCopy32)(fBufCur, ii, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ii[i]);
-# endif
 #else
    memcpy(fBufCur, ii, l);
    fBufCur += l;
@@ -2041,8 +2158,8 @@ void TBufferFile::WriteFastArray(const Long64_t *ll, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ll[i]);
+   (*gSwapCopy64)(fBufCur, ll, n);
+   fBufCur += l;
 #else
    memcpy(fBufCur, ll, l);
    fBufCur += l;
@@ -2060,13 +2177,8 @@ void TBufferFile::WriteFastArray(const Float_t *f, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, f, n);
+   (*gSwapCopy32)(fBufCur, f, n);
    fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, f[i]);
-# endif
 #else
    memcpy(fBufCur, f, l);
    fBufCur += l;
@@ -2084,8 +2196,8 @@ void TBufferFile::WriteFastArray(const Double_t *d, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, d[i]);
+   (*gSwapCopy64)(fBufCur, d, n);
+   fBufCur += l;
 #else
    memcpy(fBufCur, d, l);
    fBufCur += l;
@@ -2389,8 +2501,10 @@ void *TBufferFile::ReadObjectAny(const TClass *clCast)
             // exception
          }
       }
-      obj = (char *) (Long_t)fMap->GetValue(tag);
-      clRef = (TClass*) (Long_t)fClassMap->GetValue(tag);
+      Long64_t value, extra;
+      fMap->GetValues(tag, value, extra);
+      obj = (char *) (Long_t)value;
+      clRef = (TClass*) (Long_t)extra;
 
       if (clRef && (clRef!=(TClass*)(-1)) && clCast) {
          //baseOffset will be -1 if clRef does not inherit from clCast.
@@ -2466,9 +2580,8 @@ void TBufferFile::WriteObjectClass(const void *actualObjectStart, const TClass *
 
       ULong_t idx;
       UInt_t slot;
-      ULong_t hash = Void_Hash(actualObjectStart);
 
-      if ((idx = (ULong_t)fMap->GetValue(hash, (Long_t)actualObjectStart, slot)) != 0) {
+      if ((idx = (ULong_t)fMap->GetValue((Long_t)actualObjectStart, slot)) != 0) {
 
          // truncation is OK the value we did put in the map is an 30-bit offset
          // and not a pointer
@@ -2502,13 +2615,12 @@ void TBufferFile::WriteObjectClass(const void *actualObjectStart, const TClass *
          //MapObject(actualObjectStart, actualClass, cntpos+kMapOffset);
          UInt_t offset = cntpos+kMapOffset;
          if (mapsize == fMap->Capacity()) {
-            fMap->AddAt(slot, hash, (Long_t)actualObjectStart, offset);
+            fMap->AddAt(slot, (Long_t)actualObjectStart, offset);
          } else {
             // The slot depends on the capacity and WriteClass has induced an increase.
-            fMap->Add(hash, (Long_t)actualObjectStart, offset);
+            fMap->Add((Long_t)actualObjectStart, offset);
          }
          // No need to keep track of the class in write mode
-         // fClassMap->Add(hash, (Long_t)obj, (Long_t)((TObject*)obj)->IsA());
          fMapCount++;
 
          ((TClass*)actualClass)->Streamer((void*)actualObjectStart,*this);
@@ -2611,6 +2723,16 @@ TClass *TBufferFile::ReadClass(const TClass *clReq, UInt_t *objTag)
       // got a new class description followed by a new object
       // (class can be 0 if class dictionary is not found, in that
       // case object of this class must be skipped)
+      if (fParent && ((TFile*)fParent)->IsStreamerInfoPending()) {
+         // A class without dictionary is only described by the StreamerInfo
+         // record of the file, whose reading has been deferred.
+         Int_t namepos = Length();
+         char name[1024];
+         ReadString(name, sizeof(name));
+         TClass *known = TClass::GetClass(name, kTRUE, kTRUE);
+         if (!known || !known->IsLoaded()) ((TFile*)fParent)->ReadPendingStreamerInfo();
+         SetBufferOffset(namepos);
+      }
       cl = TClass::Load(*this);
 
       // add class to fMap for later reference
@@ -2668,10 +2790,9 @@ void TBufferFile::WriteClass(const TClass *cl)
    R__ASSERT(IsWriting());
 
    ULong_t idx;
-   ULong_t hash = Void_Hash(cl);
    UInt_t slot;
 
-   if ((idx = (ULong_t)fMap->GetValue(hash, (Long_t)cl,slot)) != 0) {
+   if ((idx = (ULong_t)fMap->GetValue((Long_t)cl,slot)) != 0) {
 
       // truncation is OK the value we did put in the map is an 30-bit offset
       // and not a pointer
@@ -2693,7 +2814,7 @@ void TBufferFile::WriteClass(const TClass *cl)
 
       // store new class reference in fMap (+kMapOffset so it's != kNullTag)
       CheckCount(offset+kMapOffset);
-      fMap->AddAt(slot, hash, (Long_t)cl, offset+kMapOffset);
+      fMap->AddAt(slot, (Long_t)cl, offset+kMapOffset);
       fMapCount++;
    }
 }
@@ -2719,7 +2840,7 @@ void TBufferFile::SkipVersion(const TClass *cl)
          UInt_t checksum = 0;
          //*this >> checksum;
          frombuf(this->fBufCur,&checksum);
-         TStreamerInfo *vinfo = (TStreamerInfo*)cl->FindStreamerInfo(checksum);
+         TStreamerInfo *vinfo = FindStreamerInfo(fParent, cl, checksum);
          if (vinfo) {
             return;
          } else {
@@ -2822,7 +2943,7 @@ Version_t TBufferFile::ReadVersion(UInt_t *startpos, UInt_t *bcnt, const TClass
                UInt_t checksum = 0;
                //*this >> checksum;
                frombuf(this->fBufCur,&checksum);
-               TStreamerInfo *vinfo = (TStreamerInfo*)cl->FindStreamerInfo(checksum);
+               TStreamerInfo *vinfo = FindStreamerInfo(fParent, cl, checksum);
                if (vinfo) {
                   return vinfo->TStreamerInfo::GetClassVersion(); // Try to get inlining.
                } else {
@@ -2898,7 +3019,7 @@ Version_t TBufferFile::ReadVersionForMemberWise(const TClass *cl)
             if (cl->GetClassVersion() != 0) {
                UInt_t checksum = 0;
                frombuf(this->fBufCur,&checksum);
-               TStreamerInfo *vinfo = (TStreamerInfo*)cl->FindStreamerInfo(checksum);
+               TStreamerInfo *vinfo = FindStreamerInfo(fParent, cl, checksum);
                if (vinfo) {
                   return vinfo->TStreamerInfo::GetClassVersion(); // Try to get inlining.
                } else {
@@ -3164,9 +3285,9 @@ Bool_t TBufferFile::CheckObject(const void *obj, const TClass *ptrClass)
    if (clActual && (ptrClass != clActual)) {
       const char *temp = (const char*) obj;
       temp -= clActual->GetBaseClassOffset(ptrClass);
-      idx = (ULong_t)fMap->GetValue(Void_Hash(temp), (Long_t)temp);
+      idx = (ULong_t)fMap->GetValue((Long_t)temp);
    } else {
-      idx = (ULong_t)fMap->GetValue(Void_Hash(obj), (Long_t)obj);
+      idx = (ULong_t)fMap->GetValue((Long_t)obj);
    }
 
    return idx ? kTRUE : kFALSE;
@@ -3196,8 +3317,10 @@ void TBufferFile::GetMappedObject(UInt_t tag, void* &ptr, TClass* &ClassPtr) con
       ptr = 0;
       ClassPtr = 0;
    } else {
-      ptr = (void*)(Long_t)fMap->GetValue(tag);
-      ClassPtr = (TClass*) (Long_t)fClassMap->GetValue(tag);
+      Long64_t value, extra;
+      fMap->GetValues(tag, value, extra);
+      ptr = (void*)(Long_t)value;
+      ClassPtr = (TClass*) (Long_t)extra;
    }
 }
 
@@ -3216,17 +3339,14 @@ void TBufferFile::MapObject(const TObject *obj, UInt_t offset)
 
       if (obj) {
          CheckCount(offset);
-         ULong_t hash = Void_Hash(obj);
-         fMap->Add(hash, (Long_t)obj, offset);
+         fMap->Add((Long_t)obj, offset);
          // No need to keep track of the class in write mode
-         // fClassMap->Add(hash, (Long_t)obj, (Long_t)((TObject*)obj)->IsA());
          fMapCount++;
       }
    } else {
-      if (!fMap || !fClassMap) InitMap();
+      if (!fMap) InitMap();
 
-      fMap->Add(offset, (Long_t)obj);
-      fClassMap->Add(offset,
+      fMap->Add(offset, (Long_t)obj,
              (obj && obj != (TObject*)-1) ? (Long_t)((TObject*)obj)->IsA() : 0);
       fMapCount++;
    }
@@ -3247,17 +3367,14 @@ void TBufferFile::MapObject(const void *obj, const TClass* cl, UInt_t offset)
 
       if (obj) {
          CheckCount(offset);
-         ULong_t hash = Void_Hash(obj);
-         fMap->Add(hash, (Long_t)obj, offset);
+         fMap->Add((Long_t)obj, offset);
          // No need to keep track of the class in write mode
-         // fClassMap->Add(hash, (Long_t)obj, (Long_t)cl);
          fMapCount++;
       }
    } else {
-      if (!fMap || !fClassMap) InitMap();
+      if (!fMap) InitMap();
 
-      fMap->Add(offset, (Long_t)obj);
-      fClassMap->Add(offset, (Long_t)cl);
+      fMap->Add(offset, (Long_t)obj, (Long_t)cl);
       fMapCount++;
    }
 }
@@ -3309,24 +3426,19 @@ void TBufferFile::InitMap()
 
    if (IsWriting()) {
       if (!fMap) {
-         fMap = new TExMap(fMapSize);
+         fMap = new TBufferFileMap(fMapSize);
          // No need to keep track of the class in write mode
-         // fClassMap = new TExMap(fMapSize);
          fMapCount = 0;
       }
    } else {
       if (!fMap) {
-         fMap = new TExMap(fMapSize);
-         fMap->Add(0, kNullTag);      // put kNullTag in slot 0
+         fMap = new TBufferFileMap(fMapSize);
+         fMap->Add(0, kNullTag, kNullTag);      // put kNullTag in slot 0
          fMapCount = 1;
       } else if (fMapCount==0) {
-         fMap->Add(0, kNullTag);      // put kNullTag in slot 0
+         fMap->Add(0, kNullTag, kNullTag);      // put kNullTag in slot 0
          fMapCount = 1;
       }
-      if (!fClassMap) {
-         fClassMap = new TExMap(fMapSize);
-         fClassMap->Add(0, kNullTag);      // put kNullTag in slot 0
-      }
    }
 }
 
@@ -3334,9 +3446,19 @@ void TBufferFile::InitMap()
 void TBufferFile::ResetMap()
 {
    // Delete existing fMap and reset map counter.
-
-   if (fMap) fMap->Delete();
-   if (fClassMap) fClassMap->Delete();
+   // The table of the map is kept, so that a reused buffer does not grow it
+   // again for the next objects, except when it was grown beyond
+   // kMaxRetainedMapSize entries and this time was mostly unused.
+
+   if (fMap) {
+      if (fMap->Capacity() > (Int_t)TBufferFileMap::CapacityFor(kMaxRetainedMapSize) &&
+          fMap->GetSize() < kMaxRetainedMapSize) {
+         delete fMap;
+         fMap = new TBufferFileMap(fMapSize);
+      } else {
+         fMap->Clear();
+      }
+   }
    fMapCount     = 0;
    fDisplacement = 0;
 
@@ -3574,6 +3696,7 @@ Int_t TBufferFile::ReadClassBuffer(const TClass *cl, void *pointer, Int_t versio
    //   count    is the number of bytes for this object in the buffer
    //
 
+   ReadPendingStreamerInfo(fParent, onFileClass ? onFileClass : cl, version);
    TObjArray *infos = cl->GetStreamerInfos();
    Int_t ninfos = infos->GetSize();
    if (version < -1 || version >= ninfos) {
@@ -3662,6 +3785,7 @@ Int_t TBufferFile::ReadClassBuffer(const TClass *cl, void *pointer, const TClass
       version = -1; //This is old file
       v2file = kTRUE;
    }
+   ReadPendingStreamerInfo(file, onFileClass ? onFileClass : cl, version);
 
    //---------------------------------------------------------------------------
    // The ondisk class has been specified so get foreign streamer info
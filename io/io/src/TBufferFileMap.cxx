@@ -0,0 +1,242 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TBufferFileMap                                                       //
+//                                                                      //
+// The map used by TBufferFile to keep track of the objects and classes //
+// already streamed. It associates a key (an object address when        //
+// writing, a buffer offset when reading) with a value and an extra     //
+// value (the class of the object when reading).                        //
+// The table uses open addressing with linear probing on a power of 2   //
+// number of slots. Clearing the map only bumps a generation counter,   //
+// so that a buffer can be reused for many objects without touching    //
+// the whole table each time.                                           //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TBufferFileMap.h"
+#include "TError.h"
+
+#include <string.h>
+
+// 2^64 divided by the golden ratio, spreads consecutive offsets and
+// aligned addresses over the whole table.
+static const ULong64_t kGoldenRatio = (ULong64_t(0x9E3779B9) << 32) | ULong64_t(0x7F4A7C15);
+
+//______________________________________________________________________________
+TBufferFileMap::TBufferFileMap(Int_t mapSize) : fTable(0), fCapacity(0), fShift(0), fTally(0), fGeneration(1)
+{
+   // Create a map able to hold mapSize entries before growing.
+
+   Allocate(CapacityFor(mapSize));
+}
+
+//______________________________________________________________________________
+TBufferFileMap::~TBufferFileMap()
+{
+   // Delete the map.
+
+   delete [] fTable;
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Add(Long64_t key, Long64_t value, Long64_t extra)
+{
+   // Add a (key,value,extra) triplet to the table. The key should be unique.
+
+   AddAt(FindSlot(key), key, value, extra);
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::AddAt(UInt_t slot, Long64_t key, Long64_t value, Long64_t extra)
+{
+   // Add a (key,value,extra) triplet to the table. The key should be unique.
+   // 'slot' must have been returned by GetValue(key,slot) and the map must
+   // not have been modified since.
+
+   if (InUse(slot)) {
+      if (fTable[slot].fKey == key) {
+         ::Error("TBufferFileMap::Add", "key %lld is not unique", key);
+         return;
+      }
+      slot = FindSlot(key);
+      if (InUse(slot)) {
+         ::Error("TBufferFileMap::Add", "key %lld is not unique", key);
+         return;
+      }
+   }
+   Slot_t &s = fTable[slot];
+   s.fKey = key;
+   s.fValue = value;
+   s.fExtra = extra;
+   s.fGeneration = fGeneration;
+   ++fTally;
+   if (4*(ULong64_t)fTally >= 3*(ULong64_t)fCapacity)
+      Expand(2*fCapacity);
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Allocate(UInt_t capacity)
+{
+   // Allocate an empty table of capacity slots (a power of 2).
+
+   fTable = new Slot_t[capacity];
+   memset(fTable, 0, capacity*sizeof(Slot_t));
+   fCapacity = capacity;
+   fShift = 64;
+   while (capacity > 1) { capacity >>= 1; --fShift; }
+   fGeneration = 1;
+   fTally = 0;
+}
+
+//______________________________________________________________________________
+UInt_t TBufferFileMap::CapacityFor(Int_t size)
+{
+   // Return the number of slots needed to hold size entries
+   // below the 3/4 load factor.
+
+   UInt_t capacity = 16;
+   while (capacity < 0x80000000u && 4*(ULong64_t)size >= 3*(ULong64_t)capacity)
+      capacity <<= 1;
+   return capacity;
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Clear()
+{
+   // Remove all entries. Only the generation counter is changed, the table
+   // itself is only rewritten when the counter wraps around.
+
+   if (++fGeneration == 0) {
+      memset(fTable, 0, fCapacity*sizeof(Slot_t));
+      fGeneration = 1;
+   }
+   fTally = 0;
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Expand(Int_t newsize)
+{
+   // Grow the table to hold at least newsize slots and rehash the entries
+   // in use.
+
+   UInt_t capacity = 16;
+   while (capacity < (UInt_t)newsize && capacity < 0x80000000u) capacity <<= 1;
+   if (capacity <= fCapacity) return;
+
+   Slot_t *old = fTable;
+   UInt_t oldcapacity = fCapacity;
+   UInt_t oldgeneration = fGeneration;
+   Int_t tally = fTally;
+
+   Allocate(capacity);
+   for (UInt_t i = 0; i < oldcapacity; ++i) {
+      if (old[i].fGeneration != oldgeneration) continue;
+      Slot_t &s = fTable[FindSlot(old[i].fKey)];
+      s = old[i];
+      s.fGeneration = fGeneration;
+   }
+   fTally = tally;
+   delete [] old;
+}
+
+//______________________________________________________________________________
+UInt_t TBufferFileMap::FindSlot(Long64_t key) const
+{
+   // Return the slot holding key or, if key is not in the map, the free
+   // slot where it would be stored.
+
+   const UInt_t mask = fCapacity - 1;
+   UInt_t slot = Home(key);
+   while (InUse(slot) && fTable[slot].fKey != key)
+      slot = (slot + 1) & mask;
+   return slot;
+}
+
+//______________________________________________________________________________
+Long64_t TBufferFileMap::GetValue(Long64_t key) const
+{
+   // Return the value belonging to key, 0 if the key is not in the map.
+
+   UInt_t slot = FindSlot(key);
+   return InUse(slot) ? fTable[slot].fValue : 0;
+}
+
+//______________________________________________________________________________
+Long64_t TBufferFileMap::GetValue(Long64_t key, UInt_t &slot) const
+{
+   // Return the value belonging to key, 0 if the key is not in the map.
+   // In the latter case slot is set to where the key can be added with
+   // AddAt, as long as the map is not modified in between.
+
+   slot = FindSlot(key);
+   return InUse(slot) ? fTable[slot].fValue : 0;
+}
+
+//______________________________________________________________________________
+Bool_t TBufferFileMap::GetValues(Long64_t key, Long64_t &value, Long64_t &extra) const
+{
+   // Set value and extra to the ones belonging to key. Return kFALSE (and
+   // set both to 0) if the key is not in the map.
+
+   UInt_t slot = FindSlot(key);
+   if (!InUse(slot)) {
+      value = extra = 0;
+      return kFALSE;
+   }
+   value = fTable[slot].fValue;
+   extra = fTable[slot].fExtra;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+UInt_t TBufferFileMap::Home(Long64_t key) const
+{
+   // Return the preferred slot for key.
+
+   return (UInt_t)(((ULong64_t)key * kGoldenRatio) >> fShift);
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Remove(Long64_t key)
+{
+   // Remove key from the map. The following entries of the probe sequence
+   // are shifted back so that no tombstone is needed.
+
+   const UInt_t mask = fCapacity - 1;
+   UInt_t hole = FindSlot(key);
+   if (!InUse(hole)) return;
+
+   UInt_t next = hole;
+   while (1) {
+      next = (next + 1) & mask;
+      if (!InUse(next)) break;
+      UInt_t home = Home(fTable[next].fKey);
+      // Leave the entry in place if its home lies cyclically in (hole,next].
+      Bool_t inrange = (hole <= next) ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+      if (inrange) continue;
+      fTable[hole] = fTable[next];
+      hole = next;
+   }
+   fTable[hole].fGeneration = fGeneration - 1;
+   --fTally;
+}
+
+//______________________________________________________________________________
+void TBufferFileMap::Reserve(Int_t size)
+{
+   // Make sure size entries can be added without growing the table.
+
+   UInt_t capacity = CapacityFor(size);
+   if (capacity > fCapacity) Expand(capacity);
+}
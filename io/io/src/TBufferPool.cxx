@@ -0,0 +1,204 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TBufferPool                                                          //
+//                                                                      //
+// A process wide pool of I/O buffer storage. Buffers are handed out in //
+// power of 2 size classes (4 kB to 64 MB) and kept on a free list per  //
+// class when released, up to a total of GetMaxPooledSize() bytes.      //
+// It is used by TKey, TBasket and TTreeCacheUnzip for the transient    //
+// buffers holding compressed and uncompressed records, which otherwise //
+// cause a lot of allocation churn in long running jobs.                //
+//                                                                      //
+// Memory obtained with Acquire must be given back with Release (never  //
+// with delete []). A TBuffer created by NewBuffer uses the pool to     //
+// expand and must be deleted with DeleteBuffer.                        //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TBufferPool.h"
+#include "TBufferFile.h"
+#include "TVirtualMutex.h"
+
+#include <string.h>
+
+// Every block starts with a header holding its size class (-1 when the
+// block is too large to be pooled) and its capacity. The header is 16
+// bytes long to keep the user part aligned for any basic type.
+static const Int_t kHeaderSize   = 16;
+static const Int_t kMinShift     = 12;   // smallest class: 4 kB
+static const Int_t kNclasses     = 15;   // largest class: 64 MB
+static const Int_t kMaxPerClass  = 64;   // free blocks kept per class
+
+static char     *gFreeBlocks[kNclasses][kMaxPerClass];
+static Int_t     gNfree[kNclasses];
+static Long64_t  gPooledSize    = 0;
+static Long64_t  gMaxPooledSize = 128*1024*1024;
+static TVirtualMutex *gBufferPoolMutex = 0;
+
+//______________________________________________________________________________
+static inline Int_t *BlockHeader(const char *buffer)
+{
+   // Return the header of the block holding buffer.
+
+   return (Int_t*)(buffer - kHeaderSize);
+}
+
+//______________________________________________________________________________
+char *TBufferPool::Acquire(Int_t size)
+{
+   // Return a buffer of at least size bytes. Its actual size is returned
+   // by Capacity(). The content is not initialized.
+
+   if (size < 1) size = 1;
+   Int_t cls = 0;
+   while (cls < kNclasses && (1 << (kMinShift+cls)) < size) ++cls;
+
+   char *block = 0;
+   Int_t capacity = size;
+   if (cls < kNclasses) {
+      capacity = 1 << (kMinShift+cls);
+      R__LOCKGUARD2(gBufferPoolMutex);
+      if (gNfree[cls]) {
+         block = gFreeBlocks[cls][--gNfree[cls]];
+         gPooledSize -= capacity;
+      }
+   } else {
+      cls = -1;
+   }
+   if (!block) {
+      block = new char[kHeaderSize + capacity];
+      Int_t *header = (Int_t*)block;
+      header[0] = cls;
+      header[1] = capacity;
+   }
+   return block + kHeaderSize;
+}
+
+//______________________________________________________________________________
+Int_t TBufferPool::Capacity(const char *buffer)
+{
+   // Return the usable size of a buffer returned by Acquire.
+
+   return buffer ? BlockHeader(buffer)[1] : 0;
+}
+
+//______________________________________________________________________________
+void TBufferPool::DeleteBuffer(TBuffer *buffer)
+{
+   // Delete buffer, giving its storage back to the pool if it came from
+   // NewBuffer. Any other TBuffer is simply deleted.
+
+   if (!buffer) return;
+   ReleaseBuffer(buffer);
+   delete buffer;
+}
+
+//______________________________________________________________________________
+Long64_t TBufferPool::GetMaxPooledSize()
+{
+   // Return the maximum number of bytes kept in the free lists.
+
+   return gMaxPooledSize;
+}
+
+//______________________________________________________________________________
+Long64_t TBufferPool::GetPooledSize()
+{
+   // Return the number of bytes currently kept in the free lists.
+
+   return gPooledSize;
+}
+
+//______________________________________________________________________________
+Bool_t TBufferPool::IsPooled(const TBuffer *buffer)
+{
+   // Return true if the storage of buffer belongs to the pool.
+
+   return buffer && buffer->GetReAllocFunc() == &TBufferPool::ReAlloc;
+}
+
+//______________________________________________________________________________
+TBuffer *TBufferPool::NewBuffer(TBuffer::EMode mode, Int_t size)
+{
+   // Create a TBufferFile of at least size bytes using storage from the
+   // pool. It must be deleted with DeleteBuffer.
+
+   char *storage = Acquire(size + 8); // TBuffer keeps 8 extra bytes in write mode.
+   return new TBufferFile(mode, Capacity(storage), storage, kFALSE, &TBufferPool::ReAlloc);
+}
+
+//______________________________________________________________________________
+char *TBufferPool::ReAlloc(char *buffer, size_t newsize, size_t oldsize)
+{
+   // Reallocation function of the buffers created by NewBuffer, following
+   // the semantic of TStorage::ReAllocChar: the first oldsize bytes are
+   // kept and the rest is zeroed. The block is reused if it is already
+   // large enough.
+
+   char *result = buffer;
+   if (!buffer || (size_t)Capacity(buffer) < newsize) {
+      result = Acquire((Int_t)newsize);
+      if (buffer && oldsize) memcpy(result, buffer, oldsize < newsize ? oldsize : newsize);
+      Release(buffer);
+   }
+   if (newsize > oldsize) memset(result + oldsize, 0, newsize - oldsize);
+   return result;
+}
+
+//______________________________________________________________________________
+void TBufferPool::Release(char *buffer)
+{
+   // Give back a buffer returned by Acquire.
+
+   if (!buffer) return;
+   char *block = buffer - kHeaderSize;
+   Int_t *header = (Int_t*)block;
+   Int_t cls = header[0];
+   if (cls >= 0) {
+      R__LOCKGUARD2(gBufferPoolMutex);
+      if (gNfree[cls] < kMaxPerClass && gPooledSize + header[1] <= gMaxPooledSize) {
+         gFreeBlocks[cls][gNfree[cls]++] = block;
+         gPooledSize += header[1];
+         return;
+      }
+   }
+   delete [] block;
+}
+
+//______________________________________________________________________________
+void TBufferPool::ReleaseBuffer(TBuffer *buffer)
+{
+   // If the storage of buffer belongs to the pool, give it back and
+   // detach it from buffer. The buffer must then be given new storage
+   // with TBuffer::SetBuffer before being used again.
+
+   if (!IsPooled(buffer)) return;
+   Release(buffer->Buffer());
+   buffer->SetBuffer(0, 0, kFALSE);
+}
+
+//______________________________________________________________________________
+void TBufferPool::SetMaxPooledSize(Long64_t size)
+{
+   // Set the maximum number of bytes kept in the free lists (128 MB by
+   // default). Blocks in excess are freed.
+
+   R__LOCKGUARD2(gBufferPoolMutex);
+   gMaxPooledSize = size;
+   for (Int_t cls = kNclasses-1; cls >= 0 && gPooledSize > gMaxPooledSize; --cls) {
+      while (gNfree[cls] && gPooledSize > gMaxPooledSize) {
+         delete [] gFreeBlocks[cls][--gNfree[cls]];
+         gPooledSize -= 1 << (kMinShift+cls);
+      }
+   }
+}
@@ -46,9 +46,118 @@
 #include "TStreamerElement.h"
 #include "TProcessUUID.h"
 #include "TVirtualMutex.h"
+#include "TThread.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 const UInt_t kIsBigFile = BIT(16);
 const Int_t  kMaxLen = 2048;
+const UInt_t kKeysIndexMagic = 0x4b494458; // "KIDX", marks the name index of a key list record
+const Int_t  kKeysPageSize = 65536;        // Size of the pages in which lazy key lists are read
+const Int_t  kMaxUnzipThreads = 8;         // Maximum number of threads used by ReadObjects
+
+extern "C" void R__unzip(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout);
+extern "C" int R__unzip_header(Int_t *nin, UChar_t *bufin, Int_t *lout);
+
+Bool_t TDirectoryFile::fgLazyKeys = kFALSE;
+
+//______________________________________________________________________________
+static UInt_t KeyNameHash(const char *name, Int_t len)
+{
+   // FNV-1a hash of a key name, as stored in the name index of the key list.
+
+   UInt_t h = 2166136261U;
+   for (Int_t i = 0; i < len; ++i) {
+      h ^= (UChar_t)name[i];
+      h *= 16777619U;
+   }
+   return h;
+}
+
+//______________________________________________________________________________
+static Bool_t SkipKeyHeader(char *&buffer, const char *end, const char *&name, Int_t &len)
+{
+   // Skip the key header starting at buffer without creating a TKey, see
+   // TKey::ReadKeyBuffer for the layout. Return the position and length of
+   // the key name, or kFALSE if the header does not fit before end.
+
+   if (buffer + 18 > end) return kFALSE;
+   char *p = buffer + 4;
+   Version_t version;
+   frombuf(p, &version);
+   p += 12;
+   if (version > 1000) p += 16;
+   else                p += 8;
+   for (Int_t s = 0; s < 3; ++s) {
+      if (p + 1 > end) return kFALSE;
+      UChar_t nwh;
+      Int_t   nchars;
+      frombuf(p, &nwh);
+      if (nwh == 255) {
+         if (p + 4 > end) return kFALSE;
+         frombuf(p, &nchars);
+      } else {
+         nchars = nwh;
+      }
+      if (nchars < 0 || p + nchars > end) return kFALSE;
+      if (s == 1) {
+         name = p;
+         len  = nchars;
+      }
+      p += nchars;
+   }
+   buffer = p;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+struct TDirectoryFileUnzip {
+   // A key record read by TDirectoryFile::ReadObjects and its uncompressed copy.
+   TKey    *fKey;     // Key of the record
+   char    *fRecord;  // Key record as read from the file
+   char    *fObject;  // Key header followed by the uncompressed object
+   Bool_t   fOk;      // True if the object has been uncompressed
+};
+
+struct TDirectoryFileUnzipRange {
+   // The records uncompressed by one thread of TDirectoryFile::ReadObjects.
+   TDirectoryFileUnzip *fRecords;
+   Int_t                fN;       // Number of records
+   Int_t                fFirst;   // First record of this thread
+   Int_t                fStride;  // Number of threads
+};
+
+//______________________________________________________________________________
+static void *UnzipRecords(void *arg)
+{
+   // Uncompress every fStride-th record starting at fFirst.
+   // Only R__unzip is called here: it does not touch any global state.
+
+   TDirectoryFileUnzipRange *range = (TDirectoryFileUnzipRange*)arg;
+   for (Int_t i = range->fFirst; i < range->fN; i += range->fStride) {
+      TDirectoryFileUnzip &rec = range->fRecords[i];
+      Int_t keylen = rec.fKey->GetKeylen();
+      Int_t objlen = rec.fKey->GetObjlen();
+      char    *objbuf = rec.fObject + keylen;
+      UChar_t *bufcur = (UChar_t *)rec.fRecord + keylen;
+      Int_t nin, nout = 0, nbuf;
+      Int_t noutot = 0;
+      while (1) {
+         Int_t hc = R__unzip_header(&nin, bufcur, &nbuf);
+         if (hc!=0) break;
+         R__unzip(&nin, bufcur, &nbuf, objbuf, &nout);
+         if (!nout) break;
+         noutot += nout;
+         if (noutot >= objlen) break;
+         bufcur += nin;
+         objbuf += nout;
+      }
+      rec.fOk = (nout != 0);
+   }
+   return 0;
+}
 
 ClassImp(TDirectoryFile)
 
@@ -57,7 +166,8 @@ ClassImp(TDirectoryFile)
 TDirectoryFile::TDirectoryFile() : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysPages(0), fNkeysLazy(0)
+   , fKeysHash(0), fKeysOffset(0), fKeysLoaded(0)
 {
 //*-*-*-*-*-*-*-*-*-*-*-*Directory default constructor-*-*-*-*-*-*-*-*-*-*-*-*
 //*-*                    =============================
@@ -68,7 +178,8 @@ TDirectoryFile::TDirectoryFile(const char *name, const char *title, Option_t *cl
            : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysPages(0), fNkeysLazy(0)
+   , fKeysHash(0), fKeysOffset(0), fKeysLoaded(0)
 {
 //*-*-*-*-*-*-*-*-*-*-*-* Create a new DirectoryFile *-*-*-*-*-*-*-*-*-*-*-*-*-*
 //*-*                     ==========================
@@ -166,7 +277,8 @@ void TDirectoryFile::Init(TClass *cl)
 TDirectoryFile::TDirectoryFile(const TDirectoryFile & directory) : TDirectory(directory)
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysPages(0), fNkeysLazy(0)
+   , fKeysHash(0), fKeysOffset(0), fKeysLoaded(0)
 {
    // Copy constructor.
    ((TDirectoryFile&)directory).Copy(*this);
@@ -181,6 +293,7 @@ TDirectoryFile::~TDirectoryFile()
       fKeys->Delete("slow");
       SafeDelete(fKeys);
    }
+   ReleaseLazyKeys();
 
    CleanTargets();
 
@@ -231,6 +344,8 @@ Int_t TDirectoryFile::AppendKey(TKey *key)
    key->SetMotherDir(this);
 
    // This is a fast hash lookup in case the key does not already exist
+   if (fNkeysLazy) LoadAllKeys();
+
    TKey *oldkey = (TKey*)fKeys->FindObject(key->GetName());
    if (!oldkey) {
       fKeys->Add(key);
@@ -262,7 +377,7 @@ void TDirectoryFile::Browse(TBrowser *b)
       TObject *obj = 0;
       TIter nextin(fList);
       TKey *key = 0, *keyo = 0;
-      TIter next(fKeys);
+      TIter next(GetListOfKeys());
 
       cd();
 
@@ -317,7 +432,7 @@ void TDirectoryFile::Build(TFile* motherFile, TDirectory* motherDir)
    fSeekParent = 0;
    fSeekKeys   = 0;
    fList       = new THashList(100,50);
-   fKeys       = new THashList(100,50);
+   fKeys       = new THashList(100,2);
    fMother     = motherDir;
    fFile       = motherFile ? motherFile : TFile::CurrentFile();
    SetBit(kCanDelete);
@@ -552,6 +667,7 @@ void TDirectoryFile::Close(Option_t *)
    if (fKeys) {
       fKeys->Delete("slow");
    }
+   ReleaseLazyKeys();
 
    CleanTargets();
 }
@@ -736,17 +852,13 @@ TKey *TDirectoryFile::FindKeyAny(const char *keyname) const
 
    DecodeNameCycle(keyname, name, cycle);
 
-   TIter next(GetListOfKeys());
-   TKey *key;
-   while ((key = (TKey *) next())) {
-      if (!strcmp(name, key->GetName()))
-         if ((cycle == 9999) || (cycle >= key->GetCycle()))  {
-            ((TDirectory*)this)->cd(); // may be we should not make cd ???
-            return key;
-         }
+   TKey *key = LookupKey(name, cycle, kFALSE);
+   if (key) {
+      ((TDirectory*)this)->cd(); // may be we should not make cd ???
+      return key;
    }
    //try with subdirectories
-   next.Reset();
+   TIter next(GetListOfKeys());
    while ((key = (TKey *) next())) {
       //if (!strcmp(key->GetClassName(),"TDirectory")) {
       if (strstr(key->GetClassName(),"TDirectory")) {
@@ -779,17 +891,11 @@ TObject *TDirectoryFile::FindObjectAny(const char *aname) const
 
    DecodeNameCycle(aname, name, cycle);
 
-   TIter next(GetListOfKeys());
-   TKey *key;
    //may be a key in the current directory
-   while ((key = (TKey *) next())) {
-      if (!strcmp(name, key->GetName())) {
-         if (cycle == 9999)             return key->ReadObj();
-         if (cycle >= key->GetCycle())  return key->ReadObj();
-      }
-   }
+   TKey *key = LookupKey(name, cycle, kFALSE);
+   if (key) return key->ReadObj();
    //try with subdirectories
-   next.Reset();
+   TIter next(GetListOfKeys());
    while ((key = (TKey *) next())) {
       //if (!strcmp(key->GetClassName(),"TDirectory")) {
       if (strstr(key->GetClassName(),"TDirectory")) {
@@ -883,16 +989,10 @@ TObject *TDirectoryFile::Get(const char *namecycle)
 
 //*-*---------------------Case of Key---------------------
 //                        ===========
-   TKey *key;
-   TIter nextkey(GetListOfKeys());
-   while ((key = (TKey *) nextkey())) {
-      if (strcmp(namobj,key->GetName()) == 0) {
-         if ((cycle == 9999) || (cycle == key->GetCycle())) {
-            TDirectory::TContext ctxt(this);
-            idcur = key->ReadObj();
-            break;
-         }
-      }
+   TKey *key = LookupKey(namobj, cycle, kTRUE);
+   if (key) {
+      TDirectory::TContext ctxt(this);
+      idcur = key->ReadObj();
    }
 
    return idcur;
@@ -992,16 +1092,10 @@ void *TDirectoryFile::GetObjectChecked(const char *namecycle, const TClass* expe
 //*-*---------------------Case of Key---------------------
 //                        ===========
    void *idcur = 0;
-   TKey *key;
-   TIter nextkey(GetListOfKeys());
-   while ((key = (TKey *) nextkey())) {
-      if (strcmp(namobj,key->GetName()) == 0) {
-         if ((cycle == 9999) || (cycle == key->GetCycle())) {
-            TDirectory::TContext ctxt(this);
-            idcur = key->ReadObjectAny(expectedClass);
-            break;
-         }
-      }
+   TKey *key = LookupKey(namobj, cycle, kTRUE);
+   if (key) {
+      TDirectory::TContext ctxt(this);
+      idcur = key->ReadObjectAny(expectedClass);
    }
 
    return idcur;
@@ -1018,6 +1112,49 @@ Int_t TDirectoryFile::GetBufferSize() const
    else                  return fBufferSize;
 }
 
+//______________________________________________________________________________
+TKey *TDirectoryFile::LookupKey(const char *name, Short_t cycle, Bool_t exact) const
+{
+   // Return the key with the given name and cycle, or 0.
+   // Only the hash bucket of fKeys holding name is scanned instead of the
+   // whole list of keys. If cycle is 9999 the highest cycle is returned,
+   // otherwise the key with exactly this cycle (exact is true) or with the
+   // highest cycle not above it (exact is false).
+
+   if (!fKeys) return 0;
+   if (fNkeysLazy) {
+      // Create the keys with this name that are still only in the key list record.
+      UInt_t hash = KeyNameHash(name, strlen(name));
+      UInt_t *first = std::lower_bound(fKeysHash, fKeysHash + fNkeysLazy, hash);
+      Int_t i = first - fKeysHash;
+      if (i < fNkeysLazy && fKeysHash[i] == hash) {
+         Long64_t fsize = fFile->GetSize();
+         for (; i < fNkeysLazy && fKeysHash[i] == hash; ++i) {
+            ((TDirectoryFile*)this)->LoadLazyKey(i, fsize);
+         }
+      }
+   }
+   TList *keys = fKeys;
+   if (fKeys->InheritsFrom(THashList::Class())) {
+      keys = ((THashList*)fKeys)->GetListForObject(name);
+      if (!keys) return 0;
+   }
+
+   TKey *found = 0;
+   TObjLink *lnk = keys->FirstLink();
+   while (lnk) {
+      TKey *key = (TKey*)lnk->GetObject();
+      lnk = lnk->Next();
+      if (strcmp(name, key->GetName())) continue;
+      if (cycle != 9999) {
+         if (exact  && key->GetCycle() != cycle) continue;
+         if (!exact && key->GetCycle() >  cycle) continue;
+      }
+      if (!found || key->GetCycle() > found->GetCycle()) found = key;
+   }
+   return found;
+}
+
 
 //______________________________________________________________________________
 TKey *TDirectoryFile::GetKey(const char *name, Short_t cycle) const
@@ -1026,14 +1163,96 @@ TKey *TDirectoryFile::GetKey(const char *name, Short_t cycle) const
 //*-*                  =====================================
 //  if cycle = 9999 returns highest cycle
 //
-   TKey *key;
-   TIter next(GetListOfKeys());
-   while ((key = (TKey *) next()))
-      if (!strcmp(name, key->GetName())) {
-         if (cycle == 9999)             return key;
-         if (cycle >= key->GetCycle())  return key;
-      }
-   return 0;
+   return LookupKey(name, cycle, kFALSE);
+}
+
+//______________________________________________________________________________
+Bool_t TDirectoryFile::GetLazyKeys()
+{
+   // Static function returning kTRUE if the keys of read-only directories
+   // are loaded on demand, see SetLazyKeys.
+
+   return fgLazyKeys;
+}
+
+//______________________________________________________________________________
+TList *TDirectoryFile::GetListOfKeys() const
+{
+   // Return the list of keys of this directory.
+   // If the keys are loaded lazily, all the keys not yet created are
+   // created first.
+
+   if (fNkeysLazy) ((TDirectoryFile*)this)->LoadAllKeys();
+   return fKeys;
+}
+
+//______________________________________________________________________________
+void TDirectoryFile::LoadAllKeys()
+{
+   // Create all the keys still pending in the lazily loaded key list and
+   // put the keys in fKeys in the order in which they were written.
+   // The key list record is released afterwards.
+
+   if (!fNkeysLazy) return;
+
+   TDirectory::TContext ctxt(this);
+
+   ReadKeysPages(0, fNbytesKeys);
+   std::vector<std::pair<Int_t,Int_t> > order(fNkeysLazy);
+   for (Int_t i = 0; i < fNkeysLazy; ++i) {
+      order[i] = std::make_pair(fKeysOffset[i], i);
+   }
+   std::sort(order.begin(), order.end());
+
+   fKeys->Clear("nodelete");
+   if (fKeys->InheritsFrom(THashList::Class()))
+      ((THashList*)fKeys)->Rehash(fNkeysLazy);
+   Long64_t fsize = fFile->GetSize();
+   for (Int_t k = 0; k < fNkeysLazy; ++k) {
+      Int_t i = order[k].second;
+      if (fKeysLoaded[i]) fKeys->Add(fKeysLoaded[i]);
+      else                LoadLazyKey(i, fsize);
+   }
+   ReleaseLazyKeys();
+}
+
+//______________________________________________________________________________
+TKey *TDirectoryFile::LoadLazyKey(Int_t i, Long64_t fsize)
+{
+   // Create the key number i of the lazily loaded key list from its header
+   // in fKeysBuffer and add it to fKeys.
+   // Return 0 if the key header is not valid.
+
+   if (fKeysLoaded[i]) return fKeysLoaded[i];
+
+   // The length of the key header is stored at byte 14 of the header.
+   Int_t offset = fKeysOffset[i];
+   Short_t keylen = 0;
+   if (offset + 18 <= fNbytesKeys && ReadKeysPages(offset, 18)) {
+      char *buffer = fKeysBuffer + offset + 14;
+      frombuf(buffer, &keylen);
+   }
+   const char *name = 0;
+   Int_t len = 0;
+   char *buffer = fKeysBuffer + offset;
+   if (keylen < 18 || offset + keylen > fNbytesKeys || !ReadKeysPages(offset, keylen)
+       || !SkipKeyHeader(buffer, fKeysBuffer + offset + keylen, name, len)) {
+      Error("ReadKeys","reading illegal key header at offset %d",offset);
+      return 0;
+   }
+
+   TKey *key = new TKey(this);
+   buffer = fKeysBuffer + offset;
+   key->ReadKeyBuffer(buffer);
+   if (key->GetSeekKey() < 64 || key->GetSeekKey() > fsize ||
+       key->GetSeekPdir() < 64 || key->GetSeekPdir() > fsize) {
+      Error("ReadKeys","reading illegal key %s",key->GetName());
+      delete key;
+      return 0;
+   }
+   fKeys->Add(key);
+   fKeysLoaded[i] = key;
+   return key;
 }
 
 //______________________________________________________________________________
@@ -1247,6 +1466,7 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
    char *buffer;
    if (forceRead) {
       fKeys->Delete();
+      ReleaseLazyKeys();
       //In case directory was updated by another process, read new
       //position for the keys
       Int_t nbytes = fNbytesName + TDirectoryFile::Sizeof();
@@ -1278,6 +1498,10 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
       delete [] header;
    }
 
+   if (fgLazyKeys && fSeekKeys > 0 && !fFile->IsWritable()) {
+      return ReadKeysLazy();
+   }
+
    Int_t nkeys = 0;
    Long64_t fsize = fFile->GetSize();
    if ( fSeekKeys >  0) {
@@ -1288,6 +1512,9 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 
       TKey *key;
       frombuf(buffer, &nkeys);
+      // Size the hash table once instead of rehashing while adding the keys.
+      if (nkeys > fKeys->GetSize() && fKeys->InheritsFrom(THashList::Class()))
+         ((THashList*)fKeys)->Rehash(nkeys);
       for (Int_t i = 0; i < nkeys; i++) {
          key = new TKey(this);
          key->ReadKeyBuffer(buffer);
@@ -1311,6 +1538,295 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
    return nkeys;
 }
 
+//______________________________________________________________________________
+Int_t TDirectoryFile::ReadKeysLazy()
+{
+   // Prepare the lazy loading of the keys of this directory.
+   // Only the name index at the end of the key list record is read and no
+   // TKey is created: LookupKey creates the keys of a name when the name is
+   // first looked up and LoadAllKeys creates the others when the full list
+   // is requested. The record is read in pages, as needed. For files
+   // written without the name index the record is read entirely once and
+   // the index is built in memory from the key headers.
+
+   ReleaseLazyKeys();
+   if (fNbytesKeys < 22) return 0;
+
+   Int_t npages = (fNbytesKeys + kKeysPageSize - 1) / kKeysPageSize;
+   fKeysBuffer  = new char[fNbytesKeys];
+   fKeysPages   = new Char_t[npages];
+   memset(fKeysPages, 0, npages);
+
+   // Skip the key header of the record and read the number of keys.
+   char   *buffer;
+   Short_t keylen = 0;
+   Int_t   nkeys  = 0;
+   if (ReadKeysPages(0, 18)) {
+      buffer = fKeysBuffer + 14;
+      frombuf(buffer, &keylen);
+   }
+   if (keylen < 18 || keylen + 4 > fNbytesKeys || !ReadKeysPages(keylen, 4)) {
+      Error("ReadKeys","cannot read the list of keys of %s",GetName());
+      ReleaseLazyKeys();
+      return 0;
+   }
+   buffer = fKeysBuffer + keylen;
+   frombuf(buffer, &nkeys);
+
+   std::vector<std::pair<UInt_t,Int_t> > entries;
+   Int_t ndata = fNbytesKeys - keylen;
+   if (nkeys > 0 && ndata >= 16 && ReadKeysPages(fNbytesKeys - 8, 8)) {
+      Int_t  pos;
+      UInt_t magic;
+      buffer = fKeysBuffer + fNbytesKeys - 8;
+      frombuf(buffer, &pos);
+      frombuf(buffer, &magic);
+      if (magic == kKeysIndexMagic && pos >= 4 && pos + 4 + 8*(Long64_t)nkeys <= ndata - 8
+          && ReadKeysPages(keylen + pos, 4 + 8*nkeys)) {
+         Int_t n;
+         buffer = fKeysBuffer + keylen + pos;
+         frombuf(buffer, &n);
+         if (n == nkeys) {
+            entries.reserve(nkeys);
+            for (Int_t i = 0; i < nkeys; ++i) {
+               UInt_t hash;
+               Int_t  offset;
+               frombuf(buffer, &hash);
+               frombuf(buffer, &offset);
+               if (offset < 4 || offset >= pos) {
+                  entries.clear();
+                  break;
+               }
+               entries.push_back(std::make_pair(hash, keylen + offset));
+            }
+         }
+      }
+   }
+   if (nkeys > 0 && entries.empty()) {
+      // No usable name index, build it from the key headers.
+      if (!ReadKeysPages(keylen, ndata)) {
+         Error("ReadKeys","cannot read the list of keys of %s",GetName());
+         ReleaseLazyKeys();
+         return 0;
+      }
+      const char *end = fKeysBuffer + fNbytesKeys;
+      buffer = fKeysBuffer + keylen + 4;
+      entries.reserve(nkeys);
+      for (Int_t i = 0; i < nkeys; ++i) {
+         Int_t offset = buffer - fKeysBuffer;
+         const char *name = 0;
+         Int_t len = 0;
+         if (!SkipKeyHeader(buffer, end, name, len)) {
+            Error("ReadKeys","reading illegal key, exiting after %d keys",i);
+            break;
+         }
+         entries.push_back(std::make_pair(KeyNameHash(name, len), offset));
+      }
+   }
+   if (entries.empty()) {
+      ReleaseLazyKeys();
+      return 0;
+   }
+
+   std::sort(entries.begin(), entries.end());
+   fNkeysLazy  = entries.size();
+   fKeysHash   = new UInt_t[fNkeysLazy];
+   fKeysOffset = new Int_t[fNkeysLazy];
+   fKeysLoaded = new TKey*[fNkeysLazy];
+   for (Int_t i = 0; i < fNkeysLazy; ++i) {
+      fKeysHash[i]   = entries[i].first;
+      fKeysOffset[i] = entries[i].second;
+      fKeysLoaded[i] = 0;
+   }
+   return fNkeysLazy;
+}
+
+//______________________________________________________________________________
+Bool_t TDirectoryFile::ReadKeysPages(Int_t pos, Int_t len)
+{
+   // Make sure that the bytes [pos, pos+len) of the key list record are in
+   // fKeysBuffer, reading the pages not read yet. Consecutive missing pages
+   // are read with a single request.
+   // Return kFALSE in case of a read error.
+
+   if (!fKeysBuffer || pos < 0 || len < 0 || pos + (Long64_t)len > fNbytesKeys) return kFALSE;
+   if (len == 0) return kTRUE;
+
+   Int_t page = pos / kKeysPageSize;
+   Int_t last = (pos + len - 1) / kKeysPageSize;
+   while (page <= last) {
+      if (fKeysPages[page]) {
+         ++page;
+         continue;
+      }
+      Int_t end = page;
+      while (end < last && !fKeysPages[end+1]) ++end;
+      Int_t start  = page * kKeysPageSize;
+      Int_t nbytes = (end + 1 == (fNbytesKeys + kKeysPageSize - 1) / kKeysPageSize)
+                   ? fNbytesKeys - start : (end + 1 - page) * kKeysPageSize;
+      if (fFile->ReadBuffer(fKeysBuffer + start, fSeekKeys + start, nbytes)) {
+         // ReadBuffer returns kTRUE in case of failure.
+         return kFALSE;
+      }
+      for (Int_t k = page; k <= end; ++k) fKeysPages[k] = 1;
+      page = end + 1;
+   }
+   return kTRUE;
+}
+
+
+//______________________________________________________________________________
+void TDirectoryFile::ReleaseLazyKeys()
+{
+   // Release the key list record and the name index of a lazily loaded
+   // key list. The keys already created are owned by fKeys.
+
+   delete [] fKeysBuffer;  fKeysBuffer = 0;
+   delete [] fKeysPages;   fKeysPages  = 0;
+   delete [] fKeysHash;    fKeysHash   = 0;
+   delete [] fKeysOffset;  fKeysOffset = 0;
+   delete [] fKeysLoaded;  fKeysLoaded = 0;
+   fNkeysLazy = 0;
+}
+
+//______________________________________________________________________________
+Int_t TDirectoryFile::ReadObjects(Int_t n, const char **namecycles, TObject **objects, Int_t nthreads)
+{
+   // Read the n objects identified by namecycles (see Get for the format)
+   // and store them in objects. objects[i] is 0 if namecycles[i] is not
+   // found or cannot be read. Return the number of objects read.
+   //
+   // This is faster than calling Get n times: the records of all the keys
+   // are read with a single vectored TFile::ReadBuffers call, then the
+   // compressed records are uncompressed by nthreads threads (by default
+   // one per CPU, at most 8; 0 or 1 uncompresses in the calling thread).
+   // The objects are finally streamed in the calling thread, in the order
+   // of namecycles.
+   //
+   // Unlike Get, the objects are always read from their keys: an object of
+   // the same name already in memory is not returned, and each call gives
+   // new objects. As with Get, the objects like histograms and trees are
+   // added to this directory, the others belong to the caller.
+
+   if (n <= 0) return 0;
+   for (Int_t i = 0; i < n; ++i) objects[i] = 0;
+   if (!fFile) return 0;
+
+   TDirectory::TContext ctxt(this);
+
+   if (!fFile->IsBinary()) {
+      Int_t nread = 0;
+      for (Int_t i = 0; i < n; ++i) {
+         objects[i] = Get(namecycles[i]);
+         if (objects[i]) ++nread;
+      }
+      return nread;
+   }
+
+   // Find the keys and sort their records by position in the file.
+   std::vector<std::pair<Long64_t,Int_t> > order;
+   std::vector<TKey*> keys(n, (TKey*)0);
+   Long64_t nbytes = 0;
+   for (Int_t i = 0; i < n; ++i) {
+      Short_t cycle;
+      char    name[kMaxLen];
+      DecodeNameCycle(namecycles[i], name, cycle);
+      keys[i] = LookupKey(name, cycle, kTRUE);
+      if (!keys[i]) continue;
+      order.push_back(std::make_pair(keys[i]->GetSeekKey(), i));
+      nbytes += keys[i]->GetNbytes();
+   }
+   Int_t nrec = order.size();
+   if (!nrec) return 0;
+   std::sort(order.begin(), order.end());
+
+   // Read all the records at once.
+   char *records = new char[nbytes];
+   std::vector<Long64_t> pos(nrec);
+   std::vector<Int_t>    len(nrec);
+   std::vector<TDirectoryFileUnzip> recs(nrec);
+   Long64_t offset = 0;
+   for (Int_t k = 0; k < nrec; ++k) {
+      TKey *key = keys[order[k].second];
+      pos[k] = key->GetSeekKey();
+      len[k] = key->GetNbytes();
+      recs[k].fKey    = key;
+      recs[k].fRecord = records + offset;
+      recs[k].fObject = new char[key->GetKeylen() + key->GetObjlen()];
+      recs[k].fOk     = kFALSE;
+      offset += len[k];
+   }
+   if (fFile->ReadBuffers(records, &pos[0], &len[0], nrec)) {
+      // ReadBuffers returns kTRUE in case of failure.
+      Error("ReadObjects","cannot read the records of %d keys from %s",nrec,fFile->GetName());
+      for (Int_t k = 0; k < nrec; ++k) delete [] recs[k].fObject;
+      delete [] records;
+      return 0;
+   }
+
+   // Copy the uncompressed records, collect the compressed ones.
+   std::vector<TDirectoryFileUnzip> zipped;
+   std::vector<Int_t> zippedIndex;
+   for (Int_t k = 0; k < nrec; ++k) {
+      TKey *key = recs[k].fKey;
+      if (key->GetObjlen() > key->GetNbytes() - key->GetKeylen()) {
+         memcpy(recs[k].fObject, recs[k].fRecord, key->GetKeylen());
+         zipped.push_back(recs[k]);
+         zippedIndex.push_back(k);
+      } else {
+         memcpy(recs[k].fObject, recs[k].fRecord, key->GetKeylen() + key->GetObjlen());
+         recs[k].fOk = kTRUE;
+      }
+   }
+
+   // Uncompress in parallel.
+   Int_t nzip = zipped.size();
+   if (nzip) {
+      if (nthreads < 0) {
+         SysInfo_t info;
+         nthreads = (gSystem->GetSysInfo(&info) == 0) ? info.fCpus : 1;
+         if (nthreads > kMaxUnzipThreads) nthreads = kMaxUnzipThreads;
+      }
+      if (nthreads > nzip) nthreads = nzip;
+      if (nthreads < 1) nthreads = 1;
+      std::vector<TDirectoryFileUnzipRange> ranges(nthreads);
+      std::vector<TThread*> threads(nthreads, (TThread*)0);
+      for (Int_t t = 0; t < nthreads; ++t) {
+         ranges[t].fRecords = &zipped[0];
+         ranges[t].fN       = nzip;
+         ranges[t].fFirst   = t;
+         ranges[t].fStride  = nthreads;
+      }
+      for (Int_t t = 1; t < nthreads; ++t) {
+         threads[t] = new TThread(UnzipRecords, (void*)&ranges[t]);
+         threads[t]->Run();
+      }
+      UnzipRecords(&ranges[0]);
+      for (Int_t t = 1; t < nthreads; ++t) {
+         threads[t]->Join();
+         delete threads[t];
+      }
+      for (Int_t z = 0; z < nzip; ++z) recs[zippedIndex[z]].fOk = zipped[z].fOk;
+   }
+   delete [] records;
+
+   // Stream the objects in the requested order.
+   std::vector<Int_t> recordOf(n, -1);
+   for (Int_t k = 0; k < nrec; ++k) recordOf[order[k].second] = k;
+   Int_t nread = 0;
+   for (Int_t i = 0; i < n; ++i) {
+      Int_t k = recordOf[i];
+      if (k < 0) continue;
+      if (!recs[k].fOk) {
+         Error("ReadObjects","cannot uncompress %s",namecycles[i]);
+         delete [] recs[k].fObject;
+         continue;
+      }
+      objects[i] = keys[i]->ReadObjWithUnzippedBuffer(recs[k].fObject);
+      if (objects[i]) ++nread;
+   }
+   return nread;
+}
 
 //______________________________________________________________________________
 Int_t TDirectoryFile::ReadTObject(TObject *obj, const char *keyname)
@@ -1365,6 +1881,7 @@ void TDirectoryFile::ResetAfterMerge(TFileMergeInfo *info)
    if (fKeys) {
       fKeys->Delete("slow");
    }
+   ReleaseLazyKeys();
 
    Init(cl);
 
@@ -1511,6 +2028,20 @@ void TDirectoryFile::SetTRefAction(TObject *ref, TObject *parent)
    }
 }
 
+//______________________________________________________________________________
+void TDirectoryFile::SetLazyKeys(Bool_t lazy)
+{
+   // Static function to enable the lazy loading of the keys of directories
+   // of files opened in read mode.
+   // When enabled, reading a directory only reads the name index of its
+   // list of keys; a TKey is created when its name is looked up (Get,
+   // GetKey, FindKey, ...). GetListOfKeys() still creates all the keys.
+   // This makes extracting a few objects from a directory with a very large
+   // number of keys much faster and cheaper in memory.
+
+   fgLazyKeys = lazy;
+}
+
 //______________________________________________________________________________
 void TDirectoryFile::SetWritable(Bool_t writable)
 {
@@ -1518,6 +2049,7 @@ void TDirectoryFile::SetWritable(Bool_t writable)
 
    TDirectory::TContext ctxt(this);
 
+   if (writable && fNkeysLazy) LoadAllKeys();
    fWritable = writable;
 
    // recursively set all sub-directories
@@ -1997,6 +2529,8 @@ void TDirectoryFile::WriteKeys()
       return;
    }
 
+   if (fNkeysLazy) LoadAllKeys();
+
 //*-* Delete the old keys structure if it exists
    if (fSeekKeys != 0) {
       f->MakeFree(fSeekKeys, fSeekKeys + fNbytesKeys -1);
@@ -2010,18 +2544,37 @@ void TDirectoryFile::WriteKeys()
    while ((key = (TKey*)next())) {
       nbytes += key->Sizeof();
    }
+   nbytes += sizeof nkeys + 8*nkeys + 8; //*-* Name index and its trailer
    TKey *headerkey  = new TKey(fName,fTitle,IsA(),nbytes,this);
    if (headerkey->GetSeekKey() == 0) {
       delete headerkey;
       return;
    }
    char *buffer = headerkey->GetBuffer();
+   char *start  = buffer;
+   std::vector<std::pair<UInt_t,Int_t> > index;
+   index.reserve(nkeys);
    next.Reset();
    tobuf(buffer, nkeys);
    while ((key = (TKey*)next())) {
+      index.push_back(std::make_pair(KeyNameHash(key->GetName(), strlen(key->GetName())), Int_t(buffer - start)));
       key->FillBuffer(buffer);
    }
 
+//*-* Write the name index used by ReadKeysLazy after the key headers, as
+//*-* (hash, offset) pairs sorted by hash, and locate it with a trailer at
+//*-* the end of the record. Older readers stop after the last key header.
+   std::sort(index.begin(), index.end());
+   Int_t indexpos = buffer - start;
+   tobuf(buffer, nkeys);
+   for (Int_t i = 0; i < nkeys; ++i) {
+      tobuf(buffer, index[i].first);
+      tobuf(buffer, index[i].second);
+   }
+   buffer = start + nbytes - 8;
+   tobuf(buffer, indexpos);
+   tobuf(buffer, kKeysIndexMagic);
+
    fSeekKeys     = headerkey->GetSeekKey();
    fNbytesKeys   = headerkey->GetNbytes();
    headerkey->WriteFile();
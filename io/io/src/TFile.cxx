@@ -114,6 +114,7 @@
 #include "compiledata.h"
 #include <cmath>
 #include <set>
+#include <vector>
 #include "TSchemaRule.h"
 #include "TSchemaRuleSet.h"
 #include "TThreadSlots.h"
@@ -124,6 +125,7 @@ Long64_t TFile::fgFileCounter = 0;
 Int_t    TFile::fgReadaheadSize = 256000;
 Int_t    TFile::fgReadCalls = 0;
 Bool_t   TFile::fgReadInfo = kTRUE;
+Bool_t   TFile::fgReadInfoOnDemand = kFALSE;
 TList   *TFile::fgAsyncOpenRequests = 0;
 TString  TFile::fgCacheFileDir;
 Bool_t   TFile::fgCacheFileForce = kFALSE;
@@ -135,6 +137,15 @@ const Int_t kBEGIN = 100;
 
 ClassImp(TFile)
 
+//______________________________________________________________________________
+static Bool_t R__ReadInfoOnDemand()
+{
+   // Return true if the StreamerInfo record of read-only files is read on
+   // demand (see TFile::SetReadStreamerInfoOnDemand).
+
+   return TFile::GetReadStreamerInfoOnDemand() || gEnv->GetValue("TFile.ReadStreamerInfoOnDemand", 0);
+}
+
 //*-*x17 macros/layout_file
 
 //______________________________________________________________________________
@@ -165,6 +176,7 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
    fIsArchive       = kFALSE;
    fInitDone        = kFALSE;
    fMustFlush       = kTRUE;
+   fInfoPending     = kFALSE;
    fAsyncHandle     = 0;
    fAsyncOpenStatus = kAOSNotAsync;
    SetBit(kBinaryFile, kTRUE);
@@ -315,6 +327,7 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
    // Init initialization control flag
    fInitDone   = kFALSE;
    fMustFlush  = kTRUE;
+   fInfoPending = kFALSE;
 
    // We are opening synchronously
    fAsyncHandle = 0;
@@ -804,7 +817,12 @@ void TFile::Init(Bool_t create)
       if (lenIndex < 5000) lenIndex = 5000;
       fClassIndex = new TArrayC(lenIndex);
       if (fgReadInfo) {
-         if (fSeekInfo > fBEGIN) {
+         if (fSeekInfo > fBEGIN && !fWritable &&
+             R__ReadInfoOnDemand()) {
+            // Read the StreamerInfo record only when a class needs it
+            // (see SetReadStreamerInfoOnDemand).
+            fInfoPending = kTRUE;
+         } else if (fSeekInfo > fBEGIN) {
             ReadStreamerInfo();
             if (IsZombie()) {
                R__LOCKGUARD2(gROOTMutex);
@@ -818,7 +836,17 @@ void TFile::Init(Bool_t create)
    }
 
    // Count number of TProcessIDs in this file
-   {
+   if (IsLazy()) {
+      // Do not create all the keys, look up ProcessID0, ProcessID1, ...
+      // as written by WriteProcessID.
+      char pidname[32];
+      snprintf(pidname,32,"ProcessID%d",fNProcessIDs);
+      while (GetKey(pidname)) {
+         fNProcessIDs++;
+         snprintf(pidname,32,"ProcessID%d",fNProcessIDs);
+      }
+      fProcessIDs = new TObjArray(fNProcessIDs+1);
+   } else {
       TIter next(fKeys);
       TKey *key;
       while ((key = (TKey*)next())) {
@@ -1251,35 +1279,8 @@ TList *TFile::GetStreamerInfoList()
    //   Int_t classversionid = info->GetClassVersion();
    //   delete list;
 
-   TList *list = 0;
-   if (fSeekInfo) {
-      TDirectory::TContext ctx(gDirectory,this); // gFile and gDirectory used in ReadObj
-      TKey *key = new TKey(this);
-      char *buffer = new char[fNbytesInfo+1];
-      char *buf    = buffer;
-      Seek(fSeekInfo);
-      if (ReadBuffer(buf,fNbytesInfo)) {
-         // ReadBuffer returns kTRUE in case of failure.
-         Warning("GetRecordHeader","%s: failed to read the StreamerInfo data from disk.",
-                 GetName());
-         return 0;
-      }
-      key->ReadKeyBuffer(buf);
-      list = dynamic_cast<TList*>(key->ReadObjWithBuffer(buffer));
-      if (list) list->SetOwner();
-      delete [] buffer;
-      delete key;
-   } else {
-      list = (TList*)Get("StreamerInfo"); //for versions 2.26 (never released)
-   }
-
-   if (list == 0) {
-      Info("GetStreamerInfoList", "cannot find the StreamerInfo record in file %s",
-           GetName());
-      return 0;
-   }
-
-   return list;
+   Bool_t known;
+   return GetStreamerInfoListImpl(0, known);
 }
 
 //______________________________________________________________________________
@@ -1566,6 +1567,9 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
    // This function is overloaded by TNetFile, TWebFile, etc.
    // Returns kTRUE in case of failure.
 
+   // The blocks written behind by the write cache must have reached the file.
+   if (fWritable && fCacheWrite) fCacheWrite->WaitForWrite();
+
    // called with buf=0, from TFileCacheRead to pass list of readahead buffers
    if (!buf) {
       for (Int_t j = 0; j < nbuf; j++) {
@@ -1952,6 +1956,10 @@ Int_t TFile::ReOpen(Option_t *mode)
       }
       SetWritable(kTRUE);
 
+      // The list of classes used by this file is needed to update its
+      // StreamerInfo record.
+      ReadPendingStreamerInfo();
+
       fFree = new TList;
       if (fSeekFree > fBEGIN)
          ReadFree();
@@ -3310,6 +3318,97 @@ Int_t TFile::MakeProjectParProofInf(const char *pack, const char *proofinf)
    return 0;
 }
 
+// The StreamerInfo records already read in this process, with the number of
+// the TStreamerInfo objects they describe. Files written by the same job
+// usually have byte for byte identical records, whose TStreamerInfo objects
+// are then already registered: only the index of the classes used by the
+// new file has to be filled.
+namespace {
+   struct TStreamerInfoRecord {
+      TString             fPayload;   // Compressed content of the record
+      std::vector<Int_t>  fNumbers;   // Numbers of the TStreamerInfo objects it describes
+   };
+}
+static const UInt_t kMaxStreamerInfoRecords = 16;
+static std::vector<TStreamerInfoRecord> gStreamerInfoRecords;
+static UInt_t gNextStreamerInfoRecord = 0;
+
+//______________________________________________________________________________
+TList *TFile::GetStreamerInfoListImpl(TString *payload, Bool_t &known)
+{
+   // Read the list of TStreamerInfo objects written to this file, see
+   // GetStreamerInfoList.
+   // If payload is given, it is set to the compressed content of the
+   // record. If an identical record has already been read by
+   // ReadStreamerInfo in this process, the index of the classes of this
+   // file is filled from it, known is set to true and 0 is returned.
+
+   known = kFALSE;
+   TList *list = 0;
+   if (fSeekInfo) {
+      TDirectory::TContext ctx(gDirectory,this); // gFile and gDirectory used in ReadObj
+      TKey *key = new TKey(this);
+      char *buffer = new char[fNbytesInfo+1];
+      char *buf    = buffer;
+      Seek(fSeekInfo);
+      if (ReadBuffer(buf,fNbytesInfo)) {
+         // ReadBuffer returns kTRUE in case of failure.
+         Warning("GetRecordHeader","%s: failed to read the StreamerInfo data from disk.",
+                 GetName());
+         delete [] buffer;
+         delete key;
+         return 0;
+      }
+      key->ReadKeyBuffer(buf);
+      if (payload && key->GetKeylen() > 0 && key->GetKeylen() < fNbytesInfo) {
+         payload->Append(buffer + key->GetKeylen(), fNbytesInfo - key->GetKeylen());
+         R__LOCKGUARD2(gROOTMutex);
+         for (UInt_t r = 0; r < gStreamerInfoRecords.size() && !known; ++r) {
+            if (gStreamerInfoRecords[r].fPayload != *payload) continue;
+            const std::vector<Int_t> &numbers = gStreamerInfoRecords[r].fNumbers;
+            for (UInt_t n = 0; n < numbers.size(); ++n) {
+               Int_t uid = numbers[n];
+               if (uid >= fClassIndex->GetSize()) fClassIndex->Set(2*uid);
+               fClassIndex->fArray[uid] = 1;
+            }
+            fClassIndex->fArray[0] = 0;
+            if (gDebug > 0) Info("GetStreamerInfoList", "record of file %s already read", GetName());
+            known = kTRUE;
+         }
+      }
+      if (!known) {
+         list = dynamic_cast<TList*>(key->ReadObjWithBuffer(buffer));
+         if (list) list->SetOwner();
+      }
+      delete [] buffer;
+      delete key;
+      if (known) return 0;
+   } else {
+      list = (TList*)Get("StreamerInfo"); //for versions 2.26 (never released)
+   }
+
+   if (list == 0) {
+      Info("GetStreamerInfoList", "cannot find the StreamerInfo record in file %s",
+           GetName());
+      return 0;
+   }
+
+   return list;
+}
+
+//______________________________________________________________________________
+Bool_t TFile::ReadPendingStreamerInfo()
+{
+   // Read the StreamerInfo record of this file if it has been deferred
+   // (see SetReadStreamerInfoOnDemand). Return kTRUE if the record was read
+   // by this call, i.e. if new TStreamerInfo may have been registered.
+
+   if (!fInfoPending) return kFALSE;
+   if (gDebug > 0) Info("ReadPendingStreamerInfo", "reading the deferred StreamerInfo record of %s", GetName());
+   ReadStreamerInfo();
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 void TFile::ReadStreamerInfo()
 {
@@ -3318,12 +3417,28 @@ void TFile::ReadStreamerInfo()
    // The corresponding TClass objects are updated.
    // Note that this function is not called if the static member fgReadInfo is falsse.
    //  (see TFile::SetReadStreamerInfo)
+   // When the StreamerInfo are read on demand (see SetReadStreamerInfoOnDemand),
+   // the TStreamerInfo objects of a record identical to one already read
+   // from another file in this process are not read again.
 
-   TList *list = GetStreamerInfoList();
+   fInfoPending = kFALSE;
+
+   // The records already read are only looked up when the StreamerInfo
+   // are read on demand, otherwise every record goes through BuildCheck.
+   TList *list = 0;
+   TString payload;
+   if (fSeekInfo && R__ReadInfoOnDemand()) {
+      Bool_t known = kFALSE;
+      list = GetStreamerInfoListImpl(&payload, known);
+      if (known) return;
+   } else {
+      list = GetStreamerInfoList();
+   }
    if (!list) {
       MakeZombie();
       return;
    }
+   std::vector<Int_t> numbers;
 
    list->SetOwner(kFALSE);
 
@@ -3377,8 +3492,10 @@ void TFile::ReadStreamerInfo()
             Int_t uid = info->GetNumber();
             Int_t asize = fClassIndex->GetSize();
             if (uid >= asize && uid <100000) fClassIndex->Set(2*asize);
-            if (uid >= 0 && uid < fClassIndex->GetSize()) fClassIndex->fArray[uid] = 1;
-            else {
+            if (uid >= 0 && uid < fClassIndex->GetSize()) {
+               fClassIndex->fArray[uid] = 1;
+               numbers.push_back(uid);
+            } else {
                printf("ReadStreamerInfo, class:%s, illegal uid=%d\n",info->GetName(),uid);
             }
             if (gDebug > 0) printf(" -class: %s version: %d info read at slot %d\n",info->GetName(), info->GetClassVersion(),uid);
@@ -3389,6 +3506,18 @@ void TFile::ReadStreamerInfo()
    fClassIndex->fArray[0] = 0;
    list->Clear();  //this will delete all TStreamerInfo objects with kCanDelete bit set
    delete list;
+
+   if (payload.Length()) {
+      R__LOCKGUARD2(gROOTMutex);
+      if (gStreamerInfoRecords.size() < kMaxStreamerInfoRecords) {
+         gStreamerInfoRecords.push_back(TStreamerInfoRecord());
+         gNextStreamerInfoRecord = gStreamerInfoRecords.size() - 1;
+      }
+      TStreamerInfoRecord &record = gStreamerInfoRecords[gNextStreamerInfoRecord];
+      record.fPayload = payload;
+      record.fNumbers.swap(numbers);
+      gNextStreamerInfoRecord = (gNextStreamerInfoRecord + 1) % kMaxStreamerInfoRecords;
+   }
 }
 
 //______________________________________________________________________________
@@ -3406,6 +3535,34 @@ void TFile::SetReadStreamerInfo(Bool_t readinfo)
    fgReadInfo = readinfo;
 }
 
+//______________________________________________________________________________
+void TFile::SetReadStreamerInfoOnDemand(Bool_t ondemand)
+{
+   // Static function to defer the reading of the StreamerInfo record of
+   // files opened read-only until it is actually needed, i.e. when an
+   // object of a class without dictionary, or of a class version other
+   // than the one in memory, is read. This speeds up the opening of many
+   // files from which only a few objects are read.
+   // The default can also be set with the rootrc variable
+   // TFile.ReadStreamerInfoOnDemand.
+   // In this mode a record identical to one already read from another file
+   // (as for files written by the same job) is not read again, only the
+   // index of the classes of the file is filled.
+   // Note that in this mode a class whose layout changed without a change
+   // of its version number is not detected.
+
+   fgReadInfoOnDemand = ondemand;
+}
+
+//______________________________________________________________________________
+Bool_t TFile::GetReadStreamerInfoOnDemand()
+{
+   // Static function returning true if the reading of the StreamerInfo
+   // record of read-only files is deferred (see SetReadStreamerInfoOnDemand).
+
+   return fgReadInfoOnDemand;
+}
+
 //______________________________________________________________________________
 void TFile::ShowStreamerInfo()
 {
@@ -3946,6 +4103,10 @@ TFile *TFile::Open(const char *url, Option_t *options, const char *ftitle,
    if (type != kLocal && type != kFile &&
        f && f->IsWritable() && !f->IsRaw()) {
       new TFileCacheWrite(f, 1);
+   } else if (f && f->IsWritable() && !f->IsRaw() && !f->GetCacheWrite() &&
+              gEnv->GetValue("TFileCacheWrite.WriteBehind", 0)) {
+      // local file written by the I/O thread of a write-behind cache
+      new TFileCacheWrite(f, 1);
    }
 
    return f;
@@ -4103,6 +4264,24 @@ TFile *TFile::Open(TFileOpenHandle *fh)
    return f;
 }
 
+//______________________________________________________________________________
+void TFile::CancelAsyncOpen(TFileOpenHandle *fh)
+{
+   // Discard an asynchronous open request submitted with TFile::AsyncOpen
+   // whose result is no longer needed: the request is removed from the
+   // list of pending requests, the file being opened (if any) is deleted
+   // and so is the handle.
+
+   if (!fh) return;
+   if (fgAsyncOpenRequests) fgAsyncOpenRequests->Remove(fh);
+   TFile *f = fh->GetFile();
+   if (f) {
+      f->fAsyncHandle = 0;
+      delete f;
+   }
+   delete fh;
+}
+
 //______________________________________________________________________________
 Int_t TFile::SysOpen(const char *pathname, Int_t flags, UInt_t mode)
 {
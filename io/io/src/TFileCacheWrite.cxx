@@ -23,11 +23,26 @@
 // The write cache is automatically created when writing a remote file  //
 // (created in TFile::Open()).                                          //
 //                                                                      //
+// In write-behind mode (see SetWriteBehind) a full buffer is handed    //
+// over to a dedicated I/O thread and the filling continues in a second //
+// buffer, so that the producer does not wait for the file system.      //
+//                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 
 #include "TFile.h"
 #include "TFileCacheWrite.h"
+#include "TCondition.h"
+#include "TEnv.h"
+#include "TMutex.h"
+#include "TThread.h"
+#include "TVirtualMonitoring.h"
+
+#include <errno.h>
+#include <string.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 ClassImp(TFileCacheWrite)
 
@@ -42,6 +57,18 @@ TFileCacheWrite::TFileCacheWrite() : TObject()
    fFile        = 0;
    fBuffer      = 0;
    fRecursive   = kFALSE;
+   fWriteBehind = kFALSE;
+   fSpare       = 0;
+   fInFlight    = 0;
+   fPending     = 0;
+   fPendingSeek = 0;
+   fPendingLen  = 0;
+   fPendingFd   = -1;
+   fAsyncErrno  = 0;
+   fStop        = kFALSE;
+   fThread      = 0;
+   fMutex       = 0;
+   fCondition   = 0;
 }
 
 //_____________________________________________________________________________
@@ -52,6 +79,8 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
    // The write cache will be connected to file.
    // The size of the cache will be buffersize,
    // if buffersize < 10000 a default size of 512 Kbytes is used
+   // The write-behind mode is enabled if TFileCacheWrite.WriteBehind
+   // is set in the system.rootrc.
 
    if (buffersize < 10000) buffersize = 512000;
    fBufferSize  = buffersize;
@@ -60,7 +89,20 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
    fFile        = file;
    fRecursive   = kFALSE;
    fBuffer      = new char[fBufferSize];
+   fWriteBehind = kFALSE;
+   fSpare       = 0;
+   fInFlight    = 0;
+   fPending     = 0;
+   fPendingSeek = 0;
+   fPendingLen  = 0;
+   fPendingFd   = -1;
+   fAsyncErrno  = 0;
+   fStop        = kFALSE;
+   fThread      = 0;
+   fMutex       = 0;
+   fCondition   = 0;
    if (file) file->SetCacheWrite(this);
+   if (gEnv->GetValue("TFileCacheWrite.WriteBehind", 0)) SetWriteBehind(kTRUE);
    if (gDebug > 0) Info("TFileCacheWrite","Creating a write cache with buffersize=%d bytes",buffersize);
 }
 
@@ -68,26 +110,98 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
 TFileCacheWrite::~TFileCacheWrite()
 {
    // Destructor.
+   // The I/O thread completes the write in flight (if any) before exiting.
 
+   if (fThread) {
+      fMutex->Lock();
+      fStop = kTRUE;
+      fCondition->Broadcast();
+      fMutex->UnLock();
+      fThread->Join();
+      delete fThread;
+   }
+   delete fCondition;
+   delete fMutex;
+   delete [] fSpare;
    delete [] fBuffer;
 }
 
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::CanWriteBehind() const
+{
+   // Return true if the file can be written by the I/O thread, which is
+   // the case of the local files accessed through a file descriptor.
+   // The other TFile implementations keep the synchronous writes.
+
+#ifndef WIN32
+   return fFile && fFile->IsA() == TFile::Class() && fFile->GetFd() >= 0;
+#else
+   return kFALSE;
+#endif
+}
+
 //_____________________________________________________________________________
 Bool_t TFileCacheWrite::Flush()
 {
    // Flush the current write buffer to the file.
-   // Returns kTRUE in case of error.
+   // In write-behind mode, also wait for the completion of the write in
+   // flight so that all the data has reached the file on return (for
+   // example before TFile::Flush syncs it or before the file is closed).
+   // Returns kTRUE in case of error, including the failure of a previous
+   // asynchronous write.
 
-   if (!fNtot) return kFALSE;
+   Bool_t status = WaitForWrite();
+   if (!fNtot) return status;
    fFile->Seek(fSeekStart);
    //printf("Flushing buffer at fSeekStart=%lld, fNtot=%d\n",fSeekStart,fNtot);
    fRecursive = kTRUE;
-   Bool_t status = fFile->WriteBuffer(fBuffer, fNtot);
+   if (fFile->WriteBuffer(fBuffer, fNtot)) status = kTRUE;
    fRecursive = kFALSE;
    fNtot = 0;
    return status;
 }
 
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::FlushBehind()
+{
+   // Flush the current write buffer. In write-behind mode, the buffer is
+   // handed over to the I/O thread (once it is done with the previous one)
+   // and the filling continues in the spare buffer.
+   // Returns kTRUE in case of error, including the failure of a previous
+   // asynchronous write.
+
+   if (!fNtot) return kFALSE;
+   if (!fWriteBehind || !CanWriteBehind()) return Flush();
+   if (WaitForWrite()) {
+      fNtot = 0;
+      return kTRUE;
+   }
+   if (!fThread) {
+      fThread = new TThread("TFileCacheWrite", (TThread::VoidRtnFunc_t)WriteBehindLoop, (void*)this);
+      if (fThread->Run() != 0) {
+         Warning("FlushBehind", "could not start the I/O thread, writing %s synchronously", fFile->GetName());
+         delete fThread;
+         fThread = 0;
+         fWriteBehind = kFALSE;
+         return Flush();
+      }
+   }
+
+   fMutex->Lock();
+   fPending     = fBuffer;
+   fPendingSeek = fSeekStart + fFile->GetArchiveOffset();
+   fPendingLen  = fNtot;
+   fPendingFd   = fFile->GetFd();
+   fCondition->Broadcast();
+   fMutex->UnLock();
+
+   fInFlight = fNtot;
+   fBuffer = fSpare;
+   fSpare = fPending;
+   fNtot = 0;
+   return kFALSE;
+}
+
 //_____________________________________________________________________________
 void TFileCacheWrite::Print(Option_t *option) const
 {
@@ -96,6 +210,9 @@ void TFileCacheWrite::Print(Option_t *option) const
    TString opt = option;
    printf("Write cache for file %s\n",fFile->GetName());
    printf("Size of write cache: %d bytes to be written at %lld\n",fNtot,fSeekStart);
+   if (fWriteBehind) {
+      printf("Write-behind mode: %d bytes being written\n",fInFlight);
+   }
    opt.ToLower();
 }
 
@@ -106,7 +223,10 @@ Int_t TFileCacheWrite::ReadBuffer(char *buf, Long64_t pos, Int_t len)
    // in the write cache buffer.
    //        Returns -1 if data not in write cache,
    //        0 otherwise.
+   // In write-behind mode, the write in flight is completed first so
+   // that the caller can then read the data from the file.
 
+   if (fInFlight) WaitForWrite();
    if (pos < fSeekStart || pos+len > fSeekStart+fNtot) return -1;
    memcpy(buf,fBuffer+pos-fSeekStart,len);
    return 0;
@@ -126,17 +246,19 @@ Int_t TFileCacheWrite::WriteBuffer(const char *buf, Long64_t pos, Int_t len)
 
    if (fSeekStart + fNtot != pos) {
       //we must flush the current cache
-      if (Flush()) return -1; //failure
+      if (FlushBehind()) return -1; //failure
    }
    if (fNtot + len >= fBufferSize) {
-      if (Flush()) return -1; //failure
       if (len >= fBufferSize) {
          //buffer larger than the cache itself: direct write to file
+         //(after the write in flight, which might overlap)
+         if (Flush()) return -1; //failure
          fRecursive = kTRUE;
          if (fFile->WriteBuffer(buf,len)) return -1;  // failure
          fRecursive = kFALSE;
          return 1;
       }
+      if (FlushBehind()) return -1; //failure
    }
    if (!fNtot) fSeekStart = pos;
    memcpy(fBuffer+fNtot,buf,len);
@@ -150,6 +272,119 @@ void TFileCacheWrite::SetFile(TFile *file)
 {
    // Set the file using this cache.
    // Any write not yet flushed will be lost.
+   // The write in flight (if any) is completed first.
 
+   WaitForWrite();
    fFile = file;
 }
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::SetWriteBehind(Bool_t on)
+{
+   // Enable or disable the write-behind mode. When enabled, a full buffer
+   // is written by a dedicated I/O thread while the next one is being
+   // filled, so that the producer is not stalled by the file system
+   // (at the cost of a second buffer of the same size). Only one write is
+   // in flight at any time, and Flush (hence TFile::Flush and TFile::Close)
+   // waits for its completion and reports its failure. The failure of an
+   // asynchronous write is also reported by the next WriteBuffer, which
+   // sets the kWriteError bit of the file.
+   // The mode is only supported for the local files accessed through a
+   // file descriptor. Returns whether the mode is enabled.
+
+   if (!on) {
+      if (fWriteBehind) WaitForWrite();
+      fWriteBehind = kFALSE;
+      return kFALSE;
+   }
+   if (!CanWriteBehind()) {
+      return kFALSE;
+   }
+   if (!fSpare) fSpare = new char[fBufferSize];
+   if (!fMutex) {
+      fMutex = new TMutex();
+      fCondition = new TCondition(fMutex);
+   }
+   fWriteBehind = kTRUE;
+   return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::WaitForWrite()
+{
+   // Wait for the write in flight (if any) to be completed by the I/O thread.
+   // Returns kTRUE if it failed, in which case the file is flagged with
+   // TFile::kWriteError and is no longer writable.
+
+   if (!fInFlight) return kFALSE;
+
+   fMutex->Lock();
+   while (fPendingLen) fCondition->Wait();
+   Int_t err = fAsyncErrno;
+   fAsyncErrno = 0;
+   fMutex->UnLock();
+
+   Int_t written = fInFlight;
+   fInFlight = 0;
+   if (err) {
+      fFile->SetBit(TFile::kWriteError);
+      fFile->SetWritable(kFALSE);
+      Error("WaitForWrite", "error writing %d bytes to file %s (%s)", written, fFile->GetName(), strerror(err));
+      return kTRUE;
+   }
+   fFile->fBytesWrite  += written;
+   TFile::fgBytesWrite += written;
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendFileWriteProgress(fFile);
+   return kFALSE;
+}
+
+//_____________________________________________________________________________
+void *TFileCacheWrite::WriteBehindLoop(void *arg)
+{
+   // Execution loop of the I/O thread: write the buffers handed over by
+   // FlushBehind until the cache is deleted.
+
+   TFileCacheWrite *cache = (TFileCacheWrite*)arg;
+   cache->fMutex->Lock();
+   while (1) {
+      while (!cache->fPendingLen && !cache->fStop) cache->fCondition->Wait();
+      if (!cache->fPendingLen) break;
+
+      const char *buf = cache->fPending;
+      Long64_t pos = cache->fPendingSeek;
+      Int_t len = cache->fPendingLen;
+      Int_t fd = cache->fPendingFd;
+      cache->fMutex->UnLock();
+
+      // Positioned writes leave the file offset, used by the producer
+      // thread, untouched.
+      Int_t err = 0;
+#ifndef WIN32
+      while (len > 0) {
+         ssize_t siz = pwrite(fd, buf, len, pos);
+         if (siz < 0) {
+            if (errno == EINTR) continue;
+            err = errno;
+            break;
+         }
+         if (siz == 0) {
+            err = EIO;
+            break;
+         }
+         buf += siz;
+         pos += siz;
+         len -= siz;
+      }
+#else
+      err = EINVAL;
+#endif
+
+      cache->fMutex->Lock();
+      cache->fAsyncErrno = err;
+      cache->fPendingLen = 0;
+      cache->fCondition->Broadcast();
+   }
+   cache->fMutex->UnLock();
+   return 0;
+}
@@ -57,6 +57,11 @@ TClassRef R__TTree_Class("TTree");
 
 static const Int_t kCpProgress = BIT(14);
 static const Int_t kCintFileNumber = 100;
+// When histograms are not merged in one go, they are still handed to
+// TH1::Merge in batches of at most kHistoBatchCount objects and
+// kHistoBatchSize (uncompressed) bytes.
+static const Int_t kHistoBatchCount = 64;
+static const Int_t kHistoBatchSize = 32*1024*1024;
 //______________________________________________________________________________
 static Int_t R__GetSystemMaxOpenedFiles()
 {
@@ -85,7 +90,7 @@ static Int_t R__GetSystemMaxOpenedFiles()
 
 //______________________________________________________________________________
 TFileMerger::TFileMerger(Bool_t isLocal, Bool_t histoOneGo)
-            : fOutputFile(0), fFastMethod(kTRUE), fNoTrees(kFALSE), fExplicitCompLevel(kFALSE), fCompressionChange(kFALSE),
+            : fOutputFile(0), fFastMethod(kTRUE), fNoTrees(kFALSE), fClusterSize(0), fExplicitCompLevel(kFALSE), fCompressionChange(kFALSE),
               fPrintLevel(0), fMsgPrefix("TFileMerger"), fMaxOpenedFiles( R__GetSystemMaxOpenedFiles() ),
               fLocal(isLocal), fHistoOneGo(histoOneGo), fObjectNames()
 {
@@ -381,8 +386,19 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
    
    TFileMergeInfo info(target);
 
-   if ((fFastMethod && !fCompressionChange)) {
+   // The fast method is also used when the compression changes, in which
+   // case the TTree baskets are recompressed without being unstreamed.
+   if (fFastMethod) {
       info.fOptions.Append(" fast");
+      // Coalesce the TTree baskets in clusters of the requested size.
+      if (fClusterSize > 0) {
+         info.fOptions.Append(TString::Format(" recluster=%lld", fClusterSize));
+      }
+   }
+   // Size the output TTree clusters and baskets for the given workload,
+   // see TTree::ApplyAccessProfile (ignored by the fast method).
+   if (fAccessProfile.Length()) {
+      info.fOptions.Append(TString::Format(" profile=%s", fAccessProfile.Data()));
    }
 
    TFile      *current_file;
@@ -518,7 +534,9 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                if (alreadyseen) continue;
                
                TList inputs;
-               Bool_t oneGo = fHistoOneGo && obj->IsA()->InheritsFrom(R__TH1_Class);
+               Bool_t isHisto = obj->IsA()->InheritsFrom(R__TH1_Class);
+               Bool_t oneGo = fHistoOneGo && isHisto;
+               Long64_t batchsize = 0;
                
                // Loop over all source files and merge same-name object
                TFile *nextsource = current_file ? (TFile*)sourcelist->After( current_file ) : (TFile*)sourcelist->First();
@@ -548,7 +566,9 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                            }
                            hobj->ResetBit(kMustCleanup);
                            inputs.Add(hobj);
-                           if (!oneGo) {
+                           batchsize += key2->GetObjlen();
+                           if (!oneGo && (!isHisto || inputs.GetSize() >= kHistoBatchCount
+                                          || batchsize >= kHistoBatchSize)) {
                               ROOT::MergeFunc_t func = obj->IsA()->GetMerge();
                               Long64_t result = func(obj, &inputs, &info);
                               info.fIsFirst = kFALSE;
@@ -557,13 +577,14 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                                        obj->GetName(), nextsource->GetName());
                               }
                               inputs.Delete();
+                              batchsize = 0;
                            }
                         }
                      }
                      nextsource = (TFile*)sourcelist->After( nextsource );
                   } while (nextsource);
                   // Merge the list, if still to be done
-                  if (oneGo || info.fIsFirst) {
+                  if (oneGo || info.fIsFirst || !inputs.IsEmpty()) {
                      ROOT::MergeFunc_t func = obj->IsA()->GetMerge();
                      func(obj, &inputs, &info);
                      info.fIsFirst = kFALSE;
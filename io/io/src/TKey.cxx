@@ -53,6 +53,7 @@
 #include "TFile.h"
 #include "TKey.h"
 #include "TBufferFile.h"
+#include "TBufferPool.h"
 #include "TFree.h"
 #include "TBrowser.h"
 #include "Bytes.h"
@@ -535,7 +536,7 @@ void TKey::DeleteBuffer()
    // Delete key buffer(s).
 
    if (fBufferRef) {
-      delete fBufferRef;
+      TBufferPool::DeleteBuffer(fBufferRef);
       fBufferRef = 0;
    } else {
       // We only need to delete fBuffer if fBufferRef is zero because
@@ -717,6 +718,10 @@ TObject *TKey::ReadObj()
    //  Of course, dynamic_cast<> can also be used in the example 1.
 
    TClass *cl = TClass::GetClass(fClassName.Data());
+   if ((!cl || !cl->IsLoaded()) && GetFile() && GetFile()->ReadPendingStreamerInfo()) {
+      // The class is described by the deferred StreamerInfo record of the file.
+      cl = TClass::GetClass(fClassName.Data());
+   }
    if (!cl) {
       Error("ReadObj", "Unknown class %s", fClassName.Data());
       return 0;
@@ -726,7 +731,7 @@ TObject *TKey::ReadObj()
       return (TObject*)ReadObjectAny(0);
    }
 
-   fBufferRef = new TBufferFile(TBuffer::kRead, fObjlen+fKeylen);
+   fBufferRef = TBufferPool::NewBuffer(TBuffer::kRead, fObjlen+fKeylen);
    if (!fBufferRef) {
       Error("ReadObj", "Cannot allocate buffer: fObjlen = %d", fObjlen);
       return 0;
@@ -735,12 +740,24 @@ TObject *TKey::ReadObj()
    fBufferRef->SetParent(GetFile());
    fBufferRef->SetPidOffset(fPidOffset);
 
-   if (fObjlen > fNbytes-fKeylen) {
-      fBuffer = new char[fNbytes];
+   Bool_t unzip = fObjlen > fNbytes-fKeylen;
+   if (unzip && fObjlen > kMAXBUF) {
+      // Large object compressed in several blocks: decompress them while
+      // reading, without holding the whole compressed record in memory.
+      unzip = kFALSE;
+      fBuffer = fBufferRef->Buffer();
+      if( !ReadFileUnzip(fBuffer) ) {
+         TBufferPool::DeleteBuffer(fBufferRef);
+         fBufferRef = 0;
+         fBuffer = 0;
+         return 0;
+      }
+   } else if (unzip) {
+      fBuffer = TBufferPool::Acquire(fNbytes);
       if( !ReadFile() )                    //Read object structure from file
       {
-        delete fBufferRef;
-        delete [] fBuffer;
+        TBufferPool::DeleteBuffer(fBufferRef);
+        TBufferPool::Release(fBuffer);
         fBufferRef = 0;
         fBuffer = 0;
         return 0;
@@ -749,7 +766,7 @@ TObject *TKey::ReadObj()
    } else {
       fBuffer = fBufferRef->Buffer();
       if( !ReadFile() ) {                   //Read object structure from file
-         delete fBufferRef;
+         TBufferPool::DeleteBuffer(fBufferRef);
          fBufferRef = 0;
          fBuffer = 0;
          return 0;
@@ -781,7 +798,7 @@ TObject *TKey::ReadObj()
    if (kvers > 1)
       fBufferRef->MapObject(pobj,cl);  //register obj in map to handle self reference
 
-   if (fObjlen > fNbytes-fKeylen) {
+   if (unzip) {
       char *objbuf = fBufferRef->Buffer() + fKeylen;
       UChar_t *bufcur = (UChar_t *)&fBuffer[fKeylen];
       Int_t nin, nout = 0, nbuf;
@@ -798,9 +815,9 @@ TObject *TKey::ReadObj()
       }
       if (nout) {
          tobj->Streamer(*fBufferRef); //does not work with example 2 above
-         delete [] fBuffer;
+         TBufferPool::Release(fBuffer);
       } else {
-         delete [] fBuffer;
+         TBufferPool::Release(fBuffer);
          delete pobj;
          pobj = 0;
          tobj = 0;
@@ -829,7 +846,7 @@ TObject *TKey::ReadObj()
    }
 
 CLEAR:
-   delete fBufferRef;
+   TBufferPool::DeleteBuffer(fBufferRef);
    fBufferRef = 0;
    fBuffer    = 0;
 
@@ -857,6 +874,10 @@ TObject *TKey::ReadObjWithBuffer(char *bufferRead)
    
 
    TClass *cl = TClass::GetClass(fClassName.Data());
+   if ((!cl || !cl->IsLoaded()) && GetFile() && GetFile()->ReadPendingStreamerInfo()) {
+      // The class is described by the deferred StreamerInfo record of the file.
+      cl = TClass::GetClass(fClassName.Data());
+   }
    if (!cl) {
       Error("ReadObjWithBuffer", "Unknown class %s", fClassName.Data());
       return 0;
@@ -866,7 +887,7 @@ TObject *TKey::ReadObjWithBuffer(char *bufferRead)
       return (TObject*)ReadObjectAny(0);
    }
 
-   fBufferRef = new TBufferFile(TBuffer::kRead, fObjlen+fKeylen);
+   fBufferRef = TBufferPool::NewBuffer(TBuffer::kRead, fObjlen+fKeylen);
    if (!fBufferRef) {
       Error("ReadObjWithBuffer", "Cannot allocate buffer: fObjlen = %d", fObjlen);
       return 0;
@@ -954,7 +975,90 @@ TObject *TKey::ReadObjWithBuffer(char *bufferRead)
    }
 
 CLEAR:
-   delete fBufferRef;
+   TBufferPool::DeleteBuffer(fBufferRef);
+   fBufferRef = 0;
+   fBuffer    = 0;
+
+   return tobj;
+}
+
+//______________________________________________________________________________
+TObject *TKey::ReadObjWithUnzippedBuffer(char *buffer)
+{
+   // To read a TObject* from buffer, which holds the key header followed
+   // by the uncompressed object (fKeylen+fObjlen bytes), e.g. as prepared
+   // by TDirectoryFile::ReadObjects. The buffer is adopted by the key and
+   // deleted once the object has been read.
+   // The object is otherwise created as in TKey::ReadObj.
+
+   TClass *cl = TClass::GetClass(fClassName.Data());
+   if ((!cl || !cl->IsLoaded()) && GetFile() && GetFile()->ReadPendingStreamerInfo()) {
+      // The class is described by the deferred StreamerInfo record of the file.
+      cl = TClass::GetClass(fClassName.Data());
+   }
+   if (!cl) {
+      Error("ReadObjWithUnzippedBuffer", "Unknown class %s", fClassName.Data());
+      delete [] buffer;
+      return 0;
+   }
+   if (!cl->InheritsFrom(TObject::Class()) || GetFile()==0) {
+      // in principle user should call TKey::ReadObjectAny!
+      delete [] buffer;
+      return GetFile() ? (TObject*)ReadObjectAny(0) : 0;
+   }
+
+   fBufferRef = new TBufferFile(TBuffer::kRead, fObjlen+fKeylen, buffer, kTRUE);
+   fBufferRef->SetParent(GetFile());
+   fBufferRef->SetPidOffset(fPidOffset);
+
+   // get version of key
+   fBufferRef->SetBufferOffset(sizeof(fNbytes));
+   Version_t kvers = fBufferRef->ReadVersion();
+
+   fBufferRef->SetBufferOffset(fKeylen);
+   TObject *tobj = 0;
+   // Create an instance of this class
+
+   char *pobj = (char*)cl->New();
+   if (!pobj) {
+      Error("ReadObjWithUnzippedBuffer", "Cannot create new object of class %s", fClassName.Data());
+      TBufferPool::DeleteBuffer(fBufferRef);
+      fBufferRef = 0;
+      return 0;
+   }
+   Int_t baseOffset = cl->GetBaseClassOffset(TObject::Class());
+   if (baseOffset==-1) {
+      // cl does not inherit from TObject.
+      // Since this is not possible yet, the only reason we could reach this code
+      // is because something is screw up in the ROOT code.
+      Fatal("ReadObjWithUnzippedBuffer","Incorrect detection of the inheritance from TObject for class %s.\n",
+            fClassName.Data());
+   }
+   tobj = (TObject*)(pobj+baseOffset);
+   if (kvers > 1)
+      fBufferRef->MapObject(pobj,cl);  //register obj in map to handle self reference
+
+   tobj->Streamer(*fBufferRef);
+
+   if (gROOT->GetForceStyle()) tobj->UseCurrentStyle();
+
+   if (cl->InheritsFrom(TDirectoryFile::Class())) {
+      TDirectory *dir = static_cast<TDirectoryFile*>(tobj);
+      dir->SetName(GetName());
+      dir->SetTitle(GetTitle());
+      dir->SetMother(fMotherDir);
+      fMotherDir->Append(dir);
+   }
+
+   // Append the object to the directory if requested:
+   {
+      ROOT::DirAutoAdd_t addfunc = cl->GetDirectoryAutoAdd();
+      if (addfunc) {
+         addfunc(pobj, fMotherDir);
+      }
+   }
+
+   TBufferPool::DeleteBuffer(fBufferRef);
    fBufferRef = 0;
    fBuffer    = 0;
 
@@ -988,7 +1092,7 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
    //  object of the class type it describes. This new object now calls its
    //  Streamer function to rebuilt itself.
 
-   fBufferRef = new TBufferFile(TBuffer::kRead, fObjlen+fKeylen);
+   fBufferRef = TBufferPool::NewBuffer(TBuffer::kRead, fObjlen+fKeylen);
    if (!fBufferRef) {
       Error("ReadObj", "Cannot allocate buffer: fObjlen = %d", fObjlen);
       return 0;
@@ -997,8 +1101,20 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
    fBufferRef->SetParent(GetFile());
    fBufferRef->SetPidOffset(fPidOffset);
 
-   if (fObjlen > fNbytes-fKeylen) {
-      fBuffer = new char[fNbytes];
+   Bool_t unzip = fObjlen > fNbytes-fKeylen;
+   if (unzip && fObjlen > kMAXBUF) {
+      // Large object compressed in several blocks: decompress them while
+      // reading, without holding the whole compressed record in memory.
+      unzip = kFALSE;
+      fBuffer = fBufferRef->Buffer();
+      if (!ReadFileUnzip(fBuffer)) {
+         TBufferPool::DeleteBuffer(fBufferRef);
+         fBufferRef = 0;
+         fBuffer = 0;
+         return 0;
+      }
+   } else if (unzip) {
+      fBuffer = TBufferPool::Acquire(fNbytes);
       ReadFile();                    //Read object structure from file
       memcpy(fBufferRef->Buffer(),fBuffer,fKeylen);
    } else {
@@ -1012,6 +1128,10 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
 
    fBufferRef->SetBufferOffset(fKeylen);
    TClass *cl = TClass::GetClass(fClassName.Data());
+   if ((!cl || !cl->IsLoaded()) && GetFile() && GetFile()->ReadPendingStreamerInfo()) {
+      // The class is described by the deferred StreamerInfo record of the file.
+      cl = TClass::GetClass(fClassName.Data());
+   }
    TClass *clOnfile = 0;
    if (!cl) {
       Error("ReadObjectAny", "Unknown class %s", fClassName.Data());
@@ -1053,7 +1173,7 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
    if (kvers > 1)
       fBufferRef->MapObject(pobj,cl);  //register obj in map to handle self reference
 
-   if (fObjlen > fNbytes-fKeylen) {
+   if (unzip) {
       char *objbuf = fBufferRef->Buffer() + fKeylen;
       UChar_t *bufcur = (UChar_t *)&fBuffer[fKeylen];
       Int_t nin, nout = 0, nbuf;
@@ -1070,9 +1190,9 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
       }
       if (nout) {
          cl->Streamer((void*)pobj, *fBufferRef, clOnfile);    //read object
-         delete [] fBuffer;
+         TBufferPool::Release(fBuffer);
       } else {
-         delete [] fBuffer;
+         TBufferPool::Release(fBuffer);
          cl->Destructor(pobj);
          pobj = 0;
          goto CLEAR;
@@ -1110,7 +1230,7 @@ void *TKey::ReadObjectAny(const TClass* expectedClass)
    }
 
    CLEAR:
-   delete fBufferRef;
+   TBufferPool::DeleteBuffer(fBufferRef);
    fBufferRef = 0;
    fBuffer    = 0;
 
@@ -1127,15 +1247,27 @@ Int_t TKey::Read(TObject *obj)
 
    if (!obj || (GetFile()==0)) return 0;
 
-   fBufferRef = new TBufferFile(TBuffer::kRead, fObjlen+fKeylen);
+   fBufferRef = TBufferPool::NewBuffer(TBuffer::kRead, fObjlen+fKeylen);
    fBufferRef->SetParent(GetFile());
    fBufferRef->SetPidOffset(fPidOffset);
 
    if (fVersion > 1)
       fBufferRef->MapObject(obj);  //register obj in map to handle self reference
 
-   if (fObjlen > fNbytes-fKeylen) {
-      fBuffer = new char[fNbytes];
+   Bool_t unzip = fObjlen > fNbytes-fKeylen;
+   if (unzip && fObjlen > kMAXBUF) {
+      // Large object compressed in several blocks: decompress them while
+      // reading, without holding the whole compressed record in memory.
+      unzip = kFALSE;
+      fBuffer = fBufferRef->Buffer();
+      if (!ReadFileUnzip(fBuffer)) {
+         TBufferPool::DeleteBuffer(fBufferRef);
+         fBufferRef = 0;
+         fBuffer = 0;
+         return 0;
+      }
+   } else if (unzip) {
+      fBuffer = TBufferPool::Acquire(fNbytes);
       ReadFile();                    //Read object structure from file
       memcpy(fBufferRef->Buffer(),fBuffer,fKeylen);
    } else {
@@ -1143,7 +1275,7 @@ Int_t TKey::Read(TObject *obj)
       ReadFile();                    //Read object structure from file
    }
    fBufferRef->SetBufferOffset(fKeylen);
-   if (fObjlen > fNbytes-fKeylen) {
+   if (unzip) {
       char *objbuf = fBufferRef->Buffer() + fKeylen;
       UChar_t *bufcur = (UChar_t *)&fBuffer[fKeylen];
       Int_t nin, nout = 0, nbuf;
@@ -1159,7 +1291,7 @@ Int_t TKey::Read(TObject *obj)
          objbuf += nout;
       }
       if (nout) obj->Streamer(*fBufferRef);
-      delete [] fBuffer;
+      TBufferPool::Release(fBuffer);
    } else {
       obj->Streamer(*fBufferRef);
    }
@@ -1172,7 +1304,7 @@ Int_t TKey::Read(TObject *obj)
       }
    }
 
-   delete fBufferRef;
+   TBufferPool::DeleteBuffer(fBufferRef);
    fBufferRef = 0;
    fBuffer    = 0;
    return fNbytes;
@@ -1263,6 +1395,69 @@ Bool_t TKey::ReadFile()
    return kTRUE;
 }
 
+//______________________________________________________________________________
+Bool_t TKey::ReadFileUnzip(char *dest)
+{
+   // Read the key structure from the file and decompress the object into
+   // dest, which must hold fKeylen+fObjlen bytes.
+   // The compressed blocks are read and decompressed one at a time, so
+   // that at most one of them (up to 16 MB) is held in memory in addition
+   // to the uncompressed object, instead of the whole compressed record.
+
+   TFile* f = GetFile();
+   if (f==0) return kFALSE;
+
+   if( f->ReadBuffer(dest,fSeekKey,fKeylen) ) {
+      Error("ReadFileUnzip", "Failed to read data.");
+      return kFALSE;
+   }
+
+   const Int_t kHeaderSize = 9;
+   UChar_t header[kHeaderSize];
+   Long64_t pos = fSeekKey + fKeylen;
+   Long64_t end = fSeekKey + fNbytes;
+   char *objbuf = dest + fKeylen;
+   char *block = 0;
+   Int_t noutot = 0;
+   Bool_t ok = kTRUE;
+   while (noutot < fObjlen) {
+      Int_t nin, nbuf, nout = 0;
+      if (pos + kHeaderSize > end || f->ReadBuffer((char*)header,pos,kHeaderSize)) {
+         Error("ReadFileUnzip", "Failed to read data.");
+         ok = kFALSE;
+         break;
+      }
+      if (R__unzip_header(&nin, header, &nbuf) != 0 || nin > end - pos || nbuf > fObjlen - noutot) {
+         Error("ReadFileUnzip", "Corrupted compression header at offset %lld of key %s", pos, GetName());
+         ok = kFALSE;
+         break;
+      }
+      if (TBufferPool::Capacity(block) < nin) {
+         TBufferPool::Release(block);
+         block = TBufferPool::Acquire(nin);
+      }
+      if( f->ReadBuffer(block,pos,nin) ) {
+         Error("ReadFileUnzip", "Failed to read data.");
+         ok = kFALSE;
+         break;
+      }
+      R__unzip(&nin, (UChar_t*)block, &nbuf, objbuf, &nout);
+      if (!nout) {
+         Error("ReadFileUnzip", "Failed to decompress block at offset %lld of key %s", pos, GetName());
+         ok = kFALSE;
+         break;
+      }
+      noutot += nout;
+      objbuf += nout;
+      pos    += nin;
+   }
+   TBufferPool::Release(block);
+   if (gDebug) {
+      cout << "TKey Reading "<<fNbytes<< " bytes at address "<<fSeekKey<<" into "<<fKeylen+noutot<<" bytes"<<endl;
+   }
+   return ok;
+}
+
 //______________________________________________________________________________
 void TKey::SetParent(const TObject *parent)
 {
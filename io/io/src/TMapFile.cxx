@@ -53,6 +53,9 @@
 // accidentally a virtual function will segv). So since we have a       //
 // robust Streamer mechanism I opted for 3).                            //
 //                                                                      //
+// TSharedMapFile provides the same Add/Update/Get interface on a      //
+// growable region that readers access without blocking the writer.     //
+//                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 
@@ -16,6 +16,14 @@
 // A TMemFile is like a normal TFile except that it reads and writes    //
 // only from memory.                                                    //
 //                                                                      //
+// The content is kept in a list of blocks. Each new block is the      //
+// largest power of two not above the size of the file so far (from 2  //
+// up to 64 MB), which is one of the size classes of the TBufferPool:   //
+// the blocks come from the pool, so the memory of deleted TMemFiles is //
+// reused by the next ones, and are kept by ResetAfterMerge. WriteTo    //
+// hands the blocks to a file descriptor (file, pipe or socket) without //
+// copying them.                                                        //
+//                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 #include "TMemFile.h"
@@ -26,9 +34,17 @@
 #include "TKey.h"
 #include "TClass.h"
 #include "TVirtualMutex.h"
+#include "TBufferPool.h"
+#include "TMath.h"
 #include <errno.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
 
 // The following snippet is used for developer-level debugging
 #define TMemFile_TRACE
@@ -43,6 +59,52 @@ ClassImp(TMemFile)
 
 Long64_t TMemFile::fgDefaultBlockSize = 2*1024*1024;
 
+// Maximum size of the blocks added when the file grows, which is also the
+// largest size class of the TBufferPool.
+static const Long64_t kMaxBlockSize = 64*1024*1024;
+
+//______________________________________________________________________________
+static Bool_t R__IsPooledBlockSize(Long64_t size)
+{
+   // Return whether a block of size bytes is taken from the TBufferPool,
+   // i.e. whether size is one of its (power of two) size classes. Other
+   // sizes, like the exact size of a buffer given to the constructor,
+   // would be rounded up to the next class and are allocated directly.
+
+   return size >= 4096 && size <= kMaxBlockSize && (size & (size - 1)) == 0;
+}
+
+//______________________________________________________________________________
+static UChar_t *R__AllocateBlock(Long64_t size)
+{
+   // Allocate the memory of a block of size bytes.
+
+   if (R__IsPooledBlockSize(size)) return (UChar_t*)TBufferPool::Acquire((Int_t)size);
+   return new UChar_t[size];
+}
+
+//______________________________________________________________________________
+static void R__ReleaseBlock(UChar_t *buffer, Long64_t size)
+{
+   // Release the memory of a block allocated by R__AllocateBlock.
+
+   if (!buffer) return;
+   if (R__IsPooledBlockSize(size)) TBufferPool::Release((char*)buffer);
+   else delete [] buffer;
+}
+
+//______________________________________________________________________________
+static Long64_t R__GrowthBlockSize(Long64_t filesize, Long64_t defaultsize)
+{
+   // Return the size of the block to add to a file of filesize bytes: the
+   // largest power of two not above the file size (and kMaxBlockSize),
+   // but at least defaultsize.
+
+   Long64_t size = 1;
+   while (2*size <= filesize && 2*size <= kMaxBlockSize) size *= 2;
+   return TMath::Max(defaultsize, size);
+}
+
 //______________________________________________________________________________
 TMemFile::TMemBlock::TMemBlock() : fPrevious(0), fNext(0), fBuffer(0), fSize(0)
 {
@@ -55,7 +117,7 @@ TMemFile::TMemBlock::TMemBlock(Long64_t size, TMemBlock *previous) :
 {
    // Constructor allocating the memory buffer.
    
-   fBuffer = new UChar_t[size];
+   fBuffer = R__AllocateBlock(size);
    fSize = size;
 }
 
@@ -65,7 +127,7 @@ TMemFile::TMemBlock::~TMemBlock()
    // Usual destructors.  Delete the block memory.
    
    delete fNext;
-   delete [] fBuffer;
+   R__ReleaseBlock(fBuffer, fSize);
 }
 
 //______________________________________________________________________________
@@ -264,6 +326,85 @@ Long64_t TMemFile::GetSize() const
    return fSize;
 }
 
+//______________________________________________________________________________
+Long64_t TMemFile::WriteTo(Int_t fd) const
+{
+   // Write the content of the TMemFile (its first GetEND() bytes) to the
+   // file descriptor fd (a file, a pipe or a socket) directly from the
+   // memory blocks, with as few system calls as possible and without any
+   // intermediate copy. The data is written at the current position of
+   // fd. The file should have been written (see TFile::Write) beforehand
+   // so that its header and list of keys are up to date.
+   // Returns the number of bytes written, or -1 in case of error (in
+   // which case errno is set).
+
+   Long64_t left = GetEND();
+   Long64_t written = 0;
+   const TMemBlock *current = &fBlockList;
+   Long64_t offset = 0; // Offset within the current block.
+#ifndef WIN32
+   const Int_t kMaxIov = 64;
+   struct iovec iov[kMaxIov];
+   while (left > 0 && current) {
+      Int_t niov = 0;
+      Long64_t batch = 0;
+      const TMemBlock *block = current;
+      Long64_t start = offset;
+      while (niov < kMaxIov && block && batch < left) {
+         Long64_t len = TMath::Min(block->fSize - start, left - batch);
+         // Keep the amount requested per call within the limit of ssize_t.
+         len = TMath::Min(len, (Long64_t)kMaxInt - batch);
+         if (len <= 0) break;
+         iov[niov].iov_base = block->fBuffer + start;
+         iov[niov].iov_len  = len;
+         ++niov;
+         batch += len;
+         block = block->fNext;
+         start = 0;
+      }
+      ssize_t siz = writev(fd, iov, niov);
+      if (siz < 0) {
+         if (errno == EINTR) continue;
+         return -1;
+      }
+      if (siz == 0) {
+         errno = EIO;
+         return -1;
+      }
+      // Move past the bytes actually written, possibly in the middle of a block.
+      written += siz;
+      left -= siz;
+      while (current && siz >= current->fSize - offset) {
+         siz -= current->fSize - offset;
+         current = current->fNext;
+         offset = 0;
+      }
+      offset += siz;
+   }
+#else
+   while (left > 0 && current) {
+      Int_t len = (Int_t)TMath::Min(TMath::Min(current->fSize - offset, left), (Long64_t)kMaxInt);
+      Int_t siz = ::_write(fd, current->fBuffer + offset, len);
+      if (siz < 0) {
+         if (errno == EINTR) continue;
+         return -1;
+      }
+      if (siz == 0) {
+         errno = EIO;
+         return -1;
+      }
+      written += siz;
+      left -= siz;
+      offset += siz;
+      if (offset == current->fSize) {
+         current = current->fNext;
+         offset = 0;
+      }
+   }
+#endif
+   return written;
+}
+
 //______________________________________________________________________________
 void TMemFile::Print(Option_t *option /* = "" */) const
 {
@@ -287,7 +428,7 @@ void TMemFile::Print(Option_t *option /* = "" */) const
 void TMemFile::ResetAfterMerge(TFileMergeInfo *info)
 {
    // Wipe all the data from the permanent buffer but keep, the in-memory object
-   // alive.
+   // alive. The memory blocks are kept and reused for the new content.
 
    ResetObjects(this,info);
 
@@ -533,7 +674,7 @@ Int_t TMemFile::SysOpen(const char * /* pathname */, Int_t /* flags */, UInt_t /
    // Open a file in 'MemFile'.
 
    if (!fBlockList.fBuffer) {
-      fBlockList.fBuffer = new UChar_t[fgDefaultBlockSize];
+      fBlockList.fBuffer = R__AllocateBlock(fgDefaultBlockSize);
       fBlockList.fSize = fgDefaultBlockSize;
       fSize = fgDefaultBlockSize;
    }
@@ -581,8 +722,9 @@ Int_t TMemFile::SysWrite(Int_t /* fd */, const void *buf, Int_t len)
          buf = (char*)buf + sublen;
          Int_t len_left = len - sublen;
          if (!fBlockSeek->fNext) {
-            fBlockSeek->CreateNext(fgDefaultBlockSize);
-            fSize += fgDefaultBlockSize;
+            Long64_t blocksize = R__GrowthBlockSize(fSize, fgDefaultBlockSize);
+            fBlockSeek->CreateNext(blocksize);
+            fSize += blocksize;
          }
          fBlockSeek = fBlockSeek->fNext; 
          
@@ -594,8 +736,9 @@ Int_t TMemFile::SysWrite(Int_t /* fd */, const void *buf, Int_t len)
             buf = (char*)buf + fBlockSeek->fSize;
             len_left -= fBlockSeek->fSize;
             if (!fBlockSeek->fNext) {
-               fBlockSeek->CreateNext(fgDefaultBlockSize);
-               fSize += fgDefaultBlockSize;
+               Long64_t blocksize = R__GrowthBlockSize(fSize, fgDefaultBlockSize);
+               fBlockSeek->CreateNext(blocksize);
+               fSize += blocksize;
             }
             fBlockSeek = fBlockSeek->fNext; 
          }
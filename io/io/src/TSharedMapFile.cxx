@@ -0,0 +1,632 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TSharedMapFile                                                       //
+//                                                                      //
+// A shared memory object store for live objects (typically histograms  //
+// filled by a producer and looked at by online monitors). Like         //
+// TMapFile, objects are registered with Add() and copied, streamed,    //
+// into shared memory by Update(); consumer processes get a fresh copy  //
+// with Get(). Unlike TMapFile the region does not need a fixed map     //
+// address, grows as needed, and readers never block the writer: every  //
+// object is protected by its own sequence counter and a reader simply  //
+// retries its copy when the object was being updated meanwhile.        //
+// There must be a single writer process per store.                     //
+//                                                                      //
+// The store is a file in /dev/shm (the POSIX shared memory file        //
+// system, or the temporary directory when it does not exist). It       //
+// starts with a header and a fixed size directory of records, one per  //
+// object, followed by the streamed objects. All positions are offsets, //
+// so every process can map the region at any address; when the writer //
+// needs more room it extends the file and the readers remap it the     //
+// next time they find an offset beyond their mapping.                  //
+//                                                                      //
+// The sequence counter of a record is odd while the writer changes the //
+// object. A reader copies the object out of shared memory and keeps    //
+// the copy only if the counter was even and did not change meanwhile.  //
+// Half the counter, returned by GetVersion(), is the number of updates //
+// of the object, so that a monitor can skip objects that did not       //
+// change since its last Get().                                         //
+//                                                                      //
+// Producer:                                                            //
+//    TSharedMapFile *mf = TSharedMapFile::Create("hsimple","RECREATE");//
+//    TH1F *h = new TH1F("h","h",100,-4,4);                             //
+//    mf->Add(h);                                                       //
+//    for (...) { h->Fill(x); if (i%1000 == 0) mf->Update(h); }         //
+//                                                                      //
+// Consumer:                                                            //
+//    TSharedMapFile *mf = TSharedMapFile::Create("hsimple");           //
+//    TH1F *h = 0;                                                      //
+//    while (1) { h = (TH1F*)mf->Get("h", h); h->Draw(); ... }          //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TSharedMapFile.h"
+#include "TBufferFile.h"
+#include "TClass.h"
+#include "TError.h"
+#include "TObjArray.h"
+#include "TSystem.h"
+
+#include <fcntl.h>
+#include <string.h>
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Full memory barrier, ordering the accesses to the sequence counters
+// with respect to the accesses to the objects they protect.
+#if defined(__GNUC__) || defined(__clang__) || defined(__INTEL_COMPILER)
+#define R__SHM_BARRIER() __sync_synchronize()
+#else
+#define R__SHM_BARRIER() do { } while (0)
+#endif
+
+namespace {
+
+   const UInt_t kMagic      = 0x524d5346;  // "RMSF"
+   const UInt_t kFormat     = 1;
+   const Int_t  kMaxName    = 116;         // records are 256 bytes long
+   const Int_t  kAlignment  = 64;
+   const Int_t  kPageSize   = 4096;
+   const Int_t  kMaxRetries = 1000;        // about one second when the writer is stuck
+
+   struct ShmHeader_t {
+      UInt_t            fMagic;            // kMagic once the store is initialized
+      UInt_t            fFormat;           // layout version
+      Int_t             fMaxObjects;       // number of records in the directory
+      volatile Int_t    fNobjects;         // number of records in use
+      volatile Long64_t fSize;             // size of the shared memory file
+      volatile Long64_t fUsed;             // end of the allocated data
+      Int_t             fWriter;           // process id of the writer
+      Int_t             fPad[7];
+   };
+
+   struct ShmRecord_t {
+      volatile UInt_t   fSeq;              // odd while the object is being updated
+      volatile Int_t    fLength;           // streamed length, 0 before the first update, -1 once removed
+      volatile Long64_t fOffset;           // position of the streamed object in the region
+      Long64_t          fCapacity;         // room available at fOffset
+      char              fName[kMaxName];   // object name, never changed once published
+      char              fClassName[kMaxName];
+   };
+
+   inline ShmHeader_t *R__Header(char *base)
+   {
+      return (ShmHeader_t*)base;
+   }
+
+   inline ShmRecord_t *R__Record(char *base, Int_t index)
+   {
+      return (ShmRecord_t*)(base + sizeof(ShmHeader_t)) + index;
+   }
+
+   inline Long64_t R__RoundUp(Long64_t value, Long64_t unit)
+   {
+      return (value + unit - 1) / unit * unit;
+   }
+
+}
+
+ClassImp(TSharedMapFile)
+
+//______________________________________________________________________________
+TSharedMapFile::TSharedMapFile() : fFd(-1), fBase(0), fMapSize(0), fWritable(kFALSE), fObjects(0), fBuffer(0)
+{
+   // Default constructor. Use Create() to open a store.
+}
+
+//______________________________________________________________________________
+TSharedMapFile::TSharedMapFile(const char *name, const char *path, Int_t fd, Bool_t writable) :
+   fName(name), fPath(path), fFd(fd), fBase(0), fMapSize(0), fWritable(writable), fObjects(0), fBuffer(0)
+{
+   // Create a store on the already opened shared memory file fd.
+
+   if (fWritable) {
+      fObjects = new TObjArray();
+      fBuffer  = new TBufferFile(TBuffer::kWrite);
+   }
+}
+
+//______________________________________________________________________________
+TSharedMapFile::~TSharedMapFile()
+{
+   // Close and delete the store. The shared memory file is kept, use
+   // Unlink() to remove it.
+
+   Close();
+   delete fObjects;
+   delete fBuffer;
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::Add(const TObject *obj, const char *name)
+{
+   // Add an object to the list of objects to be stored in shared memory,
+   // under name or, if name is empty, under the name of the object.
+   // To place the object actually into shared memory call Update().
+   // An object previously added under the same name is replaced.
+
+   if (!fWritable || !fBase || !obj) return;
+
+   const char *n = (name && *name) ? name : obj->GetName();
+   if (strlen(n) >= (size_t)kMaxName || strlen(obj->ClassName()) >= (size_t)kMaxName) {
+      Error("Add", "name or class name of object %s is too long", n);
+      return;
+   }
+
+   ShmHeader_t *header = R__Header(fBase);
+   Int_t index = FindRecord(n);
+   if (index < 0) {
+      if (header->fNobjects >= header->fMaxObjects) {
+         Error("Add", "cannot add %s, the store is limited to %d objects", n, header->fMaxObjects);
+         return;
+      }
+      // The record is filled before being published by the update of
+      // fNobjects, so that readers never see a partial name.
+      index = header->fNobjects;
+      ShmRecord_t *rec = R__Record(fBase, index);
+      rec->fSeq      = 0;
+      rec->fLength   = 0;
+      rec->fOffset   = 0;
+      rec->fCapacity = 0;
+      strlcpy(rec->fName, n, kMaxName);
+      strlcpy(rec->fClassName, obj->ClassName(), kMaxName);
+      R__SHM_BARRIER();
+      header->fNobjects = index + 1;
+   } else {
+      ShmRecord_t *rec = R__Record(fBase, index);
+      ++rec->fSeq;
+      R__SHM_BARRIER();
+      rec->fLength = 0;
+      strlcpy(rec->fClassName, obj->ClassName(), kMaxName);
+      R__SHM_BARRIER();
+      ++rec->fSeq;
+   }
+   fObjects->AddAtAndExpand(const_cast<TObject*>(obj), index);
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::Close(Option_t *)
+{
+   // Unmap the region and close the shared memory file. The objects stay
+   // available to the other processes until the file is unlinked.
+
+#ifndef WIN32
+   if (fBase) munmap(fBase, fMapSize);
+   if (fFd >= 0) close(fFd);
+#endif
+   fBase    = 0;
+   fMapSize = 0;
+   fFd      = -1;
+   if (fObjects) fObjects->Clear();
+}
+
+//______________________________________________________________________________
+TSharedMapFile *TSharedMapFile::Create(const char *name, Option_t *option, Int_t maxobjects, Long64_t size)
+{
+   // Open the store name. The shared memory file is name itself when it
+   // contains a '/', otherwise name in /dev/shm (see GetSharedMemoryPath).
+   // The option can be:
+   //    CREATE or NEW  create a new store, fails if it already exists
+   //    RECREATE       create a new store, replacing any existing one; the
+   //                   old file is unlinked, not truncated, so the processes
+   //                   which have it open keep their (now private) copy
+   //    UPDATE         open an existing store as its writer
+   //    READ           open an existing store as a reader (default)
+   // maxobjects and size, the initial size in bytes of the region, are
+   // only used when creating a store; the region grows on demand but the
+   // number of objects is fixed. Returns 0 in case of error.
+
+#ifdef WIN32
+   ::Error("TSharedMapFile::Create", "shared map files are not supported on this platform");
+   return 0;
+#else
+   TString opt = option;
+   opt.ToUpper();
+   if (opt == "NEW") opt = "CREATE";
+   if (opt != "CREATE" && opt != "RECREATE" && opt != "UPDATE") opt = "READ";
+
+   Bool_t create   = (opt == "CREATE" || opt == "RECREATE");
+   Bool_t writable = (opt != "READ");
+   Int_t  flags    = writable ? O_RDWR : O_RDONLY;
+   if (create) flags |= O_CREAT | O_EXCL;
+
+   TString path = GetSharedMemoryPath(name);
+   // Truncating the file would make the readers mapping it crash (SIGBUS)
+   // on their next access, so RECREATE creates a new file instead.
+   if (opt == "RECREATE" && !gSystem->AccessPathName(path) && gSystem->Unlink(path) != 0) {
+      ::SysError("TSharedMapFile::Create", "cannot remove %s", path.Data());
+      return 0;
+   }
+   Int_t fd = open(path, flags, 0644);
+   if (fd < 0) {
+      ::SysError("TSharedMapFile::Create", "cannot open %s", path.Data());
+      return 0;
+   }
+
+   TSharedMapFile *mf = new TSharedMapFile(name, path, fd, writable);
+   if (create) {
+      if (!mf->Init(maxobjects, size)) {
+         delete mf;
+         return 0;
+      }
+      return mf;
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(ShmHeader_t) || !mf->Map(st.st_size) ||
+       R__Header(mf->fBase)->fMagic != kMagic || R__Header(mf->fBase)->fFormat != kFormat) {
+      ::Error("TSharedMapFile::Create", "%s is not a shared map file", path.Data());
+      delete mf;
+      return 0;
+   }
+   if (!mf->Remap()) {
+      delete mf;
+      return 0;
+   }
+   if (writable) R__Header(mf->fBase)->fWriter = gSystem->GetPid();
+   return mf;
+#endif
+}
+
+//______________________________________________________________________________
+Int_t TSharedMapFile::FindRecord(const char *name) const
+{
+   // Return the index of the record of the object name, -1 if not found.
+   // Names never change once published, so no retry is needed here.
+
+   if (!fBase || !name) return -1;
+   Int_t n = R__Header(fBase)->fNobjects;
+   R__SHM_BARRIER();
+   for (Int_t i = 0; i < n; ++i) {
+      if (!strcmp(R__Record(fBase, i)->fName, name)) return i;
+   }
+   return -1;
+}
+
+//______________________________________________________________________________
+TObject *TSharedMapFile::Get(const char *name, TObject *delObj)
+{
+   // Return pointer to object retrieved from shared memory. The object must
+   // be deleted after use. If delObj is a pointer to a previously allocated
+   // object it will be deleted. Returns 0 in case object with the given
+   // name does not exist or was never updated.
+   // The writer is never blocked: if the object is modified while being
+   // copied, the copy is simply done again.
+
+   delete delObj;
+
+   Int_t index = FindRecord(name);
+   if (index < 0) return 0;
+
+   char classname[kMaxName];
+   char *data = 0;
+   Int_t capacity = 0;
+   Int_t length = 0;
+   Bool_t consistent = kFALSE;
+   for (Int_t attempt = 0; attempt < kMaxRetries && !consistent; ++attempt) {
+      if (attempt > 10) gSystem->Sleep(1);
+      ShmRecord_t *rec = R__Record(fBase, index);
+      UInt_t seq = rec->fSeq;
+      if (seq & 1) continue;
+      R__SHM_BARRIER();
+      length = rec->fLength;
+      Long64_t offset = rec->fOffset;
+      memcpy(classname, rec->fClassName, kMaxName);
+      if (length > 0) {
+         if (offset < 0 || offset + length > fMapSize) {
+            // Either the writer grew the region or the values are torn;
+            // in both cases look again after remapping if needed.
+            if (!Remap()) break;
+            continue;
+         }
+         if (length > capacity) {
+            delete [] data;
+            data = new char[length];
+            capacity = length;
+         }
+         memcpy(data, fBase + offset, length);
+      }
+      R__SHM_BARRIER();
+      consistent = (rec->fSeq == seq);
+   }
+   if (!consistent) {
+      Error("Get", "could not get a consistent copy of %s, is the writer of %s alive?", name, fPath.Data());
+      delete [] data;
+      return 0;
+   }
+   if (length <= 0) {
+      delete [] data;
+      return 0;
+   }
+
+   classname[kMaxName-1] = 0;
+   TObject *obj = 0;
+   TClass *cl = TClass::GetClass(classname);
+   if (!cl || !cl->InheritsFrom(TObject::Class())) {
+      Error("Get", "unknown class %s", classname);
+   } else if (!(obj = (TObject*)cl->New())) {
+      Error("Get", "cannot create new object of class %s", classname);
+   } else {
+      TBufferFile b(TBuffer::kRead, length, data, kFALSE);
+      b.MapObject(obj);  //register obj in map to handle self reference
+      obj->Streamer(b);
+   }
+   delete [] data;
+   return obj;
+}
+
+//______________________________________________________________________________
+Int_t TSharedMapFile::GetNobjects() const
+{
+   // Return the number of records of the store, including the ones of
+   // removed objects.
+
+   return fBase ? R__Header(fBase)->fNobjects : 0;
+}
+
+//______________________________________________________________________________
+TString TSharedMapFile::GetSharedMemoryPath(const char *name)
+{
+   // Return the path of the shared memory file of the store name: name
+   // itself if it contains a '/', otherwise name in /dev/shm or, if it
+   // does not exist, in the temporary directory.
+
+   if (strchr(name, '/')) return name;
+   const char *dir = gSystem->AccessPathName("/dev/shm") ? gSystem->TempDirectory() : "/dev/shm";
+   return TString::Format("%s/%s", dir, name);
+}
+
+//______________________________________________________________________________
+UInt_t TSharedMapFile::GetVersion(const char *name) const
+{
+   // Return the number of times the object name was updated (0 if it does
+   // not exist). A monitor can compare it to the value it had at its last
+   // Get() to know whether the object changed.
+
+   Int_t index = FindRecord(name);
+   if (index < 0) return 0;
+   return R__Record(fBase, index)->fSeq >> 1;
+}
+
+//______________________________________________________________________________
+Bool_t TSharedMapFile::Grow(Long64_t needed)
+{
+   // Extend the shared memory file so that needed more bytes can be
+   // allocated after the data in use. The size is at least doubled.
+
+#ifndef WIN32
+   ShmHeader_t *header = R__Header(fBase);
+   Long64_t newsize = fMapSize;
+   while (newsize < header->fUsed + needed) newsize *= 2;
+   newsize = R__RoundUp(newsize, kPageSize);
+   if (ftruncate(fFd, newsize) < 0) {
+      SysError("Grow", "cannot extend %s to %lld bytes", fPath.Data(), newsize);
+      return kFALSE;
+   }
+   if (!Map(newsize)) return kFALSE;
+   // Publish the new size only once the file is extended, readers use it
+   // to remap the region.
+   R__SHM_BARRIER();
+   R__Header(fBase)->fSize = newsize;
+   return kTRUE;
+#else
+   return kFALSE;
+#endif
+}
+
+//______________________________________________________________________________
+Bool_t TSharedMapFile::Init(Int_t maxobjects, Long64_t size)
+{
+   // Initialize a new store able to hold maxobjects objects in an initial
+   // region of size bytes.
+
+#ifndef WIN32
+   if (maxobjects < 1) maxobjects = kDefaultMaxObjects;
+   Long64_t datastart = R__RoundUp(sizeof(ShmHeader_t) + maxobjects*sizeof(ShmRecord_t), kAlignment);
+   if (size < datastart + kPageSize) size = datastart + kPageSize;
+   size = R__RoundUp(size, kPageSize);
+   if (ftruncate(fFd, size) < 0) {
+      SysError("Init", "cannot size %s to %lld bytes", fPath.Data(), size);
+      return kFALSE;
+   }
+   if (!Map(size)) return kFALSE;
+
+   ShmHeader_t *header = R__Header(fBase);
+   header->fFormat     = kFormat;
+   header->fMaxObjects = maxobjects;
+   header->fNobjects   = 0;
+   header->fSize       = size;
+   header->fUsed       = datastart;
+   header->fWriter     = gSystem->GetPid();
+   // Readers check the magic number last.
+   R__SHM_BARRIER();
+   header->fMagic      = kMagic;
+   return kTRUE;
+#else
+   return kFALSE;
+#endif
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::ls(Option_t *) const
+{
+   // List the objects of the store.
+
+   if (!fBase) return;
+
+   Printf("%-20s %-20s %-10s %-10s", "Object", "Class", "Size", "Version");
+   Int_t n = GetNobjects();
+   Int_t listed = 0;
+   for (Int_t i = 0; i < n; ++i) {
+      ShmRecord_t *rec = R__Record(fBase, i);
+      Int_t length = rec->fLength;
+      if (length < 0) continue;
+      Printf("%-20s %-20s %-10d %-10u", rec->fName, rec->fClassName, length, rec->fSeq >> 1);
+      ++listed;
+   }
+   if (!listed)
+      Printf("*** no objects stored in shared map file ***");
+}
+
+//______________________________________________________________________________
+Bool_t TSharedMapFile::Map(Long64_t size)
+{
+   // (Re)map the first size bytes of the shared memory file.
+
+#ifndef WIN32
+   if (fBase) munmap(fBase, fMapSize);
+   fBase = 0;
+   fMapSize = 0;
+   void *addr = mmap(0, (size_t)size, fWritable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fFd, 0);
+   if (addr == MAP_FAILED) {
+      SysError("Map", "cannot map %lld bytes of %s", size, fPath.Data());
+      return kFALSE;
+   }
+   fBase = (char*)addr;
+   fMapSize = size;
+   return kTRUE;
+#else
+   return kFALSE;
+#endif
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::Print(Option_t *) const
+{
+   // Print some info about the store.
+
+   Printf("Shared map file:      %s", fName.Data());
+   Printf("Shared memory file:   %s", fPath.Data());
+   if (fBase) {
+      ShmHeader_t *header = R__Header(fBase);
+      Printf("Mode:                 %s", fWritable ? "writer" : "reader");
+      Printf("Mapped region:        %.2f MB (%.2f MB used)", fMapSize/1048576., header->fUsed/1048576.);
+      Printf("Objects:              %d (maximum %d)", header->fNobjects, header->fMaxObjects);
+      Printf("Writer process:       %d", header->fWriter);
+   } else
+      Printf("Mode:                 closed");
+}
+
+//______________________________________________________________________________
+Bool_t TSharedMapFile::Remap() const
+{
+   // Remap the region if the writer extended the shared memory file.
+   // Return kFALSE if the region could not be mapped.
+
+   if (!fBase) return kFALSE;
+   Long64_t size = R__Header(fBase)->fSize;
+   if (size <= fMapSize) return kTRUE;
+   return const_cast<TSharedMapFile*>(this)->Map(size);
+}
+
+//______________________________________________________________________________
+TObject *TSharedMapFile::Remove(const char *name)
+{
+   // Remove object from shared memory. Returns pointer to removed
+   // object if successful, 0 otherwise. Its record stays in the store
+   // and is reused if an object with the same name is added again.
+
+   if (!fWritable || !fBase) return 0;
+
+   Int_t index = FindRecord(name);
+   if (index < 0) return 0;
+
+   ShmRecord_t *rec = R__Record(fBase, index);
+   ++rec->fSeq;
+   R__SHM_BARRIER();
+   rec->fLength = -1;
+   R__SHM_BARRIER();
+   ++rec->fSeq;
+
+   if (index >= fObjects->GetSize()) return 0;
+   TObject *obj = fObjects->UncheckedAt(index);
+   fObjects->AddAt(0, index);
+   return obj;
+}
+
+//______________________________________________________________________________
+Bool_t TSharedMapFile::Unlink(const char *name)
+{
+   // Remove the shared memory file of the store name. Processes which
+   // still have the store open can keep using it.
+
+   return gSystem->Unlink(GetSharedMemoryPath(name)) == 0;
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::Update(TObject *obj)
+{
+   // Update an object (or all objects, if obj == 0) in shared memory.
+   // Only the records of the updated objects are touched, readers of the
+   // other objects are not disturbed.
+
+   if (!fWritable || !fBase) return;
+
+   Int_t n = fObjects->GetSize();
+   for (Int_t i = 0; i < n; ++i) {
+      TObject *o = fObjects->UncheckedAt(i);
+      if (o && (!obj || o == obj)) UpdateRecord(i);
+   }
+}
+
+//______________________________________________________________________________
+void TSharedMapFile::UpdateRecord(Int_t index)
+{
+   // Stream the object of record index into shared memory.
+
+   TObject *obj = fObjects->UncheckedAt(index);
+   fBuffer->Reset();
+   fBuffer->MapObject(obj);  //register obj in map to handle self reference
+   obj->Streamer(*fBuffer);
+   Int_t length = fBuffer->Length();
+
+   ShmRecord_t *rec = R__Record(fBase, index);
+   if (length <= rec->fCapacity) {
+      // Overwrite in place, readers copying meanwhile will retry.
+      ++rec->fSeq;
+      R__SHM_BARRIER();
+      memcpy(fBase + rec->fOffset, fBuffer->Buffer(), length);
+      rec->fLength = length;
+      R__SHM_BARRIER();
+      ++rec->fSeq;
+      return;
+   }
+
+   // The object outgrew its slot: copy it to a new one, with some room to
+   // grow, and only then switch the record to it. The old slot is not
+   // reused.
+   Long64_t capacity = R__RoundUp(length + length/4, kAlignment);
+   ShmHeader_t *header = R__Header(fBase);
+   if (header->fUsed + capacity > fMapSize) {
+      if (!Grow(capacity)) {
+         Error("Update", "cannot store %s (%d bytes)", R__Record(fBase, index)->fName, length);
+         return;
+      }
+      header = R__Header(fBase);
+      rec = R__Record(fBase, index);
+   }
+   Long64_t offset = header->fUsed;
+   memcpy(fBase + offset, fBuffer->Buffer(), length);
+   header->fUsed = offset + capacity;
+
+   ++rec->fSeq;
+   R__SHM_BARRIER();
+   rec->fOffset   = offset;
+   rec->fCapacity = capacity;
+   rec->fLength   = length;
+   R__SHM_BARRIER();
+   ++rec->fSeq;
+}
@@ -23,6 +23,7 @@
 #include "TClassEdit.h"
 #include "TVirtualCollectionIterators.h"
 #include "TProcessID.h"
+#include "TVirtualObject.h"
 
 static const Int_t kRegrouped = TStreamerInfo::kOffsetL;
 
@@ -738,6 +739,75 @@ namespace TStreamerInfoActions
       (*config->fStreamer)(buf,addr,conf->fLength);
    }
 
+   template <typename T>
+   INLINE_TEMPLATE_ARGS void ReadSTLObjectWiseVectorOfVector(TBuffer &buf, void *addr, const TConfiguration *conf, Version_t vers, UInt_t start)
+   {
+      // Case of a std::vector<std::vector<T> > saved object-wise: read the
+      // inner vectors directly instead of going through the collection proxy,
+      // TClass::Streamer and TGenCollectionStreamer for each of them.
+      // The vectors are resized in place, so that the inner vectors kept
+      // from the previous read reuse their storage.
+
+      if (buf.IsA() != TBufferFile::Class()) {
+         // TBufferXML and TBufferSQL2 decorate each element.
+         ReadSTLObjectWiseFastArray(buf,addr,conf,vers,start);
+         return;
+      }
+      std::vector<std::vector<T> > *vec = (std::vector<std::vector<T> >*)addr;
+      Int_t nvalues;
+      buf.ReadInt(nvalues);
+      if (nvalues < 0) nvalues = 0;
+      vec->resize(nvalues);
+      for(Int_t i = 0; i < nvalues; ++i) {
+         std::vector<T> &inner = (*vec)[i];
+         Int_t n;
+         buf.ReadInt(n);
+         if (n < 0) n = 0;
+         inner.resize(n);
+         if (n) buf.ReadFastArray(&(inner[0]),n);
+      }
+   }
+
+   INLINE_TEMPLATE_ARGS void ReadSTLObjectWiseVectorOfClass(TBuffer &buf, void *addr, const TConfiguration *conf, Version_t vers, UInt_t start)
+   {
+      // Case of a std::vector of objects streamed by their StreamerInfo, saved
+      // object-wise: resize the vector once and read each element with
+      // ReadClassBuffer, skipping the per-element dispatch through
+      // TGenCollectionStreamer, TBuffer::StreamObject and TClass::Streamer.
+
+      if (buf.IsA() != TBufferFile::Class()) {
+         // TBufferXML and TBufferSQL2 decorate each element.
+         ReadSTLObjectWiseFastArray(buf,addr,conf,vers,start);
+         return;
+      }
+      TConfigSTL *config = (TConfigSTL*)conf;
+      TVirtualCollectionProxy *proxy = config->fOldClass->GetCollectionProxy();
+      TClass *valueClass = proxy->GetValueClass();
+      Int_t incr = proxy->GetIncrement();
+
+      TVirtualCollectionProxy::TPushPop helper( proxy, addr );
+      Int_t nvalues;
+      buf.ReadInt(nvalues);
+      proxy->Clear("force");
+      if (nvalues <= 0) return;
+      void* alternative = proxy->Allocate(nvalues,true);
+
+      char startbuf[TVirtualCollectionProxy::fgIteratorArenaSize];
+      char endbuf[TVirtualCollectionProxy::fgIteratorArenaSize];
+      void *begin = &(startbuf[0]);
+      void *end = &(endbuf[0]);
+      config->fCreateIterators( alternative, &begin, &end );
+      // For a vector the iterators are the addresses of the first and past the last element.
+      for(char *elem = (char*)begin; elem < (char*)end; elem += incr) {
+         buf.ReadClassBuffer(valueClass, elem);
+      }
+      if (begin != &(startbuf[0])) {
+         // assert(end != endbuf);
+         config->fDeleteTwoIterators(begin,end);
+      }
+      proxy->Commit(alternative);
+   }
+
    template <void (*memberwise)(TBuffer&,void *,const TConfiguration*, Version_t), 
              void (*objectwise)(TBuffer&,void *,const TConfiguration*, Version_t, UInt_t)>
    INLINE_TEMPLATE_ARGS Int_t ReadSTL(TBuffer &buf, void *addr, const TConfiguration *conf)
@@ -809,6 +879,95 @@ namespace TStreamerInfoActions
       }
    };
 
+   template <typename From, typename To>
+   struct ConvertBasicArray {
+      static INLINE_TEMPLATE_ARGS Int_t Action(TBuffer &buf, void *addr, const TConfiguration *config)
+      {
+         // Conversion of a fixed size array of fLength 'From' on disk to an array of 'To'
+         // in memory, element by element and without intermediary buffer.
+         char *x = (char*)addr;
+         for (UInt_t j = 0; j < config->fLength; ++j, x += sizeof(To)) {
+            ConvertBasicType<From,To>::Action(buf, x, config);
+         }
+         return 0;
+      }
+   };
+
+   template <typename T>
+   INLINE_TEMPLATE_ARGS Int_t SkipBasicType(TBuffer &buf, void *, const TConfiguration *config)
+   {
+      // Skip a member (or a fixed size array of fLength members) present on file
+      // but no longer in memory.
+      T dummy;
+      for (UInt_t j = 0; j < config->fLength; ++j) {
+         buf >> dummy;
+      }
+      return 0;
+   }
+
+   class TConfReadRule : public TConfiguration {
+      // Configuration object for an artificial element, i.e. the execution of a read rule.
+      // The rule functions expect the start of the object, so unlike the other
+      // configurations fOffset is not the offset of the element (the target member
+      // of the rule) but only the position of the object in the address given to
+      // the sequence: 0, unless changed by AddToOffset for a split sub-object.
+   public:
+      ROOT::TSchemaRule::ReadFuncPtr_t     fReadFunc;
+      ROOT::TSchemaRule::ReadRawFuncPtr_t  fReadRawFunc;
+      TConfReadRule(TVirtualStreamerInfo *info, UInt_t id, TStreamerArtificial *element) :
+         TConfiguration(info,id,0),fReadFunc(element->GetReadFunc()),fReadRawFunc(element->GetReadRawFunc()) {};
+      virtual TConfiguration *Copy() { return new TConfReadRule(*this); }
+   };
+
+   INLINE_TEMPLATE_ARGS Int_t ReadArtificial(TBuffer &buf, void *addr, const TConfiguration *config)
+   {
+      // Execute the read rule attached to an artificial element. As in
+      // TStreamerInfo::ReadBufferArtificial, the functions are given the start
+      // of the object (arr[k] and arr[k]+eoffset) so that they can set any of
+      // its members.
+
+      const TConfReadRule *conf = (const TConfReadRule*)config;
+      char *object = (char*)addr + conf->fOffset;
+      if (conf->fReadRawFunc) {
+         conf->fReadRawFunc( (char*)addr, buf );
+      } else if (conf->fReadFunc) {
+         TVirtualObject obj(0);
+         TVirtualArray *objarr = buf.PeekDataCache();
+         if (objarr) {
+            obj.fClass = objarr->fClass;
+            obj.fObject = objarr->GetObjectAt(0);
+         }
+         conf->fReadFunc( object, &obj );
+         obj.fObject = 0; // Prevent auto deletion
+      }
+      return 0;
+   }
+
+   class TConfPushDataCache : public TConfiguration {
+      // Configuration object for the creation of the onfile object cache used by the read rules.
+   public:
+      TClass *fOnfileClass;
+      TConfPushDataCache(TVirtualStreamerInfo *info, UInt_t id, TClass *onfileClass) :
+         TConfiguration(info,id,0),fOnfileClass(onfileClass) {};
+      virtual TConfiguration *Copy() { return new TConfPushDataCache(*this); }
+   };
+
+   INLINE_TEMPLATE_ARGS Int_t PushDataCache(TBuffer &buf, void *, const TConfiguration *config)
+   {
+      // Create the in memory copy of the onfile members used by the read rules.
+
+      buf.PushDataCache( new TVirtualArray( ((const TConfPushDataCache*)config)->fOnfileClass, 1 ) );
+      return 0;
+   }
+
+   INLINE_TEMPLATE_ARGS Int_t PopDataCache(TBuffer &buf, void *, const TConfiguration *)
+   {
+      // Delete the in memory copy of the onfile members used by the read rules.
+
+      delete buf.PopDataCache();
+      return 0;
+   }
+
    class TConfigurationUseCache : public TConfiguration {
       // Configuration object for the UseCache case.
    public:
@@ -2002,6 +2161,57 @@ static TConfiguredAction GetNumericCollectionReadAction(Int_t type, TConfigSTL *
    return TConfiguredAction();
 }
 
+template <typename T>
+static TConfiguredAction GetVectorOfVectorReadAction(TClass *oldClass, TConfigSTL *conf)
+{
+   // Return the specialised read action if oldClass really is a
+   // std::vector<std::vector<T> > (and not an emulation or a typedef variant).
+
+   if (oldClass == TClass::GetClass(typeid(std::vector<std::vector<T> >), kFALSE, kTRUE)) {
+      return TConfiguredAction( ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseVectorOfVector<T> >, conf );
+   }
+   return TConfiguredAction( ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseFastArray>, conf );
+}
+
+static TConfiguredAction GetCollectionOfClassReadAction(TClass *oldClass, TConfigSTL *conf)
+{
+   // Return the read action for a collection of objects stored without
+   // schema evolution. std::vector<std::vector<numeric> > and std::vector
+   // of classes streamed by their StreamerInfo get a specialised loop, the
+   // other collections go through their collection proxy's streamer.
+
+   TVirtualCollectionProxy *proxy = oldClass->GetCollectionProxy();
+   TClass *valueClass = proxy->GetValueClass();
+   if (proxy->GetCollectionType() == TClassEdit::kVector && !proxy->HasPointers() && valueClass) {
+      TVirtualCollectionProxy *valueProxy = valueClass->GetCollectionProxy();
+      if (valueProxy) {
+         if (valueProxy->GetCollectionType() == TClassEdit::kVector && !valueProxy->GetValueClass() && !valueProxy->HasPointers()) {
+            switch (valueProxy->GetType()) {
+               case TStreamerInfo::kChar:    return GetVectorOfVectorReadAction<Char_t>(oldClass, conf);
+               case TStreamerInfo::kShort:   return GetVectorOfVectorReadAction<Short_t>(oldClass, conf);
+               case TStreamerInfo::kInt:     return GetVectorOfVectorReadAction<Int_t>(oldClass, conf);
+               case TStreamerInfo::kLong:    return GetVectorOfVectorReadAction<Long_t>(oldClass, conf);
+               case TStreamerInfo::kLong64:  return GetVectorOfVectorReadAction<Long64_t>(oldClass, conf);
+               case TStreamerInfo::kFloat:   return GetVectorOfVectorReadAction<Float_t>(oldClass, conf);
+               case TStreamerInfo::kDouble:  return GetVectorOfVectorReadAction<Double_t>(oldClass, conf);
+               case TStreamerInfo::kUChar:   return GetVectorOfVectorReadAction<UChar_t>(oldClass, conf);
+               case TStreamerInfo::kUShort:  return GetVectorOfVectorReadAction<UShort_t>(oldClass, conf);
+               case TStreamerInfo::kUInt:    return GetVectorOfVectorReadAction<UInt_t>(oldClass, conf);
+               case TStreamerInfo::kULong:   return GetVectorOfVectorReadAction<ULong_t>(oldClass, conf);
+               case TStreamerInfo::kULong64: return GetVectorOfVectorReadAction<ULong64_t>(oldClass, conf);
+               default:
+                  // bool, Float16_t and Double32_t need the generic treatment.
+                  break;
+            }
+         }
+      } else if (!valueClass->IsTObject() && !valueClass->GetStreamer() && !valueClass->GetStreamerFunc()) {
+         // TClass::Streamer would end up in ReadClassBuffer for those.
+         return TConfiguredAction( ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseVectorOfClass>, conf );
+      }
+   }
+   return TConfiguredAction( ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseFastArray>, conf );
+}
+
 template <typename Looper, typename From> 
 static TConfiguredAction GetConvertCollectionReadActionFrom(Int_t newtype, TConfiguration *conf)
 {
@@ -2489,6 +2699,33 @@ static void AddReadConvertAction(TStreamerInfoActions::TActionSequence *sequence
    }
 }
 
+template <typename From> 
+static void AddReadConvertArrayAction(TStreamerInfoActions::TActionSequence *sequence, Int_t newtype, TConfiguration *conf)
+{
+   switch (newtype) {
+      case TStreamerInfo::kBool:    sequence->AddAction( ConvertBasicArray<From,bool>::Action,  conf ); break;
+      case TStreamerInfo::kChar:    sequence->AddAction( ConvertBasicArray<From,char>::Action,  conf ); break;
+      case TStreamerInfo::kShort:   sequence->AddAction( ConvertBasicArray<From,short>::Action, conf );  break;
+      case TStreamerInfo::kInt:     sequence->AddAction( ConvertBasicArray<From,Int_t>::Action, conf ); break;
+      case TStreamerInfo::kLong:    sequence->AddAction( ConvertBasicArray<From,Long_t>::Action,conf ); break;
+      case TStreamerInfo::kLong64:  sequence->AddAction( ConvertBasicArray<From,Long64_t>::Action, conf ); break;
+      case TStreamerInfo::kFloat:   sequence->AddAction( ConvertBasicArray<From,float>::Action,    conf ); break;
+      case TStreamerInfo::kFloat16: sequence->AddAction( ConvertBasicArray<From,float>::Action,    conf ); break;
+      case TStreamerInfo::kDouble:  sequence->AddAction( ConvertBasicArray<From,double>::Action,   conf ); break;
+      case TStreamerInfo::kDouble32:sequence->AddAction( ConvertBasicArray<From,double>::Action,   conf ); break;
+      case TStreamerInfo::kUChar:   sequence->AddAction( ConvertBasicArray<From,UChar_t>::Action,  conf ); break;
+      case TStreamerInfo::kUShort:  sequence->AddAction( ConvertBasicArray<From,UShort_t>::Action, conf ); break;
+      case TStreamerInfo::kUInt:    sequence->AddAction( ConvertBasicArray<From,UInt_t>::Action,   conf ); break;
+      case TStreamerInfo::kULong:   sequence->AddAction( ConvertBasicArray<From,ULong_t>::Action,  conf ); break;
+      case TStreamerInfo::kULong64: sequence->AddAction( ConvertBasicArray<From,ULong64_t>::Action,conf );  break;
+      default:
+         // Leave the unusual cases to the generic code.
+         sequence->AddAction( GenericReadAction, new TGenericConfiguration(sequence->fStreamerInfo,conf->fElemId) );
+         delete conf;
+         break;
+   }
+}
+
 //______________________________________________________________________________
 void TStreamerInfo::AddReadAction(Int_t i, TStreamerElement* element)
 {
@@ -2586,8 +2823,10 @@ void TStreamerInfo::AddReadAction(Int_t i, TStreamerElement* element)
                   if (element->GetStreamer()) {
                      fReadObjectWise->AddAction(ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseStreamer>, new TConfigSTL(this,i,fOffset[i],1,oldClass,element->GetStreamer(),element->GetTypeName(),isSTLbase));
                   } else {
-                     if (oldClass->GetCollectionProxy() == 0 || oldClass->GetCollectionProxy()->GetValueClass() || oldClass->GetCollectionProxy()->HasPointers() ) {
+                     if (oldClass->GetCollectionProxy() == 0) {
                         fReadObjectWise->AddAction(ReadSTL<ReadSTLMemberWiseSameClass,ReadSTLObjectWiseFastArray>, new TConfigSTL(this,i,fOffset[i],1,oldClass,element->GetTypeName(),isSTLbase));
+                     } else if (oldClass->GetCollectionProxy()->GetValueClass() || oldClass->GetCollectionProxy()->HasPointers() ) {
+                        fReadObjectWise->AddAction(GetCollectionOfClassReadAction(oldClass, new TConfigSTL(this,i,fOffset[i],1,oldClass,element->GetTypeName(),isSTLbase)));
                      } else {
                         switch (SelectLooper(*oldClass->GetCollectionProxy())) {
                         case kVectorLooper:
@@ -2706,6 +2945,127 @@ void TStreamerInfo::AddReadAction(Int_t i, TStreamerElement* element)
          }
          break;
       }
+      // Fixed size arrays of basic types whose type changed.
+      case TStreamerInfo::kConvL + TStreamerInfo::kBool:
+         AddReadConvertArrayAction<Bool_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kChar:
+         AddReadConvertArrayAction<Char_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kShort:
+         AddReadConvertArrayAction<Short_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kInt:
+         AddReadConvertArrayAction<Int_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kLong:
+         // As in ReadBufferConv, read as a 64 bits integer when converting to one.
+         if (fNewType[i]%kRegrouped == TStreamerInfo::kLong64 || fNewType[i]%kRegrouped == TStreamerInfo::kULong64) {
+            AddReadConvertArrayAction<Long64_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         } else {
+            AddReadConvertArrayAction<Long_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         }
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kLong64:
+         AddReadConvertArrayAction<Long64_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kFloat:
+         AddReadConvertArrayAction<Float_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kDouble:
+         AddReadConvertArrayAction<Double_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kUChar:
+         AddReadConvertArrayAction<UChar_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kUShort:
+         AddReadConvertArrayAction<UShort_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kUInt:
+         AddReadConvertArrayAction<UInt_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kULong:
+         if (fNewType[i]%kRegrouped == TStreamerInfo::kLong64 || fNewType[i]%kRegrouped == TStreamerInfo::kULong64) {
+            AddReadConvertArrayAction<ULong64_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         } else {
+            AddReadConvertArrayAction<ULong_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         }
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kULong64:
+         AddReadConvertArrayAction<ULong64_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+         break;
+      case TStreamerInfo::kConvL + TStreamerInfo::kFloat16: {
+         TConfiguration *conf;
+         if (element->GetFactor() != 0) {
+            conf = new TConfWithFactor(this,i,fOffset[i],element->GetFactor(),element->GetXmin());
+            conf->fLength = fLength[i];
+            AddReadConvertArrayAction<WithFactorMarker<float> >(fReadObjectWise, fNewType[i]%kRegrouped, conf );
+         } else {
+            Int_t nbits = (Int_t)element->GetXmin();
+            if (!nbits) nbits = 12;
+            conf = new TConfNoFactor(this,i,fOffset[i],nbits);
+            conf->fLength = fLength[i];
+            AddReadConvertArrayAction<NoFactorMarker<float> >(fReadObjectWise, fNewType[i]%kRegrouped, conf );
+         }
+         break;
+      }
+      case TStreamerInfo::kConvL + TStreamerInfo::kDouble32: {
+         TConfiguration *conf;
+         if (element->GetFactor() != 0) {
+            conf = new TConfWithFactor(this,i,fOffset[i],element->GetFactor(),element->GetXmin());
+            conf->fLength = fLength[i];
+            AddReadConvertArrayAction<WithFactorMarker<double> >(fReadObjectWise, fNewType[i]%kRegrouped, conf );
+         } else {
+            Int_t nbits = (Int_t)element->GetXmin();
+            if (!nbits) {
+               AddReadConvertArrayAction<Float_t>(fReadObjectWise, fNewType[i]%kRegrouped, new TConfiguration(this,i,fOffset[i],fLength[i]) );
+            } else {
+               conf = new TConfNoFactor(this,i,fOffset[i],nbits);
+               conf->fLength = fLength[i];
+               AddReadConvertArrayAction<NoFactorMarker<double> >(fReadObjectWise, fNewType[i]%kRegrouped, conf );
+            }
+         }
+         break;
+      }
+
+      // Members (or fixed size arrays) on file but no longer in memory.
+      case TStreamerInfo::kSkip  + TStreamerInfo::kBool:    fReadObjectWise->AddAction( SkipBasicType<Bool_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kChar:    fReadObjectWise->AddAction( SkipBasicType<Char_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kShort:   fReadObjectWise->AddAction( SkipBasicType<Short_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kInt:     fReadObjectWise->AddAction( SkipBasicType<Int_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kLong:    fReadObjectWise->AddAction( SkipBasicType<Long_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kLong64:  fReadObjectWise->AddAction( SkipBasicType<Long64_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kFloat:   fReadObjectWise->AddAction( SkipBasicType<Float_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kDouble:  fReadObjectWise->AddAction( SkipBasicType<Double_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kUChar:   fReadObjectWise->AddAction( SkipBasicType<UChar_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kUShort:  fReadObjectWise->AddAction( SkipBasicType<UShort_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kUInt:    fReadObjectWise->AddAction( SkipBasicType<UInt_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kULong:   fReadObjectWise->AddAction( SkipBasicType<ULong_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkip  + TStreamerInfo::kULong64: fReadObjectWise->AddAction( SkipBasicType<ULong64_t>, new TConfiguration(this,i,fOffset[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kBool:    fReadObjectWise->AddAction( SkipBasicType<Bool_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kChar:    fReadObjectWise->AddAction( SkipBasicType<Char_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kShort:   fReadObjectWise->AddAction( SkipBasicType<Short_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kInt:     fReadObjectWise->AddAction( SkipBasicType<Int_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kLong:    fReadObjectWise->AddAction( SkipBasicType<Long_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kLong64:  fReadObjectWise->AddAction( SkipBasicType<Long64_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kFloat:   fReadObjectWise->AddAction( SkipBasicType<Float_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kDouble:  fReadObjectWise->AddAction( SkipBasicType<Double_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kUChar:   fReadObjectWise->AddAction( SkipBasicType<UChar_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kUShort:  fReadObjectWise->AddAction( SkipBasicType<UShort_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kUInt:    fReadObjectWise->AddAction( SkipBasicType<UInt_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kULong:   fReadObjectWise->AddAction( SkipBasicType<ULong_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+      case TStreamerInfo::kSkipL + TStreamerInfo::kULong64: fReadObjectWise->AddAction( SkipBasicType<ULong64_t>, new TConfiguration(this,i,fOffset[i],fLength[i]) ); break;
+
+      // Schema evolution read rules.
+      case TStreamerInfo::kArtificial:
+         fReadObjectWise->AddAction( ReadArtificial, new TConfReadRule(this,i,(TStreamerArtificial*)element) );
+         break;
+      case TStreamerInfo::kCacheNew:
+         fReadObjectWise->AddAction( PushDataCache, new TConfPushDataCache(this,i,element->GetClassPointer()) );
+         break;
+      case TStreamerInfo::kCacheDelete:
+         fReadObjectWise->AddAction( PopDataCache, new TConfiguration(this,i,0) );
+         break;
       default:
          fReadObjectWise->AddAction( GenericReadAction, new TGenericConfiguration(this,i) );
          break;
@@ -47,6 +47,34 @@
   the merge will be done without  unzipping or unstreaming the baskets
   (i.e. direct copy of the raw byte on disk). The "fast" mode is typically
   5 times faster than the mode unzipping and unstreaming the baskets.
+  If the compression levels differ, the baskets are still not unstreamed
+  but they are unzipped and zipped again, in parallel on all the cpus
+  (see TTreeCloner.RecompressThreads in system.rootrc).
+
+  When the sources hold small Trees (e.g. produced by many short jobs),
+  their clusters and baskets can be coalesced with
+       hadd -c 30000000 targetfile source1 source2 ...
+  The entries are then appended (without being unstreamed) to baskets
+  written at each cluster boundary of the target Tree, the clusters
+  being sized to hold about 30 MB of compressed data.
+
+  The layout of the target Trees can also be tuned for a given analysis
+  with an access profile recorded by TTreePerfStats::SaveProfile:
+       hadd -p profile.txt targetfile source1 source2 ...
+  The cluster size is then chosen to fit the branches read by the
+  analysis in its TTreeCache, and the baskets of these branches to hold
+  a whole cluster (see TTree::ApplyAccessProfile). The baskets have to
+  be unstreamed, so this disables the "fast" mode.
+
+  The merge can be spread over several processes with
+       hadd -j 8 targetfile source1 source2 ...
+  The list of sources is cut in (at most) 8 consecutive groups, each one
+  merged by a separate process in a temporary file (in the directory
+  given by $TMPDIR). Those partial results are then merged again in
+  parallel, kFanIn of them per process, until few enough remain to be
+  merged in the target file. Histograms are thus added in a reduction
+  tree and the order of the Tree entries is preserved. If no number is
+  given after -j, the number of cpus of the machine is used.
 
   NOTE1: By default histograms are added. However hadd does not support the case where
          histograms have their bit TH1::kIsAverage set.
@@ -74,12 +102,178 @@
 #include "TROOT.h"
 #include "TInterpreter.h"
 
+#include <vector>
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Minimum number of partial results merged by each process after the
+// first parallel pass. A lower value gives a deeper reduction tree, in
+// which the content of the Trees is copied more often.
+static const Int_t kFanIn = 4;
+
+struct HaddInput_t {
+   std::string fName;      // name of the source file
+   Bool_t      fStrict;    // if true, a failure to open the file is fatal even with -k
+   HaddInput_t(const std::string &name, Bool_t strict) : fName(name), fStrict(strict) {}
+};
+
+struct HaddOptions_t {
+   Bool_t fSkipErrors;
+   Bool_t fNoTrees;
+   Int_t  fMaxOpenedFiles;
+   Int_t  fVerbosity;
+   Int_t  fCompress;
+   Long64_t fClusterSize;
+   std::string fProfile;
+};
+
+//___________________________________________________________________________
+static Bool_t AddInputs(TFileMerger &merger, const std::vector<HaddInput_t> &inputs,
+                        size_t first, size_t last, Bool_t skip_errors)
+{
+   // Add the sources [first,last) to merger. Return false if one of them
+   // could not be opened and can not be skipped.
+
+   for (size_t i = first; i < last; ++i) {
+      if (merger.AddFile(inputs[i].fName.c_str())) continue;
+      if (inputs[i].fStrict) return kFALSE;
+      if (skip_errors) {
+         cerr << "hadd skipping file with error: " << inputs[i].fName << endl;
+      } else {
+         cerr << "hadd exiting due to error in " << inputs[i].fName << endl;
+         return kFALSE;
+      }
+   }
+   return kTRUE;
+}
+
+//___________________________________________________________________________
+static void ConfigureMerger(TFileMerger &merger, const char *prefix, const HaddOptions_t &opt)
+{
+   // Apply the command line options common to all the mergers.
+
+   merger.SetMsgPrefix(prefix);
+   merger.SetPrintLevel(opt.fVerbosity - 1);
+   if (opt.fMaxOpenedFiles > 0) {
+      merger.SetMaxOpenedFiles(opt.fMaxOpenedFiles);
+   }
+   merger.SetNotrees(opt.fNoTrees);
+   merger.SetClusterSize(opt.fClusterSize);
+}
+
+#ifndef WIN32
+//___________________________________________________________________________
+static Bool_t MergeGroup(const char *output, const std::vector<HaddInput_t> &inputs,
+                         size_t first, size_t last, Int_t group, const HaddOptions_t &opt)
+{
+   // Merge the sources [first,last) into the new file output.
+   // This is executed in a child process.
+
+   TFileMerger merger(kFALSE,kFALSE);
+   TString prefix = TString::Format("hadd[%d]", group);
+   ConfigureMerger(merger, prefix, opt);
+   if (!merger.OutputFile(output, kTRUE, opt.fCompress)) {
+      cerr << prefix << " error opening temporary file " << output << endl;
+      return kFALSE;
+   }
+   if (!AddInputs(merger, inputs, first, last, opt.fSkipErrors)) {
+      return kFALSE;
+   }
+   return merger.Merge();
+}
+
+//___________________________________________________________________________
+static void RemovePartials(std::vector<std::string> &partials)
+{
+   // Remove the temporary files in partials and clear it.
+
+   for (size_t p = 0; p < partials.size(); ++p) {
+      gSystem->Unlink(partials[p].c_str());
+   }
+   partials.clear();
+}
+
+//___________________________________________________________________________
+static Bool_t MergeInParallel(std::vector<HaddInput_t> &inputs, Int_t njobs,
+                              const HaddOptions_t &opt, std::vector<std::string> &partials)
+{
+   // Reduce inputs by merging consecutive groups of them in up to njobs
+   // processes at once. The first pass uses all the processes, the next
+   // ones merge at least kFanIn partial files each, until fewer than
+   // 2*kFanIn remain. On return inputs holds the names of the files
+   // to be merged in the target, and partials the temporary files among
+   // them, which the caller has to remove. The partial files of a pass are
+   // removed as soon as the next pass has merged them, so that at most two
+   // passes are on disk at once, and all of them are removed on failure.
+
+   Int_t depth = 0;
+   std::vector<std::string> previous;   // partial files merged by this pass
+   while (1) {
+      Int_t fanin = depth ? kFanIn : 2;
+      Int_t ngroups = (Int_t)(inputs.size() / fanin);
+      if (ngroups > njobs) ngroups = njobs;
+      if (ngroups < 2) break;
+
+      std::vector<HaddInput_t> outputs;
+      std::vector<pid_t> children;
+      Bool_t status = kTRUE;
+      cout.flush();
+      cerr.flush();
+      for (Int_t g = 0; g < ngroups; ++g) {
+         size_t first = (inputs.size() * g) / ngroups;
+         size_t last  = (inputs.size() * (g+1)) / ngroups;
+         std::string name = TString::Format("%s/hadd_%d_%d_%d.root", gSystem->TempDirectory(),
+                                            gSystem->GetPid(), depth, g).Data();
+         partials.push_back(name);  // the partial files of this pass
+         outputs.push_back(HaddInput_t(name, kTRUE));
+
+         pid_t pid = fork();
+         if (pid == 0) {
+            Bool_t ok = MergeGroup(name.c_str(), inputs, first, last, g, opt);
+            cout.flush();
+            cerr.flush();
+            _exit(ok ? 0 : 1);
+         } else if (pid < 0) {
+            cerr << "hadd error: could not fork a merging process." << endl;
+            status = kFALSE;
+            break;
+         }
+         children.push_back(pid);
+      }
+      for (size_t c = 0; c < children.size(); ++c) {
+         int childstatus = 0;
+         if (waitpid(children[c], &childstatus, 0) != children[c] ||
+             !WIFEXITED(childstatus) || WEXITSTATUS(childstatus) != 0) {
+            status = kFALSE;
+         }
+      }
+      RemovePartials(previous);
+      if (!status) {
+         RemovePartials(partials);
+         return kFALSE;
+      }
+      if (opt.fVerbosity > 1) {
+         cout << "hadd merged " << inputs.size() << " files in " << ngroups
+              << " partial files" << endl;
+      }
+      inputs.swap(outputs);
+      previous.swap(partials);
+      ++depth;
+   }
+   partials.swap(previous);
+   return kTRUE;
+}
+#endif
+
 //___________________________________________________________________________
 int main( int argc, char **argv )
 {
 
    if ( argc < 3 || "-h" == string(argv[1]) || "--help" == string(argv[1]) ) {
-      cout << "Usage: " << argv[0] << " [-f[0-9]] [-k] [-T] [-O] [-n maxopenedfiles] [-v verbosity] targetfile source1 [source2 source3 ...]" << endl;
+      cout << "Usage: " << argv[0] << " [-f[0-9]] [-k] [-T] [-O] [-n maxopenedfiles] [-j [njobs]] [-c clustersize] [-p profile] [-v verbosity] targetfile source1 [source2 source3 ...]" << endl;
       cout << "This program will add histograms from a list of root files and write them" << endl;
       cout << "to a target root file. The target file is newly created and must not " << endl;
       cout << "exist, or if -f (\"force\") is given, must not be one of the source files." << endl;
@@ -89,12 +283,16 @@ int main( int argc, char **argv )
       cout << "If the option -O is used, when merging TTree, the basket size is re-optimized" <<endl;
       cout << "If the option -v is used, explicitly set the verbosity level; 0 request no output, 99 is the default" <<endl;
       cout << "If the option -n is used, hadd will open at most 'maxopenedfiles' at once, use 0 to request to use the system maximum." << endl;
+      cout << "If the option -j is used, the merge is spread over 'njobs' processes (by default the number of cpus)," << endl;
+      cout << " writing partial results in $TMPDIR which are then merged together." << endl;
+      cout << "If the option -c is used, the Tree baskets are coalesced in clusters of about 'clustersize' compressed bytes." << endl;
+      cout << "If the option -p is used, the Tree clusters and baskets are sized for the access profile written by TTreePerfStats::SaveProfile." << endl;
       cout << "When -the -f option is specified, one can also specify the compression" <<endl;
       cout << "level of the target file. By default the compression level is 1, but" <<endl;
       cout << "if \"-f0\" is specified, the target file will not be compressed." <<endl;
       cout << "if \"-f6\" is specified, the compression level 6 will be used." <<endl;
       cout << "if Target and source files have different compression levels"<<endl;
-      cout << " a slower method is used"<<endl;
+      cout << " the Tree baskets are recompressed, which is slower"<<endl;
       return 1;
    }
 
@@ -104,6 +302,9 @@ int main( int argc, char **argv )
    Bool_t noTrees = kFALSE;
    Int_t maxopenedfiles = 0;
    Int_t verbosity = 99;
+   Int_t njobs = 1;
+   Long64_t clustersize = 0;
+   const char *profile = 0;
 
    int outputPlace = 0;
    int ffirst = 2;
@@ -135,6 +336,53 @@ int main( int argc, char **argv )
             }
          }
          ++ffirst;
+      } else if ( strcmp(argv[a],"-j") == 0 ) {
+         if (a+1 < argc && argv[a+1][0] && strspn(argv[a+1],"0123456789") == strlen(argv[a+1])) {
+            Long_t request = strtol(argv[a+1], 0, 10);
+            if (request < kMaxInt && request > 0) {
+               njobs = (Int_t)request;
+            } else {
+               cerr << "Error: could not parse the number of jobs passed after -j: " << argv[a+1] << ". We will use the number of cpus.\n";
+               njobs = 0;
+            }
+            ++a;
+            ++ffirst;
+         } else {
+            njobs = 0;
+         }
+         if (njobs == 0) {
+            SysInfo_t info;
+            if (gSystem->GetSysInfo(&info) == 0 && info.fCpus > 0) {
+               njobs = info.fCpus;
+            } else {
+               njobs = 1;
+            }
+         }
+         ++ffirst;
+      } else if ( strcmp(argv[a],"-c") == 0 ) {
+         if (a+1 >= argc) {
+            cerr << "Error: no cluster size was provided after -c.\n";
+         } else {
+            TString arg(argv[a+1]);
+            Long64_t request = arg.IsDigit() ? arg.Atoll() : 0;
+            if (request > 0) {
+               clustersize = request;
+               ++a;
+               ++ffirst;
+            } else {
+               cerr << "Error: could not parse the cluster size passed after -c: " << argv[a+1] << ". The clusters will not be changed.\n";
+            }
+         }
+         ++ffirst;
+      } else if ( strcmp(argv[a],"-p") == 0 ) {
+         if (a+1 >= argc) {
+            cerr << "Error: no access profile was provided after -p.\n";
+         } else {
+            profile = argv[a+1];
+            ++a;
+            ++ffirst;
+         }
+         ++ffirst;
       } else if ( strcmp(argv[a],"-v") == 0 ) {
          if (a+1 >= argc) {
             cerr << "Error: no verbosity level was provided after -v.\n";
@@ -186,19 +434,24 @@ int main( int argc, char **argv )
       cout << "hadd Target file: " << targetname << endl;
    }
 
+   HaddOptions_t opt;
+   opt.fSkipErrors = skip_errors;
+   opt.fNoTrees = noTrees;
+   opt.fMaxOpenedFiles = maxopenedfiles;
+   opt.fVerbosity = verbosity;
+   opt.fCompress = newcomp;
+   opt.fClusterSize = clustersize;
+   if (profile) opt.fProfile = profile;
+
    TFileMerger merger(kFALSE,kFALSE);
-   merger.SetMsgPrefix("hadd");
-   merger.SetPrintLevel(verbosity - 1);
-   if (maxopenedfiles > 0) {
-      merger.SetMaxOpenedFiles(maxopenedfiles);
-   }
+   ConfigureMerger(merger, "hadd", opt);
    if (!merger.OutputFile(targetname,force,newcomp) ) {
       cerr << "hadd error opening target file (does " << argv[ffirst-1] << " exist?)." << endl;
       cerr << "Pass \"-f\" argument to force re-creation of output file." << endl;
       exit(1);
    }
 
-   
+   std::vector<HaddInput_t> inputs;
    for ( int i = ffirst; i < argc; i++ ) {
       if (argv[i] && argv[i][0]=='@') {
          std::ifstream indirect_file(argv[i]+1);
@@ -208,39 +461,63 @@ int main( int argc, char **argv )
          }
          while( indirect_file ){
             std::string line;
-            if( std::getline(indirect_file, line) && line.length() &&  !merger.AddFile(line.c_str()) ) {
-               return 1;
+            if( std::getline(indirect_file, line) && line.length() ) {
+               inputs.push_back(HaddInput_t(line, kTRUE));
             }
-         }         
-      } else if( ! merger.AddFile(argv[i]) ) {
-         if ( skip_errors ) {
-            cerr << "hadd skipping file with error: " << argv[i] << endl;
-         } else {
-            cerr << "hadd exiting due to error in " << argv[i] << endl;
-            return 1;
          }
+      } else if (argv[i]) {
+         inputs.push_back(HaddInput_t(argv[i], kFALSE));
       }
    }
-   if (reoptimize) {
-      merger.SetFastMethod(kFALSE);
-   } else {
-      if (merger.HasCompressionChange()) {
-         // Don't warn if the user any request re-optimization.
-         cout <<"hadd Sources and Target have different compression levels"<<endl;
-         cout <<"hadd merging will be slower"<<endl;
+
+   // Merge the sources in groups in parallel, keeping the partial results
+   // in place of the sources.
+   size_t ninputs = inputs.size();
+   std::vector<std::string> partials;
+   Bool_t status = kTRUE;
+   if (njobs > 1) {
+#ifndef WIN32
+      status = MergeInParallel(inputs, njobs, opt, partials);
+#else
+      cerr << "hadd warning: -j is not supported on this platform, merging sequentially." << endl;
+#endif
+   }
+
+   if (status) {
+      status = AddInputs(merger, inputs, 0, inputs.size(), skip_errors);
+   }
+   if (status) {
+      // The partial results only need to be resized once, in the target.
+      if (!opt.fProfile.empty()) {
+         merger.SetAccessProfile(opt.fProfile.c_str());
       }
+      if (reoptimize || !opt.fProfile.empty()) {
+         merger.SetFastMethod(kFALSE);
+      } else {
+         if (merger.HasCompressionChange()) {
+            // Don't warn if the user any request re-optimization.
+            cout <<"hadd Sources and Target have different compression levels"<<endl;
+            cout <<"hadd the Tree baskets will be recompressed, merging will be slower"<<endl;
+         }
+      }
+      status = merger.Merge();
+   }
+   Bool_t parallel = !partials.empty();
+#ifndef WIN32
+   RemovePartials(partials);
+#endif
+   if (!parallel) {
+      ninputs = merger.GetMergeList()->GetEntries();
    }
-   merger.SetNotrees(noTrees);
-   Bool_t status = merger.Merge();
 
    if (status) {
       if (verbosity == 1) {
-         cout << "hadd merged " << merger.GetMergeList()->GetEntries() << " input files in " << targetname << ".\n";
+         cout << "hadd merged " << ninputs << " input files in " << targetname << ".\n";
       }
       return 0;
    } else {
       if (verbosity == 1) {
-         cout << "hadd failure during the merge of " << merger.GetMergeList()->GetEntries() << " input files in " << targetname << ".\n";
+         cout << "hadd failure during the merge of " << ninputs << " input files in " << targetname << ".\n";
       }
       return 1;
    }
@@ -24,6 +24,11 @@
 // The parallel file merger will then collate the information coming    //
 // from this client and any other client in to the file described by    //
 // the filename of this object.                                         //
+// When the server runs on the same node and supports it (protocol      //
+// version 2), the content is handed over in a shared memory file and   //
+// only its name goes through the socket. The server acknowledges each  //
+// such upload, and the content is sent through the socket if it could  //
+// not read the shared memory file.                                     //
 //                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
@@ -50,8 +55,17 @@ private:
    Int_t    fServerVersion;  // Protocol version used by the server.
    TArrayC *fClassSent;      // Record which StreamerInfo we already sent.
    TMessage fMessage;
+   Bool_t   fUseShm;         //! True if the uploads go through shared memory.
+   UInt_t   fShmCount;       //! Number of shared memory files created so far.
+
+   TString  CopyToSharedMemory();
+   Int_t    SendContent();
 
 public:
+   enum EMessageKind {
+      kShmUpload = kMESS_SHMUPLOAD // Upload whose data is in a shared memory file.
+   };
+
    TParallelMergingFile(const char *filename, Option_t *option = "", const char *ftitle = "", Int_t compress = 1);   
    ~TParallelMergingFile();
 
@@ -61,6 +75,8 @@ public:
    virtual Int_t  Write(const char *name=0, Int_t opt=0, Int_t bufsiz=0) const;
    virtual void   WriteStreamerInfo();
 
+   static TMemFile *ReadUpload(TSocket *sock, TMessage *mess, Int_t &clientId, TString &filename);
+
    ClassDef(TParallelMergingFile,2);  // TFile specialization that will semi-automatically upload its content to a merging server.
 };
 
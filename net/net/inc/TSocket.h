@@ -138,6 +138,7 @@ public:
    TSocket(const TSocket &s);
    virtual ~TSocket() { Close(); }
 
+   void                  AddBytesSent(Long64_t nbytes);
    virtual void          Close(Option_t *opt="");
    virtual Int_t         GetDescriptor() const { return fSocket; }
    TInetAddress          GetInetAddress() const { return fAddress; }
@@ -19,6 +19,8 @@
 //                                                                      //
 // A TWebFile is like a normal TFile except that it reads its data      //
 // via a standard apache web server. A TWebFile is a read-only file.    //
+// Large vectored reads are split over several keep-alive connections  //
+// issued concurrently (see ReadBuffers).                               //
 //                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
@@ -34,19 +36,23 @@
 
 class TSocket;
 class TWebSocket;
+class TWebRangeRequest;
+class TObjArray;
 
 
 class TWebFile : public TFile {
 
 friend class TWebSocket;
+friend class TWebRangeRequest;
 friend class TWebSystem;
 
 private:
-	TWebFile() : fSocket(0) { }
+	TWebFile() : fSocket(0), fConnections(0) { }
 
 protected:
    mutable Long64_t  fSize;             // file size
    TSocket          *fSocket;           // socket for HTTP/1.1 (stays alive between calls)
+   TObjArray        *fConnections;      //! idle HTTP/1.1 sockets used by the parallel range requests
    TUrl              fProxy;            // proxy URL
    Bool_t            fHasModRoot;       // true if server has mod_root installed
    Bool_t            fHTTP11;           // true if server support HTTP/1.1
@@ -71,6 +77,9 @@ protected:
    virtual Int_t       GetFromWeb10(char *buf, Int_t len, const TString &msg);
    virtual Bool_t      ReadBuffer10(char *buf, Int_t len);
    virtual Bool_t      ReadBuffers10(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf);
+   virtual Bool_t      ReadBuffersParallel(char *buf, Long64_t *pos, Int_t *len, Int_t nreq,
+                                           const Int_t *first, const TString *msgs);
+   virtual TSocket    *OpenSocket();
    virtual void        SetMsgReadBuffer10(const char *redirectLocation = 0, Bool_t tempRedirect = kFALSE);
    virtual void        ProcessHttpHeader(const TString& headerLine);
 
@@ -20,17 +20,52 @@
 // The parallel file merger will then collate the information coming    //
 // from this client and any other client in to the file described by    //
 // the filename of this object.                                         //
+// When the server runs on the same node and supports it (protocol      //
+// version 2), the content is handed over in a shared memory file and   //
+// only its name goes through the socket. The server acknowledges each  //
+// such upload, and the content is sent through the socket if it could  //
+// not read the shared memory file.                                     //
 //                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 #include "TParallelMergingFile.h"
 #include "TSocket.h"
 #include "TArrayC.h"
+#include "TSystem.h"
+#include "TEnv.h"
+#include "TError.h"
+#include "Bytes.h"
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+
+static const char *const kShmPrefix = "TParallelMergingFile-";
+
+//______________________________________________________________________________
+static TString R__ShmUploadDirectory()
+{
+   // Return the directory holding the shared memory files of the uploads:
+   // /dev/shm or, if it does not exist, the temporary directory.
+
+   TString dir = gSystem->AccessPathName("/dev/shm") ? gSystem->TempDirectory() : "/dev/shm";
+   while (dir.Length() > 1 && dir.EndsWith("/")) dir.Remove(dir.Length()-1);
+   return dir;
+}
 
 //______________________________________________________________________________
 TParallelMergingFile::TParallelMergingFile(const char *filename, Option_t *option /* = "" */,
                                            const char *ftitle /* = "" */, Int_t compress /* = 1 */) : 
-   TMemFile(filename,option,ftitle,compress),fSocket(0),fServerIdx(-1),fServerVersion(0),fClassSent(0),fMessage(kMESS_OBJECT)
+   TMemFile(filename,option,ftitle,compress),fSocket(0),fServerIdx(-1),fServerVersion(0),fClassSent(0),fMessage(kMESS_OBJECT),
+   fUseShm(kFALSE),fShmCount(0)
 {
    // Constructor.
    // We do no yet open any connection to the server.  This will be done at the
@@ -68,6 +103,67 @@ void TParallelMergingFile::Close(Option_t *option)
    fSocket = 0;
 }
 
+//______________________________________________________________________________
+TString TParallelMergingFile::CopyToSharedMemory()
+{
+   // Copy the current file data into a new file in /dev/shm (or in the
+   // temporary directory if there is none). Return its name, or an empty
+   // string if it could not be created, in which case the data has to be
+   // sent through the socket.
+
+   TString path;
+#ifndef WIN32
+   Long64_t size = GetEND();
+   path.Form("%s/%s%d-%d-%u", R__ShmUploadDirectory().Data(), kShmPrefix, gSystem->GetPid(), fServerIdx, fShmCount++);
+   int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (fd < 0) {
+      path.Clear();
+      return path;
+   }
+   Long64_t written = WriteTo(fd);
+   close(fd);
+   if (written != size) {
+      Warning("CopyToSharedMemory","Could not write %lld bytes in %s, using the socket",size,path.Data());
+      unlink(path);
+      fUseShm = kFALSE;
+      path.Clear();
+      return path;
+   }
+#endif
+   return path;
+}
+
+//______________________________________________________________________________
+Int_t TParallelMergingFile::SendContent()
+{
+   // Send fMessage followed by the file data as a single message. The data
+   // is written from the memory blocks straight to the socket rather than
+   // being copied into the message, unless the socket compresses the
+   // messages. Returns the number of bytes sent (excluding the length
+   // header) or a negative value in case of error, like TSocket::Send.
+
+   Long64_t size = GetEND();
+   Long64_t total = fMessage.Length() - (Long64_t)sizeof(UInt_t) + size;
+   if (fSocket->GetCompressionLevel() > 0 || total > kMaxInt) {
+      CopyTo(fMessage);
+      return fSocket->Send(fMessage);
+   }
+
+   // Length of the whole message, normally set by TSocket::Send.
+   char *header = fMessage.Buffer();
+   tobuf(header, (UInt_t)total);
+   Int_t nsent = fSocket->SendRaw(fMessage.Buffer(), fMessage.Length());
+   if (nsent <= 0) {
+      return nsent;
+   }
+   if (WriteTo(fSocket->GetDescriptor()) != size) {
+      SysError("SendContent", "error sending %lld bytes to the merging server", size);
+      return -1;
+   }
+   fSocket->AddBytesSent(size);
+   return (Int_t)total;
+}
+
 //______________________________________________________________________________
 Bool_t TParallelMergingFile::UploadAndReset() 
 {
@@ -111,16 +207,53 @@ Bool_t TParallelMergingFile::UploadAndReset()
          Info("UploadAndReset","Connected to fastMergeServer version %d with index %d\n",fServerVersion,fServerIdx);
       }
       TMessage::EnableSchemaEvolutionForAll(kTRUE);         
+
+      // Servers from protocol version 2 accept the data in shared memory,
+      // which is only visible if they run on this node.
+      if (fServerVersion >= 2 && gEnv->GetValue("TParallelMergingFile.SharedMemory", 1)) {
+         fUseShm = !strcmp(host,"localhost") || !strcmp(host,"127.0.0.1")
+                   || !strcmp(host,gSystem->HostName());
+      }
    }
    
-   fMessage.Reset(kMESS_ANY); // re-use TMessage object
+   TString shmpath;
+   if (fUseShm) {
+      shmpath = CopyToSharedMemory();
+   }
+   fMessage.Reset(shmpath.Length() ? (UInt_t)kShmUpload : (UInt_t)kMESS_ANY); // re-use TMessage object
    fMessage.WriteInt(fServerIdx);
    fMessage.WriteTString(GetName());
    fMessage.WriteLong64(GetEND());
-   CopyTo(fMessage);
+   Int_t error;
+   if (shmpath.Length()) {
+      fMessage.WriteTString(shmpath);
+      error = fSocket->Send(fMessage);
+      if (error > 0) {
+         // The server tells whether it could read the file (it may for
+         // example run as another user), otherwise the file is ours to
+         // remove and the data goes through the socket from now on.
+         TMessage *reply = 0;
+         error = fSocket->Recv(reply);
+         if (error > 0 && reply->What() != kMESS_OK) {
+            Warning("UploadAndReset","The merging server could not read %s, using the socket",shmpath.Data());
+            gSystem->Unlink(shmpath);
+            shmpath.Clear();
+            fUseShm = kFALSE;
+            fMessage.Reset(kMESS_ANY);
+            fMessage.WriteInt(fServerIdx);
+            fMessage.WriteTString(GetName());
+            fMessage.WriteLong64(GetEND());
+            error = SendContent();
+         }
+         delete reply;
+      }
+   } else {
+      error = SendContent();
+   }
    
-   if (int error = fSocket->Send(fMessage) <= 0) {
+   if (error <= 0) {
       Error("UploadAndReset","Upload to the merging server failed with %d\n",error);
+      if (shmpath.Length()) gSystem->Unlink(shmpath);
       delete fSocket;
       fSocket = 0;
       return kFALSE;
@@ -145,6 +278,82 @@ Bool_t TParallelMergingFile::UploadAndReset()
    return kTRUE;
 }
 
+//______________________________________________________________________________
+TMemFile *TParallelMergingFile::ReadUpload(TSocket *sock, TMessage *mess, Int_t &clientId, TString &filename)
+{
+   // Return a new TMemFile, opened in UPDATE mode, holding the data of an
+   // upload received by a merging server, either sent through the socket
+   // (message kind kMESS_ANY) or left in a shared memory file (message
+   // kind kShmUpload), which is then removed. clientId and filename are
+   // set to the index of the sending client and the name of the file to
+   // merge into. Return 0 in case of error.
+   // A shared memory upload is acknowledged on sock, the socket it came
+   // from, with kMESS_OK or, if the file could not be read, kMESS_NOTOK
+   // upon which the client removes the file and sends the data again
+   // through the socket.
+   // Since the path comes from the client, only a regular file named
+   // TParallelMergingFile-* directly in the upload directory (see
+   // CopyToSharedMemory) and holding at least the announced length is
+   // read and removed. The TMemFile gets a copy of the data, the mapping
+   // is released before returning.
+
+   Long64_t length;
+   mess->ReadInt(clientId);
+   mess->ReadTString(filename);
+   mess->ReadLong64(length);
+
+   if (mess->What() == kMESS_ANY) {
+      TMemFile *transient = new TMemFile(filename,mess->Buffer() + mess->Length(),length,"UPDATE");
+      mess->SetBufferOffset(mess->Length()+length);
+      return transient;
+   }
+   if (mess->What() != kShmUpload) {
+      ::Error("TParallelMergingFile::ReadUpload","Unexpected message kind %u",mess->What());
+      return 0;
+   }
+
+   TString path;
+   mess->ReadTString(path);
+   TMemFile *transient = 0;
+#ifndef WIN32
+   TString name = gSystem->BaseName(path);
+   struct stat st;
+   if (R__ShmUploadDirectory() != gSystem->DirName(path) ||
+       !name.BeginsWith(kShmPrefix) || lstat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+      ::Error("TParallelMergingFile::ReadUpload","Refusing the shared memory file %s from client %d",
+              path.Data(),clientId);
+      sock->Send(kMESS_NOTOK);
+      return 0;
+   }
+   int fd = open(path, O_RDONLY | O_NOFOLLOW);
+   if (fd < 0) {
+      // Not an error: the client sends the data through the socket instead.
+      ::Warning("TParallelMergingFile::ReadUpload","Could not open the shared memory file %s from client %d",
+                path.Data(),clientId);
+      sock->Send(kMESS_NOTOK);
+      return 0;
+   }
+   void *addr = MAP_FAILED;
+   if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || length <= 0 || st.st_size < length) {
+      ::Warning("TParallelMergingFile::ReadUpload","The shared memory file %s from client %d does not hold %lld bytes",
+                path.Data(),clientId,length);
+   } else {
+      addr = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED)
+         ::Warning("TParallelMergingFile::ReadUpload","Could not map the shared memory file %s from client %d",
+                   path.Data(),clientId);
+   }
+   close(fd);
+   if (addr != MAP_FAILED) {
+      transient = new TMemFile(filename,(char*)addr,length,"UPDATE");
+      munmap(addr, length);
+   }
+   unlink(path);
+#endif
+   sock->Send(transient ? kMESS_OK : kMESS_NOTOK);
+   return transient;
+}
+
 //______________________________________________________________________________
 Int_t TParallelMergingFile::Write(const char *, Int_t opt, Int_t bufsiz)
 {
@@ -1505,6 +1505,18 @@ void TSocket::NetError(const char *where, Int_t err)
       ::Error(where, "%s", gRootdErrStr[err]);
 }
 
+//______________________________________________________________________________
+void TSocket::AddBytesSent(Long64_t nbytes)
+{
+   // Account for nbytes written to the socket descriptor without going
+   // through SendRaw (e.g. with writev), as SendRaw would have done:
+   // update the byte counters and the usage timestamp.
+
+   fBytesSent  += (UInt_t)nbytes;
+   fgBytesSent += nbytes;
+   Touch();
+}
+
 //______________________________________________________________________________
 ULong64_t TSocket::GetSocketBytesSent()
 {
@@ -15,6 +15,8 @@
 //                                                                      //
 // A TWebFile is like a normal TFile except that it reads its data      //
 // via a standard apache web server. A TWebFile is a read-only file.    //
+// Large vectored reads are split over several keep-alive connections  //
+// issued concurrently (see ReadBuffers).                               //
 //                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
@@ -26,12 +28,18 @@
 #include "TSystem.h"
 #include "TBase64.h"
 #include "TVirtualPerfStats.h"
+#include "TMonitor.h"
+#include "TObjArray.h"
+#include "TEnv.h"
+#include "TMath.h"
 #ifdef R__SSL
 #include "TSSLSocket.h"
 #endif
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 #ifdef WIN32
 # ifndef EADDRINUSE
@@ -44,6 +52,10 @@
 
 static const char *gUserAgent = "User-Agent: ROOT-TWebFile/1.1";
 
+// Smallest amount of data worth a request of its own when a vectored
+// read is split over several connections.
+static const Long64_t kMinParallelBytes = 64*1024;
+
 TUrl TWebFile::fgProxy;
 
 
@@ -87,35 +99,207 @@ void TWebSocket::ReOpen()
    if (fWebFile->fSocket)
       delete fWebFile->fSocket;
 
-   TUrl connurl;
-   if (fWebFile->fProxy.IsValid())
-      connurl = fWebFile->fProxy;
-   else
-      connurl = fWebFile->fUrl;
+   fWebFile->fSocket = fWebFile->OpenSocket();
+}
 
-   for (Int_t i = 0; i < 5; i++) {
-      if (strcmp(connurl.GetProtocol(), "https") == 0) {
-#ifdef R__SSL
-         fWebFile->fSocket = new TSSLSocket(connurl.GetHost(), connurl.GetPort());
+
+// Internal class holding the state of one multi-range GET request issued
+// by TWebFile::ReadBuffersParallel. The response is parsed as it arrives
+// and the data of each part is copied to the requested ranges it covers.
+class TWebRangeRequest {
+public:
+   enum EState { kStatus, kHeader, kPartHeader, kBody, kDone, kFailed };
+
+   TSocket  *fSocket;      // connection used by the request
+   Bool_t    fReused;      // true if the connection was idle in the pool
+   Bool_t    fClose;       // true if the server closes the connection after the response
+   Int_t     fFirst;       // first range of the request
+   Int_t     fLast;        // one past the last range of the request
+   Long64_t  fBytes;       // number of bytes requested
+   Long64_t  fFilled;      // number of bytes copied to the ranges
+   Long64_t  fReceived;    // number of bytes received for the response
+   Double_t  fStart;       // time at which the request was sent
+   EState    fState;       // where the parser is in the response
+   TString   fLine;        // header line being assembled
+   TString   fBoundary;    // multipart boundary, empty for a single range response
+   Long64_t  fPartCur;     // file offset of the next byte of the current part
+   Long64_t  fPartEnd;     // file offset of the end of the current part
+
+   TWebRangeRequest() : fSocket(0), fReused(kFALSE), fClose(kFALSE), fFirst(0), fLast(0),
+                        fBytes(0), fFilled(0), fReceived(0), fStart(0), fState(kStatus),
+                        fPartCur(-1), fPartEnd(-1) { }
+   void   Reset();
+   Bool_t Send(TWebFile *f, TSocket *s, const TString &msg);
+   void   ProcessLine(TWebFile *f);
+   void   Feed(TWebFile *f, const char *data, Int_t n, char *buf, const Long64_t *pos,
+               const Int_t *len, const Long64_t *dest, Long64_t archiveOffset);
+};
+
+//______________________________________________________________________________
+void TWebRangeRequest::Reset()
+{
+   // Prepare for a new response.
+
+   fClose    = kFALSE;
+   fFilled   = 0;
+   fReceived = 0;
+   fState    = kStatus;
+   fLine     = "";
+   fBoundary = "";
+   fPartCur  = -1;
+   fPartEnd  = -1;
+}
+
+//______________________________________________________________________________
+Bool_t TWebRangeRequest::Send(TWebFile *f, TSocket *s, const TString &msg)
+{
+   // Send the request msg on s, or on a new connection if s is 0.
+   // Returns kFALSE in case of failure.
+
+   Reset();
+   fReused = s ? kTRUE : kFALSE;
+   fSocket = s ? s : f->OpenSocket();
+   if (!fSocket)
+      return kFALSE;
+
+   if (gDebug > 0)
+      ::Info("TWebRangeRequest::Send", "sending HTTP request:\n%s", msg.Data());
+
+   if (gPerfStats) fStart = TTimeStamp();
+   if (fSocket->SendRaw(msg.Data(), msg.Length()) == -1) {
+      delete fSocket;
+      fSocket = 0;
+      // The server may have closed the idle connection, try a new one.
+      if (fReused)
+         return Send(f, 0, msg);
+      ::Error("TWebRangeRequest::Send", "error sending command to host %s", f->fUrl.GetHost());
+      return kFALSE;
+   }
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+void TWebRangeRequest::ProcessLine(TWebFile *f)
+{
+   // Interpret the header line in fLine.
+
+   if (gDebug > 0)
+      ::Info("TWebRangeRequest::ProcessLine", "header: %s", fLine.Data());
+
+   Long64_t first = -1, last = -1, tot = -1;
+   if (fLine.BeginsWith("Content-Range:", TString::kIgnoreCase)) {
+      TString range = fLine(14, fLine.Length());
+#ifdef R__WIN32
+      sscanf(range.Data(), " bytes %I64d-%I64d/%I64d", &first, &last, &tot);
 #else
-         ::Error("TWebSocket::ReOpen", "library compiled without SSL, https not supported");
-         return;
+      sscanf(range.Data(), " bytes %lld-%lld/%lld", &first, &last, &tot);
 #endif
-      } else
-         fWebFile->fSocket = new TSocket(connurl.GetHost(), connurl.GetPort());
+   }
 
-      if (!fWebFile->fSocket || !fWebFile->fSocket->IsValid()) {
-         delete fWebFile->fSocket;
-         fWebFile->fSocket = 0;
-         if (gSystem->GetErrno() == EADDRINUSE || gSystem->GetErrno() == EISCONN) {
-            gSystem->Sleep(i*10);
+   switch (fState) {
+   case kStatus:
+      // Skip the end of line that may follow the previous response.
+      if (fLine == "") return;
+      if (!fLine.BeginsWith("HTTP/1.") || TString(fLine(9, 3)).Atoi() != 206) {
+         if (gDebug > 0)
+            ::Info("TWebRangeRequest::ProcessLine", "unexpected reply: %s", fLine.Data());
+         fState = kFailed;
+         return;
+      }
+      if (fLine.BeginsWith("HTTP/1.0")) fClose = kTRUE;
+      fState = kHeader;
+      break;
+   case kHeader:
+      if (fLine == "") {
+         if (fBoundary != "") {
+            fState = kPartHeader;
+         } else if (fPartCur >= 0) {
+            fState = kBody;
          } else {
-            ::Error("TWebSocket::ReOpen", "cannot connect to host %s (errno=%d)",
-                    fWebFile->fUrl.GetHost(), gSystem->GetErrno());
+            fState = kFailed;
+         }
+      } else if (fLine.BeginsWith("Content-Type: multipart", TString::kIgnoreCase)) {
+         Ssiz_t idx = fLine.Index("boundary=");
+         if (idx == kNPOS) {
+            fState = kFailed;
             return;
          }
-      } else
-         return;
+         fBoundary = fLine(idx+9, fLine.Length());
+         if (fBoundary.Length() > 1 && fBoundary[0]=='"' && fBoundary[fBoundary.Length()-1]=='"')
+            fBoundary = fBoundary(1, fBoundary.Length()-2);
+         fBoundary = "--" + fBoundary;
+      } else if (fLine.BeginsWith("Connection:", TString::kIgnoreCase)) {
+         if (fLine.Contains("close", TString::kIgnoreCase)) fClose = kTRUE;
+      } else if (first >= 0) {
+         fPartCur = first;
+         fPartEnd = last + 1;
+         if (f->fSize == -1) f->fSize = tot;
+      }
+      break;
+   case kPartHeader:
+      if (fLine == "") {
+         if (fPartCur >= 0) fState = kBody;
+      } else if (fLine == fBoundary + "--") {
+         fState = kDone;
+      } else if (fLine == fBoundary) {
+         fPartCur = -1;
+      } else if (first >= 0) {
+         fPartCur = first;
+         fPartEnd = last + 1;
+      }
+      break;
+   default:
+      break;
+   }
+}
+
+//______________________________________________________________________________
+void TWebRangeRequest::Feed(TWebFile *f, const char *data, Int_t n, char *buf, const Long64_t *pos,
+                            const Int_t *len, const Long64_t *dest, Long64_t archiveOffset)
+{
+   // Parse the next n bytes of the response. The bytes of the parts are
+   // copied to the requested ranges [fFirst,fLast) they overlap, whose
+   // data goes to &buf[dest[i]].
+
+   fReceived += n;
+   while (n > 0 && fState != kDone && fState != kFailed) {
+      if (fState == kBody) {
+         Long64_t m = TMath::Min((Long64_t)n, fPartEnd - fPartCur);
+         for (Int_t i = fFirst; i < fLast; i++) {
+            Long64_t rstart = pos[i] + archiveOffset;
+            Long64_t lo = TMath::Max(fPartCur, rstart);
+            Long64_t hi = TMath::Min(fPartCur + m, rstart + len[i]);
+            if (lo >= hi) continue;
+            memcpy(&buf[dest[i] + (lo - rstart)], data + (lo - fPartCur), hi - lo);
+            fFilled += hi - lo;
+         }
+         fPartCur += m;
+         data += m;
+         n -= (Int_t)m;
+         if (fPartCur == fPartEnd) {
+            fPartCur = -1;
+            fState = fBoundary == "" ? kDone : kPartHeader;
+         }
+         continue;
+      }
+      const char *eol = (const char *)memchr(data, '\n', n);
+      Int_t l = eol ? Int_t(eol - data) + 1 : n;
+      fLine.Append(data, l);
+      data += l;
+      n -= l;
+      if (!eol) {
+         if (fLine.Length() > 8192) fState = kFailed;
+         continue;
+      }
+      fLine.Remove(TString::kTrailing, '\n');
+      fLine.Remove(TString::kTrailing, '\r');
+      ProcessLine(f);
+      fLine = "";
+   }
+   if (fState == kDone && fFilled != fBytes) {
+      ::Error("TWebRangeRequest::Feed", "error receiving expected amount of data (got %lld, expected %lld)",
+              fFilled, fBytes);
+      fState = kFailed;
    }
 }
 
@@ -123,7 +307,7 @@ void TWebSocket::ReOpen()
 ClassImp(TWebFile)
 
 //______________________________________________________________________________
-TWebFile::TWebFile(const char *url, Option_t *opt) : TFile(url, "WEB")
+TWebFile::TWebFile(const char *url, Option_t *opt) : TFile(url, "WEB"), fConnections(0)
 {
    // Create a Web file object. A web file is the same as a read-only
    // TFile except that it is being read via a HTTP server. The url
@@ -157,7 +341,7 @@ TWebFile::TWebFile(const char *url, Option_t *opt) : TFile(url, "WEB")
 }
 
 //______________________________________________________________________________
-TWebFile::TWebFile(TUrl url, Option_t *opt) : TFile(url.GetUrl(), "WEB")
+TWebFile::TWebFile(TUrl url, Option_t *opt) : TFile(url.GetUrl(), "WEB"), fConnections(0)
 {
    // Create a Web file object. A web file is the same as a read-only
    // TFile except that it is being read via a HTTP server. Make sure url
@@ -192,6 +376,7 @@ TWebFile::~TWebFile()
    // Cleanup.
 
    delete fSocket;
+   delete fConnections;
 }
 
 //______________________________________________________________________________
@@ -269,6 +454,9 @@ void TWebFile::SetMsgReadBuffer10(const char *redirectLocation, Bool_t tempRedir
       oldUrl = fUrl;
       oldBasicUrl = fBasicUrl;
 
+      // The idle connections kept by ReadBuffersParallel are to the old location.
+      if (fConnections) fConnections->Delete();
+
       fUrl.SetUrl(redirectLocation);
       fBasicUrl = fUrl.GetProtocol();
       fBasicUrl += "://";
@@ -295,6 +483,7 @@ void TWebFile::SetMsgReadBuffer10(const char *redirectLocation, Bool_t tempRedir
          // change back from temp redirection location
          fMsgReadBuffer10.ReplaceAll(fBasicUrl, fBasicUrlOrg);
          fMsgReadBuffer10.ReplaceAll(TString("Host: ")+fUrl.GetHost(), TString("Host: ")+fUrlOrg.GetHost());
+         if (fConnections) fConnections->Delete();
          fUrl         = fUrlOrg;
          fBasicUrl    = fBasicUrlOrg;
          fUrlOrg      = "";
@@ -528,38 +717,248 @@ Bool_t TWebFile::ReadBuffers10(char *buf,  Long64_t *pos, Int_t *len, Int_t nbuf
    // Note that for nbuf=1, this call is equivalent to TFile::ReafBuffer
    // This function is overloaded by TNetFile, TWebFile, etc.
    // Returns kTRUE in case of failure.
+   //
+   // The ranges are sent in requests of at most WebFile.MaxRangesPerRequest
+   // ranges (see system.rootrc). When the server supports HTTP/1.1, large
+   // reads are in addition split in up to WebFile.MaxConnections requests
+   // which are issued concurrently on as many keep-alive connections (see
+   // ReadBuffersParallel).
 
    SetMsgReadBuffer10();
 
+   Int_t maxRanges = gEnv->GetValue("WebFile.MaxRangesPerRequest", 100);
+   if (maxRanges < 1) maxRanges = 1;
+   Int_t maxConnections = fHTTP11 ? gEnv->GetValue("WebFile.MaxConnections", 4) : 1;
+   TUrl connurl = fProxy.IsValid() ? fProxy : fUrl;
+   if (strcmp(connurl.GetProtocol(), "https") == 0)
+      maxConnections = 1;  // TSSLSocket can not receive what is available only
+
+   // Bytes to put in each request to spread the read over the connections.
+   Long64_t total = 0;
+   for (Int_t i = 0; i < nbuf; i++)
+      total += len[i];
+   Long64_t target = total + 1;
+   if (maxConnections > 1)
+      target = TMath::Max(total / maxConnections + 1, kMinParallelBytes);
+
+   std::vector<TString> msgs;
+   std::vector<Int_t> first;
    TString msg = fMsgReadBuffer10;
 
-   Int_t k = 0, n = 0, r;
+   Int_t nr = 0;
+   Long64_t n = 0;
    for (Int_t i = 0; i < nbuf; i++) {
-      if (n) msg += ",";
+      if (nr) msg += ",";
+      else    first.push_back(i);
       msg += pos[i] + fArchiveOffset;
       msg += "-";
       msg += pos[i] + fArchiveOffset + len[i] - 1;
       n   += len[i];
-      if (msg.Length() > 8000) {
+      nr++;
+      if (msg.Length() > 8000 || nr >= maxRanges || n >= target) {
          msg += "\r\n\r\n";
-         r = GetFromWeb10(&buf[k], n, msg);
-         if (r == -1)
-            return kTRUE;
+         msgs.push_back(msg);
          msg = fMsgReadBuffer10;
-         k += n;
+         nr = 0;
          n = 0;
       }
    }
+   if (nr) {
+      msg += "\r\n\r\n";
+      msgs.push_back(msg);
+   }
+   first.push_back(nbuf);
+   Int_t nreq = msgs.size();
 
-   msg += "\r\n\r\n";
+   if (nreq > 1 && maxConnections > 1) {
+      if (!ReadBuffersParallel(buf, pos, len, nreq, &first[0], &msgs[0]))
+         return kFALSE;
+      if (gDebug > 0)
+         Info("ReadBuffers10", "parallel range requests failed, reading sequentially");
+   }
 
-   r = GetFromWeb10(&buf[k], n, msg);
-   if (r == -1)
-      return kTRUE;
+   Long64_t k = 0;
+   for (Int_t r = 0; r < nreq; r++) {
+      n = 0;
+      for (Int_t i = first[r]; i < first[r+1]; i++)
+         n += len[i];
+      if (GetFromWeb10(&buf[k], (Int_t)n, msgs[r]) == -1)
+         return kTRUE;
+      k += n;
+   }
 
    return kFALSE;
 }
 
+//______________________________________________________________________________
+Bool_t TWebFile::ReadBuffersParallel(char *buf, Long64_t *pos, Int_t *len, Int_t nreq,
+                                     const Int_t *first, const TString *msgs)
+{
+   // Issue the nreq multi-range requests msgs concurrently, request r asking
+   // for the ranges [first[r],first[r+1]) of pos and len. Up to
+   // WebFile.MaxConnections HTTP/1.1 connections are used, kept alive
+   // between calls; each one is given the next request as soon as it has
+   // received its response. The responses are parsed as the data arrives
+   // and the parts are copied in place in buf, in any order.
+   // Returns kTRUE in case of failure, the caller then reads the ranges
+   // again sequentially (which also takes care of redirections).
+
+   Int_t nbuf = first[nreq];
+   std::vector<Long64_t> dest(nbuf);
+   std::vector<TWebRangeRequest> reqs(nreq);
+   Long64_t k = 0;
+   for (Int_t r = 0; r < nreq; r++) {
+      reqs[r].fFirst = first[r];
+      reqs[r].fLast  = first[r+1];
+      for (Int_t i = first[r]; i < first[r+1]; i++) {
+         dest[i] = k;
+         k += len[i];
+         reqs[r].fBytes += len[i];
+      }
+   }
+
+   Int_t nconn = TMath::Min(gEnv->GetValue("WebFile.MaxConnections", 4), nreq);
+   if (!fConnections) {
+      fConnections = new TObjArray;
+      fConnections->SetOwner();
+   }
+
+   TMonitor mon;
+   std::vector<Int_t> active;   // request handled by each connection in mon
+   Int_t next = 0, ndone = 0;
+   Bool_t failed = kFALSE;
+
+   // Start the first requests, reusing the idle connections.
+   for (Int_t c = 0; c < nconn; c++) {
+      Int_t last = fConnections->GetLast();
+      TSocket *s = last >= 0 ? (TSocket *) fConnections->RemoveAt(last) : 0;
+      if (!reqs[next].Send(this, s, msgs[next])) {
+         failed = kTRUE;
+         break;
+      }
+      mon.Add(reqs[next].fSocket);
+      active.push_back(next++);
+   }
+
+   char chunk[65536];
+   while (!failed && ndone < nreq) {
+      TSocket *s = mon.Select();
+      if (!s || s == (TSocket *)-1) {
+         failed = kTRUE;
+         break;
+      }
+      Int_t c = 0;
+      while (c < (Int_t)active.size() && reqs[active[c]].fSocket != s) c++;
+      if (c == (Int_t)active.size()) continue;
+      TWebRangeRequest &req = reqs[active[c]];
+
+      Int_t nrecv = s->RecvRaw(chunk, sizeof(chunk), kDontBlock);
+      if (nrecv <= 0) {
+         mon.Remove(s);
+         delete s;
+         req.fSocket = 0;
+         // The server may have closed an idle connection, try a new one.
+         if (req.fReused && req.fReceived == 0 && req.Send(this, 0, msgs[active[c]])) {
+            if (gDebug > 0)
+               Info("ReadBuffersParallel", "HTTP/1.1 socket closed, reopen");
+            mon.Add(req.fSocket);
+            continue;
+         }
+         failed = kTRUE;
+         break;
+      }
+      req.Feed(this, chunk, nrecv, buf, pos, len, &dest[0], fArchiveOffset);
+      if (req.fState == TWebRangeRequest::kFailed) {
+         failed = kTRUE;
+         break;
+      }
+      if (req.fState != TWebRangeRequest::kDone)
+         continue;
+
+      // collect statistics
+      fBytesRead += req.fBytes;
+      fReadCalls++;
+#ifdef R__WIN32
+      SetFileBytesRead(GetFileBytesRead() + req.fBytes);
+      SetFileReadCalls(GetFileReadCalls() + 1);
+#else
+      fgBytesRead += req.fBytes;
+      fgReadCalls++;
+#endif
+      if (gPerfStats)
+         gPerfStats->FileReadEvent(this, (Int_t)req.fBytes, req.fStart);
+      ndone++;
+
+      // Hand the next request to the connection, or put it back in the pool.
+      mon.Remove(s);
+      req.fSocket = 0;
+      if (req.fClose) {
+         delete s;
+         s = 0;
+      }
+      if (next < nreq) {
+         if (!reqs[next].Send(this, s, msgs[next])) {
+            failed = kTRUE;
+            break;
+         }
+         mon.Add(reqs[next].fSocket);
+         active[c] = next++;
+      } else if (s) {
+         fConnections->Add(s);
+      }
+   }
+
+   // A connection with a pending response can not be reused.
+   for (Int_t r = 0; r < nreq; r++) {
+      if (reqs[r].fSocket) {
+         mon.Remove(reqs[r].fSocket);
+         delete reqs[r].fSocket;
+      }
+   }
+
+   return failed;
+}
+
+//______________________________________________________________________________
+TSocket *TWebFile::OpenSocket()
+{
+   // Open a new connection to the web server (or to the proxy).
+   // Returns 0 in case of failure.
+
+   TUrl connurl;
+   if (fProxy.IsValid())
+      connurl = fProxy;
+   else
+      connurl = fUrl;
+
+   TSocket *s = 0;
+   for (Int_t i = 0; i < 5; i++) {
+      if (strcmp(connurl.GetProtocol(), "https") == 0) {
+#ifdef R__SSL
+         s = new TSSLSocket(connurl.GetHost(), connurl.GetPort());
+#else
+         Error("OpenSocket", "library compiled without SSL, https not supported");
+         return 0;
+#endif
+      } else
+         s = new TSocket(connurl.GetHost(), connurl.GetPort());
+
+      if (!s || !s->IsValid()) {
+         delete s;
+         s = 0;
+         if (gSystem->GetErrno() == EADDRINUSE || gSystem->GetErrno() == EISCONN) {
+            gSystem->Sleep(i*10);
+         } else {
+            Error("OpenSocket", "cannot connect to host %s (errno=%d)",
+                  fUrl.GetHost(), gSystem->GetErrno());
+            return 0;
+         }
+      } else
+         return s;
+   }
+   return s;
+}
+
 //______________________________________________________________________________
 Int_t TWebFile::GetFromWeb(char *buf, Int_t len, const TString &msg)
 {
@@ -5614,6 +5614,124 @@ bool testMerge1DRebinProf()
    return ret;
 }
 
+void FillForMerge(TH1* h1, TH1* h2, Int_t nentries)
+{
+   // Fill the 1D or 2D histograms h1 and h2 with the same entries, which
+   // are weighted only if the histograms have Sumw2
+
+   for ( Int_t e = 0; e < nentries; ++e ) {
+      Double_t x = r.Uniform(0.9 * minRange, 1.1 * maxRange);
+      Double_t y = r.Uniform(0.9 * minRange, 1.1 * maxRange);
+      Double_t w = h1->GetSumw2N() ? r.Uniform(0.5, 2.0) : 1.0;
+      if ( h1->GetDimension() == 1 ) {
+         h1->Fill(x, w);
+         h2->Fill(x, w);
+      } else {
+         ((TH2*) h1)->Fill(x, y, w);
+         ((TH2*) h2)->Fill(x, y, w);
+      }
+   }
+}
+
+int equalsMerged(const char* msg, TH1* h1, TH1* h2, double ERRORLIMIT)
+{
+   // Compare the bin contents, errors, entries and statistics of the
+   // histograms h1 and h2, of any class and dimension
+
+   int differents = ( h1->GetSumw2N() != h2->GetSumw2N() );
+   Int_t ncells = h1->GetBin(h1->GetNbinsX() + 1, h1->GetNbinsY() + 1, h1->GetNbinsZ() + 1) + 1;
+   for ( Int_t bin = 0; bin < ncells; ++bin ) {
+      differents += (bool) equals(h1->GetBinContent(bin), h2->GetBinContent(bin), ERRORLIMIT);
+      differents += (bool) equals(h1->GetBinError(bin), h2->GetBinError(bin), ERRORLIMIT);
+   }
+   differents += (bool) equals(h1->GetEntries(), h2->GetEntries(), ERRORLIMIT);
+   double stats1[TH1::kNstat];
+   double stats2[TH1::kNstat];
+   h1->GetStats(stats1);
+   h2->GetStats(stats2);
+   for ( Int_t i = 0; i < TH1::kNstat; ++i )
+      differents += (bool) equals(stats1[i], stats2[i], ERRORLIMIT);
+
+   if ( defaultEqualOptions & cmpOptPrint ) cout << msg << ": \t" << (differents?"FAILED":"OK") << endl;
+   return differents;
+}
+
+int testMergeSameBinningCase(const char* msg, TH1* proto)
+{
+   // Merge copies of proto with the same binning into a target, which
+   // uses the fast path of Merge (TH1::MergeSameBinning), and into a
+   // reference target for which the last input has a filled buffer, which
+   // makes Merge use the general algorithm. The inputs mix histograms
+   // with and without Sumw2, for a target with and without Sumw2.
+
+   int differents = 0;
+   for ( Int_t targetSumw2 = 0; targetSumw2 < 2; ++targetSumw2 ) {
+      TH1* fast = (TH1*) proto->Clone(TString::Format("%s-fast", proto->GetName()));
+      TH1* general = (TH1*) proto->Clone(TString::Format("%s-general", proto->GetName()));
+      if ( targetSumw2 ) {
+         fast->Sumw2();
+         general->Sumw2();
+      }
+      FillForMerge(fast, general, nEvents);
+
+      TList fastList;
+      TList generalList;
+      fastList.SetOwner();
+      generalList.SetOwner();
+      const Int_t ninputs = 3;
+      for ( Int_t i = 0; i <= ninputs; ++i ) {
+         TH1* h1 = (TH1*) proto->Clone(TString::Format("%s-fast%d", proto->GetName(), i));
+         TH1* h2 = (TH1*) proto->Clone(TString::Format("%s-general%d", proto->GetName(), i));
+         if ( i % 2 ) {
+            h1->Sumw2();
+            h2->Sumw2();
+         }
+         if ( i == ninputs ) {
+            h2->SetBuffer(10);
+            FillForMerge(h1, h2, 1);
+         } else {
+            FillForMerge(h1, h2, nEvents);
+         }
+         fastList.Add(h1);
+         generalList.Add(h2);
+      }
+
+      fast->Merge(&fastList);
+      general->Merge(&generalList);
+      differents += equalsMerged(TString::Format("%s (target %s Sumw2)", msg, targetSumw2 ? "with" : "without"),
+                                 fast, general, 1E-10);
+      delete fast;
+      delete general;
+   }
+   delete proto;
+   return differents;
+}
+
+bool testMergeSameBinning()
+{
+   // Tests the fast path of the merge of histograms with the same binning
+   // against the general algorithm, for TH1F, TH1I, TH2D and variable bins
+
+   Double_t v[numberOfBins+1];
+   FillVariableRange(v);
+
+   int differents = 0;
+   differents += testMergeSameBinningCase("MergeSameBinning1F",
+                                          new TH1F("mergeSame-h1f", "h1f-Title", numberOfBins, minRange, maxRange));
+   differents += testMergeSameBinningCase("MergeSameBinning1I",
+                                          new TH1I("mergeSame-h1i", "h1i-Title", numberOfBins, minRange, maxRange));
+   differents += testMergeSameBinningCase("MergeSameBinningVar1F",
+                                          new TH1F("mergeSame-hv1f", "hv1f-Title", numberOfBins, v));
+   differents += testMergeSameBinningCase("MergeSameBinning2D",
+                                          new TH2D("mergeSame-h2d", "h2d-Title",
+                                                   numberOfBins, minRange, maxRange,
+                                                   numberOfBins + 2, minRange, maxRange));
+   differents += testMergeSameBinningCase("MergeSameBinningVar2D",
+                                          new TH2D("mergeSame-hv2d", "hv2d-Title",
+                                                   numberOfBins, v, numberOfBins, v));
+   return differents;
+}
+
 
 bool testLabel()
 {
@@ -9309,7 +9427,7 @@ int stressHistogram()
 
    // Test 10
    // Merge Tests
-   const unsigned int numberOfMerge = 43;
+   const unsigned int numberOfMerge = 44;
    pointer2Test mergeTestPointer[numberOfMerge] = { testMerge1D,                 testMergeProf1D,
                                                     testMergeVar1D,              testMergeProfVar1D,
                                                     testMerge2D,                 testMergeProf2D,
@@ -9332,7 +9450,8 @@ int stressHistogram()
                                                     testMerge2DDiff,             testMergeProf2DDiff,
                                                     testMerge3DDiff,            //  testMergeProf3DDiff, (this fails)
                                                     testMerge1DRebin,            testMerge2DRebin,
-                                                    testMerge3DRebin,            testMerge1DRebinProf
+                                                    testMerge3DRebin,            testMerge1DRebinProf,
+                                                    testMergeSameBinning
    };
    struct TTestSuite mergeTestSuite = { numberOfMerge, 
                                         "Merge tests for 1D, 2D and 3D Histograms and Profiles............",
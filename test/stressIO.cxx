@@ -0,0 +1,2774 @@
+// @(#)root/test:$Id$
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Tests of the I/O and TTree extensions: each test writes data with one
+// of the features, reads it back and compares it with what was written
+// (or with what the older code path gives).
+//
+//   To run in batch mode, do
+//     stressIO            run all the tests
+//     stressIO 3          run only the third test
+//
+//   An example of output when all tests pass:
+// Test  1: Read rule on a member not at the start of the object ..... OK
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <fcntl.h>
+#endif
+
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TString.h"
+#include "TClass.h"
+#include "TBufferFile.h"
+#include "TStreamerInfo.h"
+#include "TStreamerElement.h"
+#include "TError.h"
+#include "TTree.h"
+#include "TTreeHashIndex.h"
+#include "TFile.h"
+#include "TChain.h"
+#include "TBranch.h"
+#include "TTreePerfStats.h"
+#include "TRandom3.h"
+#include "TEnv.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TSocket.h"
+#include "TServerSocket.h"
+#include "TMonitor.h"
+#include "TWebFile.h"
+#include "TSharedMapFile.h"
+#include "TDirectoryFile.h"
+#include "TKey.h"
+#include "TBufferFileMap.h"
+#include "TBufferPool.h"
+#include "TTreeCacheUnzip.h"
+#include "TFileMerger.h"
+#include "TMath.h"
+#include "TFileCacheWrite.h"
+#include "TMemFile.h"
+#include "TParallelMergingFile.h"
+#include "TFriendElement.h"
+#include "TLeaf.h"
+
+#include "stressIO.h"
+
+//______________________________________________________________________________
+static Bool_t Check(Bool_t condition, const char *what)
+{
+   // Report a failed condition of a test.
+
+   if (!condition) printf("   failed: %s\n", what);
+   return condition;
+}
+
+//______________________________________________________________________________
+Bool_t TestReadRule()
+{
+   // Read an EvoRule written with its version 2 (without fSum). The read
+   // rule sets fSum, which is not the first member of the class, from the
+   // onfile fA and fB. The object is read once with the action sequence of
+   // the StreamerInfo and once with TStreamerInfo::ReadBuffer, and both
+   // must agree.
+
+   TClass *cl = EvoRule::Class();
+
+   // Register the StreamerInfo of version 2 the way TFile::ReadStreamerInfo
+   // does, going through the streamer to get the onfile class version.
+   if (!cl->GetStreamerInfos()->At(2)) {
+      TStreamerInfo *v2 = new TStreamerInfo(cl);
+      v2->SetClassVersion(2);
+      v2->GetElements()->Add(new TStreamerBasicType("fA", "", 0, TVirtualStreamerInfo::kInt, "Int_t"));
+      v2->GetElements()->Add(new TStreamerBasicType("fB", "", 0, TVirtualStreamerInfo::kDouble, "Double_t"));
+      TBufferFile infobuf(TBuffer::kWrite);
+      infobuf.WriteObject(v2);
+      delete v2;
+      infobuf.SetReadMode();
+      infobuf.SetBufferOffset(0);
+      TStreamerInfo *onfile = (TStreamerInfo*)infobuf.ReadObject(TStreamerInfo::Class());
+      if (!Check(onfile != 0, "reading the version 2 StreamerInfo")) return kFALSE;
+      onfile->BuildCheck();
+   }
+   TStreamerInfo *info = (TStreamerInfo*)cl->GetStreamerInfos()->At(2);
+   if (!Check(info != 0, "registering the version 2 StreamerInfo")) return kFALSE;
+
+   // An object in the version 2 layout.
+   const Int_t a = 7;
+   const Double_t b = 2.5;
+   TBufferFile w(TBuffer::kWrite);
+   UInt_t cntpos = w.Length();
+   w << (UInt_t)0;
+   w << (Version_t)2;
+   w << a;
+   w << b;
+   w.SetByteCount(cntpos, kTRUE);
+
+   // Action sequence (TBufferFile::ReadClassBuffer).
+   EvoRule *withActions = new EvoRule;
+   TBufferFile r1(TBuffer::kRead, w.Length(), w.Buffer(), kFALSE);
+   cl->ReadBuffer(r1, withActions);
+
+   // StreamerInfo interpreter.
+   EvoRule *withInterpreter = new EvoRule;
+   TBufferFile r2(TBuffer::kRead, w.Length(), w.Buffer(), kFALSE);
+   UInt_t start, count;
+   r2.ReadVersion(&start, &count, cl);
+   if (!info->IsCompiled()) info->BuildOld();
+   char *ptr = (char*)withInterpreter;
+   info->ReadBuffer(r2, &ptr, -1);
+   r2.CheckByteCount(start, count, cl);
+
+   Bool_t ok = kTRUE;
+   ok &= Check(withActions->fA == a && withActions->fB == b, "members read with the actions");
+   ok &= Check(withActions->fSum == a + 10*b, "rule executed by the actions");
+   ok &= Check(withActions->fGuard == 12345, "member after the rule target left unchanged by the actions");
+   ok &= Check(withInterpreter->fSum == a + 10*b, "rule executed by the interpreter");
+   ok &= Check(withActions->fA == withInterpreter->fA && withActions->fB == withInterpreter->fB
+               && withActions->fSum == withInterpreter->fSum && withActions->fGuard == withInterpreter->fGuard,
+               "actions and interpreter agree");
+   ok &= Check(r1.Length() == w.Length() && r2.Length() == w.Length(), "whole buffer consumed");
+   delete withActions;
+   delete withInterpreter;
+   return ok;
+}
+
+//______________________________________________________________________________
+static TTree *MakeRunEventTree(Int_t nentries)
+{
+   // Return a memory resident tree with the branches run and event, each
+   // (run,event) pair being unique.
+
+   TTree *tree = new TTree("stressIO_runevent", "run and event numbers");
+   tree->SetDirectory(0);
+   Int_t run, event;
+   tree->Branch("run", &run, "run/I");
+   tree->Branch("event", &event, "event/I");
+   for (Int_t i = 0; i < nentries; ++i) {
+      run   = i / 100;
+      event = (i * 37) % 100;
+      tree->Fill();
+   }
+   return tree;
+}
+
+//______________________________________________________________________________
+static Bool_t CopyFile(const char *from, const char *to, Long64_t nbytes, Long64_t patchpos = -1,
+                       const void *patch = 0, Int_t patchlen = 0)
+{
+   // Copy the first nbytes of the file 'from' to 'to', overwriting patchlen
+   // bytes at patchpos with patch.
+
+   FILE *in = fopen(from, "rb");
+   if (!in) return kFALSE;
+   char *buf = new char[nbytes];
+   Bool_t ok = fread(buf, 1, nbytes, in) == (size_t)nbytes;
+   fclose(in);
+   if (ok && patch) memcpy(buf + patchpos, patch, patchlen);
+   FILE *out = ok ? fopen(to, "wb") : 0;
+   if (out) {
+      ok = fwrite(buf, 1, nbytes, out) == (size_t)nbytes;
+      if (fclose(out) != 0) ok = kFALSE;
+   } else {
+      ok = kFALSE;
+   }
+   delete [] buf;
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestHashIndexSideFile()
+{
+   // Save a TTreeHashIndex with WriteSideFile, open it again and compare the
+   // lookups of every (run,event) pair with the index built from the tree.
+
+   const char *filename = "stressIO_hashindex.idx";
+   TTree *tree = MakeRunEventTree(2000);
+   TTreeHashIndex *built = new TTreeHashIndex(tree, "run", "event");
+   Long64_t nbytes = built->WriteSideFile(filename);
+
+   Bool_t ok = Check(nbytes > 0, "writing the side file");
+   TTreeHashIndex *opened = ok ? TTreeHashIndex::Open(filename, tree) : 0;
+   ok &= Check(opened != 0, "opening the side file");
+   if (opened) {
+      ok &= Check(opened->GetN() == built->GetN(), "number of entries");
+      Int_t nbad = 0;
+      for (Int_t i = 0; i < 2000; ++i) {
+         Int_t run = i / 100, event = (i * 37) % 100;
+         if (opened->GetEntryNumberWithIndex(run, event) != i
+             || built->GetEntryNumberWithIndex(run, event) != i) ++nbad;
+      }
+      ok &= Check(nbad == 0, "entry numbers of all the pairs");
+      ok &= Check(opened->GetEntryNumberWithIndex(5, 100) == -1
+                  && opened->GetEntryNumberWithIndex(20, 0) == -1, "pairs not in the index");
+   }
+   delete opened;
+   delete built;
+   delete tree;
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestHashIndexCorrupted()
+{
+   // A truncated side file, or one whose hash table size would make the
+   // lookups loop forever, must be refused by TTreeHashIndex::Open.
+
+   const char *filename  = "stressIO_hashindex.idx";
+   const char *truncated = "stressIO_hashindex_truncated.idx";
+   const char *badslots  = "stressIO_hashindex_badslots.idx";
+   TTree *tree = MakeRunEventTree(500);
+   TTreeHashIndex *built = new TTreeHashIndex(tree, "run", "event");
+   Long64_t nbytes = built->WriteSideFile(filename);
+   delete built;
+
+   Bool_t ok = Check(nbytes > 64, "writing the side file");
+   // fNslots follows the magic, the two Int_t and fN in the header.
+   Long64_t nslots = 500;
+   ok &= Check(CopyFile(filename, truncated, nbytes - 8), "truncating the side file");
+   ok &= Check(CopyFile(filename, badslots, nbytes, 24, &nslots, sizeof(nslots)), "patching the side file");
+   if (ok) {
+      Int_t level = gErrorIgnoreLevel;
+      gErrorIgnoreLevel = kFatal;
+      TTreeHashIndex *index1 = TTreeHashIndex::Open(truncated, tree);
+      TTreeHashIndex *index2 = TTreeHashIndex::Open(badslots, tree);
+      gErrorIgnoreLevel = level;
+      ok &= Check(index1 == 0, "truncated side file refused");
+      ok &= Check(index2 == 0, "number of slots not a power of two refused");
+      delete index1;
+      delete index2;
+   }
+   delete tree;
+   gSystem->Unlink(filename);
+   gSystem->Unlink(truncated);
+   gSystem->Unlink(badslots);
+   return ok;
+}
+
+//______________________________________________________________________________
+static Bool_t WriteProfileFile(const char *filename, Int_t compress, Int_t nentries)
+{
+   // Write the tree T with the branches a (read by the profiled job),
+   // b and c to filename, with the given compression level.
+
+   TFile *file = TFile::Open(filename, "RECREATE", "", compress);
+   if (!file || file->IsZombie()) {
+      delete file;
+      return kFALSE;
+   }
+   TTree *tree = new TTree("T", "profiled tree");
+   Float_t a;
+   Double_t b;
+   Int_t c[8];
+   tree->Branch("a", &a, "a/F", 4000);
+   tree->Branch("b", &b, "b/D", 4000);
+   tree->Branch("c", c, "c[8]/I", 4000);
+   for (Int_t i = 0; i < nentries; ++i) {
+      a = i * 0.37f;
+      b = i * 1.5;
+      for (Int_t j = 0; j < 8; ++j) c[j] = i * j;
+      tree->Fill();
+   }
+   tree->Write();
+   delete file;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+static Int_t CountBaskets(const char *filename, const char *branchname)
+{
+   // Return the number of baskets written for branchname in the tree T of filename.
+
+   TFile *file = TFile::Open(filename);
+   TTree *tree = file ? (TTree*)file->Get("T") : 0;
+   TBranch *branch = tree ? tree->GetBranch(branchname) : 0;
+   Int_t nbaskets = branch ? branch->GetWriteBasket() : -1;
+   delete file;
+   return nbaskets;
+}
+
+//______________________________________________________________________________
+Bool_t TestAccessProfile()
+{
+   // Record the access profile of a job reading only the branch a of a
+   // chain made of a compressed and an uncompressed file, save it, then
+   // copy the tree with the profile applied: the clusters must hold the
+   // entries fitting in the job's cache, with a single basket of a each.
+
+   const char *file1   = "stressIO_profile1.root";
+   const char *file2   = "stressIO_profile2.root";
+   const char *outname = "stressIO_profile_out.root";
+   const char *profile = "stressIO_profile.prof";
+   const Int_t nentries = 40000;
+   const Long64_t cachesize = 30000;
+
+   Bool_t ok = Check(WriteProfileFile(file1, 1, nentries) && WriteProfileFile(file2, 0, nentries),
+                     "writing the input files");
+   if (!ok) return kFALSE;
+
+   // The job. The perf stats are created before the chain loads a tree.
+   TChain *chain = new TChain("T");
+   chain->Add(file1);
+   chain->Add(file2);
+   TTreePerfStats *ps = new TTreePerfStats("ioperf", chain);
+   ps->SetRecordProfile();
+   chain->SetCacheSize(cachesize);
+   chain->SetBranchStatus("*", 0);
+   chain->SetBranchStatus("a", 1);
+   Float_t a;
+   chain->SetBranchAddress("a", &a);
+   Long64_t n = chain->GetEntries();
+   for (Long64_t i = 0; i < n; ++i) chain->GetEntry(i);
+   ok &= Check(ps->SaveProfile(profile), "saving the access profile");
+   delete ps;
+   delete chain;
+
+   // The profile lists a, with all its baskets from both files, and nothing else.
+   std::ifstream in(profile);
+   std::string line, treename;
+   Int_t nbranches = 0, nbasketsA = -1;
+   Long64_t profileCache = -1;
+   while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string key, name;
+      fields >> key;
+      if (key == "tree") fields >> treename;
+      if (key == "cachesize") fields >> profileCache;
+      if (key == "branch") {
+         ++nbranches;
+         fields >> name;
+         if (name == "a") fields >> nbasketsA;
+      }
+   }
+   in.close();
+   ok &= Check(treename == "T" && profileCache == cachesize, "tree name and cache size in the profile");
+   ok &= Check(nbranches == 1, "only the branch read in the profile");
+   ok &= Check(nbasketsA == CountBaskets(file1, "a") + CountBaskets(file2, "a"),
+               "baskets of the compressed and of the uncompressed file recorded");
+
+   // Copy with the profile applied.
+   TFile *input = TFile::Open(file1);
+   TTree *tree = input ? (TTree*)input->Get("T") : 0;
+   TFile *output = TFile::Open(outname, "RECREATE");
+   TTree *copy = (tree && output) ? tree->CloneTree(-1, "profile=stressIO_profile.prof") : 0;
+   ok &= Check(copy != 0, "copying the tree with the profile");
+   if (copy) {
+      TBranch *ina = tree->GetBranch("a");
+      Long64_t expected = (Long64_t)(cachesize / (ina->GetZipBytes() / (Double_t)ina->GetEntries()));
+      Long64_t autoflush = copy->GetAutoFlush();
+      ok &= Check(autoflush == expected, "cluster size from the profile");
+      ok &= Check(!copy->TestBit(TTree::kFixedBasketSizes), "fixed basket sizes bit reset after the first flush");
+      copy->Write();
+      Long64_t nclusters = (nentries + autoflush - 1) / autoflush;
+      ok &= Check(copy->GetBranch("a")->GetWriteBasket() == nclusters, "one basket of a per cluster");
+      ok &= Check(copy->GetBranch("b")->GetBasketSize() == tree->GetBranch("b")->GetBasketSize(),
+                  "basket size of the branches not read unchanged");
+      ok &= Check(copy->GetEntries() == nentries, "all the entries copied");
+   }
+   delete output;
+   delete input;
+   gSystem->Unlink(file1);
+   gSystem->Unlink(file2);
+   gSystem->Unlink(outname);
+   gSystem->Unlink(profile);
+   return ok;
+}
+
+//______________________________________________________________________________
+static TTree *MakeFillTree(Long64_t autoflush, Float_t &x, Int_t &id, Double_t *v)
+{
+   // Return a new tree in the current directory with the branches x, id
+   // and v[3], small baskets and the given AutoFlush setting.
+
+   TTree *tree = new TTree("T", "Fill and FillBulk");
+   tree->SetAutoFlush(autoflush);
+   tree->Branch("x", &x, "x/F", 4000);
+   tree->Branch("id", &id, "id/I", 4000);
+   tree->Branch("v", v, "v[3]/D", 4000);
+   return tree;
+}
+
+//______________________________________________________________________________
+static Bool_t CompareFillBulk(Long64_t autoflush)
+{
+   // Fill the same data with Fill and with FillBulk and compare the
+   // resulting basket and cluster boundaries.
+
+   const Int_t nentries = 60000;
+   Float_t  *xs  = new Float_t[nentries];
+   Int_t    *ids = new Int_t[nentries];
+   Double_t *vs  = new Double_t[3*nentries];
+   TRandom3 rnd(4357);
+   for (Int_t i = 0; i < nentries; ++i) {
+      xs[i]  = rnd.Gaus();
+      ids[i] = i;
+      for (Int_t j = 0; j < 3; ++j) vs[3*i+j] = rnd.Uniform();
+   }
+
+   Float_t x;
+   Int_t id;
+   Double_t v[3];
+   TFile *file1 = TFile::Open("stressIO_fill.root", "RECREATE");
+   TTree *tree1 = MakeFillTree(autoflush, x, id, v);
+   for (Int_t i = 0; i < nentries; ++i) {
+      x  = xs[i];
+      id = ids[i];
+      for (Int_t j = 0; j < 3; ++j) v[j] = vs[3*i+j];
+      tree1->Fill();
+   }
+   tree1->Write();
+
+   TFile *file2 = TFile::Open("stressIO_fillbulk.root", "RECREATE");
+   TTree *tree2 = MakeFillTree(autoflush, x, id, v);
+   void *columns[3] = { xs, ids, vs };
+   Bool_t ok = Check(tree2->FillBulk(nentries, columns) > 0, "FillBulk");
+   tree2->Write();
+
+   ok &= Check(tree1->GetEntries() == nentries && tree2->GetEntries() == nentries, "number of entries");
+   ok &= Check(tree1->GetZipBytes() == tree2->GetZipBytes() && tree1->GetTotBytes() == tree2->GetTotBytes(),
+               "bytes written");
+   ok &= Check(tree1->GetAutoFlush() == tree2->GetAutoFlush(), "AutoFlush after the first flush");
+
+   Int_t nbad = 0;
+   for (Int_t b = 0; b < 3; ++b) {
+      TBranch *branch1 = (TBranch*)tree1->GetListOfBranches()->At(b);
+      TBranch *branch2 = (TBranch*)tree2->GetListOfBranches()->At(b);
+      if (branch1->GetWriteBasket() != branch2->GetWriteBasket()) {
+         ++nbad;
+         continue;
+      }
+      for (Int_t k = 0; k < branch1->GetWriteBasket(); ++k) {
+         if (branch1->GetBasketEntry()[k] != branch2->GetBasketEntry()[k]
+             || branch1->GetBasketBytes()[k] != branch2->GetBasketBytes()[k]) ++nbad;
+      }
+   }
+   ok &= Check(nbad == 0, "basket boundaries");
+
+   TTree::TClusterIterator clusters1 = tree1->GetClusterIterator(0);
+   TTree::TClusterIterator clusters2 = tree2->GetClusterIterator(0);
+   Long64_t start1, start2;
+   Int_t nclusters = 0;
+   do {
+      start1 = clusters1();
+      start2 = clusters2();
+      if (start1 != start2 || clusters1.GetNextEntry() != clusters2.GetNextEntry()) ++nbad;
+      ++nclusters;
+   } while (start1 < nentries && start2 < nentries);
+   ok &= Check(nbad == 0, "cluster boundaries");
+   ok &= Check(nclusters > 2, "several clusters written");
+
+   delete file1;
+   delete file2;
+   delete [] xs;
+   delete [] ids;
+   delete [] vs;
+   gSystem->Unlink("stressIO_fill.root");
+   gSystem->Unlink("stressIO_fillbulk.root");
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestFillBulkEntries()
+{
+   // FillBulk and Fill with clusters of a fixed number of entries.
+
+   return CompareFillBulk(3000);
+}
+
+//______________________________________________________________________________
+Bool_t TestFillBulkBytes()
+{
+   // FillBulk and Fill with the first cluster ending after a number of
+   // compressed bytes.
+
+   return CompareFillBulk(-100000);
+}
+
+#ifndef WIN32
+//______________________________________________________________________________
+static Bool_t WebReadRequest(TSocket *s, TString &request)
+{
+   // Read the header of an HTTP request, up to the empty line.
+
+   request = "";
+   char c;
+   while (!request.EndsWith("\r\n\r\n")) {
+      if (s->RecvRaw(&c, 1) <= 0) return kFALSE;
+      request.Append(c);
+   }
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+static void RunWebServer(TServerSocket *ss, const char *content, Long64_t size)
+{
+   // Minimal HTTP/1.1 server for TestWebFileRanges, serving content:
+   //  - HEAD and single range GET are answered normally, the connection
+   //    being kept alive after a GET;
+   //  - a multi-range GET is answered with the parts in reverse order,
+   //    then the connection is closed without notice, like an idle
+   //    keep-alive connection dropped by a server;
+   //  - GET /stats returns the number of multi-range requests served,
+   //    GET /quit stops the server.
+
+   TMonitor mon;
+   mon.Add(ss);
+   Int_t nmulti = 0;
+   const char *boundary = "stressIOboundary";
+   while (1) {
+      TSocket *s = mon.Select();
+      if (!s || s == (TSocket*)-1) break;
+      if (s == ss) {
+         TSocket *client = ss->Accept();
+         if (client && client != (TSocket*)-1) mon.Add(client);
+         continue;
+      }
+      TString request, reply;
+      Bool_t close = kTRUE;
+      if (!WebReadRequest(s, request) || request.BeginsWith("GET /quit")) {
+         if (request.BeginsWith("GET /quit")) break;
+      } else if (request.BeginsWith("GET /stats")) {
+         TString body = TString::Format("%d", nmulti);
+         reply.Form("HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n%s", body.Length(), body.Data());
+      } else if (request.BeginsWith("HEAD")) {
+         reply.Form("HTTP/1.1 200 OK\r\nContent-Length: %lld\r\n\r\n", size);
+      } else {
+         Ssiz_t start = request.Index("Range: bytes=") + 13;
+         TString ranges = request(start, request.Index("\r\n", start) - start);
+         TObjArray *tokens = ranges.Tokenize(",");
+         Int_t nranges = tokens->GetEntriesFast();
+         if (nranges == 1) {
+            Long64_t first = 0, last = 0;
+            sscanf(((TObjString*)tokens->At(0))->GetName(), "%lld-%lld", &first, &last);
+            reply.Form("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%lld\r\n"
+                       "Content-Length: %lld\r\n\r\n", first, last, size, last - first + 1);
+            reply.Append(content + first, last - first + 1);
+            close = kFALSE;
+         } else {
+            ++nmulti;
+            reply.Form("HTTP/1.1 206 Partial Content\r\n"
+                       "Content-Type: multipart/byteranges; boundary=%s\r\n\r\n", boundary);
+            for (Int_t i = nranges - 1; i >= 0; --i) {
+               Long64_t first = 0, last = 0;
+               sscanf(((TObjString*)tokens->At(i))->GetName(), "%lld-%lld", &first, &last);
+               reply += TString::Format("--%s\r\nContent-Type: application/octet-stream\r\n"
+                                        "Content-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                                        boundary, first, last, size);
+               reply.Append(content + first, last - first + 1);
+               reply += "\r\n";
+            }
+            reply += TString::Format("--%s--\r\n", boundary);
+         }
+         delete tokens;
+      }
+      if (reply.Length()) s->SendRaw(reply.Data(), reply.Length());
+      if (close) {
+         mon.Remove(s);
+         delete s;
+      }
+   }
+}
+
+//______________________________________________________________________________
+static TString WebRequest(Int_t port, const char *path)
+{
+   // Send GET path to the server of TestWebFileRanges, return the body of
+   // the reply.
+
+   TSocket s("localhost", port);
+   TString request = TString::Format("GET %s HTTP/1.1\r\n\r\n", path);
+   s.SendRaw(request.Data(), request.Length());
+   TString reply;
+   char c;
+   while (s.RecvRaw(&c, 1) > 0) reply.Append(c);
+   Ssiz_t body = reply.Index("\r\n\r\n");
+   return body == kNPOS ? TString() : TString(reply(body + 4, reply.Length()));
+}
+#endif
+
+//______________________________________________________________________________
+Bool_t TestWebFileRanges()
+{
+   // Read ranges of a file through a local HTTP server with TWebFile.
+   // The ranges are split in multi-range requests issued on several
+   // connections, whose parts come back in reverse order. The server then
+   // closes these connections, which TWebFile keeps in its pool: reading
+   // again must reopen them. In both passes the data must be right and
+   // no request must have been sent again sequentially.
+
+#ifdef WIN32
+   return kTRUE;
+#else
+   const char *filename = "stressIO_web.root";
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   for (Int_t i = 0; i < 50; ++i) {
+      TNamed named(TString::Format("object%d", i).Data(), TString('x' + i % 3, 200 + i).Data());
+      named.Write();
+   }
+   delete file;
+
+   FILE *fp = fopen(filename, "rb");
+   fseek(fp, 0, SEEK_END);
+   Long64_t size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+   char *content = new char[size];
+   Bool_t ok = Check(fread(content, 1, size, fp) == (size_t)size, "reading the file");
+   fclose(fp);
+
+   TServerSocket *ss = new TServerSocket(0, kFALSE);
+   ok &= Check(ss->IsValid(), "starting the HTTP server");
+   if (!ok) {
+      delete ss;
+      delete [] content;
+      gSystem->Unlink(filename);
+      return kFALSE;
+   }
+   Int_t port = ss->GetLocalPort();
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0) {
+      alarm(120);
+      RunWebServer(ss, content, size);
+      _exit(0);
+   }
+   delete ss;
+
+   Int_t maxRanges = gEnv->GetValue("WebFile.MaxRangesPerRequest", 100);
+   Int_t maxConnections = gEnv->GetValue("WebFile.MaxConnections", 4);
+   gEnv->SetValue("WebFile.MaxRangesPerRequest", 4);
+   gEnv->SetValue("WebFile.MaxConnections", 4);
+
+   // 12 ranges, i.e. 3 requests of 4 ranges each.
+   const Int_t nbuf = 12;
+   Long64_t pos[nbuf];
+   Int_t len[nbuf];
+   Long64_t total = 0;
+   for (Int_t i = 0; i < nbuf; ++i) {
+      pos[i] = 100 + i * ((size - 200) / nbuf);
+      len[i] = 40 + 3 * i;
+      total += len[i];
+   }
+   char *buf = new char[total];
+
+   TWebFile *web = new TWebFile(TString::Format("http://localhost:%d/%s", port, filename));
+   ok &= Check(!web->IsZombie(), "opening the file through HTTP");
+   if (!web->IsZombie()) {
+      for (Int_t pass = 0; pass < 2; ++pass) {
+         memset(buf, 0, total);
+         Bool_t failed = web->ReadBuffers(buf, pos, len, nbuf);
+         Int_t nbad = 0;
+         Long64_t k = 0;
+         for (Int_t i = 0; i < nbuf; ++i) {
+            if (memcmp(buf + k, content + pos[i], len[i])) ++nbad;
+            k += len[i];
+         }
+         ok &= Check(!failed && nbad == 0, pass ? "ranges read again after the server closed the connections"
+                                                : "ranges read from out of order parts");
+      }
+      ok &= Check(WebRequest(port, "/stats") == "6", "each multi-range request sent once");
+   }
+   delete web;
+   WebRequest(port, "/quit");
+   waitpid(pid, 0, 0);
+
+   gEnv->SetValue("WebFile.MaxRangesPerRequest", maxRanges);
+   gEnv->SetValue("WebFile.MaxConnections", maxConnections);
+   delete [] buf;
+   delete [] content;
+   gSystem->Unlink(filename);
+   return ok;
+#endif
+}
+
+//______________________________________________________________________________
+static void SetSharedValue(TNamed &named, Int_t length)
+{
+   // Set named to a value of length characters, which ReadSharedValue
+   // can check for consistency.
+
+   named.SetName(TString::Format("%d", length));
+   named.SetTitle(TString('a' + length % 26, length));
+}
+
+//______________________________________________________________________________
+static Int_t ReadSharedValue(TSharedMapFile *mf)
+{
+   // Get the value set by SetSharedValue from mf. Return its length, 0 if
+   // there is no value and -1 if the value is inconsistent (torn copy).
+
+   TNamed *named = (TNamed*)mf->Get("value");
+   if (!named) return 0;
+   Int_t length = atoi(named->GetName());
+   TString title = named->GetTitle();
+   delete named;
+   if (title.Length() != length) return -1;
+   for (Int_t i = 0; i < length; ++i)
+      if (title[i] != 'a' + length % 26) return -1;
+   return length;
+}
+
+//______________________________________________________________________________
+Bool_t TestSharedMapFile()
+{
+   // Read an object of a TSharedMapFile while another process keeps
+   // updating it. The object grows at each update, so that it is moved
+   // to new slots and the region is extended several times: the reader
+   // must remap it and every copy it gets must be consistent, with a
+   // version that never decreases (the value is missing only between the
+   // Add() and the first Update() of the writer). A RECREATE of the store must not
+   // disturb the reader, which keeps the old store.
+
+#ifdef WIN32
+   return kTRUE;
+#else
+   const char *name = "stressIO_shm";
+   const Int_t nupdates = 400;
+   const Int_t step = 500;
+
+   TSharedMapFile *writer = TSharedMapFile::Create(name, "RECREATE", 4, 8192);
+   if (!Check(writer != 0, "creating the store")) return kFALSE;
+   TNamed value;
+   SetSharedValue(value, 10);
+   writer->Add(&value, "value");
+   writer->Update();
+   delete writer;
+
+   TSharedMapFile *reader = TSharedMapFile::Create(name);
+   Bool_t ok = Check(reader && !reader->IsWritable(), "opening the store as reader");
+   if (!ok) {
+      delete reader;
+      TSharedMapFile::Unlink(name);
+      return kFALSE;
+   }
+   Long64_t initialSize = reader->GetSize();
+   ok &= Check(ReadSharedValue(reader) == 10, "first value");
+
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0) {
+      alarm(120);
+      TSharedMapFile *mf = TSharedMapFile::Create(name, "UPDATE");
+      if (!mf) _exit(1);
+      mf->Add(&value, "value");
+      for (Int_t i = 1; i <= nupdates; ++i) {
+         SetSharedValue(value, 10 + i * step);
+         mf->Update(&value);
+      }
+      delete mf;
+      _exit(0);
+   }
+
+   Int_t nreads = 0, ntorn = 0, nbackwards = 0;
+   Int_t status = 0;
+   UInt_t version = 0;
+   Int_t length = 10;
+   while (1) {
+      Bool_t done = waitpid(pid, &status, WNOHANG) != 0;
+      UInt_t v = reader->GetVersion("value");
+      Int_t l = ReadSharedValue(reader);
+      ++nreads;
+      if (l < 0) ++ntorn;
+      if (v < version || (l > 0 && l < length)) ++nbackwards;
+      if (v > version) version = v;
+      if (l > length) length = l;
+      if (done) break;
+   }
+   ok &= Check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "writer process");
+   ok &= Check(ntorn == 0, TString::Format("consistent copies (%d torn out of %d)", ntorn, nreads));
+   ok &= Check(nbackwards == 0, "versions never decrease");
+   ok &= Check(length == 10 + nupdates * step, "last value");
+   ok &= Check(reader->GetSize() > initialSize, "region remapped by the reader");
+
+   // Replace the store while the reader still maps it.
+   writer = TSharedMapFile::Create(name, "RECREATE", 4, 8192);
+   ok &= Check(writer != 0, "recreating the store");
+   ok &= Check(ReadSharedValue(reader) == length, "old store kept by the reader");
+   TSharedMapFile *newReader = TSharedMapFile::Create(name);
+   ok &= Check(newReader && newReader->GetNobjects() == 0, "new store empty");
+   delete newReader;
+   delete writer;
+   delete reader;
+   TSharedMapFile::Unlink(name);
+   return ok;
+#endif
+}
+
+//______________________________________________________________________________
+static TString KeyListNames(TDirectory *dir)
+{
+   // Return the names and cycles of the keys of dir, in the list order.
+
+   TString names;
+   TIter next(dir->GetListOfKeys());
+   TKey *key;
+   while ((key = (TKey*)next()))
+      names += TString::Format("%s;%d ", key->GetName(), key->GetCycle());
+   return names;
+}
+
+//______________________________________________________________________________
+Bool_t TestLazyKeys()
+{
+   // Read a directory with several pages of keys lazily: it must be
+   // opened from the name index without reading the whole key list, give
+   // the right object (and cycle) for every name and load the complete
+   // list, in the same order as a directory read normally, on demand.
+
+   const char *filename = "stressIO_keys.root";
+   const Int_t nkeys = 4000;
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   TDirectory *dir = file->mkdir("dir");
+   dir->cd();
+   for (Int_t i = 0; i < nkeys; ++i) {
+      TNamed named(TString::Format("key%d", i).Data(), TString::Format("title%d", i).Data());
+      named.Write();
+   }
+   for (Int_t cycle = 1; cycle <= 3; ++cycle) {
+      TNamed named("multi", TString::Format("cycle%d", cycle).Data());
+      named.Write();
+   }
+   delete file;
+
+   // Reference: the list of keys read normally.
+   Bool_t lazy = TDirectoryFile::GetLazyKeys();
+   TDirectoryFile::SetLazyKeys(kFALSE);
+   file = TFile::Open(filename);
+   TString expected = KeyListNames(file->GetDirectory("dir"));
+   delete file;
+
+   TDirectoryFile::SetLazyKeys(kTRUE);
+   file = TFile::Open(filename);
+   Bool_t ok = Check(file && !file->IsZombie(), "opening the file");
+   TDirectoryFile *ldir = ok ? (TDirectoryFile*)file->GetDirectory("dir") : 0;
+   ok &= Check(ldir && ldir->IsLazy(), "directory loaded lazily");
+   if (ldir && ldir->IsLazy()) {
+      ok &= Check(ldir->GetNkeys() == nkeys + 3, "number of keys");
+      Long64_t before = file->GetBytesRead();
+      TNamed *named = (TNamed*)ldir->Get("key1234");
+      ok &= Check(named && !strcmp(named->GetTitle(), "title1234"), "object read by name");
+      delete named;
+      ok &= Check(file->GetBytesRead() - before < ldir->GetNbytesKeys(), "only some pages of the key list read");
+
+      Int_t nbad = 0;
+      TRandom3 rnd(7);
+      for (Int_t i = 0; i < 500; ++i) {
+         Int_t k = rnd.Integer(nkeys);
+         named = (TNamed*)ldir->Get(TString::Format("key%d", k));
+         if (!named || strcmp(named->GetTitle(), TString::Format("title%d", k))) ++nbad;
+         delete named;
+      }
+      ok &= Check(nbad == 0, "objects read in random order");
+      ok &= Check(ldir->Get("missing") == 0 && ldir->GetKey("missing") == 0, "missing name");
+
+      TKey *key = ldir->GetKey("multi");
+      ok &= Check(key && key->GetCycle() == 3, "highest cycle");
+      key = ldir->GetKey("multi", 2);
+      ok &= Check(key && key->GetCycle() == 2, "given cycle");
+      named = (TNamed*)ldir->Get("multi;1");
+      ok &= Check(named && !strcmp(named->GetTitle(), "cycle1"), "object of a given cycle");
+      delete named;
+
+      ok &= Check(KeyListNames(ldir) == expected, "complete list of keys");
+      ok &= Check(!ldir->IsLazy() && ldir->GetNkeys() == nkeys + 3, "directory fully loaded");
+   }
+   delete file;
+   TDirectoryFile::SetLazyKeys(lazy);
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+static Bool_t CompareFileMap(const TBufferFileMap &map, const std::map<Long64_t,Long64_t> &ref)
+{
+   // Return kTRUE if map holds exactly the entries of ref, the extra
+   // value of each entry being the opposite of its value.
+
+   if (map.GetSize() != (Int_t)ref.size()) return kFALSE;
+   std::map<Long64_t,Long64_t>::const_iterator it;
+   for (it = ref.begin(); it != ref.end(); ++it) {
+      Long64_t value, extra;
+      if (!map.GetValues(it->first, value, extra) || value != it->second || extra != -it->second)
+         return kFALSE;
+   }
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+static Bool_t StreamSharedObjects(TBufferFile &b, Int_t nobjects, Int_t nrefs)
+{
+   // Stream an array of nrefs references to nobjects objects of two classes
+   // into b, read it back and check that the objects and the sharing of
+   // the references are restored.
+
+   TObjArray objects(nobjects), refs(nrefs);
+   objects.SetOwner();
+   for (Int_t i = 0; i < nobjects; ++i) {
+      if (i % 3) objects.Add(new TNamed(TString::Format("named%d", i).Data(), ""));
+      else       objects.Add(new TObjString(TString::Format("string%d", i)));
+   }
+   for (Int_t i = 0; i < nrefs; ++i)
+      refs.Add(objects.At((i * 7) % nobjects));
+
+   b.Reset();
+   b.SetWriteMode();
+   b.WriteObject(&refs);
+   b.SetReadMode();
+   b.SetBufferOffset(0);
+   TObjArray *read = (TObjArray*)b.ReadObject(TObjArray::Class());
+   if (!read || read->GetEntriesFast() != nrefs) {
+      delete read;
+      return kFALSE;
+   }
+   Bool_t ok = kTRUE;
+   TObjArray copies(nobjects);
+   for (Int_t i = 0; i < nrefs && ok; ++i) {
+      Int_t k = (i * 7) % nobjects;
+      TObject *obj = read->At(i);
+      if (!obj || obj->IsA() != objects.At(k)->IsA() || strcmp(obj->GetName(), objects.At(k)->GetName()))
+         ok = kFALSE;
+      else if (!copies.At(k))
+         copies.AddAt(obj, k);
+      else if (copies.At(k) != obj)
+         ok = kFALSE;
+   }
+   copies.SetOwner();
+   delete read;
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestBufferFileMap()
+{
+   // Compare TBufferFileMap with std::map over a random sequence of
+   // additions, removals (which shift entries back) and clears (which
+   // only change the generation), on keys like buffer offsets and object
+   // addresses, growing the table several times. Then stream arrays with
+   // many shared references through a TBufferFile reused after Reset.
+
+   TBufferFileMap map(16);
+   std::map<Long64_t,Long64_t> ref;
+   TRandom3 rnd(35);
+   Bool_t ok = kTRUE;
+   Int_t nclears = 0;
+   for (Int_t i = 0; i < 200000 && ok; ++i) {
+      Double_t r = rnd.Rndm();
+      // Offsets are small and consecutive, addresses large and aligned.
+      Long64_t key = (i % 2) ? 1 + (Long64_t)rnd.Integer(4000)
+                             : 0x7f0000000000LL + 16 * (Long64_t)rnd.Integer(4000);
+      if (r < 0.6) {
+         UInt_t slot;
+         if (map.GetValue(key, slot) == 0) {
+            Long64_t value = i + 1;
+            if (i % 3) map.AddAt(slot, key, value, -value);
+            else       map.Add(key, value, -value);
+            ref[key] = value;
+         }
+      } else if (r < 0.9999) {
+         map.Remove(key);
+         ref.erase(key);
+      } else {
+         map.Clear();
+         ref.clear();
+         ++nclears;
+      }
+      if (i % 1000 == 0) ok = CompareFileMap(map, ref);
+   }
+   ok = Check(ok && CompareFileMap(map, ref), "map entries");
+   ok &= Check(nclears > 0 && map.Capacity() > 1024, "map cleared and grown");
+   map.Clear();
+   ok &= Check(map.GetSize() == 0 && map.GetValue(1) == 0, "map empty after Clear");
+
+   TBufferFile b(TBuffer::kWrite);
+   ok &= Check(StreamSharedObjects(b, 5000, 20000), "large object graph");
+   ok &= Check(StreamSharedObjects(b, 10, 30), "small object graph in the reused buffer");
+   ok &= Check(StreamSharedObjects(b, 3000, 3000), "object graph after a smaller one");
+   return ok;
+}
+
+//______________________________________________________________________________
+static Bool_t ReadPoolTree(const char *filename, Long64_t nentries, Bool_t parallel)
+{
+   // Read back the tree written by TestBufferPool, with a TTreeCache or,
+   // if parallel, a TTreeCacheUnzip, and check every entry.
+
+   TTreeCacheUnzip::EParUnzipMode mode = TTreeCacheUnzip::GetParallelUnzip();
+   TTreeCacheUnzip::SetParallelUnzip(parallel ? TTreeCacheUnzip::kForce : TTreeCacheUnzip::kDisable);
+   TFile *file = TFile::Open(filename);
+   TTree *tree = file ? (TTree*)file->Get("T") : 0;
+   Bool_t ok = tree && tree->GetEntries() == nentries;
+   if (ok) {
+      Int_t n = 0;
+      Double_t v[100];
+      TNamed *named = 0;
+      tree->SetBranchAddress("n", &n);
+      tree->SetBranchAddress("v", v);
+      tree->SetBranchAddress("named", &named);
+      tree->SetCacheSize(4000000);
+      for (Long64_t i = 0; i < nentries && ok; ++i) {
+         tree->GetEntry(i);
+         ok = (n == (Int_t)(i % 100) && named && named->GetName() == TString::Format("entry%lld", i));
+         for (Int_t k = 0; k < n && ok; ++k)
+            ok = (v[k] == i + 0.5 * k);
+      }
+      tree->ResetBranchAddresses();
+      delete named;
+   }
+   delete file;
+   TTreeCacheUnzip::SetParallelUnzip(mode);
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestBufferPool()
+{
+   // Check the size classes and the reuse of the blocks of TBufferPool,
+   // the expansion of a pooled TBuffer and the limit of the free lists.
+   // Then read keys and a tree, whose read buffers and unzipped chunks now
+   // come from the pool, and compare them with what was written.
+
+   Bool_t ok = kTRUE;
+   Long64_t maxPooled = TBufferPool::GetMaxPooledSize();
+
+   char *a = TBufferPool::Acquire(5000);
+   ok &= Check(TBufferPool::Capacity(a) == 8192, "size class of a block");
+   memset(a, 1, 8192);
+   Long64_t pooled = TBufferPool::GetPooledSize();
+   TBufferPool::Release(a);
+   ok &= Check(TBufferPool::GetPooledSize() == pooled + 8192, "released block kept");
+   char *b = TBufferPool::Acquire(6000);
+   ok &= Check(b == a && TBufferPool::GetPooledSize() == pooled, "released block reused");
+   TBufferPool::Release(b);
+   a = TBufferPool::Acquire(1);
+   ok &= Check(TBufferPool::Capacity(a) == 4096, "smallest size class");
+   TBufferPool::Release(a);
+
+   // A pooled buffer growing well beyond its initial block.
+   TBuffer *buf = TBufferPool::NewBuffer(TBuffer::kWrite, 100);
+   ok &= Check(TBufferPool::IsPooled(buf), "buffer from the pool");
+   const Int_t nvalues = 300000;
+   for (Int_t i = 0; i < nvalues; ++i) buf->WriteInt(i * 3);
+   buf->SetReadMode();
+   buf->SetBufferOffset(0);
+   Int_t nbad = 0;
+   for (Int_t i = 0; i < nvalues; ++i) {
+      Int_t value;
+      buf->ReadInt(value);
+      if (value != i * 3) ++nbad;
+   }
+   ok &= Check(nbad == 0 && TBufferPool::IsPooled(buf), "content of an expanded buffer");
+   pooled = TBufferPool::GetPooledSize();
+   Int_t capacity = TBufferPool::Capacity(buf->Buffer());
+   TBufferPool::DeleteBuffer(buf);
+   ok &= Check(TBufferPool::GetPooledSize() == pooled + capacity, "storage of a deleted buffer kept");
+
+   TBufferPool::SetMaxPooledSize(0);
+   ok &= Check(TBufferPool::GetPooledSize() == 0, "free lists emptied");
+   TBufferPool::Release(TBufferPool::Acquire(10000));
+   ok &= Check(TBufferPool::GetPooledSize() == 0, "block freed beyond the limit");
+   TBufferPool::SetMaxPooledSize(maxPooled);
+
+   // Keys and baskets, compressed or not.
+   const Long64_t nentries = 20000;
+   for (Int_t compress = 0; compress <= 1; ++compress) {
+      const char *filename = "stressIO_pool.root";
+      TFile *file = TFile::Open(filename, "RECREATE", "", compress);
+      if (!Check(file && !file->IsZombie(), "writing the file")) {
+         delete file;
+         return kFALSE;
+      }
+      TObjString small("small"), large(TString('z', 3000000));
+      small.Write("small");
+      large.Write("large");
+      TTree *tree = new TTree("T", "T");
+      Int_t n = 0;
+      Double_t v[100];
+      TNamed *named = new TNamed;
+      tree->Branch("n", &n, "n/I", 4000);
+      tree->Branch("v", v, "v[n]/D", 256000);
+      tree->Branch("named", &named, 32000, 0);
+      for (Long64_t i = 0; i < nentries; ++i) {
+         n = i % 100;
+         for (Int_t k = 0; k < n; ++k) v[k] = i + 0.5 * k;
+         named->SetName(TString::Format("entry%lld", i));
+         tree->Fill();
+      }
+      tree->Write();
+      delete file;
+      delete named;
+
+      file = TFile::Open(filename);
+      TObjString *s1 = file ? (TObjString*)file->Get("small") : 0;
+      TObjString *s2 = file ? (TObjString*)file->Get("large") : 0;
+      ok &= Check(s1 && s1->GetString() == small.GetString() && s2 && s2->GetString() == large.GetString(),
+                  compress ? "compressed keys" : "uncompressed keys");
+      delete s1;
+      delete s2;
+      delete file;
+      ok &= Check(ReadPoolTree(filename, nentries, kFALSE), compress ? "compressed baskets" : "uncompressed baskets");
+      if (compress)
+         ok &= Check(ReadPoolTree(filename, nentries, kTRUE), "baskets unzipped by TTreeCacheUnzip");
+      gSystem->Unlink(filename);
+   }
+   ok &= Check(TBufferPool::GetPooledSize() > 0 && TBufferPool::GetPooledSize() <= maxPooled,
+               "read buffers given back to the pool");
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestReclusterMerge()
+{
+   // Fast merge many small files, each made of small clusters, with a
+   // cluster size: the output clusters must be larger than the input ones,
+   // every cluster must start a new basket in every branch, and every
+   // entry read back must match what was written.
+
+   const Int_t nfiles = 10;
+   const Int_t nperfile = 500;
+   const Long64_t nentries = nfiles * nperfile;
+   TFileMerger *merger = new TFileMerger(kFALSE);
+   merger->SetPrintLevel(0);
+   Int_t inputBaskets = 0;
+   for (Int_t f = 0; f < nfiles; ++f) {
+      TString filename = TString::Format("stressIO_recluster%d.root", f);
+      TFile *file = TFile::Open(filename, "RECREATE");
+      if (!Check(file && !file->IsZombie(), "writing an input file")) {
+         delete file;
+         delete merger;
+         return kFALSE;
+      }
+      TTree *tree = new TTree("T", "T");
+      tree->SetAutoFlush(100);
+      Int_t id, n;
+      Double_t v[20];
+      TNamed *named = new TNamed;
+      tree->Branch("id", &id, "id/I");
+      tree->Branch("n", &n, "n/I");
+      tree->Branch("v", v, "v[n]/D");
+      tree->Branch("named", &named, 32000, 0);
+      for (Int_t i = 0; i < nperfile; ++i) {
+         id = f * nperfile + i;
+         n = id % 20;
+         for (Int_t k = 0; k < n; ++k) v[k] = id * k;
+         named->SetName(TString::Format("n%d", id));
+         tree->Fill();
+      }
+      tree->Write();
+      inputBaskets += tree->GetBranch("v")->GetWriteBasket();
+      delete file;
+      delete named;
+      merger->AddFile(filename, kFALSE);
+   }
+   merger->OutputFile("stressIO_recluster.root", "RECREATE");
+   merger->SetClusterSize(100000);
+   Bool_t ok = Check(merger->Merge(), "merging");
+   delete merger;
+
+   TFile *file = TFile::Open("stressIO_recluster.root");
+   TTree *tree = file ? (TTree*)file->Get("T") : 0;
+   ok &= Check(tree && tree->GetEntries() == nentries, "number of entries");
+   if (tree) {
+      ok &= Check(tree->GetAutoFlush() > 100, "clusters coalesced");
+      ok &= Check(tree->GetBranch("v")->GetWriteBasket() < inputBaskets, "fewer baskets");
+
+      // Every cluster starts a basket of every branch.
+      Int_t nmisaligned = 0;
+      TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+      Long64_t start;
+      while ((start = clusters()) < nentries) {
+         TIter next(tree->GetListOfBranches());
+         TBranch *branch;
+         while ((branch = (TBranch*)next())) {
+            Long64_t *first = branch->GetBasketEntry();
+            Int_t nbaskets = branch->GetWriteBasket();
+            if (std::find(first, first + nbaskets, start) == first + nbaskets) ++nmisaligned;
+         }
+      }
+      ok &= Check(nmisaligned == 0, "baskets aligned on the clusters");
+
+      Int_t id = -1, n = 0;
+      Double_t v[20];
+      TNamed *named = 0;
+      tree->SetBranchAddress("id", &id);
+      tree->SetBranchAddress("n", &n);
+      tree->SetBranchAddress("v", v);
+      tree->SetBranchAddress("named", &named);
+      Long64_t nbad = 0;
+      for (Long64_t i = 0; i < nentries; ++i) {
+         Bool_t good = tree->GetEntry(i) > 0 && id == i && n == id % 20 && named
+                       && named->GetName() == TString::Format("n%d", id);
+         for (Int_t k = 0; k < n && good; ++k)
+            good = (v[k] == id * k);
+         if (!good) ++nbad;
+      }
+      ok &= Check(nbad == 0, "entries read back");
+      tree->ResetBranchAddresses();
+      delete named;
+   }
+   delete file;
+   gSystem->Unlink("stressIO_recluster.root");
+   for (Int_t f = 0; f < nfiles; ++f)
+      gSystem->Unlink(TString::Format("stressIO_recluster%d.root", f));
+   return ok;
+}
+
+//______________________________________________________________________________
+static void SetVecOfVec(VecOfVec &v, Long64_t entry)
+{
+   // Fill v with the content of entry of TestVectorOfVector: the number
+   // and the sizes of the inner vectors change from one entry to the next,
+   // some inner vectors being empty. Entry 0 has the largest vectors.
+
+   Int_t nouter = entry ? (Int_t)(entry % 5) : 4;
+   v.fF.assign(nouter, std::vector<Float_t>());
+   v.fI.assign(nouter ? nouter - 1 : 0, std::vector<Int_t>());
+   for (Int_t j = 0; j < nouter; ++j) {
+      Int_t n = entry ? (Int_t)((entry * 3 + j) % 7) : 100;
+      for (Int_t k = 0; k < n; ++k) v.fF[j].push_back(entry + 0.25f * k);
+      if (j < nouter - 1)
+         for (Int_t k = 0; k < n + 1; ++k) v.fI[j].push_back((Int_t)(entry * 10 + k));
+   }
+}
+
+//______________________________________________________________________________
+Bool_t TestVectorOfVector()
+{
+   // Write objects holding vectors of vectors object-wise (branch not
+   // split) and read them back into the same object: every entry must
+   // be read back exactly, and an inner vector shrinking from one entry to
+   // the next must keep its storage.
+
+   const char *filename = "stressIO_vecvec.root";
+   const Long64_t nentries = 2000;
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   TTree *tree = new TTree("T", "T");
+   VecOfVec *v = new VecOfVec;
+   tree->Branch("v", &v, 32000, 0);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      SetVecOfVec(*v, i);
+      tree->Fill();
+   }
+   tree->Write();
+   delete file;
+   delete v;
+
+   file = TFile::Open(filename);
+   tree = file ? (TTree*)file->Get("T") : 0;
+   Bool_t ok = Check(tree && tree->GetEntries() == nentries, "reading the file");
+   if (ok) {
+      VecOfVec *read = new VecOfVec;
+      VecOfVec expected;
+      tree->SetBranchAddress("v", &read);
+      tree->GetEntry(0);
+      const Float_t *storage = read->fF.empty() ? 0 : &read->fF[0][0];
+      tree->GetEntry(1);
+      ok &= Check(storage && !read->fF.empty() && !read->fF[0].empty() && &read->fF[0][0] == storage,
+                  "inner vector storage reused");
+      Long64_t nbad = 0;
+      for (Long64_t i = 0; i < nentries; ++i) {
+         tree->GetEntry(i);
+         SetVecOfVec(expected, i);
+         if (read->fF != expected.fF || read->fI != expected.fI) ++nbad;
+      }
+      // Backward, so that the vectors shrink and grow differently.
+      for (Long64_t i = nentries - 1; i >= 0; i -= 3) {
+         tree->GetEntry(i);
+         SetVecOfVec(expected, i);
+         if (read->fF != expected.fF || read->fI != expected.fI) ++nbad;
+      }
+      ok &= Check(nbad == 0, "entries read into the same object");
+      tree->ResetBranchAddresses();
+      delete read;
+   }
+   delete file;
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+template <typename T>
+static Bool_t CheckSwapArray(Int_t n, Int_t misalign)
+{
+   // Write n values of type T with WriteFastArray from a source misaligned
+   // by misalign bytes, at a buffer position misaligned as well. The bytes
+   // written must be the ones of each value in big endian order, which is
+   // checked one byte at a time. Read them back with ReadFastArray into a
+   // misaligned destination and compare with the source.
+
+   std::vector<char> src(n * sizeof(T) + 8), dst(n * sizeof(T) + 8);
+   for (Int_t i = 0; i < n; ++i) {
+      // Distinct bytes in every position of every value.
+      for (UInt_t k = 0; k < sizeof(T); ++k)
+         src[misalign + i * sizeof(T) + k] = (char)((i * 13 + k * 71 + 5) & 0xff);
+   }
+   TBufferFile b(TBuffer::kWrite);
+   for (Int_t k = 0; k < misalign; ++k) b.WriteChar(0);
+   b.WriteFastArray((T*)&src[misalign], n);
+   Bool_t ok = (b.Length() == misalign + n * (Int_t)sizeof(T));
+   const char *out = b.Buffer() + misalign;
+   for (Int_t i = 0; i < n && ok; ++i) {
+      const char *in = &src[misalign + i * sizeof(T)];
+      for (UInt_t k = 0; k < sizeof(T); ++k) {
+#ifdef R__BYTESWAP
+         if (out[i * sizeof(T) + k] != in[sizeof(T) - 1 - k]) ok = kFALSE;
+#else
+         if (out[i * sizeof(T) + k] != in[k]) ok = kFALSE;
+#endif
+      }
+   }
+   b.SetReadMode();
+   b.SetBufferOffset(misalign);
+   b.ReadFastArray((T*)&dst[misalign], n);
+   ok &= (b.Length() == misalign + n * (Int_t)sizeof(T));
+   ok &= (n == 0 || !memcmp(&src[misalign], &dst[misalign], n * sizeof(T)));
+   return ok;
+}
+
+//______________________________________________________________________________
+template <typename T>
+static Bool_t CheckPackedArray(TStreamerElement *ele, Int_t n, Int_t misalign)
+{
+   // Write n values of type T (Float_t as Float16_t, Double_t as
+   // Double32_t) packed as described by ele, read them back with the array
+   // function into a misaligned destination and compare, bit for bit, with
+   // the values read one by one.
+
+   std::vector<T> values(n);
+   for (Int_t i = 0; i < n; ++i) values[i] = (T)(-9.5 + 19.0 * ((i * 37) % 101) / 101.);
+   TBufferFile b(TBuffer::kWrite);
+   for (Int_t k = 0; k < misalign; ++k) b.WriteChar(0);
+   Int_t start = b.Length();
+   if (sizeof(T) == sizeof(Float_t)) b.WriteFastArrayFloat16((Float_t*)&values[0], n, ele);
+   else                              b.WriteFastArrayDouble32((Double_t*)&values[0], n, ele);
+
+   std::vector<char> dst((n + 1) * sizeof(T));
+   T *array = (T*)&dst[misalign];
+   b.SetReadMode();
+   b.SetBufferOffset(start);
+   if (sizeof(T) == sizeof(Float_t)) b.ReadFastArrayFloat16((Float_t*)array, n, ele);
+   else                              b.ReadFastArrayDouble32((Double_t*)array, n, ele);
+   Int_t end = b.Length();
+
+   b.SetBufferOffset(start);
+   Bool_t ok = kTRUE;
+   for (Int_t i = 0; i < n; ++i) {
+      T single;
+      if (sizeof(T) == sizeof(Float_t)) b.ReadFloat16((Float_t*)&single, ele);
+      else                              b.ReadDouble32((Double_t*)&single, ele);
+      if (memcmp(&single, (char*)array + i * sizeof(T), sizeof(T))) ok = kFALSE;
+   }
+   return ok && b.Length() == end;
+}
+
+//______________________________________________________________________________
+Bool_t TestByteSwapArrays()
+{
+   // The arrays of numbers are byte swapped by vectorized kernels when
+   // the CPU has them. Check them against the byte order computed one
+   // byte at a time, for lengths around the vector widths and for
+   // misaligned sources, buffers and destinations, and check the array
+   // reads of Float16_t and Double32_t against the single value reads.
+
+   const Int_t lengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1001 };
+   const Int_t nlengths = sizeof(lengths) / sizeof(lengths[0]);
+   Int_t nbad = 0;
+   for (Int_t l = 0; l < nlengths; ++l) {
+      for (Int_t m = 0; m < 4; ++m) {
+         Int_t n = lengths[l];
+         if (!CheckSwapArray<Short_t>(n, m))   ++nbad;
+         if (!CheckSwapArray<Int_t>(n, m))     ++nbad;
+         if (!CheckSwapArray<Long64_t>(n, m))  ++nbad;
+         if (!CheckSwapArray<Float_t>(n, m))   ++nbad;
+         if (!CheckSwapArray<Double_t>(n, m))  ++nbad;
+      }
+   }
+   Bool_t ok = Check(nbad == 0, "byte order of arrays of 2, 4 and 8 byte numbers");
+
+   TStreamerElement f16range("f", "[-10,10,16]", 0, TStreamerInfo::kFloat16, "Float16_t");
+   TStreamerElement f16bits("f", "[0,0,10]", 0, TStreamerInfo::kFloat16, "Float16_t");
+   TStreamerElement d32range("d", "[-10,10,20]", 0, TStreamerInfo::kDouble32, "Double32_t");
+   TStreamerElement d32bits("d", "[0,0,14]", 0, TStreamerInfo::kDouble32, "Double32_t");
+   nbad = 0;
+   for (Int_t l = 1; l < nlengths; ++l) {
+      for (Int_t m = 0; m < 4; m += 3) {
+         Int_t n = lengths[l];
+         if (!CheckPackedArray<Float_t>(0, n, m))          ++nbad;
+         if (!CheckPackedArray<Float_t>(&f16range, n, m))  ++nbad;
+         if (!CheckPackedArray<Float_t>(&f16bits, n, m))   ++nbad;
+         if (!CheckPackedArray<Double_t>(0, n, m))         ++nbad;
+         if (!CheckPackedArray<Double_t>(&d32range, n, m)) ++nbad;
+         if (!CheckPackedArray<Double_t>(&d32bits, n, m))  ++nbad;
+      }
+   }
+   ok &= Check(nbad == 0, "Float16_t and Double32_t arrays");
+   return ok;
+}
+
+//______________________________________________________________________________
+static TString FindHadd()
+{
+   // Return the path of the hadd executable, from $PATH or $ROOTSYS/bin,
+   // or an empty string if it can not be found.
+
+   char *path = gSystem->Which(gSystem->Getenv("PATH"), "hadd", kExecutePermission);
+   TString hadd = path ? path : "";
+   delete [] path;
+   if (hadd.IsNull() && gSystem->Getenv("ROOTSYS")) {
+      TString candidate = TString::Format("%s/bin/hadd", gSystem->Getenv("ROOTSYS"));
+      if (!gSystem->AccessPathName(candidate, kExecutePermission)) hadd = candidate;
+   }
+   return hadd;
+}
+
+//______________________________________________________________________________
+static Int_t CountDirectoryEntries(const char *dirname)
+{
+   // Return the number of files in the directory dirname.
+
+   void *dir = gSystem->OpenDirectory(dirname);
+   if (!dir) return -1;
+   Int_t n = 0;
+   const char *entry;
+   while ((entry = gSystem->GetDirEntry(dir)))
+      if (strcmp(entry, ".") && strcmp(entry, "..")) ++n;
+   gSystem->FreeDirectory(dir);
+   return n;
+}
+
+//______________________________________________________________________________
+static Long64_t CompareMergedTrees(const char *name1, const char *name2)
+{
+   // Return the number of entries of the tree T in the files name1 and
+   // name2, -1 if they differ in any way.
+
+   TFile *f1 = TFile::Open(name1);
+   TFile *f2 = TFile::Open(name2);
+   TTree *t1 = f1 ? (TTree*)f1->Get("T") : 0;
+   TTree *t2 = f2 ? (TTree*)f2->Get("T") : 0;
+   Long64_t nentries = -1;
+   if (t1 && t2 && t1->GetEntries() == t2->GetEntries()) {
+      Int_t id1, id2;
+      Double_t x1, x2;
+      t1->SetBranchAddress("id", &id1);
+      t1->SetBranchAddress("x", &x1);
+      t2->SetBranchAddress("id", &id2);
+      t2->SetBranchAddress("x", &x2);
+      nentries = t1->GetEntries();
+      for (Long64_t i = 0; i < t1->GetEntries() && nentries >= 0; ++i) {
+         t1->GetEntry(i);
+         t2->GetEntry(i);
+         if (id1 != id2 || x1 != x2) nentries = -1;
+      }
+   }
+   delete f1;
+   delete f2;
+   return nentries;
+}
+
+//______________________________________________________________________________
+Bool_t TestHaddParallel()
+{
+   // Merge 40 files with hadd -j 8, which merges them in two passes of
+   // partial files, and compare the result with a sequential hadd. The
+   // partial files, written in a private $TMPDIR, must all have been
+   // removed after the merge, also when the merge fails.
+
+#ifdef WIN32
+   return kTRUE;
+#else
+   TString hadd = FindHadd();
+   if (!Check(!hadd.IsNull(), "hadd executable")) return kFALSE;
+
+   const Int_t nfiles = 40;
+   const Int_t nperfile = 250;
+   TString inputs;
+   for (Int_t f = 0; f < nfiles; ++f) {
+      TString filename = TString::Format("stressIO_hadd%d.root", f);
+      TFile *file = TFile::Open(filename, "RECREATE");
+      if (!Check(file && !file->IsZombie(), "writing an input file")) {
+         delete file;
+         return kFALSE;
+      }
+      TTree *tree = new TTree("T", "T");
+      Int_t id;
+      Double_t x;
+      tree->Branch("id", &id, "id/I");
+      tree->Branch("x", &x, "x/D");
+      for (Int_t i = 0; i < nperfile; ++i) {
+         id = f * nperfile + i;
+         x = id * 0.5;
+         tree->Fill();
+      }
+      tree->Write();
+      delete file;
+      inputs += " " + filename;
+   }
+   TString tmpdir = TString::Format("%s/stressIO_haddtmp", gSystem->WorkingDirectory());
+   gSystem->mkdir(tmpdir);
+
+   Int_t serial = gSystem->Exec(TString::Format("%s -v 0 -f stressIO_hadd_serial.root%s", hadd.Data(), inputs.Data()));
+   Int_t parallel = gSystem->Exec(TString::Format("TMPDIR=%s %s -v 0 -j 8 -f stressIO_hadd_parallel.root%s",
+                                                  tmpdir.Data(), hadd.Data(), inputs.Data()));
+   Bool_t ok = Check(serial == 0 && parallel == 0, "running hadd");
+   ok &= Check(CompareMergedTrees("stressIO_hadd_serial.root", "stressIO_hadd_parallel.root") == nfiles * nperfile,
+               "same merged tree with and without -j");
+   ok &= Check(CountDirectoryEntries(tmpdir) == 0, "partial files removed");
+
+   // A source which is not a ROOT file makes a merging process fail.
+   FILE *fp = fopen("stressIO_hadd_bad.root", "w");
+   if (fp) {
+      fputs("not a ROOT file\n", fp);
+      fclose(fp);
+   }
+   parallel = gSystem->Exec(TString::Format("TMPDIR=%s %s -v 0 -j 8 -f stressIO_hadd_failed.root%s stressIO_hadd_bad.root 2>/dev/null",
+                                            tmpdir.Data(), hadd.Data(), inputs.Data()));
+   ok &= Check(parallel != 0, "failed merge reported");
+   ok &= Check(CountDirectoryEntries(tmpdir) == 0, "partial files removed after a failure");
+
+   gSystem->Unlink("stressIO_hadd_bad.root");
+   gSystem->Unlink("stressIO_hadd_failed.root");
+   gSystem->Unlink("stressIO_hadd_serial.root");
+   gSystem->Unlink("stressIO_hadd_parallel.root");
+   gSystem->Unlink(tmpdir);
+   for (Int_t f = 0; f < nfiles; ++f)
+      gSystem->Unlink(TString::Format("stressIO_hadd%d.root", f));
+   return ok;
+#endif
+}
+
+//______________________________________________________________________________
+static Int_t PrefetchedBaskets(TTree *tree, const std::vector<Long64_t> &entries, Int_t &nbytes)
+{
+   // Return the number of distinct baskets, and their total size, holding
+   // the given (sorted) entries in the branches of tree.
+
+   Int_t nbaskets = 0;
+   nbytes = 0;
+   TObjArray *branches = tree->GetListOfBranches();
+   for (Int_t i = 0; i < branches->GetEntriesFast(); ++i) {
+      TBranch *b = (TBranch*)branches->UncheckedAt(i);
+      Int_t last = -1;
+      for (size_t e = 0; e < entries.size(); ++e) {
+         Int_t j = TMath::BinarySearch(b->GetWriteBasket()+1, b->GetBasketEntry(), entries[e]);
+         if (j == last) continue;
+         last = j;
+         ++nbaskets;
+         nbytes += b->GetBasketBytes()[j];
+      }
+   }
+   return nbaskets;
+}
+
+//______________________________________________________________________________
+Bool_t TestPrefetchEntries()
+{
+   // Register the baskets of a scattered list of entries with
+   // TTreeCache::PrefetchEntries, check that exactly the baskets of these
+   // entries are in the cache and that the entries read back correctly,
+   // without the cache being refilled. With a cache too small for the
+   // baskets of the first entry nothing must be registered.
+
+   const char *filename = "stressIO_prefetch.root";
+   const Long64_t nentries = 200000;
+   TFile *file = TFile::Open(filename, "RECREATE", "", 0);
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   TTree *tree = new TTree("T", "T");
+   Int_t id;
+   Double_t x;
+   tree->Branch("id", &id, "id/I", 64000);
+   tree->Branch("x", &x, "x/D", 64000);
+   tree->SetAutoFlush(0);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      id = (Int_t)i;
+      x = i * 0.5;
+      tree->Fill();
+   }
+   tree->Write();
+   delete file;
+
+   const Long64_t request[] = { 150000, 10, 70000, 10, 199999, -5, 300000 };
+   const Int_t nrequest = sizeof(request) / sizeof(request[0]);
+   std::vector<Long64_t> wanted;
+   wanted.push_back(10);
+   wanted.push_back(70000);
+   wanted.push_back(150000);
+   wanted.push_back(199999);
+
+   Bool_t ok = kTRUE;
+   for (Int_t pass = 0; pass < 2; ++pass) {
+      file = TFile::Open(filename);
+      tree = file ? (TTree*)file->Get("T") : 0;
+      if (!Check(tree != 0, "reading the tree")) {
+         delete file;
+         gSystem->Unlink(filename);
+         return kFALSE;
+      }
+      tree->SetBranchAddress("id", &id);
+      tree->SetBranchAddress("x", &x);
+      Int_t nbytes = 0;
+      Int_t nbaskets = PrefetchedBaskets(tree, wanted, nbytes);
+      // The second pass uses the smallest cache, which holds any single
+      // basket but not the two baskets of the first entry.
+      tree->SetCacheSize(pass == 0 ? 10000000 : 100001);
+      TTreeCache *cache = (TTreeCache*)file->GetCacheRead(tree);
+      if (!Check(cache != 0, "tree cache")) {
+         delete file;
+         break;
+      }
+      Int_t registered = cache->PrefetchEntries(nrequest, request);
+      if (pass == 0) {
+         ok &= Check(registered == nbaskets && cache->GetNseek() == nbaskets,
+                     "baskets of the requested entries registered");
+         ok &= Check(cache->GetNtot() == nbytes, "size of the registered baskets");
+      } else {
+         ok &= Check(registered == 0 && cache->GetNseek() == 0 && cache->GetNtot() == 0,
+                     "nothing registered when the first entry does not fit");
+      }
+      Int_t nbad = 0;
+      for (size_t e = 0; e < wanted.size(); ++e) {
+         if (tree->GetEntry(wanted[e]) <= 0 || id != wanted[e] || x != wanted[e] * 0.5) ++nbad;
+      }
+      ok &= Check(nbad == 0, "values of the requested entries");
+      if (pass == 0) ok &= Check(cache->GetNseek() == nbaskets, "cache not refilled");
+      delete file;
+   }
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+static Int_t ReadBigString(const char *filename, const TString &ref)
+{
+   // Read the key "big" of filename with TKey::ReadObj, ReadObjectAny and
+   // Read(TObject*) and return how many of them give back ref.
+
+   TFile *file = TFile::Open(filename);
+   TKey *key = file ? file->GetKey("big") : 0;
+   Int_t nok = 0;
+   if (key) {
+      TObjString *s1 = dynamic_cast<TObjString*>(key->ReadObj());
+      if (s1 && s1->GetString() == ref) ++nok;
+      delete s1;
+      TObjString *s2 = (TObjString*)key->ReadObjectAny(TObjString::Class());
+      if (s2 && s2->GetString() == ref) ++nok;
+      delete s2;
+      TObjString s3;
+      if (key->Read(&s3) > 0 && s3.GetString() == ref) ++nok;
+   }
+   delete file;
+   return nok;
+}
+
+//______________________________________________________________________________
+Bool_t TestLargeKeyUnzip()
+{
+   // Write a string object of 40 MB, compressed in several 16 MB blocks,
+   // and read it back through the three TKey read functions, which
+   // decompress it block by block. Then damage the second block (size
+   // beyond the end of the key, invalid header) or the data of the first
+   // block: all the reads must fail instead of returning an object.
+
+   const char *filename = "stressIO_bigkey.root";
+   const char *damaged = "stressIO_bigkey_bad.root";
+   const Int_t length = 40000000;
+   TString ref;
+   ref.Resize(length);
+   TRandom3 rnd(1);
+   for (Int_t i = 0; i < length; ++i) ref[i] = 'a' + (Int_t)(16 * rnd.Rndm());
+
+   TFile *file = TFile::Open(filename, "RECREATE", "", 1);
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   TObjString big(ref);
+   big.Write("big");
+   TKey *key = file->GetKey("big");
+   Long64_t seekkey = key ? key->GetSeekKey() : 0;
+   Int_t keylen = key ? key->GetKeylen() : 0;
+   Bool_t ok = Check(key && key->GetObjlen() > 0xffffff && key->GetNbytes() - keylen < key->GetObjlen(),
+                     "object compressed in several blocks");
+   delete file;
+   Long_t id, flags, modtime;
+   Long64_t filesize = 0;
+   gSystem->GetPathInfo(filename, &id, &filesize, &flags, &modtime);
+   if (!ok) {
+      gSystem->Unlink(filename);
+      return kFALSE;
+   }
+
+   ok &= Check(ReadBigString(filename, ref) == 3, "object read back by ReadObj, ReadObjectAny and Read");
+
+   // Locate the second block from the header of the first one.
+   Long64_t first = seekkey + keylen;
+   UChar_t header[9];
+   FILE *fp = fopen(filename, "rb");
+   Bool_t located = fp && fseek(fp, first, SEEK_SET) == 0 && fread(header, 1, 9, fp) == 9;
+   if (fp) fclose(fp);
+   if (!Check(located, "reading the compression header")) {
+      gSystem->Unlink(filename);
+      return kFALSE;
+   }
+   Long64_t second = first + 9 + (header[3] | (header[4] << 8) | (header[5] << 16));
+
+   const UChar_t toolong[3] = { 0xff, 0xff, 0xff };
+   const char badheader[2] = { 'X', 'X' };
+   char garbage[64];
+   for (Int_t i = 0; i < 64; ++i) garbage[i] = (char)(i * 97 + 13);
+   struct Damage_t { Long64_t fPos; const void *fPatch; Int_t fLen; const char *fWhat; };
+   Damage_t damages[3] = {
+      { second + 3, toolong, 3, "truncated block" },
+      { second, badheader, 2, "invalid block header" },
+      { first + 1000, garbage, 64, "corrupted block data" }
+   };
+   for (Int_t d = 0; d < 3; ++d) {
+      if (!Check(CopyFile(filename, damaged, filesize, damages[d].fPos, damages[d].fPatch, damages[d].fLen),
+                 "copying the file")) {
+         ok = kFALSE;
+         continue;
+      }
+      Int_t level = gErrorIgnoreLevel;
+      gErrorIgnoreLevel = kFatal;
+      Int_t nok = ReadBigString(damaged, ref);
+      gErrorIgnoreLevel = level;
+      ok &= Check(nok == 0, damages[d].fWhat);
+   }
+
+   gSystem->Unlink(damaged);
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+static TString RandomText(Int_t length, UInt_t seed)
+{
+   // Return a string of length random letters.
+
+   TString text;
+   text.Resize(length);
+   TRandom3 rnd(seed);
+   for (Int_t i = 0; i < length; ++i) text[i] = 'a' + (Int_t)(26 * rnd.Rndm());
+   return text;
+}
+
+//______________________________________________________________________________
+static Bool_t SameText(TFile *file, const char *name, const TString &text)
+{
+   // Return whether the object name of file is a TObjString holding text.
+
+   TObjString *s = (TObjString*)file->Get(name);
+   Bool_t same = s && s->GetString() == text;
+   delete s;
+   return same;
+}
+
+//______________________________________________________________________________
+Bool_t TestWriteBehind()
+{
+   // Write a tree with a write-behind cache and check it after Close.
+   // Then write objects of 60 kB through a 100 kB write-behind cache,
+   // so that each object hands the previous one to the I/O thread, and
+   // read the pending data back with TFile::ReadBuffers and TKey (both
+   // must wait for the write in flight) before and after the Close.
+   // Finally check, in a process with a file size limit, that a failed
+   // asynchronous write is reported by Flush and by Close.
+
+   const char *treefile = "stressIO_behind_tree.root";
+   const char *keyfile = "stressIO_behind_keys.root";
+   const Int_t nentries = 100000;
+
+   TFile *file = TFile::Open(treefile, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the tree file")) {
+      delete file;
+      return kFALSE;
+   }
+   TFileCacheWrite *cache = new TFileCacheWrite(file, 100000);
+   Bool_t ok = Check(cache->SetWriteBehind() && cache->IsWriteBehind(), "write-behind mode enabled");
+   TTree *tree = new TTree("T", "T");
+   Int_t id;
+   Double_t x;
+   tree->Branch("id", &id, "id/I", 8000);
+   tree->Branch("x", &x, "x/D", 8000);
+   for (Int_t i = 0; i < nentries; ++i) {
+      id = i;
+      x = i * 0.25;
+      tree->Fill();
+   }
+   tree->Write();
+   delete file;
+   file = TFile::Open(treefile);
+   tree = file ? (TTree*)file->Get("T") : 0;
+   Int_t nbad = -1;
+   if (tree && tree->GetEntries() == nentries) {
+      nbad = 0;
+      tree->SetBranchAddress("id", &id);
+      tree->SetBranchAddress("x", &x);
+      for (Int_t i = 0; i < nentries; ++i) {
+         if (tree->GetEntry(i) <= 0 || id != i || x != i * 0.25) ++nbad;
+      }
+   }
+   ok &= Check(nbad == 0, "tree read back after Close");
+   delete file;
+   gSystem->Unlink(treefile);
+
+   TString text[3];
+   for (Int_t i = 0; i < 3; ++i) text[i] = RandomText(60000, i + 1);
+   file = TFile::Open(keyfile, "RECREATE", "", 0);
+   if (!Check(file && !file->IsZombie(), "writing the key file")) {
+      delete file;
+      return kFALSE;
+   }
+   cache = new TFileCacheWrite(file, 100000);
+   ok &= Check(cache->SetWriteBehind(), "write-behind mode enabled for the keys");
+   TObjString a(text[0]), b(text[1]), c(text[2]);
+   a.Write("a");
+   b.Write("b");
+   TKey *ka = file->GetKey("a");
+   TKey *kb = file->GetKey("b");
+   TKey *kc = 0;
+   Long64_t posa = ka ? ka->GetSeekKey() : 0;
+   Int_t lena = ka ? ka->GetNbytes() : 0;
+   ok &= Check(ka && kb && cache->GetBytesInCache() == lena + kb->GetNbytes(), "first object in flight");
+   char *pending = new char[lena > 0 ? lena : 1];
+   ok &= Check(lena > 0 && !file->ReadBuffers(pending, &posa, &lena, 1), "ReadBuffers of the object in flight");
+   ok &= Check(kb && cache->GetBytesInCache() == kb->GetNbytes(), "ReadBuffers waited for the write");
+   c.Write("c");
+   kc = file->GetKey("c");
+   ok &= Check(kb && kc && cache->GetBytesInCache() == kb->GetNbytes() + kc->GetNbytes(), "second object in flight");
+   ok &= Check(SameText(file, "b", text[1]), "object in flight read back");
+   ok &= Check(kc && cache->GetBytesInCache() == kc->GetNbytes(), "the read waited for the write");
+   ok &= Check(SameText(file, "c", text[2]), "object in the cache read back");
+   ok &= Check(SameText(file, "a", text[0]), "written object read back");
+   file->Close();
+   ok &= Check(!file->TestBit(TFile::kWriteError), "no write error");
+   delete file;
+
+   char *written = new char[lena > 0 ? lena : 1];
+   FILE *fp = fopen(keyfile, "rb");
+   ok &= Check(fp && fseek(fp, posa, SEEK_SET) == 0 && fread(written, 1, lena, fp) == (size_t)lena
+               && memcmp(written, pending, lena) == 0, "ReadBuffers gave the bytes in the file");
+   if (fp) fclose(fp);
+   delete [] written;
+   delete [] pending;
+   file = TFile::Open(keyfile);
+   ok &= Check(file && SameText(file, "a", text[0]) && SameText(file, "b", text[1])
+               && SameText(file, "c", text[2]), "objects read back after Close");
+   delete file;
+
+#ifndef WIN32
+   // Limit the file size so that the write of the second object, done by
+   // the I/O thread, fails while the third object is in the cache.
+   for (Int_t mode = 0; mode < 2; ++mode) {
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+         alarm(60);
+         gErrorIgnoreLevel = kFatal;
+         signal(SIGXFSZ, SIG_IGN);
+         TFile *f = TFile::Open(keyfile, "RECREATE", "", 0);
+         if (!f || f->IsZombie()) _exit(2);
+         TFileCacheWrite *fc = new TFileCacheWrite(f, 100000);
+         if (!fc->SetWriteBehind()) _exit(2);
+         a.Write("a");
+         TKey *k = f->GetKey("a");
+         if (!k) _exit(2);
+         struct rlimit limit;
+         limit.rlim_cur = limit.rlim_max = k->GetSeekKey() + k->GetNbytes() + 1000;
+         if (setrlimit(RLIMIT_FSIZE, &limit) != 0) _exit(2);
+         b.Write("b");
+         c.Write("c");
+         if (f->TestBit(TFile::kWriteError)) _exit(3);
+         Bool_t reported;
+         if (mode == 0) {
+            reported = fc->Flush() && f->TestBit(TFile::kWriteError);
+            f->Close();
+         } else {
+            f->Close();
+            reported = f->TestBit(TFile::kWriteError);
+         }
+         _exit(reported ? 0 : 1);
+      }
+      Int_t status = 0;
+      waitpid(pid, &status, 0);
+      ok &= Check(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                  mode == 0 ? "write error reported by Flush" : "write error reported by Close");
+   }
+#endif
+   gSystem->Unlink(keyfile);
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestRecompressMerge()
+{
+   // Merge files written with compression level 1 with hadd -f6, whose
+   // fast merge recompresses the baskets without unstreaming them, and
+   // read every entry of the result back.
+
+   TString hadd = FindHadd();
+   if (!Check(!hadd.IsNull(), "hadd executable")) return kFALSE;
+
+   const Int_t nfiles = 4;
+   const Int_t nperfile = 20000;
+   TString inputs;
+   Long64_t inputZipBytes = 0;
+   Int_t id, n;
+   Double_t x;
+   Float_t arr[5];
+   for (Int_t f = 0; f < nfiles; ++f) {
+      TString filename = TString::Format("stressIO_recompress%d.root", f);
+      TFile *file = TFile::Open(filename, "RECREATE", "", 1);
+      if (!Check(file && !file->IsZombie(), "writing an input file")) {
+         delete file;
+         return kFALSE;
+      }
+      TTree *tree = new TTree("T", "T");
+      tree->Branch("id", &id, "id/I");
+      tree->Branch("x", &x, "x/D");
+      tree->Branch("n", &n, "n/I");
+      tree->Branch("arr", arr, "arr[n]/F");
+      for (Int_t i = 0; i < nperfile; ++i) {
+         id = f * nperfile + i;
+         x = id * 0.5;
+         n = id % 5;
+         for (Int_t k = 0; k < n; ++k) arr[k] = id + k;
+         tree->Fill();
+      }
+      tree->Write();
+      inputZipBytes += tree->GetZipBytes();
+      delete file;
+      inputs += " " + filename;
+   }
+
+   Int_t status = gSystem->Exec(TString::Format("%s -v 0 -f6 stressIO_recompress.root%s", hadd.Data(), inputs.Data()));
+   Bool_t ok = Check(status == 0, "running hadd -f6");
+   TFile *file = TFile::Open("stressIO_recompress.root");
+   TTree *tree = file ? (TTree*)file->Get("T") : 0;
+   ok &= Check(tree && tree->GetEntries() == nfiles * nperfile, "number of entries");
+   if (tree) {
+      TBranch *b = tree->GetBranch("arr");
+      ok &= Check(b && b->GetCompressionSettings() % 100 == 6, "compression level of the output");
+      ok &= Check(tree->GetZipBytes() != inputZipBytes, "baskets recompressed");
+      tree->SetBranchAddress("id", &id);
+      tree->SetBranchAddress("x", &x);
+      tree->SetBranchAddress("n", &n);
+      tree->SetBranchAddress("arr", arr);
+      Int_t nbad = 0;
+      for (Long64_t i = 0; i < tree->GetEntries(); ++i) {
+         if (tree->GetEntry(i) <= 0 || id != i || x != id * 0.5 || n != id % 5) {
+            ++nbad;
+            continue;
+         }
+         for (Int_t k = 0; k < n; ++k) if (arr[k] != id + k) ++nbad;
+      }
+      ok &= Check(nbad == 0, "entries read back");
+   }
+   delete file;
+
+   gSystem->Unlink("stressIO_recompress.root");
+   for (Int_t f = 0; f < nfiles; ++f)
+      gSystem->Unlink(TString::Format("stressIO_recompress%d.root", f));
+   return ok;
+}
+
+//______________________________________________________________________________
+static void FillBlockTree(TTree *tree, Int_t first, Int_t nentries)
+{
+   // Fill tree, with the branches id and v[100], with the entries first
+   // to first+nentries-1.
+
+   Int_t id;
+   Double_t v[100];
+   tree->ResetBranchAddresses();
+   tree->SetBranchAddress("id", &id);
+   tree->SetBranchAddress("v", v);
+   for (Int_t i = first; i < first + nentries; ++i) {
+      id = i;
+      for (Int_t k = 0; k < 100; ++k) v[k] = i * 100. + k;
+      tree->Fill();
+   }
+   tree->ResetBranchAddresses();
+}
+
+//______________________________________________________________________________
+static Int_t CheckBlockTree(TDirectory *dir, Int_t first, Int_t nentries)
+{
+   // Return the number of wrong entries of the tree T filled by
+   // FillBlockTree in dir, or -1 if it does not have nentries entries.
+
+   TTree *tree = (TTree*)dir->Get("T");
+   if (!tree || tree->GetEntries() != nentries) return -1;
+   Int_t id, nbad = 0;
+   Double_t v[100];
+   tree->SetBranchAddress("id", &id);
+   tree->SetBranchAddress("v", v);
+   for (Int_t i = 0; i < nentries; ++i) {
+      if (tree->GetEntry(i) <= 0 || id != first + i) {
+         ++nbad;
+         continue;
+      }
+      for (Int_t k = 0; k < 100; ++k) if (v[k] != id * 100. + k) ++nbad;
+   }
+   delete tree;
+   return nbad;
+}
+
+//______________________________________________________________________________
+static Bool_t CheckWriteTo(const TMemFile &mem, const char *filename)
+{
+   // Write mem to filename with TMemFile::WriteTo and compare the file with
+   // the content given by TMemFile::CopyTo.
+
+   Long64_t size = mem.GetEND();
+   Int_t fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) return kFALSE;
+   Bool_t ok = mem.WriteTo(fd) == size;
+   ok &= close(fd) == 0;
+   char *expected = new char[size];
+   char *written = new char[size];
+   ok &= mem.CopyTo(expected, size) == size;
+   FILE *fp = fopen(filename, "rb");
+   ok &= fp && fread(written, 1, size, fp) == (size_t)size && fgetc(fp) == EOF;
+   if (fp) fclose(fp);
+   ok &= memcmp(expected, written, size) == 0;
+   delete [] expected;
+   delete [] written;
+   return ok;
+}
+
+//______________________________________________________________________________
+Bool_t TestMemFileWriteTo()
+{
+   // Write a TMemFile spanning several blocks to a file with WriteTo and
+   // read it back, also after loading it in a TMemFile built from a buffer
+   // (whose first block has the size of the buffer). Then upload two
+   // TParallelMergingFile contents to a minimal merging server, which
+   // receives them through the socket (SendContent) and checks them: the
+   // data written to the socket descriptor must be counted as sent.
+
+#ifdef WIN32
+   return kTRUE;
+#else
+   const char *filename = "stressIO_memfile.root";
+   const Int_t nentries = 12000;
+   TMemFile *mem = new TMemFile("stressIO_mem.root", "RECREATE", "", 0);
+   TTree *tree = new TTree("T", "T");
+   Int_t id;
+   Double_t v[100];
+   tree->Branch("id", &id, "id/I");
+   tree->Branch("v", v, "v[100]/D");
+   FillBlockTree(tree, 0, nentries);
+   mem->Write();
+   Long64_t size = mem->GetEND();
+   Bool_t ok = Check(size > 8*1024*1024, "memory file spanning several blocks");
+   ok &= Check(CheckWriteTo(*mem, filename), "WriteTo of the memory file");
+   TFile *file = TFile::Open(filename);
+   ok &= Check(file && CheckBlockTree(file, 0, nentries) == 0, "file written by WriteTo read back");
+   delete file;
+
+   char *content = new char[size];
+   mem->CopyTo(content, size);
+   delete mem;
+   mem = new TMemFile("stressIO_mem.root", content, size, "UPDATE");
+   delete [] content;
+   ok &= Check(CheckWriteTo(*mem, filename), "WriteTo of a memory file built from a buffer");
+   ok &= Check(CheckBlockTree(mem, 0, nentries) == 0, "memory file built from a buffer read back");
+   delete mem;
+
+   // Merging server, in a child process: it writes the total size of the
+   // uploads it received to a file and exits with the number of errors.
+   const char *countfile = "stressIO_pmerge.count";
+   const Int_t nuploads = 2;
+   TServerSocket *ss = new TServerSocket(0, kFALSE);
+   if (!Check(ss->IsValid(), "starting the merging server")) {
+      delete ss;
+      gSystem->Unlink(filename);
+      return kFALSE;
+   }
+   Int_t port = ss->GetLocalPort();
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0) {
+      alarm(120);
+      TSocket *s = ss->Accept();
+      if (!s || s == (TSocket*)-1) _exit(100);
+      s->Send(0, 0);   // client index
+      s->Send(1, 1);   // protocol version, without shared memory
+      Int_t nerrors = 0, nreceived = 0;
+      Long64_t total = 0;
+      while (1) {
+         TMessage *mess = 0;
+         if (s->Recv(mess) <= 0 || !mess) {
+            ++nerrors;
+            break;
+         }
+         if (mess->What() == kMESS_STRING) {
+            delete mess;
+            break;
+         }
+         Int_t clientId;
+         TString name;
+         TMemFile *upload = mess->What() == kMESS_ANY ? TParallelMergingFile::ReadUpload(s, mess, clientId, name) : 0;
+         if (!upload || clientId != 0 || CheckBlockTree(upload, nreceived * nentries, nentries) != 0) ++nerrors;
+         if (upload) total += upload->GetEND();
+         ++nreceived;
+         delete upload;
+         delete mess;
+      }
+      if (nreceived != nuploads) ++nerrors;
+      FILE *fp = fopen(countfile, "w");
+      if (fp) {
+         fprintf(fp, "%lld\n", total);
+         fclose(fp);
+      }
+      delete s;
+      _exit(nerrors);
+   }
+   delete ss;
+
+   ULong64_t sent = TSocket::GetSocketBytesSent();
+   Int_t level = gErrorIgnoreLevel;
+   gErrorIgnoreLevel = kWarning;
+   TParallelMergingFile *pfile = new TParallelMergingFile(TString::Format("stressIO_pmerge.root?pmerge=localhost:%d", port),
+                                                          "RECREATE", "", 0);
+   tree = new TTree("T", "T");
+   tree->Branch("id", &id, "id/I");
+   tree->Branch("v", v, "v[100]/D");
+   for (Int_t u = 0; u < nuploads; ++u) {
+      FillBlockTree(tree, u * nentries, nentries);
+      pfile->Write();
+   }
+   delete pfile;
+   gErrorIgnoreLevel = level;
+   sent = TSocket::GetSocketBytesSent() - sent;
+
+   Int_t status = 0;
+   waitpid(pid, &status, 0);
+   ok &= Check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "uploads received by the merging server");
+   Long64_t total = 0;
+   FILE *fp = fopen(countfile, "r");
+   ok &= Check(fp && fscanf(fp, "%lld", &total) == 1 && total > 0, "size of the uploads");
+   if (fp) fclose(fp);
+   ok &= Check(sent >= (ULong64_t)total && sent < (ULong64_t)total + 4096, "uploaded data counted as sent");
+
+   gSystem->Unlink(countfile);
+   gSystem->Unlink(filename);
+   return ok;
+#endif
+}
+
+//______________________________________________________________________________
+static Bool_t SameObject(TObject *obj1, TObject *obj2)
+{
+   // Return whether obj1 and obj2 are both null, or are TNamed of the same
+   // class with the same name and title.
+
+   if (!obj1 || !obj2) return obj1 == obj2;
+   TNamed *n1 = dynamic_cast<TNamed*>(obj1);
+   TNamed *n2 = dynamic_cast<TNamed*>(obj2);
+   return obj1->IsA() == obj2->IsA() && n1 && n2
+      && !strcmp(n1->GetName(), n2->GetName()) && !strcmp(n1->GetTitle(), n2->GetTitle());
+}
+
+//______________________________________________________________________________
+Bool_t TestReadObjects()
+{
+   // Read a list of keys with TDirectoryFile::ReadObjects, with and
+   // without threads, and compare each object with the one given by Get:
+   // compressed and uncompressed records, several cycles of a name, a
+   // name given twice and a missing key.
+
+   const char *filename = "stressIO_readobjects.root";
+   const Int_t nobjects = 40;
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   TRandom3 rnd(7);
+   for (Int_t i = 0; i < nobjects; ++i) {
+      // Short titles give records too small to be compressed.
+      Int_t length = i % 4 ? 5000 + 1000 * i : 10;
+      TString title;
+      for (Int_t k = 0; k < length; ++k) title += (char)('a' + (Int_t)(4 * rnd.Rndm()));
+      TNamed named(TString::Format("obj%d", i).Data(), title.Data());
+      named.Write();
+      if (i % 10 == 3) {
+         named.SetTitle(TString::Format("second cycle of obj%d", i));
+         named.Write();
+      }
+   }
+   delete file;
+
+   std::vector<TString> names;
+   for (Int_t i = nobjects - 1; i >= 0; --i) names.push_back(TString::Format("obj%d", i));
+   names.push_back("obj3;1");
+   names.push_back("obj13;2");
+   names.push_back("obj5");
+   names.push_back("missing");
+   Int_t n = names.size();
+   std::vector<const char*> namecycles(n);
+   for (Int_t i = 0; i < n; ++i) namecycles[i] = names[i].Data();
+
+   file = TFile::Open(filename);
+   Bool_t ok = Check(file != 0, "opening the file");
+   for (Int_t pass = 0; pass < 2 && file; ++pass) {
+      std::vector<TObject*> objects(n, (TObject*)0);
+      Int_t nread = file->ReadObjects(n, &namecycles[0], &objects[0], pass == 0 ? 0 : 4);
+      Int_t ndiff = 0;
+      for (Int_t i = 0; i < n; ++i) {
+         TObject *obj = file->Get(namecycles[i]);
+         if (!SameObject(objects[i], obj)) ++ndiff;
+         delete obj;
+         delete objects[i];
+      }
+      ok &= Check(nread == n - 1, pass == 0 ? "number of objects read without threads" : "number of objects read with threads");
+      ok &= Check(ndiff == 0, pass == 0 ? "same objects as Get without threads" : "same objects as Get with threads");
+   }
+   delete file;
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+static Bool_t WriteFriendFile(const char *filename, const char *branch, Long64_t autoflush,
+                              Int_t nentries, Double_t scale)
+{
+   // Write the tree T with the branch (Double_t) holding scale*entry,
+   // clustered every autoflush entries.
+
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!file || file->IsZombie()) {
+      delete file;
+      return kFALSE;
+   }
+   TTree *tree = new TTree("T", "T");
+   Double_t value;
+   tree->Branch(branch, &value, TString::Format("%s/D", branch));
+   tree->SetAutoFlush(autoflush);
+   for (Int_t i = 0; i < nentries; ++i) {
+      value = scale * i;
+      tree->Fill();
+   }
+   tree->Write();
+   delete file;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+static Int_t ReadWithFriend(const char *parentname, const char *friendname, Bool_t aligned,
+                            const std::vector<Long64_t> &entries, std::vector<Double_t> &values)
+{
+   // Read the given entries of the tree T of parentname, with the tree T
+   // of friendname as friend F (declared aligned if requested), and store
+   // x and y of each entry in values. Return -1 if the friend could not
+   // be added (or declared aligned), 0 otherwise.
+
+   values.clear();
+   TFile *file = TFile::Open(parentname);
+   TTree *tree = file ? (TTree*)file->Get("T") : 0;
+   TFriendElement *fe = tree ? tree->AddFriend("F=T", friendname) : 0;
+   if (!fe || (aligned && !fe->SetAligned())) {
+      delete file;
+      return -1;
+   }
+   tree->SetCacheSize(1000000);
+   Double_t x = -1, y = -1;
+   tree->SetBranchAddress("x", &x);
+   tree->SetBranchAddress("y", &y);
+   for (size_t i = 0; i < entries.size(); ++i) {
+      tree->GetEntry(entries[i]);
+      values.push_back(x);
+      values.push_back(y);
+   }
+   delete file;
+   return 0;
+}
+
+//______________________________________________________________________________
+Bool_t TestAlignedFriend()
+{
+   // Read a tree with a friend declared aligned (TFriendElement::kAligned)
+   // and without the flag, sequentially and in a scattered order, and
+   // compare the values. A friend whose clusters differ must not be
+   // accepted as aligned.
+
+   const Int_t nentries = 20000;
+   Bool_t ok = Check(WriteFriendFile("stressIO_parent.root", "x", 1000, nentries, 1.)
+                     && WriteFriendFile("stressIO_friend.root", "y", 1000, nentries, 0.5)
+                     && WriteFriendFile("stressIO_friend2.root", "y", 700, nentries, 0.5),
+                     "writing the files");
+
+   std::vector<Long64_t> entries;
+   for (Long64_t i = 0; i < nentries; ++i) entries.push_back(i);
+   for (Long64_t i = 0; i < nentries; i += 97) entries.push_back((i * 7919) % nentries);
+   entries.push_back(nentries - 1);
+   entries.push_back(0);
+
+   std::vector<Double_t> plain, aligned;
+   ok &= Check(ReadWithFriend("stressIO_parent.root", "stressIO_friend.root", kFALSE, entries, plain) == 0,
+               "reading with a friend");
+   ok &= Check(ReadWithFriend("stressIO_parent.root", "stressIO_friend.root", kTRUE, entries, aligned) == 0,
+               "reading with an aligned friend");
+   Int_t nbad = 0;
+   for (size_t i = 0; i < entries.size() && plain.size() == 2 * entries.size(); ++i) {
+      if (plain[2*i] != entries[i] || plain[2*i+1] != 0.5 * entries[i]) ++nbad;
+   }
+   ok &= Check(plain.size() == 2 * entries.size() && nbad == 0, "values read without the flag");
+   ok &= Check(aligned == plain, "same values with the aligned friend");
+
+   Int_t level = gErrorIgnoreLevel;
+   gErrorIgnoreLevel = kError;
+   ok &= Check(ReadWithFriend("stressIO_parent.root", "stressIO_friend2.root", kTRUE, entries, aligned) == -1,
+               "friend with other clusters refused");
+   gErrorIgnoreLevel = level;
+
+   gSystem->Unlink("stressIO_parent.root");
+   gSystem->Unlink("stressIO_friend.root");
+   gSystem->Unlink("stressIO_friend2.root");
+   return ok;
+}
+
+//______________________________________________________________________________
+static Int_t ReadChainEntries(Int_t nfiles, Bool_t async, const std::vector<Long64_t> &entries,
+                              std::vector<Double_t> &values)
+{
+   // Read the given entries of the chain of the trees T of the files
+   // stressIO_chain<i>.root, with or without the asynchronous open of the
+   // next file, and store x and the tree number of each entry in values.
+   // Return the number of entries that could not be read.
+
+   values.clear();
+   TChain chain("T");
+   for (Int_t i = 0; i < nfiles; ++i) {
+      chain.Add(TString::Format("stressIO_chain%d.root", i));
+   }
+   if (async) chain.SetAsyncOpen();
+   Double_t x = -1;
+   chain.SetBranchAddress("x", &x);
+   Int_t nbad = 0;
+   for (size_t i = 0; i < entries.size(); ++i) {
+      x = -1;
+      if (chain.GetEntry(entries[i]) <= 0) ++nbad;
+      values.push_back(x);
+      values.push_back(chain.GetTreeNumber());
+   }
+   return nbad;
+}
+
+//______________________________________________________________________________
+Bool_t TestChainAsyncOpen()
+{
+   // Read a chain of local files with TChain::SetAsyncOpen, for which the
+   // open of the next file falls back to a synchronous open, and without
+   // it: sequentially, then jumping back and forth between the files (so
+   // that the pending open is discarded), and compare the entries.
+
+   const Int_t nfiles = 4;
+   const Int_t sizes[nfiles] = { 3000, 1, 2500, 4000 };
+   Bool_t ok = kTRUE;
+   std::vector<Long64_t> first;
+   Long64_t nentries = 0;
+   for (Int_t i = 0; i < nfiles; ++i) {
+      ok &= Check(WriteFriendFile(TString::Format("stressIO_chain%d.root", i), "x", 1000, sizes[i], i + 1),
+                  "writing the files");
+      first.push_back(nentries);
+      nentries += sizes[i];
+   }
+
+   std::vector<Long64_t> entries;
+   for (Long64_t i = 0; i < nentries; ++i) entries.push_back(i);
+   for (Long64_t i = 0; i < nentries; i += 37) entries.push_back((i * 7919) % nentries);
+   entries.push_back(first[3]);
+   entries.push_back(first[0]);
+   entries.push_back(first[2] - 1);
+   entries.push_back(first[1]);
+
+   std::vector<Double_t> plain, async;
+   ok &= Check(ReadChainEntries(nfiles, kFALSE, entries, plain) == 0, "reading without the option");
+   ok &= Check(ReadChainEntries(nfiles, kTRUE, entries, async) == 0, "reading with SetAsyncOpen");
+   Int_t nbad = 0;
+   for (size_t i = 0; i < entries.size() && plain.size() == 2 * entries.size(); ++i) {
+      Int_t k = nfiles - 1;
+      while (entries[i] < first[k]) --k;
+      if (plain[2*i] != (k + 1) * (entries[i] - first[k]) || plain[2*i+1] != k) ++nbad;
+   }
+   ok &= Check(plain.size() == 2 * entries.size() && nbad == 0, "entries read without the option");
+   ok &= Check(async == plain, "same entries with SetAsyncOpen");
+
+   for (Int_t i = 0; i < nfiles; ++i) {
+      gSystem->Unlink(TString::Format("stressIO_chain%d.root", i));
+   }
+   return ok;
+}
+
+//______________________________________________________________________________
+static Int_t CheckKeyLookup(TDirectory *dir, Int_t nnames)
+{
+   // Look up the keys written by TestKeyLookup in dir, with every cycle,
+   // through GetKey, Get, GetObjectChecked, FindKeyAny and FindObjectAny,
+   // and return the number of wrong results.
+
+   Int_t nbad = 0;
+   for (Int_t i = 0; i < nnames; ++i) {
+      TString name = TString::Format("k%d", i);
+      Int_t ncycles = i % 4 + 1;
+      for (Int_t cycle = 0; cycle <= ncycles + 1; ++cycle) {
+         // Cycle 2 of the names with 4 cycles was deleted.
+         Bool_t exists = cycle >= 1 && cycle <= ncycles && !(ncycles == 4 && cycle == 2);
+         Int_t below = cycle > ncycles ? ncycles : cycle;
+         if (ncycles == 4 && below == 2) below = 1;
+
+         TKey *key = dir->GetKey(name, cycle);
+         if (below ? !key || key->GetCycle() != below : key != 0) ++nbad;
+
+         // The title of each object is its name and cycle.
+         TString namecycle = TString::Format("%s;%d", name.Data(), cycle);
+         TNamed *named = (TNamed*)dir->Get(namecycle);
+         if (exists ? !named || namecycle != named->GetTitle() : named != 0) ++nbad;
+         delete named;
+         named = (TNamed*)dir->GetObjectChecked(namecycle, TNamed::Class());
+         if (exists ? !named || namecycle != named->GetTitle() : named != 0) ++nbad;
+         delete named;
+      }
+      TString title = TString::Format("%s;%d", name.Data(), ncycles);
+      TNamed *named = (TNamed*)dir->Get(name);
+      if (!named || title != named->GetTitle()) ++nbad;
+      delete named;
+      TKey *key = dir->FindKeyAny(name);
+      if (!key || key->GetCycle() != ncycles) ++nbad;
+      named = (TNamed*)dir->FindObjectAny(name);
+      if (!named || title != named->GetTitle()) ++nbad;
+      delete named;
+   }
+
+   // Missing names, in this directory and below.
+   if (dir->GetKey("missing") || dir->Get("missing") || dir->Get("missing;1")) ++nbad;
+   if (dir->GetObjectChecked("missing", TNamed::Class())) ++nbad;
+   if (dir->FindKeyAny("missing") || dir->FindObjectAny("missing")) ++nbad;
+
+   // A name only known to the subdirectory.
+   TKey *key = dir->FindKeyAny("inner");
+   if (!key || strcmp(key->GetMotherDir()->GetName(), "sub")) ++nbad;
+   TNamed *named = (TNamed*)dir->FindObjectAny("inner");
+   if (!named || strcmp(named->GetTitle(), "inner;1")) ++nbad;
+   delete named;
+   if (dir->GetKey("inner") || dir->Get("inner")) ++nbad;
+   return nbad;
+}
+
+//______________________________________________________________________________
+Bool_t TestKeyLookup()
+{
+   // Look up the keys of a directory with many names, most of them with
+   // several cycles (with a gap for some), in the directory being written
+   // and after reading it back (where the hash table is sized from the
+   // number of keys), and check the cycle semantics of each accessor.
+
+   const char *filename = "stressIO_lookup.root";
+   const Int_t nnames = 500;
+   TFile *file = TFile::Open(filename, "RECREATE");
+   if (!Check(file && !file->IsZombie(), "writing the file")) {
+      delete file;
+      return kFALSE;
+   }
+   for (Int_t i = 0; i < nnames; ++i) {
+      TString name = TString::Format("k%d", i);
+      for (Int_t cycle = 1; cycle <= i % 4 + 1; ++cycle) {
+         TNamed named(name, TString::Format("%s;%d", name.Data(), cycle));
+         named.Write();
+      }
+      if (i % 4 == 3) file->Delete(name + ";2");
+   }
+   TDirectory *sub = file->mkdir("sub");
+   sub->cd();
+   TNamed inner("inner", "inner;1");
+   inner.Write();
+   file->cd();
+
+   Bool_t ok = Check(file->GetNkeys() == nnames * 9 / 4 + 1, "number of keys written");
+   ok &= Check(CheckKeyLookup(file, nnames) == 0, "lookup in the directory being written");
+   delete file;
+
+   Bool_t lazy = TDirectoryFile::GetLazyKeys();
+   TDirectoryFile::SetLazyKeys(kFALSE);
+   file = TFile::Open(filename);
+   ok &= Check(file && !file->IsZombie(), "opening the file");
+   if (file && !file->IsZombie()) {
+      ok &= Check(file->GetNkeys() == nnames * 9 / 4 + 1, "number of keys read");
+      ok &= Check(CheckKeyLookup(file, nnames) == 0, "lookup in the directory read back");
+   }
+   delete file;
+   TDirectoryFile::SetLazyKeys(lazy);
+   gSystem->Unlink(filename);
+   return ok;
+}
+
+//______________________________________________________________________________
+static Int_t RenameInFile(const char *filename, const char *from, const char *to)
+{
+   // Replace every occurrence of from by to, of the same length, in the
+   // bytes of the file. Return the number of replacements, -1 on error.
+
+   std::string content;
+   {
+      std::ifstream in(filename, std::ios::binary);
+      if (!in) return -1;
+      std::ostringstream os;
+      os << in.rdbuf();
+      content = os.str();
+   }
+   size_t len = strlen(from);
+   if (len != strlen(to)) return -1;
+   Int_t n = 0;
+   for (size_t pos = content.find(from); pos != std::string::npos; pos = content.find(from, pos + len)) {
+      content.replace(pos, len, to);
+      ++n;
+   }
+   std::ofstream out(filename, std::ios::binary);
+   out.write(content.data(), content.size());
+   return out ? n : -1;
+}
+
+//______________________________________________________________________________
+static Bool_t WriteDemandFile(const char *filename, Bool_t lost, Int_t nentries)
+{
+   // Write a TNamed, a tree T with the branch "old." of DemandOld objects
+   // (or "lost." of DemandLive objects) and one such object in the key
+   // "key", uncompressed, then rename the class in the file to DemandNew
+   // (or DemandLost).
+
+   TFile *file = TFile::Open(filename, "RECREATE", "", 0);
+   if (!file || file->IsZombie()) {
+      delete file;
+      return kFALSE;
+   }
+   TNamed named("named", "title");
+   named.Write();
+   TTree *tree = new TTree("T", "T");
+   DemandOld old, *pold = &old;
+   DemandLive live, *plive = &live;
+   if (lost) tree->Branch("lost.", "DemandLive", &plive);
+   else      tree->Branch("old.", "DemandOld", &pold);
+   for (Int_t i = 0; i < nentries; ++i) {
+      old.fA = i;
+      old.fB = 0.5 * i;
+      old.fOld = -i;
+      live.fX = 3 * i;
+      live.fY = 0.25 * i;
+      tree->Fill();
+   }
+   tree->Write();
+   if (lost) file->WriteObjectAny(plive, DemandLive::Class(), "key");
+   else      file->WriteObjectAny(pold, DemandOld::Class(), "key");
+   delete file;
+   if (lost) return RenameInFile(filename, "DemandLive", "DemandLost") > 0;
+   return RenameInFile(filename, "DemandOld", "DemandNew") > 0;
+}
+
+//______________________________________________________________________________
+static Int_t ReadOldVersionFile(const char *filename, Int_t nentries, Bool_t ondemand)
+{
+   // Read the file written by WriteDemandFile with version 2 of DemandNew:
+   // the tree first, then the key. Return the number of wrong values or
+   // states of the StreamerInfo record.
+
+   TFile *file = TFile::Open(filename);
+   if (!file || file->IsZombie()) {
+      delete file;
+      return 1;
+   }
+   Int_t nbad = 0;
+   if (file->IsStreamerInfoPending() != ondemand) ++nbad;
+   // A class whose version is the one in memory does not need the record.
+   TNamed *named = (TNamed*)file->Get("named");
+   if (!named || strcmp(named->GetTitle(), "title")) ++nbad;
+   delete named;
+   if (file->IsStreamerInfoPending() != ondemand) ++nbad;
+
+   TTree *tree = (TTree*)file->Get("T");
+   DemandNew *obj = new DemandNew;
+   if (!tree || tree->SetBranchAddress("old.", &obj) < 0) {
+      ++nbad;
+   } else {
+      for (Int_t i = 0; i < nentries; ++i) {
+         if (tree->GetEntry(i) <= 0 || obj->fA != i || obj->fB != 0.5 * i || obj->fC != 42) ++nbad;
+      }
+   }
+   if (file->IsStreamerInfoPending()) ++nbad;
+
+   DemandNew *key = (DemandNew*)file->GetObjectChecked("key", DemandNew::Class());
+   if (!key || key->fA != nentries - 1 || key->fB != 0.5 * (nentries - 1) || key->fC != 42) ++nbad;
+   delete key;
+   delete file;
+   delete obj;
+   return nbad;
+}
+
+//______________________________________________________________________________
+static Int_t ReadLostClassFile(const char *filename, Int_t nentries, Bool_t ondemand)
+{
+   // Read the file written by WriteDemandFile with DemandLost, which has
+   // no dictionary: the key first, then the tree. Return the number of
+   // wrong values or states of the StreamerInfo record.
+
+   TFile *file = TFile::Open(filename);
+   if (!file || file->IsZombie()) {
+      delete file;
+      return 1;
+   }
+   Int_t nbad = 0;
+   if (file->IsStreamerInfoPending() != ondemand) ++nbad;
+
+   TKey *key = file->GetKey("key");
+   void *obj = key ? key->ReadObjectAny(0) : 0;
+   TClass *cl = TClass::GetClass("DemandLost");
+   TVirtualStreamerInfo *info = cl ? cl->GetStreamerInfo(1) : 0;
+   if (!obj || !info || cl->IsLoaded()) {
+      ++nbad;
+   } else {
+      Int_t x = *(Int_t*)((char*)obj + info->GetOffset("fX"));
+      Double_t y = *(Double_t*)((char*)obj + info->GetOffset("fY"));
+      if (x != 3 * (nentries - 1) || y != 0.25 * (nentries - 1)) ++nbad;
+   }
+   if (obj && cl) cl->Destructor(obj);
+   if (file->IsStreamerInfoPending()) ++nbad;
+
+   TTree *tree = (TTree*)file->Get("T");
+   TLeaf *lx = tree ? tree->GetLeaf("lost.fX") : 0;
+   TLeaf *ly = tree ? tree->GetLeaf("lost.fY") : 0;
+   if (!lx || !ly) {
+      ++nbad;
+   } else {
+      for (Int_t i = 0; i < nentries; ++i) {
+         if (tree->GetEntry(i) <= 0 || lx->GetValue() != 3 * i || ly->GetValue() != 0.25 * i) ++nbad;
+      }
+   }
+   delete file;
+   return nbad;
+}
+
+//______________________________________________________________________________
+Bool_t TestStreamerInfoOnDemand()
+{
+   // Read files holding an older version of a class and a class without
+   // dictionary with the StreamerInfo record read on demand (twice, the
+   // second time the record is known to the process) and read when the
+   // file is opened. The record must stay pending until one of these
+   // classes is met, and the objects must be the same in all cases.
+
+   const Int_t nentries = 1000;
+   Bool_t ok = Check(WriteDemandFile("stressIO_demandold.root", kFALSE, nentries)
+                     && WriteDemandFile("stressIO_demandlost.root", kTRUE, nentries),
+                     "writing the files");
+
+   Bool_t ondemand = TFile::GetReadStreamerInfoOnDemand();
+   Int_t envdemand = gEnv->GetValue("TFile.ReadStreamerInfoOnDemand", 0);
+   gEnv->SetValue("TFile.ReadStreamerInfoOnDemand", 0);
+   // The emulation of DemandLost is reported with a warning.
+   Int_t level = gErrorIgnoreLevel;
+   gErrorIgnoreLevel = kError;
+   for (Int_t pass = 0; pass < 3; ++pass) {
+      Bool_t demand = pass < 2;
+      TFile::SetReadStreamerInfoOnDemand(demand);
+      ok &= Check(ReadOldVersionFile("stressIO_demandold.root", nentries, demand) == 0,
+                  demand ? "older class version read on demand" : "older class version");
+      ok &= Check(ReadLostClassFile("stressIO_demandlost.root", nentries, demand) == 0,
+                  demand ? "class without dictionary read on demand" : "class without dictionary");
+   }
+   gErrorIgnoreLevel = level;
+   TFile::SetReadStreamerInfoOnDemand(ondemand);
+   gEnv->SetValue("TFile.ReadStreamerInfoOnDemand", envdemand);
+
+   gSystem->Unlink("stressIO_demandold.root");
+   gSystem->Unlink("stressIO_demandlost.root");
+   return ok;
+}
+
+typedef Bool_t (*StressIOTest_t)();
+
+struct StressIOEntry_t {
+   const char     *fTitle;
+   StressIOTest_t  fTest;
+};
+
+static StressIOEntry_t gStressIOTests[] = {
+   { "Read rule on a member not at the start of the object", TestReadRule },
+   { "TTreeHashIndex side file round trip", TestHashIndexSideFile },
+   { "TTreeHashIndex truncated or corrupted side file", TestHashIndexCorrupted },
+   { "Access profile of a chain applied to a copy", TestAccessProfile },
+   { "FillBulk and Fill layouts, AutoFlush in entries", TestFillBulkEntries },
+   { "FillBulk and Fill layouts, AutoFlush in bytes", TestFillBulkBytes },
+   { "TWebFile parallel multi-range requests", TestWebFileRanges },
+   { "TSharedMapFile concurrent updates, growth, RECREATE", TestSharedMapFile },
+   { "Lazy loading of a directory with many keys", TestLazyKeys },
+   { "TBufferFileMap entries and object graph round trip", TestBufferFileMap },
+   { "TBufferPool blocks, buffers, keys and baskets", TestBufferPool },
+   { "Fast merge coalescing small clusters", TestReclusterMerge },
+   { "Vectors of vectors read into the same object", TestVectorOfVector },
+   { "Byte swapping of arrays", TestByteSwapArrays },
+   { "hadd -j compared with a sequential hadd", TestHaddParallel },
+   { "TTreeCache::PrefetchEntries of scattered entries", TestPrefetchEntries },
+   { "Object larger than a compression block, damaged blocks", TestLargeKeyUnzip },
+   { "TFileCacheWrite write-behind, pending reads, errors", TestWriteBehind },
+   { "hadd -f6 of files compressed with level 1", TestRecompressMerge },
+   { "TMemFile::WriteTo and TParallelMergingFile uploads", TestMemFileWriteTo },
+   { "TDirectoryFile::ReadObjects compared with Get", TestReadObjects },
+   { "Aligned friend compared with a plain friend", TestAlignedFriend },
+   { "TChain::SetAsyncOpen with local files", TestChainAsyncOpen },
+   { "Key lookup through the hash buckets", TestKeyLookup },
+   { "StreamerInfo record read on demand", TestStreamerInfoOnDemand },
+   { 0, 0 }
+};
+
+//______________________________________________________________________________
+int main(int argc, char *argv[])
+{
+   gROOT->SetBatch();
+   Int_t which = argc > 1 ? atoi(argv[1]) : 0;
+
+   Int_t nfailed = 0;
+   for (Int_t i = 0; gStressIOTests[i].fTitle; ++i) {
+      if (which && which != i+1) continue;
+      Bool_t ok = gStressIOTests[i].fTest();
+      TString line = TString::Format("Test %2d: %s ", i+1, gStressIOTests[i].fTitle);
+      while (line.Length() < 68) line += ".";
+      printf("%s %s\n", line.Data(), ok ? "OK" : "FAILED");
+      if (!ok) ++nfailed;
+   }
+   return nfailed ? 1 : 0;
+}
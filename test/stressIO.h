@@ -0,0 +1,90 @@
+// @(#)root/test:$Id$
+
+#ifndef ROOT_stressIO
+#define ROOT_stressIO
+
+#ifndef ROOT_Rtypes
+#include "Rtypes.h"
+#endif
+
+#include <vector>
+
+// Classes used by stressIO.
+
+//______________________________________________________________________________
+// Version 2 of EvoRule had only fA and fB. The read rule declared in
+// stressIOLinkDef.h computes fSum, which is not at the start of the object,
+// from the version 2 members. fGuard is not set by the rule and must keep
+// its default value.
+class EvoRule {
+public:
+   Int_t    fA;
+   Double_t fB;
+   Double_t fSum;
+   Int_t    fGuard;
+
+   EvoRule() : fA(0), fB(0), fSum(-1), fGuard(12345) { }
+   virtual ~EvoRule() { }
+
+   ClassDef(EvoRule,3)  // Class with a read rule for its version 2
+};
+
+//______________________________________________________________________________
+// Vectors of vectors of numbers, read by the specialised object-wise
+// action of TStreamerInfoActions.
+class VecOfVec {
+public:
+   std::vector<std::vector<Float_t> > fF;
+   std::vector<std::vector<Int_t> >   fI;
+
+   VecOfVec() { }
+   virtual ~VecOfVec() { }
+
+   ClassDef(VecOfVec,1)  // Vectors of vectors of numbers
+};
+
+//______________________________________________________________________________
+// DemandOld is written under the name DemandNew: the file then holds
+// version 2 of DemandNew, where fB was a Float_t and fOld still existed.
+class DemandOld {
+public:
+   Int_t    fA;
+   Float_t  fB;
+   Int_t    fOld;
+
+   DemandOld() : fA(0), fB(0), fOld(0) { }
+   virtual ~DemandOld() { }
+
+   ClassDef(DemandOld,2)  // Version 2 of DemandNew
+};
+
+//______________________________________________________________________________
+// Version 3, read from the files holding version 2. fC is not on file and
+// must keep its default value.
+class DemandNew {
+public:
+   Int_t    fA;
+   Double_t fB;
+   Int_t    fC;
+
+   DemandNew() : fA(0), fB(0), fC(42) { }
+   virtual ~DemandNew() { }
+
+   ClassDef(DemandNew,3)  // Class read from an older version
+};
+
+//______________________________________________________________________________
+// DemandLive is written under the name DemandLost, a class without
+// dictionary when the file is read.
+class DemandLive {
+public:
+   Int_t    fX;
+   Double_t fY;
+
+   DemandLive() : fX(0), fY(0) { }
+   virtual ~DemandLive() { }
+
+   ClassDef(DemandLive,1)  // Class written under the name of a class without dictionary
+};
+
+#endif
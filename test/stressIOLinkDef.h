@@ -0,0 +1,19 @@
+#ifdef __CINT__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ class EvoRule+;
+#pragma link C++ class VecOfVec+;
+#pragma link C++ class DemandOld+;
+#pragma link C++ class DemandNew+;
+#pragma link C++ class DemandLive+;
+#pragma link C++ class vector<vector<float> >+;
+#pragma link C++ class vector<vector<int> >+;
+
+#pragma read sourceClass="EvoRule" targetClass="EvoRule" version="[2]" \
+   source="Int_t fA; Double_t fB" target="fSum" \
+   code="{ fSum = onfile.fA + 10*onfile.fB; }"
+
+#endif
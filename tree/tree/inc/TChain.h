@@ -26,6 +26,7 @@
 #endif
 
 class TFile;
+class TFileOpenHandle;
 class TBrowser;
 class TCut;
 class TEntryList;
@@ -45,13 +46,17 @@ protected:
    TObjArray   *fFiles;            //-> List of file names containing the trees (TChainElement, owned)
    TList       *fStatus;           //-> List of active/inactive branches (TChainElement, owned)
    TChain      *fProofChain;       //! chain proxy when going to be processed by PROOF
+   TFileOpenHandle *fNextFileHandle; //! Pending asynchronous open of the next file (see SetAsyncOpen)
+   Int_t        fNextFileNumber;   //! Tree number of the file opened via fNextFileHandle
 
 private:
    TChain(const TChain&);            // not implemented
    TChain& operator=(const TChain&); // not implemented
 
 protected:
+   void CancelNextFile();
    void InvalidateCurrentTree();
+   void OpenNextFile();
    void ReleaseChainProof();
 
 public:
@@ -61,6 +66,7 @@ public:
       kAutoDelete     = BIT(16),
       kProofUptodate  = BIT(17),
       kProofLite      = BIT(18),
+      kAsyncOpen      = BIT(19),
       kBigNumber      = 1234567890
    };
 
@@ -140,6 +146,7 @@ public:
    virtual void      ResetBranchAddress(TBranch *);
    virtual void      ResetBranchAddresses();
    virtual Long64_t  Scan(const char *varexp="", const char *selection="", Option_t *option="", Long64_t nentries=1000000000, Long64_t firstentry=0); // *MENU*
+   virtual void      SetAsyncOpen(Bool_t on=kTRUE);
    virtual void      SetAutoDelete(Bool_t autodel=kTRUE);
 #if !defined(__CINT__)
    virtual Int_t     SetBranchAddress(const char *bname,void *add, TBranch **ptr = 0);
@@ -45,7 +45,7 @@ protected:
    TFriendElement& operator=(const TFriendElement&);
 
 public:
-   enum { kFromChain = BIT(11) };
+   enum { kFromChain = BIT(11), kAligned = BIT(12) };
    TFriendElement();
    TFriendElement(TTree *tree, const char *treename, const char *filename);
    TFriendElement(TTree *tree, const char *treename, TFile *file);
@@ -57,7 +57,9 @@ public:
    virtual TTree      *GetParentTree() const {return fParentTree;}
    virtual TTree      *GetTree();
    virtual const char *GetTreeName() const {return fTreeName.Data();}
+           Bool_t      IsAligned() const {return TestBit(kAligned);}
    virtual void        ls(Option_t *option="") const;
+   virtual Bool_t      SetAligned(Bool_t aligned = kTRUE);
 
    ClassDef(TFriendElement,2)  //A friend element of another TTree
 };
@@ -61,8 +61,10 @@ public:
    virtual ~TLeaf();
 
    virtual void     Browse(TBrowser* b);
+   virtual Bool_t   CanFillBasketBulk() const { return kFALSE; }
    virtual void     Export(TClonesArray*, Int_t) {}
    virtual void     FillBasket(TBuffer& b);
+   virtual void     FillBasketBulk(TBuffer& b, const void* data, Int_t nentries);
    TBranch         *GetBranch() const { return fBranch; }
    virtual TLeaf   *GetLeafCount() const { return fLeafCount; }
    virtual TLeaf   *GetLeafCounter(Int_t& countval) const;
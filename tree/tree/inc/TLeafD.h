@@ -38,8 +38,10 @@ public:
    TLeafD(TBranch *parent, const char *name, const char *type);
    virtual ~TLeafD();
 
+   virtual Bool_t  CanFillBasketBulk() const { return kTRUE; }
    virtual void    Export(TClonesArray *list, Int_t n);
    virtual void    FillBasket(TBuffer &b);
+   virtual void    FillBasketBulk(TBuffer &b, const void *data, Int_t nentries);
    const char     *GetTypeName() const {return "Double_t";}
    Double_t        GetValue(Int_t i=0) const;
    virtual void   *GetValuePointer() const {return fValue;}
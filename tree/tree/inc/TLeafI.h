@@ -38,9 +38,11 @@ public:
    TLeafI();
    TLeafI(TBranch *parent, const char *name, const char *type);
    virtual ~TLeafI();
+   virtual Bool_t  CanFillBasketBulk() const { return kTRUE; }
    
    virtual void    Export(TClonesArray *list, Int_t n);
    virtual void    FillBasket(TBuffer &b);
+   virtual void    FillBasketBulk(TBuffer &b, const void *data, Int_t nentries);
    const char     *GetTypeName() const;
    virtual Int_t   GetMaximum() const {return fMaximum;}
    virtual Int_t   GetMinimum() const {return fMinimum;}
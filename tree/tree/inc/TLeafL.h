@@ -39,8 +39,10 @@ public:
    TLeafL(TBranch *parent, const char *name, const char *type);
    virtual ~TLeafL();
 
+   virtual Bool_t  CanFillBasketBulk() const { return kTRUE; }
    virtual void    Export(TClonesArray *list, Int_t n);
    virtual void    FillBasket(TBuffer &b);
+   virtual void    FillBasketBulk(TBuffer &b, const void *data, Int_t nentries);
    const char     *GetTypeName() const;
    virtual Int_t   GetMaximum() const {return (Int_t)fMaximum;}
    virtual Int_t   GetMinimum() const {return (Int_t)fMinimum;}
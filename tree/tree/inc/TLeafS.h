@@ -38,8 +38,10 @@ public:
    TLeafS(TBranch *parent, const char *name, const char *type);
    virtual ~TLeafS();
 
+   virtual Bool_t  CanFillBasketBulk() const { return kTRUE; }
    virtual void    Export(TClonesArray *list, Int_t n);
    virtual void    FillBasket(TBuffer &b);
+   virtual void    FillBasketBulk(TBuffer &b, const void *data, Int_t nentries);
    virtual Int_t   GetMaximum() const { return fMaximum; }
    virtual Int_t   GetMinimum() const { return fMinimum; }
    const char     *GetTypeName() const;
@@ -150,6 +150,7 @@ private:
 
 protected:
    void             AddClone(TTree*);
+   void             AutoFlushBaskets();
    virtual void     KeepCircular();
    virtual TBranch *BranchImp(const char* branchname, const char* classname, TClass* ptrClass, void* addobj, Int_t bufsize, Int_t splitlevel);
    virtual TBranch *BranchImp(const char* branchname, TClass* ptrClass, void* addobj, Int_t bufsize, Int_t splitlevel);
@@ -200,7 +201,8 @@ protected:
       kLoadTree          = BIT(9),
       kPrint             = BIT(10),
       kRemoveFriend      = BIT(11),
-      kSetBranchStatus   = BIT(12)
+      kSetBranchStatus   = BIT(12),
+      kSetCacheEntryRange = BIT(13)
    };
    
 public:
@@ -222,7 +224,8 @@ public:
    // TTree status bits
    enum {
       kForceRead   = BIT(11),
-      kCircular    = BIT(12)
+      kCircular    = BIT(12),
+      kFixedBasketSizes = BIT(14)  // Basket sizes set by ApplyAccessProfile, not optimized at the first AutoFlush
    };
 
    // Split level modifier 
@@ -282,6 +285,7 @@ public:
    virtual TFriendElement *AddFriend(const char* treename, TFile* file);
    virtual TFriendElement *AddFriend(TTree* tree, const char* alias = "", Bool_t warn = kFALSE);
    virtual void            AddTotBytes(Int_t tot) { fTotBytes += tot; }
+   virtual Bool_t          ApplyAccessProfile(const char* filename, TTree* reference = 0);
    virtual void            AddZipBytes(Int_t zip) { fZipBytes += zip; }
    virtual Long64_t        AutoSave(Option_t* option = "");
    virtual Int_t           Branch(TCollection* list, Int_t bufsize = 32000, Int_t splitlevel = 99, const char* name = "");
@@ -347,6 +351,7 @@ public:
    virtual void            DropBaskets();
    virtual void            DropBuffers(Int_t nbytes);
    virtual Int_t           Fill();
+   virtual Long64_t        FillBulk(Long64_t nentries, void **columns);
    virtual TBranch        *FindBranch(const char* name);
    virtual TLeaf          *FindLeaf(const char* name);
    virtual Int_t           Fit(const char* funcname, const char* varexp, const char* selection = "", Option_t* option = "", Option_t* goption = "", Long64_t nentries = 1000000000, Long64_t firstentry = 0); // *MENU*
@@ -377,6 +382,7 @@ public:
    virtual Int_t           GetEntryWithIndex(Int_t major, Int_t minor = 0);
    virtual Long64_t        GetEntryNumberWithBestIndex(Int_t major, Int_t minor = 0) const;
    virtual Long64_t        GetEntryNumberWithIndex(Int_t major, Int_t minor = 0) const;
+   virtual Long64_t        GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries, Long64_t *order = 0) const;
    TEventList             *GetEventList() const { return fEventList; }
    virtual TEntryList     *GetEntryList();
    virtual Long64_t        GetEntryNumber(Long64_t entry) const;
@@ -459,6 +465,7 @@ public:
    static  TTree          *MergeTrees(TList* list, Option_t* option = "");
    virtual Bool_t          Notify();
    virtual void            OptimizeBaskets(ULong64_t maxMemory=10000000, Float_t minComp=1.1, Option_t *option=""); 
+   virtual Int_t           PrefetchEntries(Long64_t n, const Long64_t *entries);
    TPrincipal             *Principal(const char* varexp = "", const char* selection = "", Option_t* option = "np", Long64_t nentries = 1000000000, Long64_t firstentry = 0);
    virtual void            Print(Option_t* option = "") const; // *MENU*
    virtual void            PrintCacheStats(Option_t* option = "") const;
@@ -89,6 +89,7 @@ public:
 
    virtual Bool_t       FillBuffer();
    virtual void         LearnPrefill();
+   virtual Int_t        PrefetchEntries(Long64_t n, const Long64_t *entries);
 
    virtual void         Print(Option_t *option="") const;
    virtual Int_t        ReadBuffer(char *buf, Long64_t pos, Int_t len);
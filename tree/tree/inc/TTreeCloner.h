@@ -33,6 +33,7 @@ namespace std {
 }
 #endif
 
+class TBasket;
 class TBranch;
 class TTree;
 
@@ -60,6 +61,7 @@ class TTreeCloner {
 
    UInt_t     fCloneMethod;      //Indicates which cloning method was selected.
    Long64_t   fToStartEntries;   //Number of entries in the target tree before any addition.
+   Long64_t   fClusterSize;      //Target size (compressed bytes) of the output clusters, 0 to keep the input ones.
 
    enum ECloneMethod {
       kDefault             = 0,
@@ -85,7 +87,10 @@ class TTreeCloner {
    friend class CompareSeek;
    friend class CompareEntry;
    
-   void ImportClusterRanges();
+   Long64_t AppendEntries(TBasket *basket, TBranch *to, Long64_t clusterStart, Long64_t clusterEntries);
+   Bool_t   CanRecluster() const;
+   void     ImportClusterRanges();
+   void     ReclusterBaskets();
 
 private:
    TTreeCloner(const TTreeCloner&);            // Not implemented.
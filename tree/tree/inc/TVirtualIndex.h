@@ -40,6 +40,7 @@ public:
    virtual Long64_t       GetEntryNumberFriend(const TTree * /*parent*/) = 0;
    virtual Long64_t       GetEntryNumberWithIndex(Int_t major, Int_t minor) const = 0;
    virtual Long64_t       GetEntryNumberWithBestIndex(Int_t major, Int_t minor) const = 0;
+   virtual Long64_t       GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries) const;
    virtual const char    *GetMajorName()    const = 0;
    virtual const char    *GetMinorName()    const = 0;
    virtual Long64_t       GetN()            const = 0;
@@ -10,6 +10,7 @@
 
 #include "TBasket.h"
 #include "TBufferFile.h"
+#include "TBufferPool.h"
 #include "TTree.h"
 #include "TBranch.h"
 #include "TFile.h"
@@ -18,6 +19,8 @@
 #include "TTreeCache.h"
 #include "TVirtualPerfStats.h"
 #include "TTimeStamp.h"
+#include "TVirtualMutex.h"
+#include "Compression.h"
 
 // TODO: Copied from TBranch.cxx
 #if (__GNUC__ >= 3) || defined(__INTEL_COMPILER)
@@ -35,11 +38,16 @@
 extern "C" void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm);
 extern "C" void R__unzip(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout);
 extern "C" int R__unzip_header(Int_t *nin, UChar_t *bufin, Int_t *lout);
+extern "C" int R__ZipMode;
 
 const Int_t  kMAXBUF = 0xFFFFFF;
 const UInt_t kDisplacementMask = 0xFF000000;  // In the streamer the two highest bytes of
                                               // the fEntryOffset are used to stored displacement.
 
+// Serializes the compressions done with the old ROOT algorithm, which
+// keeps its state in global variables (see Recompress).
+static TVirtualMutex *gOldZipMutex = 0;
+
 ClassImp(TBasket)
 
 //_______________________________________________________________________
@@ -133,14 +141,14 @@ TBasket::~TBasket()
 
    if (fDisplacement) delete [] fDisplacement;
    if (fEntryOffset)  delete [] fEntryOffset;
-   if (fBufferRef) delete fBufferRef;
+   if (fBufferRef) TBufferPool::DeleteBuffer(fBufferRef);
    fBufferRef = 0;
    fBuffer = 0;
    fDisplacement= 0;
    fEntryOffset = 0;
    // Note we only delete the compressed buffer if we own it
    if (fCompressedBufferRef && fOwnsCompressedBuffer) {
-      delete fCompressedBufferRef;
+      TBufferPool::DeleteBuffer(fCompressedBufferRef);
       fCompressedBufferRef = 0;
    }
 }
@@ -178,6 +186,25 @@ Long64_t TBasket::CopyTo(TFile *to)
    return nBytes>0 ? nBytes : -1;
 }
 
+//_______________________________________________________________________
+static Int_t R__ZipBlocks(Int_t cxlevel, Int_t cxAlgorithm, char *src, Int_t srcsize, char *tgt)
+{
+   // Compress srcsize bytes from src into tgt, in blocks of at most kMAXBUF
+   // bytes. Return the compressed size, or srcsize if the data could not
+   // be made smaller (in which case tgt is meaningless).
+
+   Int_t nbuffers = 1 + (srcsize - 1) / kMAXBUF;
+   Int_t noutot = 0;
+   for (Int_t i = 0; i < nbuffers; ++i) {
+      Int_t bufmax = (i == nbuffers - 1) ? srcsize - i*kMAXBUF : kMAXBUF;
+      Int_t nout = 0;
+      R__zipMultipleAlgorithm(cxlevel, &bufmax, src + i*kMAXBUF, &bufmax, tgt + noutot, &nout, cxAlgorithm);
+      if (nout == 0 || noutot + nout >= srcsize) return srcsize;
+      noutot += nout;
+   }
+   return noutot;
+}
+
 //_______________________________________________________________________
 void TBasket::DeleteEntryOffset()
 {
@@ -197,8 +224,8 @@ Int_t TBasket::DropBuffers()
 
    if (fDisplacement) delete [] fDisplacement;
    if (fEntryOffset)  delete [] fEntryOffset;
-   if (fBufferRef)    delete fBufferRef;
-   if (fCompressedBufferRef && fOwnsCompressedBuffer) delete fCompressedBufferRef;
+   if (fBufferRef)    TBufferPool::DeleteBuffer(fBufferRef);
+   if (fCompressedBufferRef && fOwnsCompressedBuffer) TBufferPool::DeleteBuffer(fCompressedBufferRef);
    fBufferRef   = 0;
    fCompressedBufferRef = 0;
    fBuffer      = 0;
@@ -279,6 +306,80 @@ Int_t TBasket::LoadBasketBuffers(Long64_t pos, Int_t len, TFile *file, TTree *tr
    return 0;
 }
 
+//_______________________________________________________________________
+Int_t TBasket::Recompress(Int_t settings)
+{
+   // Replace the content of a basket loaded by LoadBasketBuffers by the
+   // same data compressed with the given compression settings, without
+   // unstreaming it. The key header is updated when the basket is written
+   // by CopyTo. This function is called by TTreeCloner, possibly from
+   // several threads at once for different baskets, and hence does not
+   // touch the branch nor the files.
+   // The function returns 0 in case of success, 1 in case of error (the
+   // basket is then left unchanged).
+
+   Int_t cxlevel = settings % 100;
+   Int_t cxAlgorithm = settings / 100;
+   Int_t nin = fNbytes - fKeylen;
+   Bool_t compressed = fObjlen > nin;
+   if (fObjlen <= 0 || (!compressed && cxlevel == 0)) return 0;
+
+   char *objbuf = fBufferRef->Buffer() + fKeylen;
+   char *unzipped = 0;
+   if (compressed) {
+      unzipped = TBufferPool::Acquire(fObjlen);
+      UChar_t *bufcur = (UChar_t*)objbuf;
+      Int_t noutot = 0, nintot = 0;
+      while (noutot < fObjlen) {
+         Int_t nzip, nbuf, nout = 0;
+         if (nintot + 9 > nin || R__unzip_header(&nzip, bufcur, &nbuf) != 0
+             || nintot + nzip > nin || noutot + nbuf > fObjlen) break;
+         R__unzip(&nzip, bufcur, &nbuf, unzipped + noutot, &nout);
+         if (!nout) break;
+         noutot += nout;
+         nintot += nzip;
+         bufcur += nzip;
+      }
+      if (noutot != fObjlen) {
+         Error("Recompress", "Inconsistency found in basket of %s (fNbytes=%d, fKeylen=%d, fObjlen=%d, noutot=%d)",
+               GetName(), fNbytes, fKeylen, fObjlen, noutot);
+         TBufferPool::Release(unzipped);
+         return 1;
+      }
+      objbuf = unzipped;
+   }
+
+   Int_t nout = fObjlen;
+   char *zipped = 0;
+   if (cxlevel > 0) {
+      Int_t nbuffers = 1 + (fObjlen - 1) / kMAXBUF;
+      zipped = TBufferPool::Acquire(fObjlen + 9*nbuffers + 28);
+      Bool_t oldAlgo = cxAlgorithm == ROOT::kOldCompressionAlgo
+         || (cxAlgorithm == ROOT::kUseGlobalSetting && (R__ZipMode == 0 || R__ZipMode == 3));
+      if (oldAlgo) {
+         R__LOCKGUARD2(gOldZipMutex);
+         nout = R__ZipBlocks(cxlevel, cxAlgorithm, objbuf, fObjlen, zipped);
+      } else {
+         nout = R__ZipBlocks(cxlevel, cxAlgorithm, objbuf, fObjlen, zipped);
+      }
+   }
+   char *result = nout < fObjlen ? zipped : objbuf;
+
+   if (fBufferRef->BufferSize() < fKeylen + nout) {
+      fBufferRef->SetWriteMode();
+      fBufferRef->Expand(fKeylen + nout);
+      fBufferRef->SetReadMode();
+   }
+   if (result != fBufferRef->Buffer() + fKeylen) {
+      memcpy(fBufferRef->Buffer() + fKeylen, result, nout);
+   }
+   fNbytes = fKeylen + nout;
+
+   TBufferPool::Release(zipped);
+   TBufferPool::Release(unzipped);
+   return 0;
+}
+
 //_______________________________________________________________________
 void TBasket::MoveEntries(Int_t dentries)
 {
@@ -352,12 +453,15 @@ Int_t TBasket::ReadBasketBuffersUncompressedCase()
 Int_t TBasket::ReadBasketBuffersUnzip(char* buffer, Int_t size, Bool_t mustFree, TFile* file)
 {
    // We always create the TBuffer for the basket but it hold the buffer from the cache.
+   // When we must free it, the buffer comes from TBufferPool and goes back there.
+   ReAllocCharFun_t reallocfunc = mustFree ? &TBufferPool::ReAlloc : 0;
    if (fBufferRef) {
-      fBufferRef->SetBuffer(buffer, size, mustFree);
+      TBufferPool::ReleaseBuffer(fBufferRef);
+      fBufferRef->SetBuffer(buffer, size, kFALSE, reallocfunc);
       fBufferRef->SetReadMode();
       fBufferRef->Reset();
    } else {
-      fBufferRef = new TBufferFile(TBuffer::kRead, size, buffer, mustFree);
+      fBufferRef = new TBufferFile(TBuffer::kRead, size, buffer, kFALSE, reallocfunc);
    }
    fBufferRef->SetParent(file);
 
@@ -393,7 +497,7 @@ static inline TBuffer* R__InitializeReadBasketBuffer(TBuffer* bufferRef, Int_t l
       bufferRef->Reset();
       result = bufferRef;
    } else {
-      result = new TBufferFile(TBuffer::kRead, len);
+      result = TBufferPool::NewBuffer(TBuffer::kRead, len);
    }
    result->SetParent(file);
    return result;
@@ -433,6 +537,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
    }  
 
    Bool_t oldCase;
+   Bool_t unzipReported = kFALSE;
    char *rawUncompressedBuffer, *rawCompressedBuffer;
    Int_t uncompressedBufferLen;
 
@@ -441,7 +546,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
    if (pf) {
       Int_t res = -1;
       Bool_t free = kTRUE;
-      char *buffer;
+      char *buffer = 0;
       res = pf->GetUnzipBuffer(&buffer, pos, len, &free);
       if (R__unlikely(res >= 0)) {
          len = ReadBasketBuffersUnzip(buffer, res, free, file);
@@ -582,6 +687,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       len = fObjlen+fKeylen;
       if (R__unlikely(gPerfStats)) {
          gPerfStats->FileUnzipEvent(file,pos,start,nintot,fObjlen);
+         unzipReported = kTRUE;
       }
    } else {
       // Nothing is compressed - copy over wholesale.
@@ -590,6 +696,13 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
 
 AfterBuffer:
 
+   // The baskets stored without compression, or already unzipped by the
+   // cache, are reported too (with no unzip time) so that a monitor sees
+   // every basket read, see TTreePerfStats::SetRecordProfile.
+   if (R__unlikely(gPerfStats) && !unzipReported) {
+      gPerfStats->FileUnzipEvent(file,pos,TTimeStamp(),fNbytes-fKeylen,fObjlen);
+   }
+
    fBranch->GetTree()->IncrementTotalBuffers(fBufferSize);
 
    // Read offsets table if needed.
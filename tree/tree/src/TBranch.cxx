@@ -584,6 +584,23 @@ void TBranch::Browse(TBrowser* b)
 }
 
  //______________________________________________________________________________
+Bool_t TBranch::CanFillBulk() const
+{
+   // Return true if the branch can be filled with FillBulk: a plain
+   // TBranch with a single leaf of a basic type, of fixed length and not
+   // used as the leaf count of other leaves.
+
+   if (IsA() != TBranch::Class() || fEntryBuffer || fSkipZip) {
+      return kFALSE;
+   }
+   if (fLeaves.GetEntriesFast() != 1) {
+      return kFALSE;
+   }
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   return !leaf->GetLeafCount() && !leaf->IsRange() && leaf->CanFillBasketBulk();
+}
+
+//______________________________________________________________________________
 void TBranch::DeleteBaskets(Option_t* option)
 {
    // Loop on all branch baskets. If the file where branch buffers reside is
@@ -787,6 +804,101 @@ Int_t TBranch::Fill()
    return nbytes;
 }
 
+//______________________________________________________________________________
+Long64_t TBranch::FillBulk(Long64_t nentries, const void *data)
+{
+   // Fill nentries entries at once from data, an array holding for each
+   // entry in turn the values of the leaf (GetLen() values of its type,
+   // in memory order), i.e. a column of the tree.
+   //
+   // The entries are appended to the current basket with one call to
+   // TBuffer::WriteFastArray per basket instead of going through the leaf
+   // for each entry. The baskets are written exactly when Fill() would
+   // have written them, so the file layout does not depend on the method
+   // used to fill the branch.
+   //
+   // Only branches with a single leaf of a basic type and without leaf
+   // count can be filled this way (see CanFillBulk).
+   // Note that the tree entry count is not changed, use TTree::FillBulk
+   // to fill all the branches of a tree.
+   //
+   // The function returns the number of bytes committed to the memory
+   // baskets, -1 in case of error.
+
+   if (TestBit(kDoNotProcess)) {
+      return 0;
+   }
+   if (!CanFillBulk()) {
+      Error("FillBulk", "Branch %s cannot be filled in bulk", GetName());
+      return -1;
+   }
+
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   const Int_t entrySize = leaf->GetLen() * leaf->GetLenType();
+   const char *cursor = (const char*)data;
+   Long64_t nbytes = 0;
+
+   while (nentries > 0) {
+      Long64_t nfull = GetEntriesToWriteBasket();
+      if (nfull < 0) return -1;
+      TBasket* basket = GetBasket(fWriteBasket);
+      TBuffer* buf = basket->GetBufferRef();
+      buf->ResetMap();
+
+      Int_t lold = buf->Length();
+      Int_t n = (Int_t)TMath::Min(nentries, nfull);
+
+      for (Int_t i = 0; i < n; ++i) {
+         basket->Update(lold + i * entrySize);
+      }
+      leaf->FillBasketBulk(*buf, cursor, n);
+      if (!fEntryOffsetLen && !basket->GetNevBufSize()) {
+         basket->SetNevBufSize(entrySize);
+      }
+      fEntries += n;
+      fEntryNumber += n;
+      cursor += (Long64_t)n * entrySize;
+      nbytes += (Long64_t)n * entrySize;
+      nentries -= n;
+
+      if (n == nfull && !fTree->TestBit(TTree::kCircular)) {
+         if (WriteBasket(basket,fWriteBasket) < 0) return -1;
+      }
+   }
+   return nbytes;
+}
+
+//______________________________________________________________________________
+Long64_t TBranch::GetEntriesToWriteBasket()
+{
+   // Return the number of entries that Fill() can add to the current basket
+   // of this branch before writing it, the entry triggering the write
+   // included. The current basket is created if needed.
+   // Only meaningful for the branches which can be filled in bulk (see
+   // CanFillBulk), whose entries all have the same size: it is used by
+   // FillBulk, and by TTree::FillBulk to stop where Fill could flush the
+   // baskets of the tree. Returns -1 in case of error.
+
+   TBasket* basket = GetBasket(fWriteBasket);
+   if (!basket) {
+      basket = fTree->CreateBasket(this); //  create a new basket
+      if (!basket) return -1;
+      ++fNBaskets;
+      fBaskets.AddAtAndExpand(basket,fWriteBasket);
+   }
+   TBuffer* buf = basket->GetBufferRef();
+   if (buf->IsReading()) {
+      basket->SetWriteMode();
+   }
+
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   const Int_t entrySize = leaf->GetLen() * leaf->GetLenType();
+   // The entry offset table is counted twice in the basket size test of Fill.
+   const Int_t offsetSize = fEntryOffsetLen ? 2 * sizeof(Int_t) : 0;
+   Long64_t room = fBasketSize - entrySize - buf->Length() - (Long64_t)offsetSize * basket->GetNevBuf();
+   return room > 0 ? (room + entrySize + offsetSize - 1) / (entrySize + offsetSize) : 1;
+}
+
 //______________________________________________________________________________
 Int_t TBranch::FillEntryBuffer(TBasket* basket, TBuffer* buf, Int_t& lnew) 
 {
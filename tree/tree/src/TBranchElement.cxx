@@ -1863,6 +1863,12 @@ void TBranchElement::InitInfo()
    if (!fInfo) {
       // We did not already have streamer info, so now we must find it.
       TClass* cl = fBranchClass.GetClass();
+      TFile *file = fDirectory ? fDirectory->GetFile() : 0;
+      if (file && file->IsStreamerInfoPending() && (!cl || !cl->IsLoaded() || fClassVersion != cl->GetClassVersion())) {
+         // This class version may only be described by the deferred StreamerInfo record of the file.
+         file->ReadPendingStreamerInfo();
+         cl = fBranchClass.GetClass();
+      }
 
       //------------------------------------------------------------------------
       // Check if we're dealing with the name change
@@ -73,6 +73,8 @@ TChain::TChain()
 , fFiles(0)
 , fStatus(0)
 , fProofChain(0)
+, fNextFileHandle(0)
+, fNextFileNumber(-1)
 {
    // -- Default constructor.
 
@@ -109,6 +111,8 @@ TChain::TChain(const char* name, const char* title)
 , fFiles(0)
 , fStatus(0)
 , fProofChain(0)
+, fNextFileHandle(0)
+, fNextFileNumber(-1)
 {
    // -- Create a chain.
    //
@@ -174,6 +178,7 @@ TChain::~TChain()
    gROOT->GetListOfCleanups()->Remove(this);
    
    SafeDelete(fProofChain);
+   CancelNextFile();
    fStatus->Delete();
    delete fStatus;
    fStatus = 0;
@@ -719,6 +724,18 @@ void TChain::Browse(TBrowser* b)
    TTree::Browse(b);
 }
 
+//______________________________________________________________________________
+void TChain::CancelNextFile()
+{
+   // Discard the pending asynchronous open of the next file (if any).
+
+   if (fNextFileHandle) {
+      TFile::CancelAsyncOpen(fNextFileHandle);
+      fNextFileHandle = 0;
+   }
+   fNextFileNumber = -1;
+}
+
 //_______________________________________________________________________
 void TChain::CanDeleteRefs(Bool_t flag /* = kTRUE */)
 {
@@ -1471,7 +1488,15 @@ Long64_t TChain::LoadTree(Long64_t entry)
    //        if we did not delete it above.
    {
       TDirectory::TContext ctxt(0);
-      fFile = TFile::Open(element->GetTitle());
+      if (fNextFileHandle && fNextFileNumber == treenum) {
+         // The open of this file was submitted while reading the previous one.
+         fFile = TFile::Open(fNextFileHandle);
+         fNextFileHandle = 0;
+         fNextFileNumber = -1;
+      } else {
+         CancelNextFile();
+         fFile = TFile::Open(element->GetTitle());
+      }
       if (fFile) fFile->SetBit(kMustCleanup);
    }
 
@@ -1645,6 +1670,11 @@ Long64_t TChain::LoadTree(Long64_t entry)
       fNotify->Notify();
    }
 
+   // Start opening the next file while this one is processed.
+   if (TestBit(kAsyncOpen)) {
+      OpenNextFile();
+   }
+
    // Return the new local entry number.
    return treeReadEntry;
 }
@@ -2022,6 +2052,26 @@ Long64_t TChain::Merge(TFile* file, Int_t basketsize, Option_t* option)
    return nfiles;
 }
 
+//______________________________________________________________________________
+void TChain::OpenNextFile()
+{
+   // Submit the asynchronous open (see TFile::AsyncOpen) of the file
+   // following the current one, so that it proceeds while the current
+   // file is processed. LoadTree picks up the result when it moves to
+   // that file and discards it if it moves to another one.
+
+   Int_t next = fTreeNumber + 1;
+   if (fTreeNumber < 0 || next >= fNtrees) return;
+   if (fNextFileHandle && fNextFileNumber == next) return;
+   CancelNextFile();
+
+   TChainElement *element = (TChainElement*) fFiles->At(next);
+   if (!element) return;
+   TDirectory::TContext ctxt(0);
+   fNextFileHandle = TFile::AsyncOpen(element->GetTitle());
+   if (fNextFileHandle) fNextFileNumber = next;
+}
+
 //______________________________________________________________________________
 void TChain::Print(Option_t *option) const
 {
@@ -2133,6 +2183,7 @@ void TChain::Reset(Option_t*)
 {
    // Resets the state of this chain.
 
+   CancelNextFile();
    delete fFile;
    fFile = 0;
    fNtrees         = 0;
@@ -2155,6 +2206,7 @@ void TChain::ResetAfterMerge(TFileMergeInfo *info)
    // Resets the state of this chain after a merge (keep the customization but
    // forget the data).
    
+   CancelNextFile();
    fNtrees         = 0;
    fTreeNumber     = -1;
    fTree           = 0;
@@ -2180,6 +2232,26 @@ Long64_t TChain::Scan(const char* varexp, const char* selection, Option_t* optio
    return TTree::Scan(varexp, selection, option, nentries, firstentry);
 }
 
+//_______________________________________________________________________
+void TChain::SetAsyncOpen(Bool_t on)
+{
+   // -- Enable/disable the asynchronous open of the next file.
+   //
+   //  When enabled, each time LoadTree moves to a new file it submits
+   //  the open of the following file with TFile::AsyncOpen, so that
+   //  for protocols supporting it (e.g. xrootd) the open, including
+   //  the reading of the file header, overlaps with the processing of
+   //  the current file instead of stalling the next LoadTree.
+   //  For the other protocols the open stays synchronous.
+
+   SetBit(kAsyncOpen, on);
+   if (!on) {
+      CancelNextFile();
+   } else if (fTree) {
+      OpenNextFile();
+   }
+}
+
 //_______________________________________________________________________
 void TChain::SetAutoDelete(Bool_t autodelete)
 {
@@ -23,6 +23,13 @@
 //                                                                      //
 //  See TTree::AddFriend for more information.                          //
 //                                                                      //
+// If the friend tree has exactly the same entries and clusters as its  //
+// parent, the friendship can be declared aligned:                      //
+//       T.AddFriend("friendTreename","friendTreeFile")->SetAligned();  //
+// The friend entry is then always the parent entry (any index of the   //
+// friend is ignored by LoadTree) and the friend TTreeCache is filled   //
+// together with the parent's one, cluster by cluster.                  //
+//                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 #include "TTree.h"
@@ -250,5 +257,52 @@ void TFriendElement::ls(Option_t *) const
 {
    // List this friend element.
 
-   printf(" Friend Tree: %s in file: %s\n",GetName(),GetTitle());
+   printf(" Friend Tree: %s in file: %s%s\n",GetName(),GetTitle(),IsAligned() ? " (aligned)" : "");
+}
+
+//_______________________________________________________________________
+Bool_t TFriendElement::SetAligned(Bool_t aligned)
+{
+   // Declare (or undeclare) the friend TTree as aligned with its parent.
+   //
+   // An aligned friend has the same number of entries as its parent and
+   // the same cluster boundaries; entry i of the parent always corresponds
+   // to entry i of the friend. TTree::LoadTree then loads the same entry
+   // number in the friend without going through the friend's index and
+   // TTreeCache::FillBuffer fills the friend cache for the same cluster
+   // as the parent's one.
+   //
+   // The compatibility is verified once here; both trees must be TTrees
+   // (not TChains). Return kTRUE if the friend is now aligned.
+
+   if (!aligned) {
+      ResetBit(kAligned);
+      return kFALSE;
+   }
+   TTree *t = GetTree();
+   if (!t || !fParentTree) {
+      Warning("SetAligned", "friend tree %s is not available", GetName());
+      return kFALSE;
+   }
+   if (t->IsA() != TTree::Class() || fParentTree->IsA() != TTree::Class()) {
+      Warning("SetAligned", "friend %s: aligned friendship is only supported between TTrees", GetName());
+      return kFALSE;
+   }
+   Long64_t nentries = fParentTree->GetEntries();
+   if (t->GetEntries() != nentries) {
+      Warning("SetAligned", "friend %s has %lld entries instead of %lld", GetName(), t->GetEntries(), nentries);
+      return kFALSE;
+   }
+   TTree::TClusterIterator piter = fParentTree->GetClusterIterator(0);
+   TTree::TClusterIterator fiter = t->GetClusterIterator(0);
+   Long64_t pstart, fstart;
+   while ((pstart = piter()) < nentries) {
+      fstart = fiter();
+      if (pstart != fstart) {
+         Warning("SetAligned", "friend %s has a cluster starting at entry %lld instead of %lld", GetName(), fstart, pstart);
+         return kFALSE;
+      }
+   }
+   SetBit(kAligned);
+   return kTRUE;
 }
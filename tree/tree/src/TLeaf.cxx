@@ -146,6 +146,15 @@ void TLeaf::FillBasket(TBuffer &)
    // -- Pack leaf elements in Basket output buffer.
 }
 
+//______________________________________________________________________________
+void TLeaf::FillBasketBulk(TBuffer &, const void *, Int_t)
+{
+   // -- Pack several consecutive entries in Basket output buffer.
+   //
+   // Only implemented by the leaves of basic types, for which
+   // CanFillBasketBulk() returns true. See TBranch::FillBulk.
+}
+
 //______________________________________________________________________________
 TLeaf* TLeaf::GetLeafCounter(Int_t& countval) const
 {
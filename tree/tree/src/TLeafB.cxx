@@ -90,6 +90,15 @@ void TLeafB::FillBasket(TBuffer& b)
    }
 }
 
+//______________________________________________________________________________
+void TLeafB::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Char_t*)data, nentries*GetLen());
+}
+
 //______________________________________________________________________________
 const char *TLeafB::GetTypeName() const
 {
@@ -84,6 +84,15 @@ void TLeafD::FillBasket(TBuffer &b)
    b.WriteFastArray(fValue,len);
 }
 
+//______________________________________________________________________________
+void TLeafD::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Double_t*)data, nentries*GetLen());
+}
+
 
 //______________________________________________________________________________
 void TLeafD::Import(TClonesArray *list, Int_t n)
@@ -88,6 +88,15 @@ void TLeafF::FillBasket(TBuffer &b)
    b.WriteFastArray(fValue,len);
 }
 
+//______________________________________________________________________________
+void TLeafF::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Float_t*)data, nentries*GetLen());
+}
+
 
 //______________________________________________________________________________
 void TLeafF::Import(TClonesArray *list, Int_t n)
@@ -95,6 +95,15 @@ void TLeafI::FillBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+void TLeafI::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Int_t*)data, nentries*GetLen());
+}
+
 //______________________________________________________________________________
 const char *TLeafI::GetTypeName() const
 {
@@ -95,6 +95,15 @@ void TLeafL::FillBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+void TLeafL::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Long64_t*)data, nentries*GetLen());
+}
+
 //______________________________________________________________________________
 const char *TLeafL::GetTypeName() const
 {
@@ -88,6 +88,15 @@ void TLeafO::FillBasket(TBuffer &b)
    b.WriteFastArray(fValue,len);
 }
 
+//______________________________________________________________________________
+void TLeafO::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Bool_t*)data, nentries*GetLen());
+}
+
 //______________________________________________________________________________
 const char *TLeafO::GetTypeName() const
 {
@@ -92,6 +92,15 @@ void TLeafS::FillBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+void TLeafS::FillBasketBulk(TBuffer &b, const void *data, Int_t nentries)
+{
+   // Pack nentries consecutive entries in Basket output buffer. data holds
+   // nentries*GetLen() values. The leaf must not have a leaf count.
+
+   b.WriteFastArray((const Short_t*)data, nentries*GetLen());
+}
+
 
 //______________________________________________________________________________
 const char *TLeafS::GetTypeName() const
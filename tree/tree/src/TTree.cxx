@@ -370,6 +370,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <limits.h>
 
@@ -1110,6 +1111,172 @@ TFriendElement* TTree::AddFriend(TTree* tree, const char* alias, Bool_t warn)
    return fe;
 }
 
+//______________________________________________________________________________
+Bool_t TTree::ApplyAccessProfile(const char* filename, TTree* reference)
+{
+   // Choose the cluster size and the basket sizes of this (still empty)
+   // tree such that the workload described by the access profile filename
+   // needs as few reads as possible. The profile is a text file written by
+   // TTreePerfStats::SaveProfile, listing the branches read by the workload.
+   //
+   // The sizes of the branches are taken from reference (by default this
+   // tree), typically the tree being copied into this one:
+   //  - the clusters (see SetAutoFlush) hold as many entries as fit, for
+   //    the branches read, in the TTreeCache size used by the workload
+   //    (30 MB if no cache was used). A reader using the same branches then
+   //    reads one cluster per cache fill.
+   //  - the basket size of each branch read is set to hold a full cluster,
+   //    so that the branch is read with a single basket per cluster. Other
+   //    branches keep their basket size.
+   // The basket sizes are then not changed at the first AutoFlush (see
+   // kFixedBasketSizes, which is reset by that AutoFlush).
+   //
+   // This is used by CloneTree and hadd when given a profile (option
+   // "profile=<file>" and -p respectively). Returns kFALSE if the profile
+   // could not be used.
+
+   std::ifstream in(filename);
+   if (!in) {
+      Error("ApplyAccessProfile", "cannot open the access profile %s", filename);
+      return kFALSE;
+   }
+   std::string treename;
+   Long64_t cachesize = 0;
+   std::vector<std::string> names;
+   std::string line;
+   while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string key;
+      fields >> key;
+      if (key == "tree") {
+         fields >> treename;
+      } else if (key == "cachesize") {
+         fields >> cachesize;
+      } else if (key == "branch") {
+         std::string name;
+         fields >> name;
+         if (!name.empty()) names.push_back(name);
+      }
+   }
+   if (!treename.empty() && treename != GetName()) {
+      Warning("ApplyAccessProfile", "the access profile %s was recorded for the tree %s, not %s",
+              filename, treename.c_str(), GetName());
+   }
+
+   TTree *ref = reference ? reference : this;
+   // Compressed bytes read per entry by the workload.
+   Double_t zread = 0;
+   for (size_t i = 0; i < names.size(); ++i) {
+      TBranch *branch = ref->GetBranch(names[i].c_str());
+      if (!branch || branch->GetEntries() == 0) continue;
+      zread += branch->GetZipBytes() / (Double_t)branch->GetEntries();
+   }
+   if (zread <= 0) {
+      Warning("ApplyAccessProfile", "none of the branches read in the access profile %s has data in %s",
+              filename, ref->GetName());
+      return kFALSE;
+   }
+
+   const Long64_t kDefaultClusterBytes = 30000000;
+   const Double_t kMaxProfileBasketSize = 16*1024*1024;
+   Long64_t budget = cachesize > 0 ? cachesize : kDefaultClusterBytes;
+   Long64_t clusterEntries = TMath::Max((Long64_t)1, (Long64_t)(budget / zread));
+   SetAutoFlush(clusterEntries);
+
+   for (size_t i = 0; i < names.size(); ++i) {
+      TBranch *from = ref->GetBranch(names[i].c_str());
+      TBranch *to = GetBranch(names[i].c_str());
+      if (!from || !to || from->GetEntries() == 0) continue;
+      // Fill writes the basket when it is about to overflow, counting the
+      // entry offsets twice; keep some room for the key.
+      Double_t perEntry = from->GetTotBytes() / (Double_t)from->GetEntries();
+      if (to->GetEntryOffsetLen()) perEntry += 2*sizeof(Int_t);
+      Double_t bsize = perEntry * (clusterEntries + 1) + 512;
+      if (bsize > kMaxProfileBasketSize) bsize = kMaxProfileBasketSize;
+      Int_t newBsize = (Int_t)bsize;
+      newBsize += 512 - newBsize % 512;
+      if (gDebug > 0) Info("ApplyAccessProfile", "Changing buffer size from %d to %d bytes for %s", to->GetBasketSize(), newBsize, to->GetName());
+      to->SetBasketSize(newBsize);
+   }
+   SetBit(kFixedBasketSizes);
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+void TTree::AutoFlushBaskets()
+{
+   // Flush the baskets and/or save the tree header if the number of entries
+   // or bytes written reached fAutoFlush or fAutoSave (see Fill).
+   // The first time the baskets are flushed, their sizes are optimized and
+   // fAutoFlush is converted to a number of entries.
+
+   if (fAutoFlush == 0 && fAutoSave == 0) {
+      return;
+   }
+   if (fFlushedBytes == 0) {
+      // Decision can be based initially either on the number of bytes
+      // or the number of entries written.
+      if ((fAutoFlush<0 && fZipBytes > -fAutoFlush)  ||
+          (fAutoSave <0 && fZipBytes > -fAutoSave )  ||
+          (fAutoFlush>0 && fEntries%TMath::Max((Long64_t)1,fAutoFlush) == 0) ||
+          (fAutoSave >0 && fEntries%TMath::Max((Long64_t)1,fAutoSave)  == 0) ) {
+
+         //First call FlushBasket to make sure that fTotBytes is up to date.
+         FlushBaskets();
+         if (!TestBit(kFixedBasketSizes)) OptimizeBaskets(fTotBytes,1,"");
+         // The bit only concerns this first flush, it must not be written
+         // with the tree and affect a later copy or update of it.
+         ResetBit(kFixedBasketSizes);
+         if (gDebug > 0) Info("TTree::Fill","OptimizeBaskets called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
+         fFlushedBytes = fZipBytes;
+         fAutoFlush    = fEntries;  // Use test on entries rather than bytes
+
+         // subsequently in run
+         if (fAutoSave < 0) {
+            // Set fAutoSave to the largest integer multiple of
+            // fAutoFlush events such that fAutoSave*fFlushedBytes
+            // < (minus the input value of fAutoSave)
+            if (fZipBytes != 0) {
+               fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/fZipBytes)/fEntries));                  
+            } else if (fTotBytes != 0) {
+               fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/fTotBytes)/fEntries));                  
+            } else {
+               TBufferFile b(TBuffer::kWrite, 10000);
+               TTree::Class()->WriteBuffer(b, (TTree*) this);
+               Long64_t total = b.Length();
+               fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/total)/fEntries));                                    
+            }
+         } else if(fAutoSave > 0) {
+            fAutoSave = fAutoFlush*(fAutoSave/fAutoFlush);
+         }
+         if (fAutoSave!=0 && fEntries >= fAutoSave) AutoSave();    // FlushBaskets not called in AutoSave
+         if (gDebug > 0) Info("TTree::Fill","First AutoFlush.  fAutoFlush = %lld, fAutoSave = %lld\n", fAutoFlush, fAutoSave);
+      }
+   } else if (fNClusterRange && fAutoFlush && ( (fEntries-fClusterRangeEnd[fNClusterRange-1]) % fAutoFlush == 0)  ) {
+      if (fAutoSave != 0 && fEntries%fAutoSave == 0) {
+         //We are at an AutoSave point. AutoSave flushes baskets and saves the Tree header
+         AutoSave("flushbaskets");
+         if (gDebug > 0) Info("TTree::Fill","AutoSave called at entry %lld, fZipBytes=%lld, fSavedBytes=%lld\n",fEntries,fZipBytes,fSavedBytes);
+      } else {
+         //We only FlushBaskets
+         FlushBaskets();
+         if (gDebug > 0) Info("TTree::Fill","FlushBasket called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
+      }
+      fFlushedBytes = fZipBytes;         
+   } else if (fNClusterRange == 0 && fEntries > 1 && fAutoFlush && fEntries%fAutoFlush == 0) {
+      if (fAutoSave != 0 && fEntries%fAutoSave == 0) {
+         //We are at an AutoSave point. AutoSave flushes baskets and saves the Tree header
+         AutoSave("flushbaskets");
+         if (gDebug > 0) Info("TTree::Fill","AutoSave called at entry %lld, fZipBytes=%lld, fSavedBytes=%lld\n",fEntries,fZipBytes,fSavedBytes);
+      } else {
+         //We only FlushBaskets
+         FlushBaskets();
+         if (gDebug > 0) Info("TTree::Fill","FlushBasket called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
+      }
+      fFlushedBytes = fZipBytes;
+   }
+}
+
 //______________________________________________________________________________
 Long64_t TTree::AutoSave(Option_t* option)
 {
@@ -2773,6 +2940,21 @@ Int_t TTree::CheckBranchAddressType(TBranch* branch, TClass* ptrClass, EDataType
    return kMatch;
 }
 
+//______________________________________________________________________________
+static TString R__ExtractProfile(TString &options)
+{
+   // Remove the "profile=<file>" token from options and return the file
+   // name (empty if there is no such token).
+
+   Ssiz_t start = options.Index("profile=");
+   if (start == kNPOS) return "";
+   Ssiz_t end = options.Index(" ", start);
+   if (end == kNPOS) end = options.Length();
+   TString profile = options(start + 8, end - start - 8);
+   options.Remove(start, end - start);
+   return profile;
+}
+
 //______________________________________________________________________________
 TTree* TTree::CloneTree(Long64_t nentries /* = -1 */, Option_t* option /* = "" */)
 {
@@ -2843,10 +3025,16 @@ TTree* TTree::CloneTree(Long64_t nentries /* = -1 */, Option_t* option /* = "" *
    //     The input file has been generated by the program in
    //     $ROOTSYS/test/Event with: Event 1000 1 1 1
    //
+   // If 'option' contains 'profile=<file>' (and not 'fast'), the cluster
+   // and basket sizes of the new tree are chosen for the access profile
+   // written by TTreePerfStats::SaveProfile (see ApplyAccessProfile).
 
    // Options
    Bool_t fastClone = kFALSE;
 
+   TString copyopt = option;
+   TString profile = R__ExtractProfile(copyopt);
+   option = copyopt.Data();
    TString opt = option;
    opt.ToLower();
    if (opt.Contains("fast")) {
@@ -2971,6 +3159,14 @@ TTree* TTree::CloneTree(Long64_t nentries /* = -1 */, Option_t* option /* = "" *
    // Copy branch addresses.
    CopyAddresses(newtree);
 
+   if (profile.Length()) {
+      if (fastClone) {
+         Warning("CloneTree", "The access profile %s is ignored when cloning with the fast method", profile.Data());
+      } else {
+         newtree->ApplyAccessProfile(profile, thistree);
+      }
+   }
+
    //
    // Copy entries if requested.
    //
@@ -3194,6 +3390,12 @@ Long64_t TTree::CopyEntries(TTree* tree, Long64_t nentries /* = -1 */, Option_t*
    //
    // See TTree::CloneTree for a detailed explanation of the semantics of these 3 options.
    //
+   // When 'fast' is specified, 'option' can also contain "recluster=<bytes>". The entries
+   // are then appended (still without being unstreamed) to the baskets of this tree, which
+   // are written at each cluster boundary, the clusters being sized to hold about <bytes>
+   // compressed bytes. This coalesces the small clusters and baskets of many small input
+   // trees (see TTreeCloner::ReclusterBaskets).
+   //
    // If the tree or any of the underlying tree of the chain has an index, that index and any
    // index in the subsequent underlying TTree objects will be merged.
    //
@@ -4179,68 +4381,8 @@ Int_t TTree::Fill()
    if (gDebug > 0) printf("TTree::Fill - A:  %d %lld %lld %lld %lld %lld %lld \n",
        nbytes, fEntries, fAutoFlush,fAutoSave,fZipBytes,fFlushedBytes,fSavedBytes);
 
-   if (fAutoFlush != 0 || fAutoSave != 0) {
-      // Is it time to flush or autosave baskets?
-      if (fFlushedBytes == 0) {
-         // Decision can be based initially either on the number of bytes
-         // or the number of entries written.
-         if ((fAutoFlush<0 && fZipBytes > -fAutoFlush)  ||
-             (fAutoSave <0 && fZipBytes > -fAutoSave )  ||
-             (fAutoFlush>0 && fEntries%TMath::Max((Long64_t)1,fAutoFlush) == 0) ||
-             (fAutoSave >0 && fEntries%TMath::Max((Long64_t)1,fAutoSave)  == 0) ) {
-
-            //First call FlushBasket to make sure that fTotBytes is up to date.
-            FlushBaskets();
-            OptimizeBaskets(fTotBytes,1,"");
-            if (gDebug > 0) Info("TTree::Fill","OptimizeBaskets called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
-            fFlushedBytes = fZipBytes;
-            fAutoFlush    = fEntries;  // Use test on entries rather than bytes
-
-            // subsequently in run
-            if (fAutoSave < 0) {
-               // Set fAutoSave to the largest integer multiple of
-               // fAutoFlush events such that fAutoSave*fFlushedBytes
-               // < (minus the input value of fAutoSave)
-               if (fZipBytes != 0) {
-                  fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/fZipBytes)/fEntries));                  
-               } else if (fTotBytes != 0) {
-                  fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/fTotBytes)/fEntries));                  
-               } else {
-                  TBufferFile b(TBuffer::kWrite, 10000);
-                  TTree::Class()->WriteBuffer(b, (TTree*) this);
-                  Long64_t total = b.Length();
-                  fAutoSave =  TMath::Max( fAutoFlush, fEntries*((-fAutoSave/total)/fEntries));                                    
-               }
-            } else if(fAutoSave > 0) {
-               fAutoSave = fAutoFlush*(fAutoSave/fAutoFlush);
-            }
-            if (fAutoSave!=0 && fEntries >= fAutoSave) AutoSave();    // FlushBaskets not called in AutoSave
-            if (gDebug > 0) Info("TTree::Fill","First AutoFlush.  fAutoFlush = %lld, fAutoSave = %lld\n", fAutoFlush, fAutoSave);
-         }
-      } else if (fNClusterRange && fAutoFlush && ( (fEntries-fClusterRangeEnd[fNClusterRange-1]) % fAutoFlush == 0)  ) {
-         if (fAutoSave != 0 && fEntries%fAutoSave == 0) {
-            //We are at an AutoSave point. AutoSave flushes baskets and saves the Tree header
-            AutoSave("flushbaskets");
-            if (gDebug > 0) Info("TTree::Fill","AutoSave called at entry %lld, fZipBytes=%lld, fSavedBytes=%lld\n",fEntries,fZipBytes,fSavedBytes);
-         } else {
-            //We only FlushBaskets
-            FlushBaskets();
-            if (gDebug > 0) Info("TTree::Fill","FlushBasket called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
-         }
-         fFlushedBytes = fZipBytes;         
-      } else if (fNClusterRange == 0 && fEntries > 1 && fAutoFlush && fEntries%fAutoFlush == 0) {
-         if (fAutoSave != 0 && fEntries%fAutoSave == 0) {
-            //We are at an AutoSave point. AutoSave flushes baskets and saves the Tree header
-            AutoSave("flushbaskets");
-            if (gDebug > 0) Info("TTree::Fill","AutoSave called at entry %lld, fZipBytes=%lld, fSavedBytes=%lld\n",fEntries,fZipBytes,fSavedBytes);
-         } else {
-            //We only FlushBaskets
-            FlushBaskets();
-            if (gDebug > 0) Info("TTree::Fill","FlushBasket called at entry %lld, fZipBytes=%lld, fFlushedBytes=%lld\n",fEntries,fZipBytes,fFlushedBytes);
-         }
-         fFlushedBytes = fZipBytes;
-      }
-   }
+   AutoFlushBaskets();
+
    // Check that output file is still below the maximum size.
    // If above, close the current file and continue on a new file.
    // Currently, the automatic change of file is restricted
@@ -4260,6 +4402,125 @@ Int_t TTree::Fill()
    return nbytes;
 }
 
+//______________________________________________________________________________
+Long64_t TTree::FillBulk(Long64_t nentries, void **columns)
+{
+   // Fill nentries entries at once from columnar data.
+   //
+   //   columns must hold one array per branch of the tree, in the order of
+   //   GetListOfBranches(); the array of a branch holds for each entry in
+   //   turn the values of its leaf, e.g. nentries Float_t for a branch
+   //   "x/F" or 3*nentries Int_t for a branch "v[3]/I". The columns of
+   //   disabled branches (see SetBranchStatus) are ignored and may be 0.
+   //
+   //   The tree must only contain branches with a single leaf of a basic
+   //   type and fixed length (see TBranch::CanFillBulk), and must not be
+   //   circular or hold references.
+   //
+   //   The result is the same as calling Fill() nentries times, including
+   //   the automatic flushing of the baskets and saving of the tree header,
+   //   but the values of each branch are copied (and converted to the
+   //   machine independent format) in one pass per basket, without going
+   //   through the branches and leaves for each entry. This is much faster
+   //   when converting large columnar data sets into a tree.
+   //
+   //   The function returns the number of bytes committed to the branches,
+   //   -1 in case of error.
+   //
+   //   Example:
+   //      TTree *t = new TTree("t","t");
+   //      Float_t px; Int_t id;
+   //      t->Branch("px",&px,"px/F");
+   //      t->Branch("id",&id,"id/I");
+   //      std::vector<Float_t> pxs(n); std::vector<Int_t> ids(n);
+   //      ... // fill the vectors
+   //      void *columns[2] = { &pxs[0], &ids[0] };
+   //      t->FillBulk(n, columns);
+
+   if (nentries <= 0) {
+      return 0;
+   }
+   if (fBranchRef || TestBit(kCircular)) {
+      Error("FillBulk", "Tree %s is circular or holds references, it must be filled with Fill", GetName());
+      return -1;
+   }
+
+   Int_t nb = fBranches.GetEntriesFast();
+   Long64_t *entrySize = new Long64_t[nb];
+   for (Int_t i = 0; i < nb; ++i) {
+      TBranch* branch = (TBranch*) fBranches.UncheckedAt(i);
+      entrySize[i] = 0;
+      if (branch->TestBit(kDoNotProcess)) {
+         continue;
+      }
+      if (!branch->CanFillBulk() || !columns[i]) {
+         Error("FillBulk", "Branch %s cannot be filled in bulk", branch->GetName());
+         delete [] entrySize;
+         return -1;
+      }
+      TLeaf *leaf = (TLeaf*) branch->GetListOfLeaves()->UncheckedAt(0);
+      entrySize[i] = leaf->GetLen() * leaf->GetLenType();
+   }
+
+   Long64_t nbytes = 0;
+   Int_t nerror = 0;
+   for (Long64_t done = 0; done < nentries; ) {
+      // Stop at each entry where Fill could flush the baskets or save the
+      // tree header, so that AutoFlushBaskets takes the same decisions.
+      Long64_t n = nentries - done;
+      if (fFlushedBytes == 0) {
+         if (fAutoFlush > 0) n = TMath::Min(n, fAutoFlush - fEntries % fAutoFlush);
+         if (fAutoSave > 0)  n = TMath::Min(n, fAutoSave - fEntries % fAutoSave);
+         if (fAutoFlush < 0 || fAutoSave < 0) {
+            // The number of bytes written (fZipBytes) only changes when a
+            // basket is written: stop at the first entry where one is.
+            for (Int_t i = 0; i < nb; ++i) {
+               TBranch* branch = (TBranch*) fBranches.UncheckedAt(i);
+               if (branch->TestBit(kDoNotProcess)) {
+                  continue;
+               }
+               Long64_t nfull = branch->GetEntriesToWriteBasket();
+               if (nfull > 0) n = TMath::Min(n, nfull);
+            }
+         }
+      } else if (fAutoFlush > 0) {
+         Long64_t start = fNClusterRange ? fClusterRangeEnd[fNClusterRange-1] : 0;
+         n = TMath::Min(n, fAutoFlush - (fEntries - start) % fAutoFlush);
+      }
+
+      for (Int_t i = 0; i < nb; ++i) {
+         TBranch* branch = (TBranch*) fBranches.UncheckedAt(i);
+         if (branch->TestBit(kDoNotProcess)) {
+            continue;
+         }
+         Long64_t nwrite = branch->FillBulk(n, (const char*)columns[i] + done * entrySize[i]);
+         if (nwrite < 0) {
+            Error("FillBulk", "Failed filling branch:%s.%s, entries=%lld-%lld", GetName(), branch->GetName(), fEntries+1, fEntries+n);
+            ++nerror;
+         } else {
+            nbytes += nwrite;
+         }
+      }
+      fEntries += n;
+      done += n;
+
+      AutoFlushBaskets();
+
+      // Same automatic change of file as in Fill.
+      if (fDirectory) {
+         TFile* file = fDirectory->GetFile();
+         if (file && (file->GetEND() > fgMaxTreeSize) && fDirectory == (TDirectory*) file) {
+            ChangeFile(file);
+         }
+      }
+   }
+   delete [] entrySize;
+   if (nerror) {
+      return -1;
+   }
+   return nbytes;
+}
+
 //______________________________________________________________________________
 static TBranch *R__FindBranchHelper(TObjArray *list, const char *branchname) {
    // Search in the array for a branch matching the branch name,
@@ -5009,6 +5270,42 @@ Long64_t TTree::GetEntryNumberWithIndex(Int_t major, Int_t minor) const
    return fTreeIndex->GetEntryNumberWithIndex(major, minor);
 }
 
+//______________________________________________________________________________
+Long64_t TTree::GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries, Long64_t *order) const
+{
+   // Batched version of GetEntryNumberWithIndex.
+   // Fill entries[i] with the entry number corresponding to (major[i],minor[i])
+   // for the n given pairs, -1 for the pairs not in the index.
+   // If minor is 0, all minor numbers are taken to be 0.
+   // If order is not 0, it is filled with the permutation of [0,n) sorting
+   // the pairs by increasing entry number (the pairs not found first).
+   // Return the number of pairs found.
+   //
+   // Reading the entries in this order after registering them with
+   // PrefetchEntries turns the random access of event picking into
+   // sorted, coalesced reads:
+   //
+   //   tree->GetEntryNumbersWithIndex(n, runs, events, entries, order);
+   //   tree->PrefetchEntries(n, entries);
+   //   for (Long64_t i = 0; i < n; ++i) {
+   //      if (entries[order[i]] < 0) continue;
+   //      tree->GetEntry(entries[order[i]]);
+   //      ...
+   //   }
+
+   if (n <= 0 || !entries) return 0;
+   Long64_t nfound = 0;
+   if (fTreeIndex) {
+      nfound = fTreeIndex->GetEntryNumbersWithIndex(n, major, minor, entries);
+   } else {
+      for (Long64_t i = 0; i < n; ++i) entries[i] = -1;
+   }
+   if (order) {
+      TMath::Sort(n, entries, order, kFALSE);
+   }
+   return nfound;
+}
+
 //______________________________________________________________________________
 Int_t TTree::GetEntryWithIndex(Int_t major, Int_t minor)
 {
@@ -5542,6 +5839,12 @@ Long64_t TTree::LoadTree(Long64_t entry)
             TTree* friendTree = fe->GetTree();
             if (friendTree == 0) {
                // Somehow we failed to retrieve the friend TTree.
+            } else if (fe->TestBit(TFriendElement::kAligned)) {
+               // Friend declared aligned (see TFriendElement::SetAligned),
+               // it has the same entry numbers, no need to consult its index.
+               if (friendTree->LoadTree(entry) >= 0) {
+                  friendHasEntry = kTRUE;
+               }
             } else if (friendTree->IsA() == TTree::Class()) {
                // Friend is actually a tree.
                if (friendTree->LoadTreeFriend(entry, this) >= 0) {
@@ -5946,7 +6249,7 @@ Long64_t TTree::Merge(TCollection* li, TFileMergeInfo *info)
    // Returns the total number of entries in the merged tree.
    //
 
-   const char *options = info ? info->fOptions.Data() : "";
+   TString options = info ? info->fOptions.Data() : "";
    if (info && info->fIsFirst && info->fOutputDirectory && info->fOutputDirectory->GetFile() != GetCurrentFile()) {
       TDirectory::TContext ctxt(gDirectory,info->fOutputDirectory);
       TTree *newtree = CloneTree(-1, options);
@@ -5959,6 +6262,8 @@ Long64_t TTree::Merge(TCollection* li, TFileMergeInfo *info)
       info->fOutputDirectory->ReadTObject(this,this->GetName());
    }
    if (!li) return 0;
+   // The access profile only matters when creating the output tree.
+   R__ExtractProfile(options);
    Long64_t storeAutoSave = fAutoSave;
    // Disable the autosave as the TFileMerge keeps a list of key and deleting the underlying
    // key would invalidate its iteration (or require costly measure to not use the deleted keys).
@@ -6104,6 +6409,25 @@ void TTree::OptimizeBaskets(ULong64_t maxMemory, Float_t minComp, Option_t *opti
    }
 }
 
+//______________________________________________________________________________
+Int_t TTree::PrefetchEntries(Long64_t n, const Long64_t *entries)
+{
+   // Register with the TTreeCache the baskets of the cached branches
+   // containing the given entries, so that they are read with a single
+   // sorted vectored read instead of one read per basket
+   // (see TTreeCache::PrefetchEntries).
+   // The entries do not need to be sorted. For a TChain, only the entries
+   // in the current tree are considered; call this function again once
+   // the next tree has been loaded.
+   // Return the number of baskets registered (0 if there is no cache).
+
+   TFile *f = GetCurrentFile();
+   if (!f) return 0;
+   TTreeCache *tc = dynamic_cast<TTreeCache*>(f->GetCacheRead(this));
+   if (!tc) return 0;
+   return tc->PrefetchEntries(n, entries);
+}
+
 //______________________________________________________________________________
 TPrincipal* TTree::Principal(const char* varexp, const char* selection, Option_t* option, Long64_t nentries, Long64_t firstentry)
 {
@@ -7450,11 +7774,23 @@ void TTree::SetCacheSize(Long64_t cacheSize)
 void TTree::SetCacheEntryRange(Long64_t first, Long64_t last)
 {
    //interface to TTreeCache to set the cache entry range
+   //The range is also set in the cache of the aligned friends (see
+   //TFriendElement::SetAligned).
 
    TFile *f = GetCurrentFile();
    if (!f) return;
    TTreeCache *tc = (TTreeCache*)f->GetCacheRead(this);
    if (tc) tc->SetEntryRange(first,last);
+   if (fFriends && !(kSetCacheEntryRange & fFriendLockStatus)) {
+      TFriendLock lock(this, kSetCacheEntryRange);
+      TIter nextf(fFriends);
+      TFriendElement *fe;
+      while ((fe = (TFriendElement*)nextf())) {
+         if (!fe->IsAligned()) continue;
+         TTree *t = fe->GetTree();
+         if (t && t != this) t->SetCacheEntryRange(first,last);
+      }
+   }
 }
 
 //______________________________________________________________________________
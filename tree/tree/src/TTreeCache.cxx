@@ -238,7 +238,10 @@
 #include "TLeaf.h"
 #include "TFriendElement.h"
 #include "TFile.h"
+#include "TMath.h"
 #include <limits.h>
+#include <algorithm>
+#include <vector>
 
 Int_t TTreeCache::fgLearnEntries = 100;
 
@@ -852,6 +855,21 @@ Bool_t TTreeCache::FillBuffer()
       }
    }
    fIsLearning = kFALSE;
+
+   // Fill the caches of the aligned friends for the same cluster, so that
+   // their reads are issued together with ours.
+   if (!fEnablePrefetching && tree->GetListOfFriends()) {
+      TIter nextf(tree->GetListOfFriends());
+      TFriendElement *fe;
+      while ((fe = (TFriendElement*)nextf())) {
+         if (!fe->IsAligned()) continue;
+         TTree *t = fe->GetTree();
+         if (!t || !t->GetCurrentFile()) continue;
+         TTreeCache *tc = dynamic_cast<TTreeCache*>(t->GetCurrentFile()->GetCacheRead(t));
+         if (!tc || tc == this || tc->IsLearning() || !tc->IsEnabled()) continue;
+         tc->FillBuffer();
+      }
+   }
    return kTRUE;
 }
 
@@ -900,6 +918,114 @@ TTree *TTreeCache::GetTree() const
    return ((TBranch*)(fBranches->UncheckedAt(0)))->GetTree();
 }
 
+//_____________________________________________________________________________
+Int_t TTreeCache::PrefetchEntries(Long64_t n, const Long64_t *entries)
+{
+   // Register in the cache the baskets of the cached branches containing
+   // the given entries, in place of the cluster based filling done by
+   // FillBuffer. The entries are numbered as in the owner of the cache
+   // (i.e. in the chain if the cache belongs to a TChain); entries not
+   // in the current tree (and negative values) are ignored.
+   // The baskets are read with a single (sorted) vectored read the first
+   // time one of them is requested.
+   //
+   // The entries are processed in increasing order until the cache is
+   // full; FillBuffer will not refill the cache while the entries read
+   // are between the first and the last entry whose baskets were all
+   // registered. The baskets of the entries that did not fit are read
+   // individually. If not even the baskets of the first entry fit, nothing
+   // is registered and FillBuffer fills the cache as usual.
+   //
+   // If no branch has been added to the cache, all the branches are
+   // added and the learning phase is stopped.
+   // This is not supported (and returns 0) when asynchronous prefetching
+   // is enabled.
+   //
+   // Return the number of baskets registered.
+
+   if (n <= 0 || !entries || fEnablePrefetching) return 0;
+
+   if (fNbranches <= 0) {
+      if (!fTree) return 0;
+      AddBranch("*", kTRUE);
+      if (fNbranches <= 0) return 0;
+   }
+   if (fIsLearning) StopLearningPhase();
+
+   TTree *tree = ((TBranch*)fBranches->UncheckedAt(0))->GetTree();
+   Long64_t chainOffset = 0;
+   if (fTree && fTree->IsA() == TChain::Class()) {
+      TChain *chain = (TChain*)fTree;
+      chainOffset = chain->GetTreeOffset()[chain->GetTreeNumber()];
+   }
+   Long64_t nentries = tree->GetEntries();
+
+   std::vector<Long64_t> local;
+   local.reserve(n);
+   for (Long64_t i = 0; i < n; ++i) {
+      Long64_t entry = entries[i] - chainOffset;
+      if (entries[i] < 0 || entry < 0 || entry >= nentries) continue;
+      local.push_back(entry);
+   }
+   if (local.empty()) return 0;
+   std::sort(local.begin(), local.end());
+   local.erase(std::unique(local.begin(), local.end()), local.end());
+
+   TFileCacheRead::Prefetch(0,0);
+
+   std::vector<Int_t> lastBasket(fNbranches, -1);
+   Int_t nbaskets = 0;
+   Long64_t lastEntry = local.front();
+   Bool_t full = kFALSE;
+   Bool_t complete = kFALSE;
+   for (size_t e = 0; e < local.size() && !full; ++e) {
+      Long64_t entry = local[e];
+      for (Int_t i = 0; i < fNbranches; ++i) {
+         TBranch *b = (TBranch*)fBranches->UncheckedAt(i);
+         if (b->GetDirectory()==0) continue;
+         if (b->GetDirectory()->GetFile() != fFile) continue;
+         Int_t *lbaskets   = b->GetBasketBytes();
+         Long64_t *bentries = b->GetBasketEntry();
+         if (!lbaskets || !bentries) continue;
+         Int_t j = TMath::BinarySearch(b->GetWriteBasket()+1, bentries, entry);
+         if (j < 0 || j == lastBasket[i]) continue;
+         lastBasket[i] = j;
+         // This basket has already been read, skip it
+         if (j < b->GetListOfBaskets()->GetSize() && b->GetListOfBaskets()->UncheckedAt(j)) continue;
+         Long64_t pos = b->GetBasketSeek(j);
+         Int_t len = lbaskets[j];
+         if (pos <= 0 || len <= 0) continue;
+         if (len > fBufferSizeMin) continue;
+         if (fNtot + len > fBufferSizeMin) {
+            full = kTRUE;
+            break;
+         }
+         TFileCacheRead::Prefetch(pos,len);
+         fNReadPref++;
+         nbaskets++;
+      }
+      if (!full) {
+         lastEntry = entry;
+         complete = kTRUE;
+      }
+   }
+
+   if (!complete) {
+      // Not even the first entry fit, let FillBuffer handle it.
+      TFileCacheRead::Prefetch(0,0);
+      fNReadPref -= nbaskets;
+      fEntryNext = -1;
+      return 0;
+   }
+
+   fEntryCurrent = local.front();
+   fEntryNext    = lastEntry + 1;
+   if (gDebug > 0)
+      Info("PrefetchEntries", "registered %d baskets for entries %lld to %lld (%d bytes)",
+           nbaskets, fEntryCurrent, lastEntry, fNtot);
+   return nbaskets;
+}
+
 //_____________________________________________________________________________
 void TTreeCache::Print(Option_t *option) const
 {
@@ -49,6 +49,7 @@
 #include "TChain.h"
 #include "TBranch.h"
 #include "TFile.h"
+#include "TBufferPool.h"
 #include "TEventList.h"
 #include "TVirtualMutex.h"
 #include "TThread.h"
@@ -621,7 +622,7 @@ void TTreeCacheUnzip::ResetCache()
    for (Int_t i = 0; i < fNseekMax; i++) {
       if (fUnzipLen) fUnzipLen[i] = 0;
       if (fUnzipChunks) {
-         if (fUnzipChunks[i]) delete [] fUnzipChunks[i];
+         if (fUnzipChunks[i]) TBufferPool::Release(fUnzipChunks[i]);
          fUnzipChunks[i] = 0;
       }
       if (fUnzipStatus) fUnzipStatus[i] = 0;
@@ -676,7 +677,7 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
    // pos and len are the original values as were passed to ReadBuffer
    // but instead we will return the inflated buffer.
    // Note!! : If *buf == 0 we will allocate the buffer and it will be the
-   // responsability of the caller to free it... it is useful for example
+   // responsability of the caller to free it (with TBufferPool::Release)... it is useful for example
    // to pass it to the creator of TBuffer
    Int_t res = 0;
    Int_t loc = -1;
@@ -768,7 +769,7 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
                   }
                   else {
                      memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-	             delete fUnzipChunks[seekidx];
+                     TBufferPool::Release(fUnzipChunks[seekidx]);
                      fTotalUnzipBytes -= fUnzipLen[seekidx];
                      fUnzipChunks[seekidx] = 0;
                      SendUnzipStartSignal(kFALSE);
@@ -820,7 +821,7 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
                }
                else {
                   memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-                  delete fUnzipChunks[seekidx];
+                  TBufferPool::Release(fUnzipChunks[seekidx]);
                   fTotalUnzipBytes -= fUnzipLen[seekidx];
                   fUnzipChunks[seekidx] = 0;
                   SendUnzipStartSignal(kFALSE);
@@ -932,7 +933,7 @@ Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
    // UNzips a ROOT specific buffer... by reading the header at the beginning.
    // returns the size of the inflated buffer or -1 if error
    // Note!! : If *dest == 0 we will allocate the buffer and it will be the
-   // responsability of the caller to free it... it is useful for example
+   // responsability of the caller to free it (with TBufferPool::Release)... it is useful for example
    // to pass it to the creator of TBuffer
    // src is the original buffer with the record (header+compressed data)
    // *dest is the inflated buffer (including the header)
@@ -954,7 +955,7 @@ Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
          return uzlen;
       }
       Int_t l = keylen+objlen;
-      *dest = new char[l];
+      *dest = TBufferPool::Acquire(l);
       alloc = kTRUE;
    }
    // Must unzip the buffer
@@ -1014,7 +1015,7 @@ Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
          Error("UnzipBuffer", "nbytes = %d, keylen = %d, objlen = %d, noutot = %d, nout=%d, nin=%d, nbuf=%d",
                nbytes,keylen,objlen, noutot,nout,nin,nbuf);
          uzlen = -1;
-         if(alloc) delete [] *dest;
+         if(alloc) TBufferPool::Release(*dest);
          *dest = 0;
          return uzlen;
       }
@@ -1206,7 +1207,7 @@ Int_t TTreeCacheUnzip::UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&lo
          if (gDebug > 0)
             Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
                  IsActiveThread(), fNseek, fIsLearning);
-         delete [] ptr;
+         TBufferPool::Release(ptr);
 
          fUnzipStatus[idxtounzip] = 2; // Set it as not done
          fUnzipChunks[idxtounzip] = 0;
@@ -1219,6 +1220,7 @@ Int_t TTreeCacheUnzip::UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&lo
 
       fUnzipStatus[idxtounzip] = 2; // Set it as done
       fUnzipChunks[idxtounzip] = ptr;
+      ptr = 0; // now owned by fUnzipChunks
       fUnzipLen[idxtounzip] = loclen;
       fTotalUnzipBytes += loclen;
 
@@ -1241,7 +1243,7 @@ Int_t TTreeCacheUnzip::UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&lo
 
    fUnzipDoneCondition->Signal();
 
-   delete [] ptr;
+   TBufferPool::Release(ptr);
    return 0;
 }
 
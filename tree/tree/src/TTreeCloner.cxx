@@ -35,8 +35,65 @@
 #include "TLeafS.h"
 #include "TLeafO.h"
 #include "TLeafC.h"
+#include "TEnv.h"
+#include "TSystem.h"
+#include "TThread.h"
+#include "TMutex.h"
 
 #include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+// Maximum amount of (compressed) data loaded from the input file before
+// the baskets are recompressed and written.
+static const Long64_t kRecompressWindowSize = 64*1024*1024;
+
+// Size above which a basket filled by ReclusterBaskets is written even
+// if the end of the cluster has not been reached.
+static const Int_t kMaxReclusterBasketSize = 256*1024*1024;
+
+struct R__RecompressWork_t {
+   std::vector<TBasket*> *fBaskets;   // baskets of the window
+   std::vector<Int_t>    *fSettings;  // target compression settings of each basket, -1 if not to be recompressed
+   std::vector<Int_t>    *fStatus;    // result of TBasket::Recompress for each basket
+   UInt_t                 fNext;      // next basket to be handled
+   TMutex                 fMutex;     // protects fNext
+};
+
+//______________________________________________________________________________
+static void *R__RecompressLoop(void *arg)
+{
+   // Recompress the baskets of the window until there are none left.
+   // Executed by each of the threads started by WriteBaskets.
+
+   R__RecompressWork_t *work = (R__RecompressWork_t*)arg;
+   while (1) {
+      UInt_t k;
+      {
+         TLockGuard guard(&work->fMutex);
+         k = work->fNext++;
+      }
+      if (k >= work->fBaskets->size()) break;
+      if ((*work->fSettings)[k] >= 0) {
+         (*work->fStatus)[k] = (*work->fBaskets)[k]->Recompress((*work->fSettings)[k]);
+      }
+   }
+   return 0;
+}
+
+//______________________________________________________________________________
+static Int_t R__GetRecompressThreads()
+{
+   // Return the number of threads used to recompress the baskets, as set
+   // by TTreeCloner.RecompressThreads (0, the default, means one per cpu).
+
+   Int_t nthreads = gEnv->GetValue("TTreeCloner.RecompressThreads", 0);
+   if (nthreads <= 0) {
+      SysInfo_t info;
+      nthreads = (gSystem->GetSysInfo(&info) == 0 && info.fCpus > 0) ? info.fCpus : 1;
+   }
+   return nthreads;
+}
 
 //______________________________________________________________________________
 Bool_t TTreeCloner::CompareSeek::operator()(UInt_t i1, UInt_t i2)
@@ -78,7 +135,8 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
    fBasketIndex(new UInt_t[fMaxBaskets]),
    fPidOffset(0),
    fCloneMethod(TTreeCloner::kDefault),
-   fToStartEntries(0)
+   fToStartEntries(0),
+   fClusterSize(0)
 {
    // Constructor.  This object would transfer the data from
    // 'from' to 'to' using the method indicated in method.
@@ -118,9 +176,22 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
    // in which they will be needed when reading the whole tree
    // sequentially.
    //
+   // If 'method' contains "recluster=<bytes>", the baskets are not
+   // copied as is: their entries are appended to the baskets of the
+   // output branches, which are written at each cluster boundary of the
+   // output TTree. The clusters hold about <bytes> compressed bytes and
+   // consecutive small input TTrees are coalesced (see ReclusterBaskets).
+   //
 
    TString opt(method);
    opt.ToLower();
+   Ssiz_t clusterOpt = opt.Index("recluster=");
+   if (clusterOpt != kNPOS) {
+      Long64_t size = 0;
+      if (sscanf(opt.Data() + clusterOpt + 10, "%lld", &size) == 1 && size > 0) {
+         fClusterSize = size;
+      }
+   }
    if (opt.Contains("sortbasketsbybranch")) {
       //::Info("TTreeCloner::TTreeCloner","use: kSortBasketsByBranch");
       fCloneMethod = TTreeCloner::kSortBasketsByBranch;
@@ -177,9 +248,13 @@ Bool_t TTreeCloner::Exec()
    if (!IsValid()) {
       return kFALSE;
    }
-   ImportClusterRanges();
    CopyStreamerInfos();
    CopyProcessIds();
+   if (fClusterSize > 0 && CanRecluster()) {
+      ReclusterBaskets();
+      return kTRUE;
+   }
+   ImportClusterRanges();
    CloseOutWriteBaskets();
    CollectBaskets();
    SortBaskets();
@@ -201,6 +276,95 @@ TTreeCloner::~TTreeCloner()
    delete [] fBasketIndex;
 }
 
+//______________________________________________________________________________
+Long64_t TTreeCloner::AppendEntries(TBasket *basket, TBranch *to, Long64_t clusterStart, Long64_t clusterEntries)
+{
+   // Append the entries of the (uncompressed) input basket to the write
+   // basket of the branch 'to', without unstreaming them. The write basket
+   // is written each time the output branch reaches the end of a cluster.
+   // Return the number of entries appended.
+
+   Int_t nevbuf = basket->GetNevBuf();
+   Int_t *offsets = basket->GetEntryOffset();
+   Int_t *displacement = basket->GetDisplacement();
+   Int_t entrySize = basket->GetNevBufSize(); // Length of each entry when there is no offset table.
+   const char *data = basket->GetBufferRef()->Buffer();
+   // Only entries using the object map need to keep track of the position
+   // they were written at.
+   Bool_t keepPosition = !to->TestBit(TBranch::kDoNotUseBufferMap);
+
+   for (Int_t first = 0; first < nevbuf; ) {
+      TBasket *tobasket = to->GetBasket(to->fWriteBasket);
+      if (!tobasket) {
+         tobasket = fToTree->CreateBasket(to);
+         if (!tobasket) return first;
+         ++to->fNBaskets;
+         to->fBaskets.AddAtAndExpand(tobasket, to->fWriteBasket);
+      }
+      if (tobasket->GetBufferRef()->IsReading()) {
+         tobasket->SetWriteMode();
+      }
+      TBuffer *buf = tobasket->GetBufferRef();
+
+      // Copy in one go the entries up to the end of the current cluster.
+      Long64_t left = clusterEntries - (to->fEntryNumber - clusterStart) % clusterEntries;
+      Int_t n = (Int_t)TMath::Min((Long64_t)(nevbuf - first), left);
+      Int_t begin, end;
+      if (offsets) {
+         begin = offsets[first];
+         end = (first + n < nevbuf) ? offsets[first + n] : basket->GetLast();
+      } else {
+         begin = basket->GetKeylen() + first * entrySize;
+         end = begin + n * entrySize;
+      }
+      Int_t pos = buf->Length();
+      for (Int_t k = first; k < first + n; ++k) {
+         if (offsets) {
+            Int_t offset = pos + offsets[k] - begin;
+            Int_t skipped = offset;
+            if (keepPosition) skipped = displacement ? displacement[k] : offsets[k];
+            tobasket->Update(offset, skipped);
+         } else {
+            tobasket->Update(pos);
+         }
+      }
+      buf->WriteFastArray(data + begin, end - begin);
+      if (!offsets && !tobasket->GetNevBufSize()) {
+         tobasket->SetNevBufSize(entrySize);
+      }
+      to->fEntries += n;
+      to->fEntryNumber += n;
+      first += n;
+
+      if (n == left || buf->Length() >= kMaxReclusterBasketSize) {
+         to->WriteBasket(tobasket, to->fWriteBasket);
+      }
+   }
+   return nevbuf;
+}
+
+//______________________________________________________________________________
+Bool_t TTreeCloner::CanRecluster() const
+{
+   // Return true if the entries of the input baskets can be appended to
+   // the output baskets (see ReclusterBaskets). This is not the case when
+   // the input objects reference TProcessIDs that are renumbered in the
+   // output file, or when the branches do not store their entries in the
+   // same way.
+
+   if (fPidOffset != 0) {
+      return kFALSE;
+   }
+   for (Int_t i = 0; i < fToBranches.GetEntries(); ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to   = (TBranch*)fToBranches.UncheckedAt(i);
+      if ((from->GetEntryOffsetLen() > 0) != (to->GetEntryOffsetLen() > 0)) {
+         return kFALSE;
+      }
+   }
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 void TTreeCloner::CloseOutWriteBaskets()
 {
@@ -590,6 +754,84 @@ void TTreeCloner::ImportClusterRanges()
    fToTree->SetEntries(fToTree->GetEntries() + fFromTree->GetTree()->GetEntries());
 }
 
+//______________________________________________________________________________
+void TTreeCloner::ReclusterBaskets()
+{
+   // Copy the entries of the input TTree by appending them, without
+   // unstreaming them, to the write baskets of the output branches instead
+   // of copying the input baskets as is. The write baskets are compressed
+   // with the settings of the output branches and written each time the
+   // output TTree reaches a cluster boundary, so the baskets of all the
+   // branches are aligned on the clusters. Since the write baskets are
+   // not closed out at the end of an input TTree, consecutive small input
+   // TTrees are coalesced in full size clusters.
+   //
+   // The number of entries per cluster is chosen when the first input
+   // TTree is copied so that a cluster holds about fClusterSize compressed
+   // bytes, and is kept (as the output fAutoFlush) for the next ones.
+
+   Long64_t fromEntries = fFromTree->GetEntries();
+   Long64_t clusterEntries = fToTree->GetAutoFlush();
+   if (fToStartEntries == 0 || clusterEntries <= 0) {
+      // Estimate the compressed size of the input TTree, including the
+      // baskets still held in memory.
+      Long64_t zipBytes = fFromTree->GetZipBytes();
+      Long64_t totBytes = fFromTree->GetTotBytes();
+      Double_t ratio = (zipBytes > 0 && totBytes > 0) ? Double_t(zipBytes) / totBytes : 1;
+      Double_t bytes = zipBytes;
+      for (Int_t i = 0; i < fFromBranches.GetEntries(); ++i) {
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+         TBasket *basket = from->GetListOfBaskets()->GetEntries() ? from->GetBasket(from->GetWriteBasket()) : 0;
+         if (basket) bytes += ratio * (basket->GetLast() - basket->GetKeylen());
+      }
+      clusterEntries = fromEntries;
+      if (bytes > 0 && fromEntries > 0) {
+         clusterEntries = (Long64_t)(fClusterSize / (bytes / fromEntries));
+      }
+      if (clusterEntries < 1) clusterEntries = 1;
+      if (fToStartEntries == 0) {
+         fToTree->fNClusterRange = 0;
+         fToTree->fAutoFlush = clusterEntries;
+      } else {
+         fToTree->SetAutoFlush(clusterEntries);
+      }
+   }
+   Long64_t clusterStart = 0;
+   if (fToTree->fNClusterRange) {
+      clusterStart = fToTree->fClusterRangeEnd[fToTree->fNClusterRange - 1] + 1;
+   }
+
+   for (Int_t i = 0; i < fToBranches.GetEntries(); ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to   = (TBranch*)fToBranches.UncheckedAt(i);
+      if (!from->TestBit(TBranch::kDoNotUseBufferMap)) {
+         to->ResetBit(TBranch::kDoNotUseBufferMap);
+      }
+      Long64_t copied = 0;
+      for (Int_t b = 0; b <= from->GetWriteBasket(); ++b) {
+         Bool_t ondisk = b < from->GetWriteBasket();
+         if (!ondisk && !from->GetListOfBaskets()->GetEntries()) break;
+         TBasket *basket = from->GetBasket(b);
+         if (!basket) {
+            if (ondisk) {
+               Error("ReclusterBaskets", "Could not read basket %d of branch %s from %s",
+                     b, from->GetName(), from->GetFile(0) ? from->GetFile(0)->GetName() : "");
+            }
+            continue;
+         }
+         copied += AppendEntries(basket, to, clusterStart, clusterEntries);
+         if (ondisk) {
+            from->DropBaskets();
+         }
+      }
+      // In older files, if the branch is a TBranchElement non-terminal 'object' branch, it's basket will contain 0
+      // events, in newer file in the same case, the write basket will be missing.
+      if (copied == 0 && from->GetEntries() != 0) {
+         to->SetEntries(to->GetEntries() + from->GetEntries());
+      }
+   }
+}
+
 //______________________________________________________________________________
 void TTreeCloner::SortBaskets()
 {
@@ -620,37 +862,130 @@ void TTreeCloner::SortBaskets()
 void TTreeCloner::WriteBaskets()
 {
    // Transfer the basket from the input file to the output file
+   //
+   // When the compression settings of a branch differ between the input
+   // and the output TTree, its baskets are not copied as is but are
+   // decompressed and compressed again with the settings of the output
+   // branch, without being unstreamed. The baskets are then loaded by
+   // windows of up to 64 MB, recompressed in parallel by
+   // TTreeCloner.RecompressThreads threads (one per cpu by default) and
+   // written in their original order.
+
+   UInt_t nbranches = fToBranches.GetEntries();
+   std::vector<Int_t> branchSettings(nbranches, -1);
+   Bool_t recompress = kFALSE;
+   for (UInt_t i = 0; i < nbranches; ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to   = (TBranch*)fToBranches.UncheckedAt(i);
+      if (from->GetCompressionSettings() != to->GetCompressionSettings()) {
+         branchSettings[i] = to->GetCompressionSettings();
+         recompress = kTRUE;
+      }
+   }
+   Int_t nthreads = recompress ? R__GetRecompressThreads() : 1;
+
+   std::vector<TBasket*> baskets;
+   std::vector<UInt_t> slots;
+   std::vector<Int_t> settings;
+   std::vector<Int_t> status;
+   UInt_t j = 0;
+   while (j < fMaxBaskets) {
+      // Load the next window of on-file baskets. Without recompression,
+      // a window holds a single basket.
+      UInt_t nloaded = 0;
+      Long64_t loadedBytes = 0;
+      slots.clear();
+      settings.clear();
+      for (; j < fMaxBaskets; ++j) {
+         UInt_t bi = fBasketIndex[j];
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TFile *fromfile = from->GetFile(0);
+         Int_t index = fBasketNum[bi];
+         Long64_t pos = from->GetBasketSeek(index);
+         if (pos == 0) {
+            if (nloaded) break;
+            // In memory basket, written below in order.
+            slots.push_back(j);
+            settings.push_back(-1);
+            ++j;
+            break;
+         }
+         if (nloaded && (!recompress || loadedBytes >= kRecompressWindowSize)) break;
 
-   TBasket *basket = new TBasket();
-   for(UInt_t j=0; j<fMaxBaskets; ++j) {
-      TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[ fBasketIndex[j] ] );
-      TBranch *to   = (TBranch*)fToBranches.UncheckedAt( fBasketBranchNum[ fBasketIndex[j] ] );
-
-      TFile *tofile = to->GetFile(0);
-      TFile *fromfile = from->GetFile(0);
-
-      Int_t index = fBasketNum[ fBasketIndex[j] ];
-
-      Long64_t pos = from->GetBasketSeek(index);
-      if (pos!=0) {
+         if (nloaded == baskets.size()) baskets.push_back(new TBasket());
+         TBasket *basket = baskets[nloaded++];
          if (from->GetBasketBytes()[index] == 0) {
             from->GetBasketBytes()[index] = basket->ReadBasketBytes(pos, fromfile);
          }
          Int_t len = from->GetBasketBytes()[index];
-
          basket->LoadBasketBuffers(pos,len,fromfile,fFromTree);
          basket->IncrementPidOffset(fPidOffset);
-         basket->CopyTo(tofile);
-         to->AddBasket(*basket,kTRUE,fToStartEntries + from->GetBasketEntry()[index]);
-      } else {
-         TBasket *frombasket = from->GetBasket( index );
-         if (frombasket && frombasket->GetNevBuf()>0) {
-            TBasket *tobasket = (TBasket*)frombasket->Clone();
-            tobasket->SetBranch(to);
-            to->AddBasket(*tobasket, kFALSE, fToStartEntries+from->GetBasketEntry()[index]);
-            to->FlushOneBasket(to->GetWriteBasket());
+         loadedBytes += len;
+         slots.push_back(j);
+         settings.push_back(branchSettings[ fBasketBranchNum[bi] ]);
+      }
+
+      // Recompress the baskets of the window.
+      if (recompress && nloaded) {
+         std::vector<TBasket*> window(baskets.begin(), baskets.begin() + nloaded);
+         status.assign(nloaded, 0);
+         if (nthreads > 1 && nloaded > 1) {
+            R__RecompressWork_t work;
+            work.fBaskets = &window;
+            work.fSettings = &settings;
+            work.fStatus = &status;
+            work.fNext = 0;
+            Int_t nt = TMath::Min(nthreads, (Int_t)nloaded);
+            std::vector<TThread*> threads;
+            for (Int_t t = 0; t < nt; ++t) {
+               TThread *thread = new TThread("TTreeCloner::Recompress", R__RecompressLoop, &work);
+               thread->Run();
+               threads.push_back(thread);
+            }
+            for (Int_t t = 0; t < nt; ++t) {
+               threads[t]->Join();
+               delete threads[t];
+            }
+         } else {
+            for (UInt_t k = 0; k < nloaded; ++k) {
+               if (settings[k] >= 0) status[k] = window[k]->Recompress(settings[k]);
+            }
+         }
+         // A basket which could not be recompressed is left unchanged and
+         // is copied with the compression of the input.
+         for (UInt_t k = 0; k < nloaded; ++k) {
+            if (!status[k]) continue;
+            UInt_t bi = fBasketIndex[ slots[k] ];
+            TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+            Warning("TTreeCloner::WriteBaskets", "Could not recompress basket %d of branch %s, it is copied with its original compression.",
+                    fBasketNum[bi], from->GetName());
          }
       }
+
+      // Write the window.
+      for (UInt_t k = 0, b = 0; k < slots.size(); ++k) {
+         UInt_t bi = fBasketIndex[ slots[k] ];
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TBranch *to   = (TBranch*)fToBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TFile *tofile = to->GetFile(0);
+         Int_t index = fBasketNum[bi];
+
+         if (from->GetBasketSeek(index) != 0) {
+            TBasket *basket = baskets[b++];
+            basket->CopyTo(tofile);
+            to->AddBasket(*basket,kTRUE,fToStartEntries + from->GetBasketEntry()[index]);
+         } else {
+            TBasket *frombasket = from->GetBasket( index );
+            if (frombasket && frombasket->GetNevBuf()>0) {
+               TBasket *tobasket = (TBasket*)frombasket->Clone();
+               tobasket->SetBranch(to);
+               to->AddBasket(*tobasket, kFALSE, fToStartEntries+from->GetBasketEntry()[index]);
+               to->FlushOneBasket(to->GetWriteBasket());
+            }
+         }
+      }
+   }
+   for (UInt_t k = 0; k < baskets.size(); ++k) {
+      delete baskets[k];
    }
-   delete basket;
 }
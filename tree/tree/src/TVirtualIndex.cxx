@@ -32,3 +32,21 @@ TVirtualIndex::TVirtualIndex(): TNamed()
 TVirtualIndex::~TVirtualIndex()
 {
 }
+
+//______________________________________________________________________________
+Long64_t TVirtualIndex::GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries) const
+{
+   // Fill entries[i] with the entry number corresponding to (major[i],minor[i])
+   // for the n given pairs, -1 for the pairs not in the index.
+   // If minor is 0, all minor numbers are taken to be 0.
+   // Return the number of pairs found.
+   // This default implementation calls GetEntryNumberWithIndex for each pair.
+
+   if (n <= 0 || !major || !entries) return 0;
+   Long64_t nfound = 0;
+   for (Long64_t i = 0; i < n; ++i) {
+      entries[i] = GetEntryNumberWithIndex(major[i], minor ? minor[i] : 0);
+      if (entries[i] >= 0) ++nfound;
+   }
+   return nfound;
+}
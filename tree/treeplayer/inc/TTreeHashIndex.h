@@ -0,0 +1,65 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TTreeHashIndex
+#define ROOT_TTreeHashIndex
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TTreeHashIndex                                                       //
+//                                                                      //
+// A Tree Index with majorname and minorname answering exact lookups    //
+// via an open addressing hash table. The index can be saved to and     //
+// memory mapped from a compact side file.                              //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ROOT_TTreeIndex
+#include "TTreeIndex.h"
+#endif
+
+class TTreeHashIndex : public TTreeIndex {
+
+protected:
+   Long64_t       fNslots;              //! Number of slots in the hash table (power of 2)
+   Long64_t      *fHashTable;           //! [2*fNslots] pairs of (index value, entry number)
+   void          *fMapAddress;          //! Start of the memory mapped side file (if any)
+   Long64_t       fMapSize;             //! Size of the memory mapped side file
+
+   void           BuildHashTable();
+   void           ReleaseHashTable();
+   void           ReleaseMapping();
+
+private:
+   TTreeHashIndex(const TTreeHashIndex&);            // Not implemented.
+   TTreeHashIndex &operator=(const TTreeHashIndex&); // Not implemented.
+
+public:
+   TTreeHashIndex();
+   TTreeHashIndex(const TTree *T, const char *majorname, const char *minorname);
+   TTreeHashIndex(const TTreeIndex *index);
+   virtual               ~TTreeHashIndex();
+   virtual void           Append(const TVirtualIndex *,Bool_t delaySort = kFALSE);
+   virtual Long64_t       GetEntryNumberWithIndex(Int_t major, Int_t minor) const;
+   virtual Long64_t       GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries) const;
+   Long64_t               GetNslots()       const {return fNslots;}
+   Bool_t                 IsMapped()        const {return fMapAddress != 0;}
+   virtual void           Print(Option_t *option="") const;
+   Long64_t               WriteSideFile(const char *filename) const;
+
+   static TTreeHashIndex *Open(const char *filename, const TTree *T = 0);
+
+   ClassDef(TTreeHashIndex,1);  //A Tree Index with O(1) lookup of major and minor name.
+};
+
+#endif
+
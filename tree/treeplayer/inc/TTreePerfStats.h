@@ -27,9 +27,16 @@
 #ifndef ROOT_TString
 #include "TString.h"
 #endif
+#ifndef ROOT_TArrayI
+#include "TArrayI.h"
+#endif
+#ifndef ROOT_TArrayL64
+#include "TArrayL64.h"
+#endif
 
 
 class TBrowser;
+class TExMap;
 class TFile;
 class TTree;
 class TStopwatch;
@@ -37,6 +44,7 @@ class TPaveText;
 class TGraphErrors;
 class TGaxis;
 class TText;
+class TObjArray;
 class TTreePerfStats : public TVirtualPerfStats {
 
 protected:
@@ -62,6 +70,16 @@ protected:
    TStopwatch   *fWatch;         //TStopwatch pointer
    TGaxis       *fRealTimeAxis;  //pointer to TGaxis object showing real-time
    TText        *fHostInfoText;  //Graphics Text object with the fHostInfo data
+   TExMap       *fBasketMap;     //!Map of the basket positions in fMapFile to their branch index+1 (if recording the access profile)
+   TFile        *fMapFile;       //!File of the tree whose baskets are in fBasketMap
+   Int_t         fMapTreeNumber; //!Number in the chain of the tree whose baskets are in fBasketMap
+   TObjArray    *fProfileBranches; //!Names of the branches with baskets of the monitored tree(s)
+   TArrayL64     fBranchBytes;   //!Compressed bytes read per branch
+   TArrayI       fBranchBaskets; //!Number of baskets read per branch
+   Long64_t      fFirstEntryRead;//!First entry read while recording the access profile
+   Long64_t      fLastEntryRead; //!Last entry read while recording the access profile
+
+   void          MapBaskets();
       
 public:
    TTreePerfStats();
@@ -103,6 +121,7 @@ public:
 
    virtual void     SaveAs(const char *filename="",Option_t *option="") const;
    virtual void     SavePrimitive(ostream &out, Option_t *option = "");
+   Bool_t           SaveProfile(const char *filename) const;
    virtual void     SetBytesRead(Long64_t nbytes) {fBytesRead = nbytes;}
    virtual void     SetBytesReadExtra(Long64_t nbytes) {fBytesReadExtra = nbytes;}
    virtual void     SetCompress(Double_t cx) {fCompress = cx;}
@@ -116,6 +135,7 @@ public:
    virtual void     SetNleaves(Int_t nleaves) {fNleaves = nleaves;}
    virtual void     SetReadaheadSize(Int_t nbytes) {fReadaheadSize = nbytes;}
    virtual void     SetReadCalls(Int_t ncalls) {fReadCalls = ncalls;}
+   void             SetRecordProfile(Bool_t record = kTRUE);
    virtual void     SetRealNorm(Double_t rnorm) {fRealNorm = rnorm;}
    virtual void     SetRealTime(Double_t rtime) {fRealTime = rtime;}
    virtual void     SetTreeCacheSize(Int_t nbytes) {fTreeCacheSize = nbytes;}
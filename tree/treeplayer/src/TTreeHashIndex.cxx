@@ -0,0 +1,463 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TTreeHashIndex                                                       //
+//                                                                      //
+// A TTreeIndex variant answering GetEntryNumberWithIndex in constant   //
+// time. In addition to the sorted tables of TTreeIndex (still used by  //
+// GetEntryNumberWithBestIndex) it keeps an open addressing hash table  //
+// of (major<<31)+minor -> entry number.                                //
+//                                                                      //
+// The index can be saved to a compact side file with WriteSideFile     //
+// and re-opened with TTreeHashIndex::Open. On platforms supporting     //
+// mmap the side file is mapped read-only, so that opening the index    //
+// of a large chain costs neither the loop over the entries nor the     //
+// reading of the trees. Example:                                       //
+//                                                                      //
+//   TTreeHashIndex *index = new TTreeHashIndex(chain,"Run","Event");   //
+//   index->WriteSideFile("runevent.idx");                              //
+//   ...                                                                //
+//   TTreeHashIndex *index = TTreeHashIndex::Open("runevent.idx",chain);//
+//   chain->SetTreeIndex(index);                                        //
+//   chain->GetEntryWithIndex(1234,56789);                              //
+//                                                                      //
+// The side file is written in the native byte order and can only be   //
+// opened on a platform with the same endianness.                       //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TTreeHashIndex.h"
+#include "TTree.h"
+#include "TError.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(R__UNIX) || defined(R__MACOSX)
+#define HAVE_MMAP
+#endif
+
+#ifdef HAVE_MMAP
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+ClassImp(TTreeHashIndex)
+
+namespace {
+
+   const char  kSideFileMagic[8] = { 'R','T','H','I','D','X','0','1' };
+   const Int_t kSideFileEndian   = 0x01020304;
+
+   struct SideFileHeader_t {
+      char     fMagic[8];     // kSideFileMagic
+      Int_t    fEndian;       // kSideFileEndian as written by the producer
+      Int_t    fHeaderSize;   // Size of this header plus the padded names
+      Long64_t fN;            // Number of entries in the index
+      Long64_t fNslots;       // Number of slots in the hash table
+      Int_t    fMajorLen;     // Length of the major name (without trailing 0)
+      Int_t    fMinorLen;     // Length of the minor name (without trailing 0)
+   };
+
+   inline Int_t PaddedLength(Int_t len)
+   {
+      // Return len+1 rounded up to a multiple of 8.
+
+      return (len + 1 + 7) & ~7;
+   }
+
+   inline ULong64_t HashValue(Long64_t value)
+   {
+      // Mix the bits of an index value (fmix64 finalizer of MurmurHash3).
+
+      ULong64_t h = (ULong64_t)value;
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+   }
+
+   inline Long64_t FindInTable(const Long64_t *table, Long64_t nslots, Long64_t value)
+   {
+      // Return the entry number stored for value, -1 if not found.
+
+      ULong64_t mask = nslots - 1;
+      ULong64_t slot = HashValue(value) & mask;
+      while (1) {
+         const Long64_t *s = table + 2*slot;
+         if (s[1] < 0) return -1;
+         if (s[0] == value) return s[1];
+         slot = (slot + 1) & mask;
+      }
+      return -1;
+   }
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::TTreeHashIndex() : TTreeIndex()
+{
+   // Default constructor for TTreeHashIndex.
+
+   fNslots     = 0;
+   fHashTable  = 0;
+   fMapAddress = 0;
+   fMapSize    = 0;
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::TTreeHashIndex(const TTree *T, const char *majorname, const char *minorname)
+               : TTreeIndex(T, majorname, minorname)
+{
+   // Normal constructor for TTreeHashIndex.
+   //
+   // The sorted tables are built exactly as in the TTreeIndex constructor,
+   // see there for the meaning of majorname and minorname. The hash table
+   // is built once the sorted tables are available.
+
+   fNslots     = 0;
+   fHashTable  = 0;
+   fMapAddress = 0;
+   fMapSize    = 0;
+   if (IsZombie() || fN <= 0 || !fIndexValues) return;
+   BuildHashTable();
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::TTreeHashIndex(const TTreeIndex *index) : TTreeIndex()
+{
+   // Build a TTreeHashIndex from the tables of an existing TTreeIndex,
+   // for example the one read together with a TTree header.
+   // This avoids looping again over the entries of the tree.
+
+   fNslots     = 0;
+   fHashTable  = 0;
+   fMapAddress = 0;
+   fMapSize    = 0;
+   if (!index) return;
+   fTree      = index->GetTree();
+   fMajorName = index->GetMajorName();
+   fMinorName = index->GetMinorName();
+   fN         = index->GetN();
+   if (fN <= 0 || !index->GetIndexValues()) {
+      fN = 0;
+      return;
+   }
+   fIndexValues = new Long64_t[fN];
+   fIndex       = new Long64_t[fN];
+   memcpy(fIndexValues, index->GetIndexValues(), fN*sizeof(Long64_t));
+   memcpy(fIndex,       index->GetIndex(),       fN*sizeof(Long64_t));
+   BuildHashTable();
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::~TTreeHashIndex()
+{
+   // Destructor.
+
+   if (fMapAddress) {
+      // The tables point into the mapped region, they must not be
+      // deleted by ~TTreeIndex.
+      fIndexValues = 0;
+      fIndex       = 0;
+      fHashTable   = 0;
+#ifdef HAVE_MMAP
+      munmap((char*)fMapAddress, (size_t)fMapSize);
+#endif
+      fMapAddress = 0;
+   }
+   delete [] fHashTable; fHashTable = 0;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Append(const TVirtualIndex *add, Bool_t delaySort)
+{
+   // Append 'add' to this index (see TTreeIndex::Append).
+   // The hash table is rebuilt once the tables are sorted again.
+
+   ReleaseMapping();
+   ReleaseHashTable();
+   TTreeIndex::Append(add, delaySort);
+   if (!delaySort && fN > 0) BuildHashTable();
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::BuildHashTable()
+{
+   // Fill the hash table from the sorted tables fIndexValues/fIndex.
+   // The table has at least twice as many slots as entries, hence the
+   // expected number of probes per lookup stays close to one.
+   // In case of duplicated index values, the first one in the sorted
+   // table is kept.
+
+   ReleaseHashTable();
+   if (fN <= 0 || !fIndexValues) return;
+
+   fNslots = 16;
+   while (fNslots < 2*fN) fNslots <<= 1;
+   fHashTable = new Long64_t[2*fNslots];
+   for (Long64_t s = 0; s < fNslots; ++s) {
+      fHashTable[2*s]   = 0;
+      fHashTable[2*s+1] = -1;
+   }
+
+   ULong64_t mask = fNslots - 1;
+   for (Long64_t i = 0; i < fN; ++i) {
+      Long64_t value = fIndexValues[i];
+      ULong64_t slot = HashValue(value) & mask;
+      while (1) {
+         Long64_t *s = fHashTable + 2*slot;
+         if (s[1] < 0) {
+            s[0] = value;
+            s[1] = fIndex[i];
+            break;
+         }
+         if (s[0] == value) break;
+         slot = (slot + 1) & mask;
+      }
+   }
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::GetEntryNumberWithIndex(Int_t major, Int_t minor) const
+{
+   // Return entry number corresponding to major and minor number,
+   // -1 if the pair is not in the index.
+   // Note that this function returns only the entry number, not the data
+   // To read the data corresponding to an entry number, use TTree::GetEntryWithIndex
+   //
+   // See also GetEntryNumberWithBestIndex
+
+   if (fN == 0) return -1;
+   if (!fHashTable) const_cast<TTreeHashIndex*>(this)->BuildHashTable();
+   if (!fHashTable) return -1;
+   Long64_t value = Long64_t(major)<<31;
+   value += minor;
+   return FindInTable(fHashTable, fNslots, value);
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::GetEntryNumbersWithIndex(Long64_t n, const Int_t *major, const Int_t *minor, Long64_t *entries) const
+{
+   // Fill entries[i] with the entry number corresponding to (major[i],minor[i])
+   // for the n given pairs, -1 for the pairs not in the index.
+   // If minor is 0, all minor numbers are taken to be 0.
+   // Return the number of pairs found.
+
+   if (n <= 0 || !major || !entries) return 0;
+   if (fN > 0 && !fHashTable) const_cast<TTreeHashIndex*>(this)->BuildHashTable();
+   if (!fHashTable) {
+      for (Long64_t i = 0; i < n; ++i) entries[i] = -1;
+      return 0;
+   }
+   Long64_t nfound = 0;
+   for (Long64_t i = 0; i < n; ++i) {
+      Long64_t value = Long64_t(major[i])<<31;
+      if (minor) value += minor[i];
+      entries[i] = FindInTable(fHashTable, fNslots, value);
+      if (entries[i] >= 0) ++nfound;
+   }
+   return nfound;
+}
+
+//______________________________________________________________________________
+TTreeHashIndex *TTreeHashIndex::Open(const char *filename, const TTree *T)
+{
+   // Open an index previously saved with WriteSideFile and attach it to T.
+   // When mmap is available, the file is mapped read-only and the tables
+   // are used in place, otherwise they are read into memory.
+   // Return 0 in case of error.
+
+   if (!filename || !filename[0]) return 0;
+
+   FILE *fp = fopen(filename, "rb");
+   if (!fp) {
+      ::Error("TTreeHashIndex::Open", "cannot open index file %s", filename);
+      return 0;
+   }
+   SideFileHeader_t header;
+   if (fread(&header, sizeof(header), 1, fp) != 1
+       || memcmp(header.fMagic, kSideFileMagic, sizeof(kSideFileMagic)) != 0) {
+      ::Error("TTreeHashIndex::Open", "%s is not a TTreeHashIndex side file", filename);
+      fclose(fp);
+      return 0;
+   }
+   if (header.fEndian != kSideFileEndian) {
+      ::Error("TTreeHashIndex::Open", "%s was written on a platform with a different byte order", filename);
+      fclose(fp);
+      return 0;
+   }
+   if (header.fN < 0 || header.fNslots < 0 || header.fMajorLen < 0 || header.fMinorLen < 0
+       || header.fHeaderSize != (Int_t)sizeof(header) + PaddedLength(header.fMajorLen) + PaddedLength(header.fMinorLen)) {
+      ::Error("TTreeHashIndex::Open", "%s has a corrupted header", filename);
+      fclose(fp);
+      return 0;
+   }
+   // FindInTable relies on a power of two number of slots and on at least
+   // one empty slot to stop probing. An empty index has no table.
+   if ((header.fN == 0 && header.fNslots != 0)
+       || (header.fN > 0 && (header.fNslots <= header.fN || header.fNslots > (kMaxLong64 >> 5)
+                             || (header.fNslots & (header.fNslots - 1)) != 0))) {
+      ::Error("TTreeHashIndex::Open", "%s has a corrupted hash table size (%lld slots for %lld entries)",
+              filename, header.fNslots, header.fN);
+      fclose(fp);
+      return 0;
+   }
+
+   char *majorname = new char[PaddedLength(header.fMajorLen)];
+   char *minorname = new char[PaddedLength(header.fMinorLen)];
+   Bool_t ok = fread(majorname, PaddedLength(header.fMajorLen), 1, fp) == 1
+            && fread(minorname, PaddedLength(header.fMinorLen), 1, fp) == 1;
+   majorname[header.fMajorLen] = 0;
+   minorname[header.fMinorLen] = 0;
+
+   TTreeHashIndex *index = new TTreeHashIndex();
+   index->fMajorName = majorname;
+   index->fMinorName = minorname;
+   index->fN         = header.fN;
+   index->fNslots    = header.fNslots;
+   delete [] majorname;
+   delete [] minorname;
+
+   Long64_t offset = header.fHeaderSize;
+   Long64_t size   = offset + (2*header.fN + 2*header.fNslots)*(Long64_t)sizeof(Long64_t);
+#ifdef HAVE_MMAP
+   struct stat st;
+   if (ok && (fstat(fileno(fp), &st) != 0 || size > (Long64_t)st.st_size)) ok = kFALSE;
+#endif
+   if (ok && header.fN > 0) {
+#ifdef HAVE_MMAP
+      void *addr = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+      if (addr != MAP_FAILED) {
+         index->fMapAddress  = addr;
+         index->fMapSize     = size;
+         Long64_t *tables    = (Long64_t*)((char*)addr + offset);
+         index->fIndexValues = tables;
+         index->fIndex       = tables + header.fN;
+         index->fHashTable   = tables + 2*header.fN;
+      }
+#endif
+      if (!index->fMapAddress) {
+         index->fIndexValues = new Long64_t[header.fN];
+         index->fIndex       = new Long64_t[header.fN];
+         index->fHashTable   = new Long64_t[2*header.fNslots];
+         ok = fread(index->fIndexValues, sizeof(Long64_t), header.fN, fp) == (size_t)header.fN
+           && fread(index->fIndex, sizeof(Long64_t), header.fN, fp) == (size_t)header.fN
+           && fread(index->fHashTable, sizeof(Long64_t), 2*header.fNslots, fp) == (size_t)(2*header.fNslots);
+      }
+   }
+   fclose(fp);
+
+   if (!ok) {
+      ::Error("TTreeHashIndex::Open", "%s is truncated", filename);
+      delete index;
+      return 0;
+   }
+   index->SetTree(T);
+   return index;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Print(Option_t *option) const
+{
+   // Print the hash table occupancy, then the table of TTreeIndex::Print
+   // if the index is attached to a tree.
+
+   Printf("TTreeHashIndex %s,%s: %lld entries in %lld slots%s",
+          fMajorName.Data(), fMinorName.Data(), fN, fNslots,
+          fMapAddress ? " (memory mapped)" : "");
+   if (fTree) TTreeIndex::Print(option);
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::ReleaseHashTable()
+{
+   // Delete the hash table (unless it lives in the mapped side file).
+
+   if (!fMapAddress) delete [] fHashTable;
+   fHashTable = 0;
+   fNslots    = 0;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::ReleaseMapping()
+{
+   // Copy the sorted tables out of the mapped side file and unmap it,
+   // so that they can be modified (for example by Append).
+
+   if (!fMapAddress) return;
+
+   Long64_t *values = new Long64_t[fN];
+   Long64_t *index  = new Long64_t[fN];
+   memcpy(values, fIndexValues, fN*sizeof(Long64_t));
+   memcpy(index,  fIndex,       fN*sizeof(Long64_t));
+   fHashTable = 0;
+   fNslots    = 0;
+#ifdef HAVE_MMAP
+   munmap((char*)fMapAddress, (size_t)fMapSize);
+#endif
+   fMapAddress  = 0;
+   fMapSize     = 0;
+   fIndexValues = values;
+   fIndex       = index;
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::WriteSideFile(const char *filename) const
+{
+   // Save the index (names, sorted tables and hash table) into the side
+   // file 'filename' that can later be opened with TTreeHashIndex::Open.
+   // The tables are stored 8 bytes aligned in the native byte order.
+   // Return the number of bytes written, -1 in case of error.
+
+   if (fN > 0 && !fHashTable) const_cast<TTreeHashIndex*>(this)->BuildHashTable();
+
+   FILE *fp = fopen(filename, "wb");
+   if (!fp) {
+      Error("WriteSideFile", "cannot create index file %s", filename);
+      return -1;
+   }
+
+   SideFileHeader_t header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.fMagic, kSideFileMagic, sizeof(kSideFileMagic));
+   header.fEndian     = kSideFileEndian;
+   header.fN          = fN;
+   header.fNslots     = fNslots;
+   header.fMajorLen   = fMajorName.Length();
+   header.fMinorLen   = fMinorName.Length();
+   header.fHeaderSize = sizeof(header) + PaddedLength(header.fMajorLen) + PaddedLength(header.fMinorLen);
+
+   char *names = new char[header.fHeaderSize - sizeof(header)];
+   memset(names, 0, header.fHeaderSize - sizeof(header));
+   memcpy(names, fMajorName.Data(), header.fMajorLen);
+   memcpy(names + PaddedLength(header.fMajorLen), fMinorName.Data(), header.fMinorLen);
+
+   Bool_t ok = fwrite(&header, sizeof(header), 1, fp) == 1
+            && fwrite(names, header.fHeaderSize - sizeof(header), 1, fp) == 1;
+   delete [] names;
+   if (ok && fN > 0) {
+      ok = fwrite(fIndexValues, sizeof(Long64_t), fN, fp) == (size_t)fN
+        && fwrite(fIndex, sizeof(Long64_t), fN, fp) == (size_t)fN
+        && fwrite(fHashTable, sizeof(Long64_t), 2*fNslots, fp) == (size_t)(2*fNslots);
+   }
+   if (fclose(fp) != 0) ok = kFALSE;
+   if (!ok) {
+      Error("WriteSideFile", "error writing index file %s", filename);
+      return -1;
+   }
+   return header.fHeaderSize + (2*fN + 2*fNslots)*(Long64_t)sizeof(Long64_t);
+}
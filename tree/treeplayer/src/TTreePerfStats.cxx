@@ -76,6 +76,22 @@
 //           number of bytes returned to the application per second.
 //           The Physical disk speed is DiskIO + DiskIO*ReadExtra/100.
 //
+// Access profile
+// ==============
+// With SetRecordProfile(), the object also records which branches are
+// read (number of baskets and compressed bytes per branch) and the range
+// of entries read. SaveProfile writes this access profile to a text file
+// which can be given to TTree::ApplyAccessProfile, to TTree::CloneTree
+// (option "profile=<file>") or to hadd (option -p) to choose
+// the cluster and basket sizes of a new copy of the tree such that the
+// same workload needs as few reads as possible:
+//   TTreePerfStats *ps= new TTreePerfStats("ioperf",T);
+//   ps->SetRecordProfile();
+//   ... // the usual analysis loop
+//   ps->SaveProfile("analysis.prof");
+// then:
+//   hadd -p analysis.prof relayout.root input*.root
+//
 //////////////////////////////////////////////////////////////////////////
 
 
@@ -95,6 +111,12 @@
 #include "TTimeStamp.h"
 #include "TDatime.h"
 #include "TMath.h"
+#include "TExMap.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjString.h"
+
+#include <fstream>
 
 ClassImp(TTreePerfStats)
 
@@ -125,6 +147,12 @@ TTreePerfStats::TTreePerfStats() : TVirtualPerfStats()
    fCompress      = 0;
    fRealTimeAxis  = 0;
    fHostInfoText  = 0;
+   fBasketMap     = 0;
+   fMapFile       = 0;
+   fMapTreeNumber = -1;
+   fProfileBranches = 0;
+   fFirstEntryRead = -1;
+   fLastEntryRead  = -1;
 }
 
 //______________________________________________________________________________
@@ -134,11 +162,11 @@ TTreePerfStats::TTreePerfStats(const char *name, TTree *T) : TVirtualPerfStats()
 
    fName   = name;
    fTree   = T;
-   fNleaves= T->GetListOfLeaves()->GetEntries();
+   fNleaves= T->GetListOfLeaves() ? T->GetListOfLeaves()->GetEntries() : 0;
    fFile   = T->GetCurrentFile();
    fGraphIO  = new TGraphErrors(0);
    fGraphIO->SetName("ioperf");
-   fGraphIO->SetTitle(Form("%s/%s",fFile->GetName(),T->GetName()));
+   fGraphIO->SetTitle(Form("%s/%s",fFile ? fFile->GetName() : "",T->GetName()));
    fGraphIO->SetUniqueID(999999999);
    fGraphTime = new TGraphErrors(0);   
    fGraphTime->SetLineColor(kRed);
@@ -170,6 +198,12 @@ TTreePerfStats::TTreePerfStats(const char *name, TTree *T) : TVirtualPerfStats()
    TDatime dt;
    fHostInfo += TString::Format(" %s",dt.AsString());
    fHostInfoText   = 0;
+   fBasketMap      = 0;
+   fMapFile        = 0;
+   fMapTreeNumber  = -1;
+   fProfileBranches = 0;
+   fFirstEntryRead = -1;
+   fLastEntryRead  = -1;
 
    gPerfStats = this;
 }
@@ -187,6 +221,8 @@ TTreePerfStats::~TTreePerfStats()
    delete fWatch;
    delete fRealTimeAxis;
    delete fHostInfoText;
+   delete fBasketMap;
+   delete fProfileBranches;
 
    if (gPerfStats == this) {
       gPerfStats = 0;
@@ -203,6 +239,49 @@ void TTreePerfStats::Browse(TBrowser * /*b*/)
    gPad->Update();
 }
 
+//______________________________________________________________________________
+void TTreePerfStats::MapBaskets()
+{
+   // Map the positions in the file of the baskets of the tree currently
+   // loaded by the monitored tree or chain to their branch, used to record
+   // the access profile. The branches are identified by their name, so that
+   // the counts of the successive trees of a chain add up. Nothing is
+   // mapped while a chain has not loaded any tree.
+
+   fBasketMap->Delete();
+   fMapFile = 0;
+   fMapTreeNumber = -1;
+   TTree *tree = fTree ? fTree->GetTree() : 0;
+   if (!tree || !tree->GetCurrentFile()) return;
+   fMapFile = tree->GetCurrentFile();
+   fMapTreeNumber = fTree->GetTreeNumber();
+
+   TObjArray *leaves = tree->GetListOfLeaves();
+   Int_t nleaves = leaves->GetEntriesFast();
+   for (Int_t i = 0; i < nleaves; ++i) {
+      TBranch *branch = ((TLeaf*)leaves->UncheckedAt(i))->GetBranch();
+      Int_t nbaskets = branch->GetWriteBasket();
+      if (nbaskets <= 0) continue;
+      // A branch with several leaves is seen once per leaf.
+      Long64_t first = branch->GetBasketSeek(0);
+      if (first && fBasketMap->GetValue(first, first)) continue;
+      TObject *known = fProfileBranches->FindObject(branch->GetName());
+      Int_t index;
+      if (known) {
+         index = fProfileBranches->IndexOf(known);
+      } else {
+         index = fProfileBranches->GetEntriesFast();
+         fProfileBranches->Add(new TObjString(branch->GetName()));
+         fBranchBytes.Set(index+1);
+         fBranchBaskets.Set(index+1);
+      }
+      for (Int_t b = 0; b < nbaskets; ++b) {
+         Long64_t seek = branch->GetBasketSeek(b);
+         if (seek) fBasketMap->Add(seek, seek, index+1);
+      }
+   }
+}
+
 //______________________________________________________________________________
 Int_t TTreePerfStats::DistancetoPrimitive(Int_t px, Int_t py)
 {
@@ -293,7 +372,7 @@ void TTreePerfStats::FileReadEvent(TFile *file, Int_t len, Double_t start)
 
 
 //______________________________________________________________________________
-void TTreePerfStats::FileUnzipEvent(TFile * /* file */, Long64_t /* pos */, Double_t start, Int_t /* complen */, Int_t /* objlen */)
+void TTreePerfStats::FileUnzipEvent(TFile *file, Long64_t pos, Double_t start, Int_t complen, Int_t /* objlen */)
 {
    // Record TTree file unzip event.
    // start is the TimeStamp before unzip
@@ -304,6 +383,25 @@ void TTreePerfStats::FileUnzipEvent(TFile * /* file */, Long64_t /* pos */, Doub
    Double_t tnow = TTimeStamp();
    Double_t dtime = tnow-start;
    fUnzipTime += dtime;
+
+   if (fBasketMap) {
+      // A chain may have loaded its next tree since the baskets were mapped
+      // (its file may even have been allocated where the previous one was).
+      if (!fMapFile || fTree->GetTreeNumber() != fMapTreeNumber) {
+         MapBaskets();
+      }
+      if (file != fMapFile) return;
+      Long64_t index = fBasketMap->GetValue(pos, pos);
+      if (index > 0) {
+         fBranchBytes[index-1] += complen;
+         ++fBranchBaskets[index-1];
+      }
+      Long64_t entry = fTree->GetReadEntry();
+      if (entry >= 0) {
+         if (fFirstEntryRead < 0 || entry < fFirstEntryRead) fFirstEntryRead = entry;
+         if (entry > fLastEntryRead) fLastEntryRead = entry;
+      }
+   }
 }
 
 //______________________________________________________________________________
@@ -466,6 +564,48 @@ void TTreePerfStats::SaveAs(const char *filename, Option_t * /*option*/) const
    ps->TObject::SaveAs(filename);
 }
 
+//______________________________________________________________________________
+Bool_t TTreePerfStats::SaveProfile(const char *filename) const
+{
+   // Write the access profile recorded since SetRecordProfile() was called
+   // to the text file filename. The file lists the branches which were
+   // read, with the number of baskets and of compressed bytes read, the
+   // range of entries read and the TTreeCache size used:
+   //    tree <name>
+   //    entries <number of entries of the tree>
+   //    range <first entry read> <last entry read>
+   //    cachesize <TTreeCache size>
+   //    branch <name> <baskets read> <compressed bytes read>
+   // See TTree::ApplyAccessProfile. Returns kFALSE in case of error.
+
+   if (!fBasketMap) {
+      Error("SaveProfile", "the access profile was not recorded, call SetRecordProfile first");
+      return kFALSE;
+   }
+   std::ofstream out(filename);
+   if (!out) {
+      Error("SaveProfile", "cannot open %s", filename);
+      return kFALSE;
+   }
+   Int_t nbranches = fProfileBranches->GetEntriesFast();
+   Int_t nread = 0;
+   for (Int_t i = 0; i < nbranches; ++i) nread += fBranchBaskets[i];
+   if (!nread) {
+      Warning("SaveProfile", "no basket of %s was read since SetRecordProfile was called", fTree->GetName());
+   }
+   out << "# Access profile written by TTreePerfStats::SaveProfile" << std::endl;
+   out << "tree " << fTree->GetName() << std::endl;
+   out << "entries " << fTree->GetEntries() << std::endl;
+   out << "range " << fFirstEntryRead << " " << fLastEntryRead << std::endl;
+   out << "cachesize " << fTree->GetCacheSize() << std::endl;
+   for (Int_t i = 0; i < nbranches; ++i) {
+      if (!fBranchBaskets[i]) continue;
+      out << "branch " << fProfileBranches->UncheckedAt(i)->GetName() << " "
+          << fBranchBaskets[i] << " " << fBranchBytes[i] << std::endl;
+   }
+   return out.good();
+}
+
 //______________________________________________________________________________
 void TTreePerfStats::SavePrimitive(ostream &out, Option_t *option /*= ""*/)
 {
@@ -521,3 +661,32 @@ void TTreePerfStats::SavePrimitive(ostream &out, Option_t *option /*= ""*/)
 
    out<<"   ps->Draw("<<quote<<option<<quote<<");"<<endl;
 }
+
+//______________________________________________________________________________
+void TTreePerfStats::SetRecordProfile(Bool_t record)
+{
+   // Start recording the access profile: which branches and entries are
+   // read. SetRecordProfile(kFALSE) stops recording and discards it.
+   // The baskets are attributed to their branch when TBasket reports them
+   // (see FileUnzipEvent), whether they are compressed or not. For a chain
+   // the baskets of each tree are mapped when the chain loads it. See
+   // SaveProfile.
+
+   if (record && !fBasketMap && fTree) {
+      fBasketMap = new TExMap();
+      fProfileBranches = new TObjArray();
+      fProfileBranches->SetOwner(kTRUE);
+      MapBaskets();
+   } else if (!record) {
+      delete fBasketMap;
+      fBasketMap = 0;
+      fMapFile = 0;
+      fMapTreeNumber = -1;
+      delete fProfileBranches;
+      fProfileBranches = 0;
+      fBranchBytes.Set(0);
+      fBranchBaskets.Set(0);
+      fFirstEntryRead = -1;
+      fLastEntryRead  = -1;
+   }
+}